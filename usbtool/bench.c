@@ -0,0 +1,683 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+
+#include <zlib.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Benchmarks. Data comes from a fixed seed, so every run moves the same
+//	bytes, and each benchmark keeps the best of a few runs to filter noise.
+//
+//	A baseline file lists one benchmark per line, as written by "bench save":
+//
+//		<name> <value> <unit> <tolerance %>
+//
+//	"bench check" runs the benchmarks listed there and fails if any result
+//	is worse than the baseline by more than its tolerance. Benchmarks that
+//	touch flash only run when named, either explicitly or in the baseline,
+//	so that a plain "bench" is safe on real hardware.
+//
+//	Results depend on the host as much as on the code, so the "reference"
+//	benchmark (plain host work, with nothing of ours in it) runs first, and
+//	when the baseline has it, it also runs once next to every run of the
+//	others. Each baseline is then scaled by how much faster or slower the
+//	reference came out alongside that benchmark: a slower or busy host is
+//	not a regression, and a faster one does not hide one. Its tolerance is
+//	0, it is never checked.
+//
+
+#define BENCH_SEED			0x18002009
+#define BENCH_SIZE			(16 << 20)
+#define BENCH_NOR_SIZE		(256 << 10)
+#define BENCH_DUMP_SIZE		(2 << 20)
+#define BENCH_RUNS			5
+#define BENCH_LOOPS			100000
+#define BENCH_REF_BLOCK		(64 << 10)
+#define BENCH_MAX			32
+
+struct bench_ctx {
+	struct cc1800_session *s;
+	unsigned char *data;
+	unsigned long len;
+	unsigned char *gz;
+	unsigned long gz_len;
+	char tmp [64];
+	int quiet_fd;
+};
+
+struct bench {
+	const char *name;
+	const char *unit;
+	int lower;						// Lower values are better
+	int flash;						// Writes flash, only run when asked for
+	int tolerance;					// Default tolerance for "bench save", in %
+	int (*run) (struct bench_ctx *b, double *value);
+};
+
+//
+//	Silence the chatter of the commands being measured.
+//
+
+static void bench_quiet (struct bench_ctx *b, int on) {
+
+	int fd;
+
+	fflush(stdout);
+
+	if (on) {
+		b->quiet_fd = dup(1);
+		fd = open("/dev/null", O_WRONLY);
+		if (fd >= 0) { dup2(fd, 1); close(fd); }
+	} else if (b->quiet_fd >= 0) {
+		dup2(b->quiet_fd, 1);
+		close(b->quiet_fd);
+		b->quiet_fd = -1;
+	}
+}
+
+//
+//	Half incompressible, half text like, which is roughly what kernels and
+//	root filesystems look like to a compressor.
+//
+
+static void bench_fill (unsigned char *p, unsigned long len, unsigned int seed) {
+
+	static const char words [] = "the usb boot loader reads each block into sram and ";
+	unsigned long i;
+
+	for (i = 0; i < len; i++) {
+		seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+		if ((i >> 12) & 1) p[i] = words[(i + (seed & 3)) % (sizeof(words) - 1)];
+		else p[i] = seed;
+	}
+}
+
+static int bench_file (struct bench_ctx *b, unsigned long len) {
+
+	FILE *f;
+
+	f = fopen(b->tmp, "wb");
+	if (f == NULL || fwrite(b->data, len, 1, f) != 1) {
+		fprintf(stderr, "ERROR: cannot write file '%s'\n", b->tmp);
+		if (f != NULL) fclose(f);
+		return -1;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+//==============================================================================
+
+static int bench_upload (struct bench_ctx *b, double *value) {
+
+	unsigned long off, n = 1 << 20;
+	double t = time_now();
+	int r;
+
+	for (off = 0; off < b->len; off += n) {
+		r = cc1800_upload(b->s->handle, (const char *)b->data + off, n, CC1800_SDRAM_BASE + off);
+		if (r < 0) return r;
+	}
+
+	*value = b->len / (time_now() - t) / 1e6;
+	return 0;
+}
+
+static int bench_download (struct bench_ctx *b, double *value) {
+
+	unsigned long off, n = 1 << 20;
+	char *buf = (char *)malloc(n);
+	double t = time_now();
+	int r = 0;
+
+	if (buf == NULL) return -1;
+
+	for (off = 0; off < b->len && r >= 0; off += n)
+		r = cc1800_download(b->s->handle, buf, n, CC1800_SDRAM_BASE + off);
+
+	*value = b->len / (time_now() - t) / 1e6;
+	free(buf);
+	return r < 0 ? r : 0;
+}
+
+static int bench_latency (struct bench_ctx *b, double *value) {
+
+	char info [8];
+	double t = time_now();
+	int i, r;
+
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		r = cc1800_req_get_cpu_info(b->s->handle, info);
+		if (r < 0) return r;
+	}
+
+	*value = (time_now() - t) / BENCH_LOOPS * 1e6;
+	return 0;
+}
+
+//
+//	Compression on the way down: read +gzip into a file.
+//
+
+static int bench_gzip (struct bench_ctx *b, double *value) {
+
+	const char *stages [] = { "gzip" };
+	double t = time_now();
+	int r;
+
+	bench_quiet(b, 1);
+	r = pipeline_download(b->s, CC1800_SDRAM_BASE, b->len, b->tmp, 1, stages);
+	bench_quiet(b, 0);
+
+	*value = b->len / (time_now() - t) / 1e6;
+	return r;
+}
+
+//
+//	Hex rendering on the way down: read +hex:all into a file.
+//
+
+static int bench_hex (struct bench_ctx *b, double *value) {
+
+	const char *stages [] = { "hex:all" };
+	double t = time_now();
+	int r;
+
+	bench_quiet(b, 1);
+	r = pipeline_download(b->s, CC1800_SDRAM_BASE, b->len, b->tmp, 1, stages);
+	bench_quiet(b, 0);
+
+	*value = b->len / (time_now() - t) / 1e6;
+	return r;
+}
+
+//
+//	Decompression on the way up: write +gunzip, verified.
+//
+
+static int bench_gunzip (struct bench_ctx *b, double *value) {
+
+	const char *stages [] = { "gunzip" };
+	double t = time_now();
+	int r;
+
+	bench_quiet(b, 1);
+	r = pipeline_upload(b->s, CC1800_SDRAM_BASE, "bench", (const char *)b->gz, b->gz_len, 1, stages);
+	bench_quiet(b, 0);
+
+	*value = b->len / (time_now() - t) / 1e6;
+	return r;
+}
+
+static int bench_hash (struct bench_ctx *b, double *value) {
+
+	unsigned char out [8];
+	unsigned long off;
+	double t = time_now();
+
+	for (off = 0; off < b->len; off += 4096) norflash_hash(b->data + off, 4096, out);
+
+	*value = b->len / (time_now() - t) / 1e6;
+	return 0;
+}
+
+static int bench_load (struct bench_ctx *b, double *value) {
+
+	unsigned long len;
+	char *data;
+	double t;
+	int r;
+
+	r = bench_file(b, b->len); if (r < 0) return r;
+
+	t = time_now();
+	bench_quiet(b, 1);
+	r = load_file(b->tmp, &data, &len);
+	bench_quiet(b, 0);
+	if (r < 0) return r;
+
+	*value = len / (time_now() - t) / 1e6;
+	free(data);
+	return 0;
+}
+
+//
+//	Reading an image that is not in the page cache, three ways. The file is
+//	pushed out of the cache with fadvise, which needs no privileges but
+//	does nothing on tmpfs: point TMPDIR at a local disk to see the disk.
+//
+
+static int bench_cold (struct bench_ctx *b, int *fd) {
+
+	int r;
+
+	r = bench_file(b, b->len); if (r < 0) return r;
+
+	*fd = open(b->tmp, O_RDONLY);
+	if (*fd < 0 || fdatasync(*fd) < 0 || posix_fadvise(*fd, 0, 0, POSIX_FADV_DONTNEED) != 0) {
+		fprintf(stderr, "ERROR: cannot drop '%s' from the page cache\n", b->tmp);
+		if (*fd >= 0) close(*fd);
+		return -1;
+	}
+	return 0;
+}
+
+static int bench_cold_fread (struct bench_ctx *b, double *value) {
+
+	char *data;
+	FILE *f;
+	double t;
+	int fd, r;
+
+	r = bench_cold(b, &fd); if (r < 0) return r;
+	data = (char *)malloc(b->len);
+	f = fdopen(fd, "rb");
+
+	t = time_now();
+	r = data != NULL && f != NULL && fread(data, b->len, 1, f) == 1 ? 0 : -1;
+	*value = b->len / (time_now() - t) / 1e6;
+
+	if (f != NULL) fclose(f); else close(fd);
+	free(data);
+	return r;
+}
+
+static int bench_cold_mmap (struct bench_ctx *b, double *value) {
+
+	char *data;
+	void *map;
+	double t;
+	int fd, r;
+
+	r = bench_cold(b, &fd); if (r < 0) return r;
+	data = (char *)malloc(b->len);
+
+	t = time_now();
+	map = mmap(NULL, b->len, PROT_READ, MAP_SHARED, fd, 0);
+	r = data != NULL && map != MAP_FAILED ? 0 : -1;
+	if (r == 0) {
+		madvise(map, b->len, MADV_SEQUENTIAL);
+		memcpy(data, map, b->len);
+	}
+	*value = b->len / (time_now() - t) / 1e6;
+
+	if (map != MAP_FAILED) munmap(map, b->len);
+	close(fd);
+	free(data);
+	return r;
+}
+
+static int bench_cold_uring (struct bench_ctx *b, double *value) {
+
+	struct uring_reader *u;
+	unsigned long len;
+	char *data;
+	double t;
+	int fd, r;
+
+	r = bench_cold(b, &fd); if (r < 0) return r;
+	close(fd);
+	data = (char *)malloc(b->len);
+
+	t = time_now();
+	u = uring_open(b->tmp, &len);
+	r = data != NULL && u != NULL && uring_read(u, data, b->len) == (long)b->len ? 0 : -1;
+	uring_close(u);
+	*value = b->len / (time_now() - t) / 1e6;
+
+	free(data);
+	return r;
+}
+
+static int bench_cache_hit (struct bench_ctx *b, double *value) {
+
+	struct file_cache *fc = file_cache_new();
+	unsigned long len;
+	const char *data;
+	double t;
+	int i, r;
+
+	if (fc == NULL) return -1;
+	r = bench_file(b, 1 << 20);
+
+	bench_quiet(b, 1);
+	if (r >= 0) r = file_cache_load(fc, b->tmp, &data, &len);
+	t = time_now();
+	for (i = 0; i < BENCH_LOOPS && r >= 0; i++) r = file_cache_load(fc, b->tmp, &data, &len);
+	*value = (time_now() - t) / BENCH_LOOPS * 1e6;
+	bench_quiet(b, 0);
+
+	file_cache_free(fc);
+	return r;
+}
+
+//
+//	Host speed: CRC32 over a block that stays in cache, so it is the CPU
+//	and not memory or the TLB (which depend on how the test data landed)
+//	that it measures.
+//
+
+static int bench_reference (struct bench_ctx *b, double *value) {
+
+	double t = time_now();
+	uLong crc = crc32(0, NULL, 0);
+	unsigned long i;
+
+	for (i = 0; i < b->len; i += BENCH_REF_BLOCK) crc = crc32(crc, b->data, BENCH_REF_BLOCK);
+	*value = b->len / (time_now() - t) / 1e6;
+
+	return crc == 0 ? -1 : 0;		// Keeps the CRC from being left out
+}
+
+//
+//	Reflash of an unchanged image: all the time goes to hashing on target.
+//
+
+static int bench_norflash (struct bench_ctx *b, double *value) {
+
+	const char *argv [] = { "0", b->tmp };
+	double t;
+	int r;
+
+	r = bench_file(b, BENCH_NOR_SIZE); if (r < 0) return r;
+
+	bench_quiet(b, 1);
+	r = cc1800_norflash(b->s, 2, argv);
+	t = time_now();
+	if (r >= 0) r = cc1800_norflash(b->s, 2, argv);
+	*value = (time_now() - t) * 1e3;
+	bench_quiet(b, 0);
+
+	return r < 0 ? r : 0;
+}
+
+//
+//	Compressed readback, effective rate: compression on the target (the
+//	interpreter, on the simulator) plus the compressed data over USB.
+//
+
+static int bench_dump_lz4 (struct bench_ctx *b, double *value) {
+
+	struct lz4_opts o;
+	char *buf = (char *)malloc(BENCH_DUMP_SIZE);
+	double t;
+	int r;
+
+	if (buf == NULL) return -1;
+	lz4_defaults(&o);
+
+	r = cc1800_upload(b->s->handle, (const char *)b->data, BENCH_DUMP_SIZE, CC1800_SDRAM_BASE);
+
+	bench_quiet(b, 1);
+	t = time_now();
+	if (r >= 0) r = lz4_download(b->s, buf, BENCH_DUMP_SIZE, CC1800_SDRAM_BASE, &o);
+	*value = BENCH_DUMP_SIZE / (time_now() - t) / 1e6;
+	bench_quiet(b, 0);
+
+	if (r >= 0 && memcmp(buf, b->data, BENCH_DUMP_SIZE)) {
+		fprintf(stderr, "ERROR: compressed readback does not match\n");
+		r = -1;
+	}
+
+	free(buf);
+	return r < 0 ? r : 0;
+}
+
+static const struct bench benches [] = {
+	{ "reference",		"MB/s",	0, 0, 0, bench_reference },
+	{ "upload",			"MB/s",	0, 0, 40, bench_upload },
+	{ "download",		"MB/s",	0, 0, 40, bench_download },
+	{ "dump_lz4",		"MB/s",	0, 0, 25, bench_dump_lz4 },
+	{ "latency",		"us",	1, 0, 40, bench_latency },
+	{ "read_gzip",		"MB/s",	0, 0, 20, bench_gzip },
+	{ "read_hex",		"MB/s",	0, 0, 40, bench_hex },
+	{ "write_gunzip",	"MB/s",	0, 0, 25, bench_gunzip },
+	{ "sector_hash",	"MB/s",	0, 0, 20, bench_hash },
+	{ "load_file",		"MB/s",	0, 0, 45, bench_load },
+	{ "cold_fread",		"MB/s",	0, 0, 50, bench_cold_fread },
+	{ "cold_mmap",		"MB/s",	0, 0, 50, bench_cold_mmap },
+	{ "cold_uring",		"MB/s",	0, 0, 50, bench_cold_uring },
+	{ "file_cache_hit",	"us",	1, 0, 50, bench_cache_hit },
+	{ "norflash_noop",	"ms",	1, 1, 20, bench_norflash },
+	{ NULL }
+};
+
+//==============================================================================
+//
+//	Baselines
+//
+
+struct bench_result {
+	const struct bench *bench;
+	double baseline;				// Negative if none
+	int tolerance;
+	double value;
+};
+
+static const struct bench *bench_find (const char *name) {
+	const struct bench *b;
+	for (b = benches; b->name != NULL; b++) if (!strcmp(b->name, name)) return b;
+	fprintf(stderr, "ERROR: unknown benchmark '%s'\n", name);
+	return NULL;
+}
+
+static int bench_load_baseline (const char *file, struct bench_result *res, int *n) {
+
+	char line [256], name [64], unit [16];
+	double value;
+	int tol, lineno = 0;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: cannot open file '%s'\n", file);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		lineno++;
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == 0) continue;
+		if (sscanf(line, "%63s %lf %15s %d", name, &value, unit, &tol) != 4 || *n == BENCH_MAX) {
+			fprintf(stderr, "ERROR: %s:%d: <name> <value> <unit> <tolerance %%> expected\n", file, lineno);
+			fclose(f);
+			return -1;
+		}
+		res[*n].bench = bench_find(name);
+		if (res[*n].bench == NULL) { fclose(f); return -1; }
+		res[*n].baseline = value;
+		res[*n].tolerance = tol;
+		(*n)++;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static int bench_save (const char *file, struct bench_result *res, int n) {
+
+	FILE *f;
+	int i;
+
+	f = fopen(file, "w");
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: cannot create file '%s'\n", file);
+		return -1;
+	}
+
+	fprintf(f, "# usbtool benchmark baseline, see bench.c\n");
+	fprintf(f, "# name            value      unit  tolerance (%%)\n");
+	for (i = 0; i < n; i++)
+		fprintf(f, "%-16s %10.3f  %-5s %d\n", res[i].bench->name, res[i].value, res[i].bench->unit,
+			res[i].tolerance > 0 ? res[i].tolerance : res[i].bench->tolerance);
+
+	fclose(f);
+	printf("Saved baseline '%s'\n", file);
+	return 0;
+}
+
+//
+//	BENCH command, usage: bench [check|save <baseline>] [<name>...]
+//	Returns the number of arguments used.
+//
+
+int cc1800_bench (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct bench_result res [BENCH_MAX];
+	struct bench_ctx b;
+	const struct bench *be;
+	const char *check = NULL, *save = NULL;
+	struct bench_result tmp;
+	int i, k, n = 0, used = 0, r = 0, failed = 0, fd, scaled = 0;
+	double v, change, scale, base, ref;
+	uLongf gz_len;
+
+	memset(res, 0, sizeof(res));
+
+	if (argc >= 2 && (!strcmp(argv[0], "check") || !strcmp(argv[0], "save"))) {
+		if (argv[0][0] == 'c') check = argv[1]; else save = argv[1];
+		used = 2;
+	}
+
+	if (check != NULL && bench_load_baseline(check, res, &n) < 0) return -1;
+
+	for (; used < argc && n < BENCH_MAX; used++) {
+		for (i = 0; i < n && strcmp(res[i].bench->name, argv[used]); i++);
+		if (i < n) continue;
+		be = bench_find(argv[used]); if (be == NULL) break;
+		res[n].bench = be;
+		res[n++].baseline = -1;
+	}
+
+	if (n == 0) {
+		for (be = benches; be->name != NULL; be++) {
+			if (be->flash) continue;
+			res[n].bench = be;
+			res[n++].baseline = -1;
+		}
+	}
+
+	// The reference goes first, the others are scaled by it
+
+	for (i = 0; i < n && strcmp(res[i].bench->name, "reference"); i++);
+	if (i < n) { tmp = res[i]; res[i] = res[0]; res[0] = tmp; }
+
+	// Test data, and its compressed form for the upload side
+
+	memset(&b, 0, sizeof(b));
+	b.s = s;
+	b.quiet_fd = -1;
+	b.len = BENCH_SIZE;
+	gz_len = compressBound(b.len) + 32;
+	b.data = (unsigned char *)malloc(b.len);
+	b.gz = (unsigned char *)malloc(gz_len);
+	snprintf(b.tmp, sizeof(b.tmp), "%s/usbtool-bench-XXXXXX", getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+	fd = mkstemp(b.tmp);
+
+	if (b.data == NULL || b.gz == NULL || fd < 0) {
+		fprintf(stderr, "ERROR: cannot set up benchmarks\n");
+		r = -1; goto done;
+	}
+	close(fd);
+
+	bench_fill(b.data, b.len, BENCH_SEED);
+
+	{
+		z_stream z;
+		memset(&z, 0, sizeof(z));
+		if (deflateInit2(&z, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) { r = -1; goto done; }
+		z.next_in = b.data; z.avail_in = b.len;
+		z.next_out = b.gz; z.avail_out = gz_len;
+		deflate(&z, Z_FINISH);
+		b.gz_len = z.total_out;
+		deflateEnd(&z);
+	}
+
+	// Run them
+
+	printf("%-16s %13s %13s %8s %6s\n", "benchmark", "baseline", "result", "change", "limit");
+
+	for (i = 0; i < n; i++) {
+
+		be = res[i].bench;
+		ref = 0;
+		for (k = 0; k < BENCH_RUNS; k++) {
+
+			// A reference pass next to each run, host noise comes in
+			// bursts and has to hit both alike
+
+			if (scaled && i > 0 && bench_reference(&b, &v) == 0 && v > ref) ref = v;
+
+			if (s->mem != NULL) mem_cache_invalidate(s->mem);	// Measure the device, not the cache
+			r = be->run(&b, &v);
+			if (r < 0) {
+				fprintf(stderr, "ERROR: benchmark '%s' failed\n", be->name);
+				goto done;
+			}
+			if (k == 0 || (be->lower ? v < res[i].value : v > res[i].value)) res[i].value = v;
+		}
+
+		if (i == 0) {
+			scaled = be->tolerance == 0 && res[0].baseline > 0;
+			ref = res[0].value;
+		}
+		scale = scaled && ref > 0 ? ref / res[0].baseline : 1;
+		base = be->lower ? res[i].baseline / scale : res[i].baseline * scale;
+		if (i == 0) base = res[0].baseline;
+
+		printf("%-16s ", be->name);
+		if (res[i].baseline < 0) printf("%13s ", "-");
+		else printf("%8.2f %-4s ", base, be->unit);
+		printf("%8.2f %-4s ", res[i].value, be->unit);
+
+		if (res[i].baseline <= 0) { printf("\n"); continue; }
+
+		if (be->tolerance == 0) {
+			printf("%+7.1f%%        host speed, baselines scaled by about %.2f\n", (scale - 1) * 100, scale);
+			continue;
+		}
+
+		// Change in the "better" direction is positive
+
+		change = (res[i].value - base) / base * 100;
+		if (be->lower) change = -change;
+		printf("%+7.1f%% %5d%% ", change, -res[i].tolerance);
+
+		if (change < -res[i].tolerance) { printf("REGRESSION\n"); failed++; }
+		else if (change > res[i].tolerance) printf("improved, update the baseline?\n");
+		else printf("ok\n");
+	}
+
+	if (save != NULL) r = bench_save(save, res, n);
+
+	if (failed) {
+		fflush(stdout);
+		fprintf(stderr, "ERROR: %d benchmark%s regressed beyond tolerance\n", failed, failed > 1 ? "s" : "");
+		r = -1;
+	}
+
+done:
+	if (s->mem != NULL) mem_cache_invalidate(s->mem);
+	unlink(b.tmp);
+	free(b.gz);
+	free(b.data);
+
+	return r < 0 ? r : used;
+}
@@ -0,0 +1,163 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Host memory budget. Small station PCs start swapping when a whole image,
+//	its verification copy and the caches are all held at once. With a budget
+//	(the budget command, or CC1800_BUDGET) no single buffer may take more
+//	than a quarter of it: writes and reads of anything bigger are streamed
+//	through the pipeline instead of held whole, pipelines, the file cache
+//	and the mount cache shrink to fit, and the target memory cache is not
+//	kept.
+//
+//	Peak RSS is reset before each command and reported after it, from the
+//	kernel's own high-water mark (VmHWM, reset through clear_refs).
+//
+
+#define BUDGET_SHARE	4				// One buffer takes at most 1/4
+
+static unsigned long budget;			// Bytes, 0 for none
+static int budget_env;					// CC1800_BUDGET looked at
+static const char *budget_cmd;			// Command being measured
+
+//
+//	Sizes are decimal like everywhere else (see scan_size), 64M is 64000000.
+//
+
+static int budget_size (const char *str, unsigned long *v) {
+
+	double d;
+
+	if (scan_size(str, &d) < 0 || d >= (double)~0UL) {
+		fprintf(stderr, "ERROR: bad size '%s'\n", str);
+		return -1;
+	}
+
+	*v = (unsigned long)d;
+	return 0;
+}
+
+unsigned long budget_get (void) {
+	const char *env;
+	if (!budget_env) {
+		budget_env = 1;
+		env = getenv("CC1800_BUDGET");
+		if (env != NULL && *env && budget_size(env, &budget) < 0) budget = 0;
+	}
+	return budget;
+}
+
+//
+//	Whether a buffer of 'len' bytes may be allocated.
+//
+
+int budget_fits (unsigned long len) {
+	return budget_get() == 0 || len <= budget / BUDGET_SHARE;
+}
+
+//
+//	Room for buffers holding 'unit' bytes each, at most 'want' of them and
+//	at least 'least'.
+//
+
+unsigned long budget_count (unsigned long unit, unsigned long want, unsigned long least) {
+	unsigned long n;
+	if (budget_get() == 0) return want;
+	n = budget / BUDGET_SHARE / unit;
+	return n < least ? least : n > want ? want : n;
+}
+
+//
+//	Peak resident set size since the last reset, 0 if unknown.
+//
+
+static unsigned long budget_peak (void) {
+
+	char line [128];
+	unsigned long kb = 0;
+	FILE *f;
+
+	f = fopen("/proc/self/status", "r");
+	if (f == NULL) return 0;
+	while (fgets(line, sizeof(line), f) != NULL)
+		if (sscanf(line, "VmHWM: %lu kB", &kb) == 1) break;
+	fclose(f);
+
+	return kb << 10;
+}
+
+static void budget_reset (void) {
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (f == NULL) return;
+	fputs("5", f);
+	fclose(f);
+}
+
+//
+//	Called before each command with its name, and with NULL after the last
+//	one. Reports the peak of the command before, under a budget.
+//
+
+void budget_command (const char *name) {
+
+	unsigned long peak;
+
+	if (budget_cmd != NULL && budget_get() != 0 && (peak = budget_peak()) != 0)
+		printf("Peak RSS %.1f MB of %.1f MB budget (%s)%s\n", peak / 1e6, budget / 1e6,
+			budget_cmd, peak > budget ? ", OVER BUDGET" : "");
+
+	budget_cmd = name;
+	if (name != NULL) budget_reset();
+}
+
+//
+//	BUDGET command, usage: budget [<size>|off]
+//	Returns the number of arguments used.
+//
+
+int cc1800_budget (struct cc1800_session *s, int argc, const char **argv) {
+
+	unsigned long v;
+
+	budget_get();
+
+	if (argc > 0 && !strcmp(argv[0], "off")) {
+		budget = 0;
+		printf("Memory budget disabled\n");
+		return 1;
+	}
+
+	if (argc > 0 && argv[0][0] >= '0' && argv[0][0] <= '9') {
+		if (budget_size(argv[0], &v) < 0) return -1;
+		budget = v;
+		printf("Memory budget %.1f MB, buffers up to %.1f MB\n", budget / 1e6, budget / BUDGET_SHARE / 1e6);
+
+		// The target memory cache is optional, and grows without bound
+
+		if (s->mem != NULL) {
+			mem_cache_free(s->mem);
+			s->mem = NULL;
+		}
+		return 1;
+	}
+
+	if (budget == 0) printf("No memory budget\n");
+	else printf("Memory budget %.1f MB, buffers up to %.1f MB\n", budget / 1e6, budget / BUDGET_SHARE / 1e6);
+	printf("Peak RSS %.1f MB\n", budget_peak() / 1e6);
+	return 0;
+}
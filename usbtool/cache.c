@@ -0,0 +1,270 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	File cache. Files are kept in memory for as long as the session lives, and
+//	reloaded only when their size, modification time or inode change. Under
+//	a memory budget the cache holds no more than a buffer may take (see
+//	budget.c), and the files used least recently make room for new ones.
+//
+
+struct file_entry {
+	struct file_entry *next;
+	char *name;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	char *data;
+	unsigned long len;
+	unsigned long hits;
+};
+
+struct file_cache {
+	struct file_entry *head;
+};
+
+struct file_cache *file_cache_new (void) {
+	return (struct file_cache *)calloc(1, sizeof(struct file_cache));
+}
+
+static void file_entry_free (struct file_entry *fe) {
+	free(fe->data);
+	free(fe->name);
+	free(fe);
+}
+
+void file_cache_free (struct file_cache *fc) {
+	struct file_entry *fe, *next;
+	if (fc == NULL) return;
+	for (fe = fc->head; fe != NULL; fe = next) {
+		next = fe->next;
+		file_entry_free(fe);
+	}
+	free(fc);
+}
+
+//
+//	Get a file, loading it only if not cached or stale. Data is owned by the
+//	cache and stays valid until the same file is loaded again, two others
+//	are loaded under a budget, or the cache is freed, so the caller must
+//	not free it.
+//
+
+int file_cache_load (struct file_cache *fc, const char *file, const char **data, unsigned long *len) {
+
+	struct file_entry *fe, **pfe;
+	unsigned long total, cap;
+	struct stat st;
+	int r;
+
+	if (stat(file, &st) < 0) {
+		fprintf(stderr, "ERROR: cannot open file '%s'\n", file);
+		return -1;
+	}
+
+	for (pfe = &fc->head; (fe = *pfe) != NULL; pfe = &fe->next) {
+		if (strcmp(fe->name, file)) continue;
+		if (fe->dev == st.st_dev && fe->ino == st.st_ino && fe->size == st.st_size &&
+			fe->mtime.tv_sec == st.st_mtim.tv_sec && fe->mtime.tv_nsec == st.st_mtim.tv_nsec)
+		{
+			*pfe = fe->next;		// Most recently used first
+			fe->next = fc->head;
+			fc->head = fe;
+			fe->hits++;
+			*data = fe->data;
+			*len = fe->len;
+			printf("Cached file '%s' (%lu bytes)\n", file, fe->len);
+			return 0;
+		}
+		*pfe = fe->next;			// Stale, drop it and reload
+		file_entry_free(fe);
+		break;
+	}
+
+	// Make room, always keeping the last file used: a command may still
+	// be holding it while it loads another
+
+	cap = budget_count(1, ~0UL, 0);
+	for (;;) {
+		total = st.st_size;
+		for (pfe = &fc->head; *pfe != NULL; pfe = &(*pfe)->next) total += (*pfe)->len;
+		if (total <= cap || fc->head == NULL || fc->head->next == NULL) break;
+		for (pfe = &fc->head->next; (*pfe)->next != NULL; pfe = &(*pfe)->next);
+		fe = *pfe;
+		*pfe = NULL;
+		printf("Dropped cached file '%s' (%lu bytes)\n", fe->name, fe->len);
+		file_entry_free(fe);
+	}
+
+	fe = (struct file_entry *)calloc(1, sizeof(struct file_entry));
+	if (fe == NULL || (fe->name = strdup(file)) == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		free(fe);
+		return -1;
+	}
+
+	r = load_file(file, &fe->data, &fe->len);
+	if (r < 0) {
+		free(fe->name);
+		free(fe);
+		return r;
+	}
+
+	fe->dev = st.st_dev;
+	fe->ino = st.st_ino;
+	fe->size = st.st_size;
+	fe->mtime = st.st_mtim;
+	fe->next = fc->head;
+	fc->head = fe;
+
+	*data = fe->data;
+	*len = fe->len;
+	return 0;
+}
+
+void file_cache_list (struct file_cache *fc) {
+	struct file_entry *fe;
+	unsigned long total = 0;
+	for (fe = fc->head; fe != NULL; fe = fe->next) {
+		printf("  %10lu  %6lu hits  %s\n", fe->len, fe->hits, fe->name);
+		total += fe->len;
+	}
+	printf("  %10lu bytes total\n", total);
+}
+
+//==============================================================================
+//
+//	Target memory cache. Memory is tracked in fixed size pages, and a page is
+//	only cached once its whole content is known from a verified write or a
+//	read, so a cached read never needs to merge partial data.
+//
+
+#define MEM_PAGE_SHIFT	12
+#define MEM_PAGE_SIZE	(1UL << MEM_PAGE_SHIFT)
+#define MEM_HASH_SIZE	1024
+
+struct mem_page {
+	struct mem_page *next;
+	unsigned long addr;
+	char data [MEM_PAGE_SIZE];
+};
+
+struct mem_cache {
+	struct mem_page *hash [MEM_HASH_SIZE];
+	unsigned long pages;
+	unsigned long hits, misses;
+};
+
+static unsigned mem_hash (unsigned long addr) {
+	return (addr >> MEM_PAGE_SHIFT) & (MEM_HASH_SIZE - 1);
+}
+
+static struct mem_page *mem_page_find (struct mem_cache *mc, unsigned long addr) {
+	struct mem_page *p;
+	for (p = mc->hash[mem_hash(addr)]; p != NULL; p = p->next)
+		if (p->addr == addr) return p;
+	return NULL;
+}
+
+struct mem_cache *mem_cache_new (void) {
+	return (struct mem_cache *)calloc(1, sizeof(struct mem_cache));
+}
+
+void mem_cache_invalidate (struct mem_cache *mc) {
+	struct mem_page *p, *next;
+	int i;
+	for (i = 0; i < MEM_HASH_SIZE; i++) {
+		for (p = mc->hash[i]; p != NULL; p = next) {
+			next = p->next;
+			free(p);
+		}
+		mc->hash[i] = NULL;
+	}
+	mc->pages = 0;
+}
+
+void mem_cache_free (struct mem_cache *mc) {
+	if (mc == NULL) return;
+	mem_cache_invalidate(mc);
+	free(mc);
+}
+
+//
+//	Record known target memory contents. Pages only partially covered are
+//	dropped, since their remaining bytes may no longer match.
+//
+
+void mem_cache_store (struct mem_cache *mc, unsigned long addr, const char *data, unsigned long len) {
+
+	unsigned long a, end = addr + len;
+	struct mem_page *p, **pp;
+
+	for (a = addr & ~(MEM_PAGE_SIZE - 1); a < end; a += MEM_PAGE_SIZE) {
+
+		if (a >= addr && a + MEM_PAGE_SIZE <= end) {
+			p = mem_page_find(mc, a);
+			if (p == NULL) {
+				p = (struct mem_page *)malloc(sizeof(struct mem_page));
+				if (p == NULL) return;		// Caching is best effort
+				p->addr = a;
+				p->next = mc->hash[mem_hash(a)];
+				mc->hash[mem_hash(a)] = p;
+				mc->pages++;
+			}
+			memcpy(p->data, data + (a - addr), MEM_PAGE_SIZE);
+			continue;
+		}
+
+		for (pp = &mc->hash[mem_hash(a)]; (p = *pp) != NULL; pp = &p->next) {
+			if (p->addr != a) continue;
+			*pp = p->next;
+			free(p);
+			mc->pages--;
+			break;
+		}
+	}
+}
+
+//
+//	Fetch memory contents from the cache. Returns 0 if the whole range was
+//	cached, -1 (and leaves data undefined) otherwise.
+//
+
+int mem_cache_fetch (struct mem_cache *mc, unsigned long addr, char *data, unsigned long len) {
+
+	unsigned long a, n, end = addr + len;
+	struct mem_page *p;
+
+	for (a = addr; a < end; a += n) {
+		p = mem_page_find(mc, a & ~(MEM_PAGE_SIZE - 1));
+		if (p == NULL) { mc->misses++; return -1; }
+		n = MEM_PAGE_SIZE - (a & (MEM_PAGE_SIZE - 1));
+		if (n > end - a) n = end - a;
+		memcpy(data + (a - addr), p->data + (a & (MEM_PAGE_SIZE - 1)), n);
+	}
+
+	mc->hits++;
+	return 0;
+}
+
+void mem_cache_stats (struct mem_cache *mc) {
+	printf("  %lu pages (%lu bytes) cached, %lu hits, %lu misses\n",
+		mc->pages, mc->pages * MEM_PAGE_SIZE, mc->hits, mc->misses);
+}
@@ -0,0 +1,764 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <elf.h>
+
+#include "usbtool.h"
+#include "stubs/coverage.h"
+
+//==============================================================================
+//
+//	Coverage of bare-metal tests. The payload is built with --coverage and
+//	-fprofile-info-section (GCC 12 or later), which leaves a table of its
+//	gcov_info objects in a section instead of registering them at startup
+//	for a runtime with file I/O to dump. Everything but the counters is
+//	constant, so it is read from the payload ELF; after the test has run,
+//	a stub finds which blocks of the counter arrays are not all zeros and
+//	only those are read. The .gcda files are written as libgcov would and
+//	merged into any already there, so runs on many boards add up (files
+//	are locked while merged).
+//
+
+#define COV_OP_SCAN			1
+
+#define COV_ARG_COUNT		0
+#define COV_ARG_BLOCK		1
+
+#define COV_MAX_SPANS		64
+#define COV_MAX_BLOCKS		8192
+#define COV_SPANS			(sizeof(coverage_stub) - COV_MAX_SPANS * 8 - COV_MAX_BLOCKS / 8)
+#define COV_BITMAP			(sizeof(coverage_stub) - COV_MAX_BLOCKS / 8)
+
+#define GCOV_DATA_MAGIC		0x67636461		// "gcda"
+#define GCOV_TAG_FUNCTION	0x01000000
+#define GCOV_TAG_COUNTER(t)	(0x01A10000 + ((t) << 17))
+#define GCOV_MAX_COUNTERS	9
+
+// How counters of each kind add up across runs, by index
+
+enum { COV_ADD, COV_IOR, COV_MIN, COV_TOPN };
+
+static const int cov_merge_kind [GCOV_MAX_COUNTERS] = {
+	COV_ADD, COV_ADD, COV_ADD, COV_TOPN, COV_TOPN, COV_ADD, COV_IOR, COV_MIN, COV_IOR
+};
+
+struct cov_elf {
+	const unsigned char *data;
+	unsigned long len;
+	int is64, ptr;
+	unsigned long shoff, shnum, shentsize, shstrndx;
+};
+
+struct cov_ctr {
+	unsigned num;
+	unsigned long addr;
+	unsigned long long *values;
+};
+
+struct cov_fn {
+	int present;					// Not a COMDAT copy owned by another object
+	unsigned ident, lineno, cfg;
+	struct cov_ctr ctr [GCOV_MAX_COUNTERS];
+};
+
+struct cov_obj {
+	char filename [1024];
+	unsigned version, stamp, checksum;
+	int merge [GCOV_MAX_COUNTERS];
+	unsigned nfn;
+	struct cov_fn *fn;
+};
+
+struct cov_span {
+	unsigned long start, end;
+	unsigned char *data;			// Host copy, zeros where not read
+};
+
+//==============================================================================
+//
+//	ELF access, 32 or 64 bit little endian
+//
+
+static unsigned long cov_u32 (const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned long long cov_u64 (const unsigned char *p) {
+	return cov_u32(p) | ((unsigned long long)cov_u32(p + 4) << 32);
+}
+
+static unsigned long cov_word (struct cov_elf *e, const unsigned char *p) {
+	return e->is64 ? (unsigned long)cov_u64(p) : cov_u32(p);
+}
+
+static const unsigned char *cov_shdr (struct cov_elf *e, unsigned long i) {
+	return e->data + e->shoff + i * e->shentsize;
+}
+
+// Section header fields: type, flags, address, offset, size
+
+static void cov_section (struct cov_elf *e, unsigned long i, unsigned long *type, unsigned long *flags,
+	unsigned long *addr, unsigned long *off, unsigned long *size)
+{
+	const unsigned char *sh = cov_shdr(e, i);
+	*type = cov_u32(sh + 4);
+	if (e->is64) { *flags = cov_u64(sh + 8); *addr = cov_u64(sh + 16); *off = cov_u64(sh + 24); *size = cov_u64(sh + 32); }
+	else { *flags = cov_u32(sh + 8); *addr = cov_u32(sh + 12); *off = cov_u32(sh + 16); *size = cov_u32(sh + 20); }
+}
+
+static int cov_elf_open (struct cov_elf *e, const char *file, const unsigned char *data, unsigned long len) {
+
+	unsigned long i, type, flags, addr, off, size;
+
+	memset(e, 0, sizeof(*e));
+	e->data = data;
+	e->len = len;
+
+	if (len < 64 || memcmp(data, ELFMAG, SELFMAG) || data[EI_DATA] != ELFDATA2LSB ||
+		(data[EI_CLASS] != ELFCLASS32 && data[EI_CLASS] != ELFCLASS64))
+	{
+		fprintf(stderr, "ERROR: '%s' is not a little endian ELF file\n", file);
+		return -1;
+	}
+
+	e->is64 = data[EI_CLASS] == ELFCLASS64;
+	e->ptr = e->is64 ? 8 : 4;
+
+	if (e->is64) {
+		e->shoff = cov_u64(data + 0x28);
+		e->shentsize = data[0x3A] | (data[0x3B] << 8);
+		e->shnum = data[0x3C] | (data[0x3D] << 8);
+		e->shstrndx = data[0x3E] | (data[0x3F] << 8);
+	} else {
+		e->shoff = cov_u32(data + 0x20);
+		e->shentsize = data[0x2E] | (data[0x2F] << 8);
+		e->shnum = data[0x30] | (data[0x31] << 8);
+		e->shstrndx = data[0x32] | (data[0x33] << 8);
+	}
+
+	if (e->shentsize < (e->is64 ? 64u : 40u) || e->shoff > len || e->shnum > (len - e->shoff) / e->shentsize || e->shstrndx >= e->shnum) {
+		fprintf(stderr, "ERROR: bad section headers in '%s'\n", file);
+		return -1;
+	}
+
+	for (i = 0; i < e->shnum; i++) {
+		cov_section(e, i, &type, &flags, &addr, &off, &size);
+		if (type != SHT_NOBITS && (off > len || size > len - off)) {
+			fprintf(stderr, "ERROR: section %lu of '%s' is truncated\n", i, file);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int cov_elf_find (struct cov_elf *e, const char *name, unsigned long *addr, unsigned long *size) {
+
+	unsigned long i, type, flags, off, stroff, strsize, n;
+
+	cov_section(e, e->shstrndx, &type, &flags, addr, &stroff, &strsize);
+
+	for (i = 0; i < e->shnum; i++) {
+		n = cov_u32(cov_shdr(e, i));
+		if (n >= strsize || strncmp((const char *)e->data + stroff + n, name, strsize - n)) continue;
+		cov_section(e, i, &type, &flags, addr, &off, size);
+		return 0;
+	}
+
+	return -1;
+}
+
+//
+//	Read what the payload has at an address when loaded.
+//
+
+static int cov_elf_read (struct cov_elf *e, unsigned long addr, void *buf, unsigned long len) {
+
+	unsigned long i, type, flags, a, off, size;
+
+	for (i = 0; i < e->shnum; i++) {
+		cov_section(e, i, &type, &flags, &a, &off, &size);
+		if (!(flags & SHF_ALLOC) || addr < a || addr - a > size || len > size - (addr - a)) continue;
+		if (type == SHT_NOBITS) memset(buf, 0, len);
+		else memcpy(buf, e->data + off + addr - a, len);
+		return 0;
+	}
+
+	fprintf(stderr, "ERROR: nothing at 0x%08lX in the payload\n", addr);
+	return -1;
+}
+
+static int cov_elf_string (struct cov_elf *e, unsigned long addr, char *buf, unsigned long size) {
+	unsigned long i;
+	for (i = 0; i < size; i++) {
+		if (cov_elf_read(e, addr + i, buf + i, 1) < 0) return -1;
+		if (buf[i] == 0) return 0;
+	}
+	fprintf(stderr, "ERROR: string at 0x%08lX is too long\n", addr);
+	return -1;
+}
+
+//==============================================================================
+//
+//	gcov_info and gcov_fn_info, as laid out by GCC 12 and later for the
+//	pointer size of the payload.
+//
+
+static int cov_object (struct cov_elf *e, unsigned long addr, struct cov_obj *o) {
+
+	unsigned char b [32 + 8 * GCOV_MAX_COUNTERS + 16], f [32 + 16 * GCOV_MAX_COUNTERS], p [8];
+	int P = e->ptr, ncounters, major, t, k, off;
+	unsigned long fnaddr, fns;
+	unsigned i;
+
+	memset(o, 0, sizeof(*o));
+
+	// Counter kinds known to the compiler that built it, from its version
+
+	if (cov_elf_read(e, addr, b, 4) < 0) return -1;
+	o->version = cov_u32(b);
+	major = (o->version >> 24) >= 'A' ? ((o->version >> 24) - 'A') * 10 + ((o->version >> 16) & 0xFF) - '0' : 0;
+	if (major < 12) {
+		fprintf(stderr, "ERROR: coverage needs a payload built by GCC 12 or later\n");
+		return -1;
+	}
+	ncounters = major >= 14 ? 9 : 8;
+
+	// version, next, stamp, checksum, filename, merge [], n_functions, functions
+
+	if (cov_elf_read(e, addr, b, 5 * P + 8 + P * ncounters) < 0) return -1;
+	o->stamp = cov_u32(b + 2 * P);
+	o->checksum = cov_u32(b + 2 * P + 4);
+	if (cov_elf_string(e, cov_word(e, b + 2 * P + 8), o->filename, sizeof(o->filename)) < 0) return -1;
+
+	off = 3 * P + 8;
+	for (t = 0; t < ncounters; t++) o->merge[t] = cov_word(e, b + off + t * P) != 0;
+	off += ncounters * P;
+	o->nfn = cov_u32(b + off);
+	fns = cov_word(e, b + off + P);
+
+	for (t = 0; t < ncounters; t++) {
+		if (o->merge[t] && cov_merge_kind[t] == COV_TOPN) {
+			fprintf(stderr, "ERROR: '%s' has value profiling counters, only --coverage is supported\n", o->filename);
+			return -1;
+		}
+	}
+
+	o->fn = (struct cov_fn *)calloc(o->nfn > 0 ? o->nfn : 1, sizeof(struct cov_fn));
+	if (o->fn == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	// key, ident, lineno_checksum, cfg_checksum, then { num, values } for
+	// each kind in use
+
+	for (i = 0; i < o->nfn; i++) {
+
+		if (cov_elf_read(e, fns + i * P, p, P) < 0) return -1;
+		fnaddr = cov_word(e, p);
+		if (fnaddr == 0) continue;
+
+		if (cov_elf_read(e, fnaddr, f, P + 12) < 0) return -1;
+		if (cov_word(e, f) != addr) continue;
+
+		o->fn[i].present = 1;
+		o->fn[i].ident = cov_u32(f + P);
+		o->fn[i].lineno = cov_u32(f + P + 4);
+		o->fn[i].cfg = cov_u32(f + P + 8);
+
+		off = (P + 12 + P - 1) & ~(P - 1);
+		for (t = 0, k = 0; t < ncounters; t++) {
+			if (!o->merge[t]) continue;
+			if (cov_elf_read(e, fnaddr + off + k * 2 * P, f, 2 * P) < 0) return -1;
+			o->fn[i].ctr[t].num = cov_u32(f);
+			o->fn[i].ctr[t].addr = cov_word(e, f + P);
+			k++;
+		}
+	}
+
+	return 0;
+}
+
+//==============================================================================
+//
+//	Counter reading. Counter arrays are gathered into spans, merged when
+//	close enough, and scanned by the stub in as many passes as needed.
+//
+
+static int cov_span_cmp (const void *a, const void *b) {
+	const struct cov_span *x = (const struct cov_span *)a, *y = (const struct cov_span *)b;
+	return x->start < y->start ? -1 : x->start > y->start;
+}
+
+static int cov_read (struct cc1800_session *s, struct cc1800_stub *stub, struct cov_span *spans, int nspans,
+	unsigned long block, unsigned long *fetched, unsigned long *transfers)
+{
+	unsigned char bitmap [COV_MAX_BLOCKS / 8];
+	unsigned long piece [COV_MAX_SPANS][2], blocks, nblocks, result, a, b, i, j;
+	int sp = 0, n, k, r;
+	unsigned long pos = spans[0].start;
+	const struct cc1800_region *reg;
+	struct cov_span *span;
+
+	while (sp < nspans) {
+
+		// Fill the stub table with what fits
+
+		for (n = 0, nblocks = 0; n < COV_MAX_SPANS && nblocks < COV_MAX_BLOCKS && sp < nspans; n++) {
+			blocks = (spans[sp].end - pos + block - 1) / block;
+			if (blocks > COV_MAX_BLOCKS - nblocks) blocks = COV_MAX_BLOCKS - nblocks;
+			piece[n][0] = pos;
+			piece[n][1] = pos + blocks * block < spans[sp].end ? pos + blocks * block : spans[sp].end;
+			stub_set(stub, COV_SPANS + n * 8, piece[n][0]);
+			stub_set(stub, COV_SPANS + n * 8 + 4, piece[n][1]);
+			nblocks += blocks;
+			pos = piece[n][1];
+			if (pos == spans[sp].end && ++sp < nspans) pos = spans[sp].start;
+		}
+
+		stub_set(stub, STUB_PARAM_OP, COV_OP_SCAN);
+		stub_set(stub, STUB_ARG(COV_ARG_COUNT), n);
+		stub_set(stub, STUB_ARG(COV_ARG_BLOCK), block);
+
+		r = stub_run(s, stub, &result);
+		if (r >= 0) r = cc1800_download(s->handle, (char *)bitmap, ((nblocks + 31) / 32) * 4, stub->base + COV_BITMAP);
+		if (r < 0) {
+			fprintf(stderr, "ERROR: cannot scan coverage counters\n");
+			return r;
+		}
+
+		// Read every run of non-zero blocks in one go
+
+		for (k = 0, j = 0; k < n; k++) {
+
+			for (span = spans; span->end < piece[k][1] || span->start > piece[k][0]; span++);
+
+			for (a = piece[k][0]; a < piece[k][1]; ) {
+				i = j + (a - piece[k][0]) / block;
+				if (!(bitmap[i / 8] & (1 << (i % 8)))) { a += block; continue; }
+				for (b = a; b < piece[k][1]; b += block) {
+					i = j + (b - piece[k][0]) / block;
+					if (!(bitmap[i / 8] & (1 << (i % 8)))) break;
+				}
+				if (b > piece[k][1]) b = piece[k][1];
+
+				reg = memmap_check(s, a, b - a, MEM_READ);
+				if (reg == NULL) return -1;
+				r = memmap_download(s, reg, (char *)span->data + a - span->start, b - a, a);
+				if (r < 0) {
+					fprintf(stderr, "ERROR: cannot read coverage counters at 0x%08lX\n", a);
+					return r;
+				}
+				*fetched += b - a;
+				(*transfers)++;
+				a = b;
+			}
+
+			j += (piece[k][1] - piece[k][0] + block - 1) / block;
+		}
+	}
+
+	return 0;
+}
+
+//==============================================================================
+//
+//	.gcda files
+//
+
+struct cov_buf {
+	unsigned char *data;
+	unsigned long len, size;
+};
+
+static int cov_put (struct cov_buf *b, unsigned long v) {
+	unsigned char *p;
+	if (b->len + 4 > b->size) {
+		p = (unsigned char *)realloc(b->data, b->size * 2 + 1024);
+		if (p == NULL) return -1;
+		b->data = p;
+		b->size = b->size * 2 + 1024;
+	}
+	p = b->data + b->len;
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+	b->len += 4;
+	return 0;
+}
+
+//
+//	Walk the previous contents of the file along the new ones. Returns the
+//	old counters for a function and kind, NULL if there were none, or sets
+//	*bad when the file does not match the object.
+//
+
+struct cov_old {
+	const unsigned char *p, *end;
+	int bad;
+};
+
+static unsigned long cov_next (struct cov_old *o) {
+	unsigned long v;
+	if (o->end - o->p < 4) { o->bad = 1; return 0; }
+	v = cov_u32(o->p);
+	o->p += 4;
+	return v;
+}
+
+static const unsigned char *cov_old_counters (struct cov_old *o, int t, unsigned num) {
+	const unsigned char *values;
+	long len;
+	if (cov_next(o) != GCOV_TAG_COUNTER(t)) { o->bad = 1; return NULL; }
+	len = (int)cov_next(o);
+	if ((len < 0 ? -len : len) != 8L * num) { o->bad = 1; return NULL; }
+	if (len <= 0) return NULL;
+	if (o->end - o->p < len) { o->bad = 1; return NULL; }
+	values = o->p;
+	o->p += len;
+	return values;
+}
+
+static void cov_merge (int kind, unsigned long long *v, unsigned long long old) {
+	switch (kind) {
+	case COV_ADD: *v += old; break;
+	case COV_IOR: *v |= old; break;
+	case COV_MIN: if (old != 0 && (*v == 0 || old < *v)) *v = old; break;
+	}
+}
+
+static void cov_encode_fn (struct cov_obj *o, struct cov_fn *fn, struct cov_old *prev, struct cov_buf *b, int *r) {
+
+	const unsigned char *ov;
+	unsigned long long v;
+	unsigned j, zero;
+	int t;
+
+	*r |= cov_put(b, GCOV_TAG_FUNCTION);
+	*r |= cov_put(b, fn->present ? 12 : 0);
+
+	if (prev != NULL && (cov_next(prev) != GCOV_TAG_FUNCTION || cov_next(prev) != (fn->present ? 12u : 0u))) prev->bad = 1;
+	if (!fn->present) return;
+
+	*r |= cov_put(b, fn->ident);
+	*r |= cov_put(b, fn->lineno);
+	*r |= cov_put(b, fn->cfg);
+
+	if (prev != NULL && (cov_next(prev) != fn->ident || cov_next(prev) != fn->lineno || cov_next(prev) != fn->cfg)) prev->bad = 1;
+
+	for (t = 0; t < GCOV_MAX_COUNTERS; t++) {
+
+		if (!o->merge[t]) continue;
+
+		ov = prev != NULL && !prev->bad ? cov_old_counters(prev, t, fn->ctr[t].num) : NULL;
+		if (ov != NULL && !prev->bad)
+			for (j = 0; j < fn->ctr[t].num; j++) cov_merge(cov_merge_kind[t], &fn->ctr[t].values[j], cov_u64(ov + j * 8));
+
+		// Like libgcov, all zeros is written as a negative length alone
+
+		for (j = 0, zero = 1; j < fn->ctr[t].num && zero; j++) zero = fn->ctr[t].values[j] == 0;
+
+		*r |= cov_put(b, GCOV_TAG_COUNTER(t));
+		*r |= cov_put(b, (zero ? -8UL : 8UL) * fn->ctr[t].num);
+
+		for (j = 0; j < fn->ctr[t].num && !zero; j++) {
+			v = fn->ctr[t].values[j];
+			*r |= cov_put(b, v & 0xFFFFFFFF);
+			*r |= cov_put(b, v >> 32);
+		}
+	}
+}
+
+//
+//	Encode an object, merged with the previous contents of its file if they
+//	are from the same build. Sets *merged accordingly.
+//
+
+static int cov_encode (struct cov_obj *o, const unsigned char *old, unsigned long oldlen, struct cov_buf *b, int *merged) {
+
+	struct cov_old prev = { old, old + oldlen, 0 };
+	struct cov_ctr *c;
+	unsigned i;
+	int t, r = 0;
+
+	*merged = 0;
+
+	if (oldlen > 0) {
+
+		if (cov_next(&prev) != GCOV_DATA_MAGIC || cov_next(&prev) != o->version ||
+			cov_next(&prev) != o->stamp || cov_next(&prev) != o->checksum) prev.bad = 1;
+
+		for (i = 0; i < o->nfn && !prev.bad; i++) cov_encode_fn(o, &o->fn[i], &prev, b, &r);
+		if (!prev.bad && (cov_next(&prev) != 0 || prev.p != prev.end)) prev.bad = 1;
+
+		if (!prev.bad) *merged = 1;
+		else {
+			fprintf(stderr, "WARNING: '%s' is from a different build, overwriting it\n", o->filename);
+
+			// Back to the values read from the target
+
+			for (i = 0; i < o->nfn; i++) {
+				for (t = 0; t < GCOV_MAX_COUNTERS; t++) {
+					c = &o->fn[i].ctr[t];
+					if (c->num > 0) memcpy(c->values, c->values + c->num, c->num * sizeof(*c->values));
+				}
+			}
+		}
+	}
+
+	b->len = 0;
+	r |= cov_put(b, GCOV_DATA_MAGIC);
+	r |= cov_put(b, o->version);
+	r |= cov_put(b, o->stamp);
+	r |= cov_put(b, o->checksum);
+	for (i = 0; i < o->nfn; i++) cov_encode_fn(o, &o->fn[i], NULL, b, &r);
+	r |= cov_put(b, 0);
+
+	if (r) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int cov_mkdirs (char *path) {
+	char *p;
+	for (p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+		*p = 0;
+		if (mkdir(path, 0777) < 0 && errno != EEXIST) {
+			fprintf(stderr, "ERROR: cannot create directory '%s'\n", path);
+			*p = '/';
+			return -1;
+		}
+		*p = '/';
+	}
+	return 0;
+}
+
+//
+//	Write or merge the .gcda file of an object. Like libgcov, the name is
+//	the one the object was compiled with, with 'strip' leading directories
+//	removed and 'prefix' put in front.
+//
+
+static int cov_write (struct cov_obj *o, const char *prefix, int strip, int *merged) {
+
+	struct cov_buf b = { NULL, 0, 0 };
+	unsigned char *old = NULL;
+	const char *name = o->filename;
+	char path [2048];
+	struct stat st;
+	int fd, r = -1, i;
+
+	for (i = 0; i < strip; i++) {
+		const char *q = strchr(name + 1, '/');
+		if (q == NULL) break;
+		name = q;
+	}
+
+	snprintf(path, sizeof(path), "%s%s%s", prefix != NULL ? prefix : "",
+		prefix != NULL && name[0] != '/' ? "/" : "", name);
+	if (cov_mkdirs(path) < 0) return -1;
+
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0 || flock(fd, LOCK_EX) < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "ERROR: cannot open '%s'\n", path);
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+
+	if (st.st_size > 0) {
+		old = (unsigned char *)malloc(st.st_size);
+		if (old == NULL || pread(fd, old, st.st_size, 0) != st.st_size) {
+			fprintf(stderr, "ERROR: cannot read '%s'\n", path);
+			goto done;
+		}
+	}
+
+	if (cov_encode(o, old, st.st_size, &b, merged) < 0) goto done;
+
+	if (pwrite(fd, b.data, b.len, 0) != (ssize_t)b.len || ftruncate(fd, b.len) < 0) {
+		fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+		goto done;
+	}
+
+	r = 0;
+
+done:
+	close(fd);			// Also releases the lock
+	free(old);
+	free(b.data);
+	return r;
+}
+
+//==============================================================================
+//
+//	COVERAGE command, usage: coverage <elf> [prefix=<dir>] [strip=<n>]
+//	[section=<name>] [block=<size>] [stub=<address>]. Returns the number
+//	of arguments used.
+//
+
+int cc1800_coverage (struct cc1800_session *s, int argc, const char **argv) {
+
+	const char *prefix = getenv("GCOV_PREFIX"), *section = ".gcov_info", *data;
+	unsigned long len, addr, size, block = 256, base = CC1800_STUB_BASE, v, fetched = 0, transfers = 0, total = 0;
+	int n, r = -1, i, t, strip = 0, nobjs = 0, nspans = 0, m;
+	struct cov_obj *objs = NULL;
+	struct cov_span *spans = NULL;
+	struct cc1800_stub stub;
+	unsigned char p [8];
+	struct cov_elf e;
+	struct cov_ctr *c;
+	unsigned j;
+	char *buf = NULL;
+
+	if (argc < 1) {
+		fprintf(stderr, "ERROR: coverage command requires the payload ELF file\n");
+		return -1;
+	}
+
+	if (getenv("GCOV_PREFIX_STRIP") != NULL) strip = atoi(getenv("GCOV_PREFIX_STRIP"));
+
+	for (n = 1; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		if (!strncmp(argv[n], "prefix=", 7)) prefix = argv[n] + 7;
+		else if (!strncmp(argv[n], "strip=", 6)) strip = atoi(argv[n] + 6);
+		else if (!strncmp(argv[n], "section=", 8)) section = argv[n] + 8;
+		else if (!strncmp(argv[n], "block=", 6)) { if (scan_ulong(argv[n] + 6, &block) < 0) return -1; }
+		else if (!strncmp(argv[n], "stub=", 5)) { if (scan_ulong(argv[n] + 5, &base) < 0) return -1; }
+		else {
+			fprintf(stderr, "ERROR: unknown coverage option '%s'\n", argv[n]);
+			return -1;
+		}
+	}
+
+	if (block < 4 || block & 3) {
+		fprintf(stderr, "ERROR: block size must be a multiple of 4\n");
+		return -1;
+	}
+
+	if (s->files != NULL) r = file_cache_load(s->files, argv[0], &data, &len);
+	else { r = load_file(argv[0], &buf, &len); data = buf; }
+	if (r < 0) return r;
+	r = -1;
+
+	if (cov_elf_open(&e, argv[0], (const unsigned char *)data, len) < 0) goto done;
+
+	if (cov_elf_find(&e, section, &addr, &size) < 0) {
+		fprintf(stderr, "ERROR: no %s section in '%s', build with -fprofile-info-section\n", section, argv[0]);
+		goto done;
+	}
+
+	// Objects and their counters
+
+	objs = (struct cov_obj *)calloc(size / e.ptr + 1, sizeof(struct cov_obj));
+	if (objs == NULL) goto nomem;
+
+	for (nobjs = 0; nobjs < (int)(size / e.ptr); nobjs++) {
+		if (cov_elf_read(&e, addr + nobjs * e.ptr, p, e.ptr) < 0) goto done;
+		if (cov_object(&e, cov_word(&e, p), &objs[nobjs]) < 0) { nobjs++; goto done; }
+		for (j = 0; j < objs[nobjs].nfn; j++)
+			for (t = 0; t < GCOV_MAX_COUNTERS; t++)
+				if (objs[nobjs].fn[j].ctr[t].num > 0) nspans++;
+	}
+
+	if (nspans == 0) {
+		printf("No coverage counters in '%s'\n", argv[0]);
+		r = 0; goto done;
+	}
+
+	spans = (struct cov_span *)calloc(nspans, sizeof(struct cov_span));
+	if (spans == NULL) goto nomem;
+
+	for (i = 0, nspans = 0; i < nobjs; i++)
+		for (j = 0; j < objs[i].nfn; j++)
+			for (t = 0; t < GCOV_MAX_COUNTERS; t++) {
+				c = &objs[i].fn[j].ctr[t];
+				if (c->num == 0) continue;
+				spans[nspans].start = c->addr & ~3UL;
+				spans[nspans].end = (c->addr + c->num * 8 + 3) & ~3UL;
+				nspans++;
+			}
+
+	qsort(spans, nspans, sizeof(struct cov_span), cov_span_cmp);
+
+	for (i = 1, m = 0; i < nspans; i++) {
+		if (spans[i].start <= spans[m].end + block) {
+			if (spans[i].end > spans[m].end) spans[m].end = spans[i].end;
+		}
+		else spans[++m] = spans[i];
+	}
+	nspans = m + 1;
+
+	for (i = 0; i < nspans; i++) {
+		total += spans[i].end - spans[i].start;
+		spans[i].data = (unsigned char *)calloc(1, spans[i].end - spans[i].start);
+		if (spans[i].data == NULL) goto nomem;
+	}
+
+	// Scan and read
+
+	if (memmap_check(s, base, sizeof(coverage_stub), MEM_WRITE | MEM_EXEC) == NULL) goto done;
+	if (stub_init(s, &stub, coverage_stub, sizeof(coverage_stub), base) < 0) goto done;
+	r = cov_read(s, &stub, spans, nspans, block, &fetched, &transfers);
+	stub_free(&stub);
+	if (r < 0) goto done;
+	r = -1;
+
+	// Values, with room for a copy in case merging has to be undone
+
+	for (i = 0; i < nobjs; i++) {
+		for (j = 0; j < objs[i].nfn; j++) {
+			for (t = 0; t < GCOV_MAX_COUNTERS; t++) {
+				c = &objs[i].fn[j].ctr[t];
+				if (c->num == 0) continue;
+				c->values = (unsigned long long *)malloc(2 * c->num * sizeof(*c->values));
+				if (c->values == NULL) goto nomem;
+				for (m = 0; spans[m].end <= c->addr; m++);
+				for (v = 0; v < c->num; v++) c->values[v] = cov_u64(spans[m].data + c->addr - spans[m].start + v * 8);
+				memcpy(c->values + c->num, c->values, c->num * sizeof(*c->values));
+			}
+		}
+	}
+
+	for (i = 0, m = 0; i < nobjs; i++) {
+		if (cov_write(&objs[i], prefix, strip, &t) < 0) goto done;
+		m += t;
+	}
+
+	printf("%d objects, %lu bytes of counters, %lu read in %lu transfers, %d files merged\n",
+		nobjs, total, fetched, transfers, m);
+	r = 0;
+	goto done;
+
+nomem:
+	fprintf(stderr, "ERROR: cannot allocate memory\n");
+
+done:
+	for (i = 0; i < nobjs; i++) {
+		if (objs[i].fn != NULL)
+			for (j = 0; j < objs[i].nfn; j++)
+				for (t = 0; t < GCOV_MAX_COUNTERS; t++) free(objs[i].fn[j].ctr[t].values);
+		free(objs[i].fn);
+	}
+	for (i = 0; i < nspans && spans != NULL; i++) free(spans[i].data);
+	free(spans);
+	free(objs);
+	free(buf);
+	return r < 0 ? r : n;
+}
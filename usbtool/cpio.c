@@ -0,0 +1,374 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/sysmacros.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Initramfs archives. Writing a directory uploads a newc cpio archive of it,
+//	as the kernel wants for an initramfs, generated while it is being sent
+//	(and through any stages given, +gzip typically) instead of built first.
+//
+//	Entries are in name order and owned by root, so the same tree always
+//	makes the same archive. What gets uploaded is also kept in the cache
+//	directory, together with a hash of the tree metadata (names, types,
+//	sizes, modification times and inodes) and the stages, and reused as is
+//	while neither changes.
+//
+
+#define CPIO_HEADER		110
+
+struct cpio_entry {
+	char *name;						// Archive name, relative to the tree
+	char *path;						// Host path
+	struct stat st;
+	char *link;						// Symbolic link target
+};
+
+struct cpio {
+	const char *dir;
+	struct cpio_entry *e;
+	int n, size;
+	unsigned long long hash;
+	int cur;						// Entry being output, n is the trailer
+	FILE *f;
+	unsigned long dpos, dlen;		// Entry data output so far and size
+	char head [3 + CPIO_HEADER + PATH_MAX + 4];
+	int hpos, hlen;					// Padding, header and name not output yet
+	unsigned long total;
+};
+
+static unsigned long long cpio_fnv (unsigned long long h, const void *data, unsigned long len) {
+	const unsigned char *p = (const unsigned char *)data;
+	while (len--) h = (h ^ *p++) * 0x100000001B3ULL;
+	return h;
+}
+
+static int cpio_namecmp (const void *a, const void *b) {
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+//
+//	Walk the tree, collecting entries with their metadata in archive order.
+//
+
+static int cpio_add (struct cpio *c, const char *path, const char *name) {
+
+	struct cpio_entry *e;
+	char link [PATH_MAX];
+	long n;
+
+	if (c->n == c->size) {
+		c->size = c->size ? c->size * 2 : 256;
+		e = (struct cpio_entry *)realloc(c->e, c->size * sizeof(*e));
+		if (e == NULL) return -1;
+		c->e = e;
+	}
+
+	e = &c->e[c->n];
+	memset(e, 0, sizeof(*e));
+
+	if (lstat(path, &e->st) < 0) {
+		fprintf(stderr, "ERROR: cannot stat '%s'\n", path);
+		return -1;
+	}
+
+	if (strlen(name) >= PATH_MAX) {
+		fprintf(stderr, "ERROR: name too long '%s'\n", path);
+		return -1;
+	}
+
+	if (S_ISLNK(e->st.st_mode)) {
+		n = readlink(path, link, sizeof(link) - 1);
+		if (n < 0) {
+			fprintf(stderr, "ERROR: cannot read link '%s'\n", path);
+			return -1;
+		}
+		link[n] = 0;
+		e->link = strdup(link);
+		e->st.st_size = n;
+	} else if (!S_ISREG(e->st.st_mode)) e->st.st_size = 0;
+
+	e->name = strdup(name);
+	e->path = strdup(path);
+	if (e->name == NULL || e->path == NULL || (S_ISLNK(e->st.st_mode) && e->link == NULL)) return -1;
+	c->n++;
+
+	c->hash = cpio_fnv(c->hash, name, strlen(name) + 1);
+	c->hash = cpio_fnv(c->hash, &e->st.st_mode, sizeof(e->st.st_mode));
+	c->hash = cpio_fnv(c->hash, &e->st.st_size, sizeof(e->st.st_size));
+	c->hash = cpio_fnv(c->hash, &e->st.st_mtim, sizeof(e->st.st_mtim));
+	c->hash = cpio_fnv(c->hash, &e->st.st_ino, sizeof(e->st.st_ino));
+	c->hash = cpio_fnv(c->hash, &e->st.st_rdev, sizeof(e->st.st_rdev));
+	if (e->link != NULL) c->hash = cpio_fnv(c->hash, e->link, strlen(e->link));
+
+	return 0;
+}
+
+static int cpio_scan (struct cpio *c, const char *path, const char *name) {
+
+	char **names = NULL, **t, sub [PATH_MAX], subname [PATH_MAX];
+	struct dirent *de;
+	int i, n = 0, size = 0, r = 0;
+	DIR *d;
+
+	d = opendir(path);
+	if (d == NULL) {
+		fprintf(stderr, "ERROR: cannot open directory '%s'\n", path);
+		return -1;
+	}
+
+	while ((de = readdir(d)) != NULL) {
+		if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) continue;
+		if (n == size) {
+			size = size ? size * 2 : 64;
+			t = (char **)realloc(names, size * sizeof(char *));
+			if (t == NULL) { r = -1; break; }
+			names = t;
+		}
+		names[n] = strdup(de->d_name);
+		if (names[n++] == NULL) { r = -1; break; }
+	}
+
+	closedir(d);
+	if (r == 0) qsort(names, n, sizeof(char *), cpio_namecmp);
+
+	for (i = 0; i < n && r == 0; i++) {
+		snprintf(sub, sizeof(sub), "%s/%s", path, names[i]);
+		snprintf(subname, sizeof(subname), "%s%s%s", name, *name ? "/" : "", names[i]);
+		r = cpio_add(c, sub, subname);
+		if (r == 0 && S_ISDIR(c->e[c->n - 1].st.st_mode)) r = cpio_scan(c, sub, subname);
+	}
+
+	for (i = 0; i < n; i++) free(names[i]);
+	free(names);
+	return r;
+}
+
+static void cpio_free (struct cpio *c) {
+	int i;
+	for (i = 0; i < c->n; i++) {
+		free(c->e[i].name);
+		free(c->e[i].path);
+		free(c->e[i].link);
+	}
+	free(c->e);
+	if (c->f != NULL) fclose(c->f);
+}
+
+//
+//	Archive output. Padding for the previous entry data, then the header and
+//	name of the next, are staged in c->head.
+//
+
+static int cpio_next (struct cpio *c) {
+
+	struct cpio_entry *e;
+	const char *name = "TRAILER!!!";
+	unsigned long mode = 0, nlink = 1, mtime = 0, size = 0, rmajor = 0, rminor = 0;
+	int n, pad;
+
+	if (c->f != NULL) { fclose(c->f); c->f = NULL; }
+
+	n = pad = (4 - c->dlen % 4) % 4;
+	memset(c->head, 0, n);
+
+	c->cur++;
+	c->dpos = c->dlen = 0;
+
+	if (c->cur < c->n) {
+		e = &c->e[c->cur];
+		name = e->name;
+		mode = e->st.st_mode;
+		nlink = S_ISDIR(mode) ? 2 : 1;
+		mtime = e->st.st_mtime;
+		size = c->dlen = e->st.st_size;
+		rmajor = major(e->st.st_rdev);
+		rminor = minor(e->st.st_rdev);
+
+		if (S_ISREG(mode) && size > 0) {
+			c->f = fopen(e->path, "rb");
+			if (c->f == NULL) {
+				fprintf(stderr, "ERROR: cannot open file '%s'\n", e->path);
+				return -1;
+			}
+		}
+	}
+
+	n += sprintf(c->head + n, "070701%08lX%08lX%08lX%08lX%08lX%08lX%08lX%08lX%08lX%08lX%08lX%08lX%08lX%s",
+		c->cur < c->n ? (unsigned long)c->cur + 1 : 0, mode, 0UL, 0UL, nlink, mtime, size,
+		0UL, 0UL, rmajor, rminor, (unsigned long)strlen(name) + 1, 0UL, name);
+
+	c->head[n++] = 0;
+	while ((n - pad) % 4) c->head[n++] = 0;
+
+	c->hpos = 0;
+	c->hlen = n;
+	return 0;
+}
+
+static int cpio_read (void *priv, char *buf, unsigned long len) {
+
+	struct cpio *c = (struct cpio *)priv;
+	struct cpio_entry *e;
+	unsigned long done = 0, n;
+
+	while (done < len) {
+
+		if (c->hpos < c->hlen) {
+			n = c->hlen - c->hpos;
+			if (n > len - done) n = len - done;
+			memcpy(buf + done, c->head + c->hpos, n);
+			c->hpos += n;
+			done += n;
+			continue;
+		}
+
+		if (c->dpos < c->dlen) {
+			e = &c->e[c->cur];
+			n = c->dlen - c->dpos;
+			if (n > len - done) n = len - done;
+			if (e->link != NULL) memcpy(buf + done, e->link + c->dpos, n);
+			else if (fread(buf + done, 1, n, c->f) != n) {
+				fprintf(stderr, "ERROR: '%s' changed while archiving\n", e->path);
+				return -1;
+			}
+			c->dpos += n;
+			done += n;
+			continue;
+		}
+
+		if (c->cur >= c->n) break;
+		if (cpio_next(c) < 0) return -1;
+	}
+
+	c->total += done;
+	return done;
+}
+
+//
+//	Cache files for a tree, named after its absolute path.
+//
+
+static int cpio_cache_path (const char *dir, const char *ext, char *path, unsigned long size) {
+
+	const char *base = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+	char real [PATH_MAX], top [PATH_MAX];
+
+	if (realpath(dir, real) == NULL) return -1;
+
+	if (base != NULL && *base) snprintf(top, sizeof(top), "%s/usbtool", base);
+	else if (home != NULL) snprintf(top, sizeof(top), "%s/.cache/usbtool", home);
+	else return -1;
+
+	if (ext == NULL) {
+		snprintf(path, size, "%s", top);
+		return 0;
+	}
+
+	snprintf(path, size, "%s/initramfs-%016llx%s", top, cpio_fnv(0xCBF29CE484222325ULL, real, strlen(real)), ext);
+	return 0;
+}
+
+static int cpio_mkdir (const char *path) {
+
+	char tmp [PATH_MAX], *p;
+
+	snprintf(tmp, sizeof(tmp), "%s", path);
+	for (p = tmp + 1; *p; p++) {
+		if (*p != '/') continue;
+		*p = 0;
+		mkdir(tmp, 0755);
+		*p = '/';
+	}
+
+	return mkdir(tmp, 0755) < 0 && access(tmp, W_OK) < 0 ? -1 : 0;
+}
+
+//
+//	Upload an archive of directory 'dir' to 'addr', through the given stages.
+//
+
+int cpio_upload (struct cc1800_session *s, unsigned long addr, const char *dir, int nstages, const char **stages) {
+
+	struct cpio c;
+	char archive [PATH_MAX], manifest [PATH_MAX], tmp [PATH_MAX + 4], line [64];
+	unsigned long long hash = 0;
+	int i, r, cached;
+	FILE *f, *save = NULL;
+
+	memset(&c, 0, sizeof(c));
+	c.dir = dir;
+	c.cur = -1;
+	c.hash = 0xCBF29CE484222325ULL;
+
+	for (i = 0; i < nstages; i++) c.hash = cpio_fnv(c.hash, stages[i], strlen(stages[i]) + 1);
+
+	r = cpio_scan(&c, dir, "");
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot archive '%s'\n", dir);
+		cpio_free(&c);
+		return r;
+	}
+
+	cached = cpio_cache_path(dir, ".cpio", archive, sizeof(archive)) == 0 &&
+		cpio_cache_path(dir, ".manifest", manifest, sizeof(manifest)) == 0;
+
+	// Unchanged tree, the previous archive is still good
+
+	if (cached && (f = fopen(manifest, "r")) != NULL) {
+		if (fgets(line, sizeof(line), f) != NULL) hash = strtoull(line, NULL, 16);
+		fclose(f);
+
+		if (hash == c.hash && access(archive, R_OK) == 0) {
+			printf("Reusing archive of unchanged '%s' (%d entries)\n", dir, c.n);
+			cpio_free(&c);
+			return pipeline_upload(s, addr, archive, NULL, 0, 0, NULL);
+		}
+	}
+
+	if (cached) {
+		cpio_cache_path(dir, NULL, tmp, sizeof(tmp));
+		if (cpio_mkdir(tmp) == 0) {
+			snprintf(tmp, sizeof(tmp), "%s.tmp", archive);
+			save = fopen(tmp, "wb");
+		}
+		if (save == NULL) fprintf(stderr, "WARNING: cannot cache archive of '%s'\n", dir);
+	}
+
+	printf("Archiving '%s' (%d entries)\n", dir, c.n);
+	r = pipeline_upload_source(s, addr, cpio_read, &c, nstages, stages, save);
+	if (r >= 0) printf("Archive is %lu bytes before stages\n", c.total);
+	cpio_free(&c);
+
+	if (save != NULL) {
+		if (fclose(save) != 0 && r >= 0) r = -1;
+		if (r >= 0 && rename(tmp, archive) == 0 && (f = fopen(manifest, "w")) != NULL) {
+			fprintf(f, "%016llx\n", c.hash);
+			fclose(f);
+		} else {
+			unlink(tmp);
+			unlink(manifest);
+			if (r >= 0) fprintf(stderr, "WARNING: cannot cache archive of '%s'\n", dir);
+		}
+	}
+
+	return r;
+}
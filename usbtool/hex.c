@@ -0,0 +1,236 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define HEX_SSSE3
+#endif
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Hex and ASCII rendering, in the canonical "hexdump -C" layout so that the
+//	output can be compared with that of other tools:
+//
+//	40000000  7f 45 4c 46 01 01 01 00  00 00 00 00 00 00 00 00  |.ELF............|
+//
+//	Every full line has the same length and places, so it is built in a few
+//	vector stores from the 16 bytes it shows: nibbles become digits through
+//	a table lookup with PSHUFB, and other shuffles spread the digits to their
+//	columns. Lines equal to the one before are collapsed into a "*" line.
+//
+
+#define HEX_HEX		10						// Column of the first digit
+#define HEX_ASCII	61						// Column of the first character
+
+static const char digits [] = "0123456789abcdef";
+
+static void hex_addr (char *out, unsigned long addr) {
+	int i;
+	for (i = 7; i >= 0; i--, addr >>= 4) out[i] = digits[addr & 15];
+}
+
+static void hex_frame (char *out) {
+	memset(out + 8, ' ', HEX_ASCII - 9);
+	out[HEX_ASCII - 1] = '|';
+	out[HEX_ASCII + 16] = '|';
+	out[HEX_ASCII + 17] = '\n';
+}
+
+//
+//	Plain C version, one byte at a time. Also renders the last line of a
+//	stream, which may be shorter than 16 bytes.
+//
+
+static void hex_line (char *out, const unsigned char *p, unsigned long addr, int n) {
+
+	char *q;
+	int i;
+
+	hex_addr(out, addr);
+	hex_frame(out);
+
+	for (i = 0; i < n; i++) {
+		q = out + HEX_HEX + 3 * i + (i >= 8);
+		q[0] = digits[p[i] >> 4];
+		q[1] = digits[p[i] & 15];
+		out[HEX_ASCII + i] = p[i] >= 0x20 && p[i] < 0x7F ? p[i] : '.';
+	}
+
+	if (n < 16) {
+		out[HEX_ASCII + n] = '|';
+		out[HEX_ASCII + n + 1] = '\n';
+	}
+}
+
+static char *hex_lines_c (struct hex_view *h, char *out, const unsigned char *p, unsigned long lines) {
+
+	for (; lines > 0; lines--, p += 16, h->addr += 16) {
+		if (h->squeeze && h->started && !memcmp(p, h->prev, 16)) {
+			if (!h->skipping) { *out++ = '*'; *out++ = '\n'; h->skipping = 1; }
+			continue;
+		}
+		hex_line(out, p, h->addr, 16);
+		out += HEX_LINE;
+		memcpy(h->prev, p, 16);
+		h->started = 1;
+		h->skipping = 0;
+	}
+
+	return out;
+}
+
+#ifdef HEX_SSSE3
+
+//
+//	SSSE3 version. The 48 columns from HEX_HEX on are three 16 byte stores,
+//	each made of shuffles of the digits of the low and high 8 bytes; index
+//	-1 leaves a zero, which is then turned into a space.
+//
+
+#define X	-1
+
+static const signed char shuf [4][16] __attribute__ ((aligned (16))) = {
+	{ 0, 1, X, 2, 3, X, 4, 5, X, 6, 7, X, 8, 9, X, 10 },			// Columns 10-25 from the low half
+	{ 11, X, 12, 13, X, 14, 15, X, X, X, X, X, X, X, X, X },		// Columns 26-41 from the low half
+	{ X, X, X, X, X, X, X, X, X, 0, 1, X, 2, 3, X, 4 },			// and from the high half
+	{ 5, X, 6, 7, X, 8, 9, X, 10, 11, X, 12, 13, X, 14, 15 },	// Columns 42-57 from the high half
+};
+
+#undef X
+
+__attribute__ ((target ("ssse3")))
+static char *hex_lines_ssse3 (struct hex_view *h, char *out, const unsigned char *p, unsigned long lines) {
+
+	const __m128i table = _mm_loadu_si128((const __m128i *)digits);
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i dot = _mm_set1_epi8('.');
+	const __m128i low = _mm_set1_epi8(0x1F), high = _mm_set1_epi8(0x7F);
+	__m128i v, lo, hi, a, b, s0, s1, s2, print, prev, addr;
+
+	prev = _mm_loadu_si128((const __m128i *)h->prev);
+
+	for (; lines > 0; lines--, p += 16, h->addr += 16) {
+
+		v = _mm_loadu_si128((const __m128i *)p);
+
+		if (h->squeeze && h->started && _mm_movemask_epi8(_mm_cmpeq_epi8(v, prev)) == 0xFFFF) {
+			if (!h->skipping) { *out++ = '*'; *out++ = '\n'; h->skipping = 1; }
+			continue;
+		}
+
+		// Digits in order, two per byte: a for bytes 0-7, b for 8-15
+
+		hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+		lo = _mm_shuffle_epi8(table, _mm_and_si128(v, mask));
+		a = _mm_unpacklo_epi8(hi, lo);
+		b = _mm_unpackhi_epi8(hi, lo);
+
+		s0 = _mm_shuffle_epi8(a, _mm_load_si128((const __m128i *)shuf[0]));
+		s1 = _mm_or_si128(_mm_shuffle_epi8(a, _mm_load_si128((const __m128i *)shuf[1])),
+			_mm_shuffle_epi8(b, _mm_load_si128((const __m128i *)shuf[2])));
+		s2 = _mm_shuffle_epi8(b, _mm_load_si128((const __m128i *)shuf[3]));
+
+		s0 = _mm_or_si128(s0, _mm_and_si128(_mm_cmpeq_epi8(s0, _mm_setzero_si128()), space));
+		s1 = _mm_or_si128(s1, _mm_and_si128(_mm_cmpeq_epi8(s1, _mm_setzero_si128()), space));
+		s2 = _mm_or_si128(s2, _mm_and_si128(_mm_cmpeq_epi8(s2, _mm_setzero_si128()), space));
+
+		// Printable is 0x20-0x7E, bytes from 0x80 up compare as negative
+
+		print = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, high));
+
+		// The address the same way, followed by spaces up to the digits
+
+		addr = _mm_cvtsi32_si128(__builtin_bswap32(h->addr));
+		addr = _mm_unpacklo_epi8(_mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(addr, 4), mask)),
+			_mm_shuffle_epi8(table, _mm_and_si128(addr, mask)));
+
+		_mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi64(addr, space));
+		_mm_storeu_si128((__m128i *)(out + HEX_HEX), s0);
+		_mm_storeu_si128((__m128i *)(out + HEX_HEX + 16), s1);
+		_mm_storeu_si128((__m128i *)(out + HEX_HEX + 32), s2);
+		out[HEX_ASCII - 3] = out[HEX_ASCII - 2] = ' ';
+		out[HEX_ASCII - 1] = '|';
+		_mm_storeu_si128((__m128i *)(out + HEX_ASCII), _mm_or_si128(_mm_and_si128(print, v), _mm_andnot_si128(print, dot)));
+		out[HEX_ASCII + 16] = '|';
+		out[HEX_ASCII + 17] = '\n';
+
+		out += HEX_LINE;
+		prev = v;
+		h->started = 1;
+		h->skipping = 0;
+	}
+
+	_mm_storeu_si128((__m128i *)h->prev, prev);
+	return out;
+}
+
+#endif
+
+//==============================================================================
+//
+//	Start a view of data at 'addr'. With 'squeeze', repeated lines are
+//	collapsed.
+//
+
+void hex_init (struct hex_view *h, unsigned long addr, int squeeze) {
+	memset(h, 0, sizeof(*h));
+	h->addr = addr;
+	h->squeeze = squeeze;
+#ifdef HEX_SSSE3
+	h->simd = __builtin_cpu_supports("ssse3");
+#endif
+}
+
+//
+//	Render the full lines in 'len' bytes into 'out', which must have room for
+//	HEX_LINE bytes per line. Returns the number of bytes written; whatever
+//	is left after the last full line is not rendered.
+//
+
+unsigned long hex_render (struct hex_view *h, char *out, const char *data, unsigned long len) {
+
+	const unsigned char *p = (const unsigned char *)data;
+	char *end;
+
+#ifdef HEX_SSSE3
+	if (h->simd) end = hex_lines_ssse3(h, out, p, len / 16);
+	else
+#endif
+	end = hex_lines_c(h, out, p, len / 16);
+
+	return end - out;
+}
+
+//
+//	Render the last, partial line (if 'len' is not zero) and the address past
+//	the end, which needs room for two HEX_LINE lines.
+//
+
+unsigned long hex_finish (struct hex_view *h, char *out, const char *data, unsigned long len) {
+
+	char *end = out;
+
+	if (len > 0) {
+		hex_line(out, (const unsigned char *)data, h->addr, len);
+		end += HEX_LINE - 16 + len;
+		h->addr += len;
+	}
+
+	hex_addr(end, h->addr);
+	end[8] = '\n';
+	return end + 9 - out;
+}
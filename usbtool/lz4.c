@@ -0,0 +1,336 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+#include "stubs/lz4.h"
+
+//==============================================================================
+//
+//	Compressed readback. Memory dumps are mostly zeros, code and tables, so
+//	a stub compresses them on the target (LZ4 block format) into a staging
+//	buffer, and only that goes over USB. Blocks that do not compress come
+//	as they are.
+//
+//	The target works in rounds, as much as the staging buffer holds at a
+//	time. While it compresses the next round, the host decompresses the last
+//	one on a few worker threads, so that decompression never adds to the
+//	time taken: what a dump costs is compression on the target plus the
+//	compressed bytes over USB.
+//
+
+#define LZ4_OP_COMPRESS		1
+
+#define LZ4_ARG_SRC			0
+#define LZ4_ARG_END			1
+#define LZ4_ARG_BLOCK		2
+#define LZ4_ARG_HASH		3
+#define LZ4_ARG_DST			4
+#define LZ4_ARG_DST_END		5
+
+#define LZ4_RAW				0x80000000UL
+#define LZ4_HASH_SIZE		0x4000			// Hash table, at the start of the staging buffer
+#define LZ4_BLOCK			0x10000
+#define LZ4_BUF_SIZE		0x00400000
+#define LZ4_BUF				(CC1800_SDRAM_BASE + 0x03C00000)	// Last 4 MB of SDRAM
+#define LZ4_MAX_THREADS		8
+
+struct lz4_job {
+	const unsigned char *in;
+	unsigned long in_len, out_len;
+	unsigned char *out;
+	int raw, slot;
+};
+
+struct lz4_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct lz4_job *jobs;
+	int njobs, next, quit, failed;
+	int pending [2];				// Jobs not done yet per host buffer
+};
+
+//
+//	Decompress an LZ4 block that must come out exactly out_len bytes long.
+//	Returns 0 if it does, -1 if the block is corrupt.
+//
+
+static int lz4_decode (const unsigned char *in, unsigned long in_len, unsigned char *out, unsigned long out_len) {
+
+	const unsigned char *end = in + in_len;
+	unsigned long lit, len, off, o = 0;
+	unsigned token;
+
+	while (in < end) {
+
+		token = *in++;
+
+		lit = token >> 4;
+		if (lit == 15) do {
+			if (in == end) return -1;
+			lit += *in;
+		} while (*in++ == 255);
+
+		if (lit > (unsigned long)(end - in) || lit > out_len - o) return -1;
+		memcpy(out + o, in, lit);
+		in += lit;
+		o += lit;
+
+		if (in == end) break;				// Last sequence, literals only
+
+		if (end - in < 2) return -1;
+		off = in[0] | (in[1] << 8);
+		in += 2;
+		if (off == 0 || off > o) return -1;
+
+		len = (token & 15) + 4;
+		if ((token & 15) == 15) do {
+			if (in == end) return -1;
+			len += *in;
+		} while (*in++ == 255);
+
+		if (len > out_len - o) return -1;
+		for (; len > 0; len--, o++) out[o] = out[o - off];	// May overlap
+	}
+
+	return o == out_len ? 0 : -1;
+}
+
+static void *lz4_worker (void *arg) {
+
+	struct lz4_pool *p = (struct lz4_pool *)arg;
+	struct lz4_job *j;
+	int r;
+
+	pthread_mutex_lock(&p->lock);
+
+	for (;;) {
+
+		while (p->next == p->njobs && !p->quit) pthread_cond_wait(&p->cond, &p->lock);
+		if (p->next == p->njobs) break;
+		j = &p->jobs[p->next++];
+		pthread_mutex_unlock(&p->lock);
+
+		r = 0;
+		if (j->raw) memcpy(j->out, j->in, j->out_len);
+		else r = lz4_decode(j->in, j->in_len, j->out, j->out_len);
+
+		pthread_mutex_lock(&p->lock);
+		if (r < 0) p->failed = 1;
+		p->pending[j->slot]--;
+		pthread_cond_broadcast(&p->cond);
+	}
+
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+void lz4_defaults (struct lz4_opts *o) {
+	o->on = 0;
+	o->block = LZ4_BLOCK;
+	o->buf = LZ4_BUF;
+	o->size = LZ4_BUF_SIZE;
+	o->stub = CC1800_STUB_BASE;
+}
+
+//
+//	Parse lz4=<0|1>, block=<size>, buf=<address>[:<size>] or stub=<address>.
+//	Returns 1 if arg was one of them, 0 if not.
+//
+
+int lz4_option (struct lz4_opts *o, const char *arg) {
+
+	unsigned long on;
+	const char *p;
+	int r;
+
+	if (!strncmp(arg, "lz4=", 4)) {
+		r = scan_ulong(arg + 4, &on);
+		o->on = on != 0;
+	}
+	else if (!strncmp(arg, "block=", 6)) r = scan_ulong(arg + 6, &o->block);
+	else if (!strncmp(arg, "stub=", 5)) r = scan_ulong(arg + 5, &o->stub);
+	else if (!strncmp(arg, "buf=", 4)) {
+		p = strchr(arg + 4, ':');
+		r = p != NULL ? scan_ulong(p + 1, &o->size) : 0;
+		if (r >= 0) r = scan_ulong(arg + 4, &o->buf);
+	}
+	else return 0;
+
+	return r < 0 ? r : 1;
+}
+
+//
+//	Read [addr, addr + len) into buf through the compressor stub. Reports
+//	the effective rate, and what a plain read would take at the USB rate
+//	seen meanwhile.
+//
+
+int lz4_download (struct cc1800_session *s, char *buf, unsigned long len, unsigned long addr, const struct lz4_opts *o) {
+
+	const struct cc1800_region *reg;
+	struct cc1800_stub stub;
+	struct lz4_pool p;
+	pthread_t threads [LZ4_MAX_THREADS];
+	unsigned char *host [2] = { NULL, NULL };
+	unsigned long cap = o->size - LZ4_HASH_SIZE, done = 0, wire = 0, used, pos, h, n, blk;
+	unsigned long blocks = 0, raw = 0, rounds = 0;
+	double t0 = time_now(), t, t_target = 0, t_usb = 0;
+	int nthreads = 0, i, r = -1, k;
+	long cpus;
+
+	if (o->block < 256 || o->block > LZ4_BUF_SIZE) {
+		fprintf(stderr, "ERROR: the block size must be from 256 bytes to %u KB\n", LZ4_BUF_SIZE >> 10);
+		return -1;
+	}
+
+	if ((o->buf | o->size) & 3 || o->size < LZ4_HASH_SIZE + o->block + o->block / 128 + 32) {
+		fprintf(stderr, "ERROR: the staging buffer must be word aligned and sized, and hold a %lu byte block\n", o->block);
+		return -1;
+	}
+
+	reg = memmap_check(s, o->buf, o->size, MEM_READ | MEM_WRITE);
+	if (reg == NULL || memmap_check(s, o->stub, sizeof(lz4_stub), MEM_WRITE | MEM_EXEC) == NULL) return -1;
+
+	if ((addr < o->buf + o->size && o->buf < addr + len) || (addr < o->stub + sizeof(lz4_stub) && o->stub < addr + len)) {
+		fprintf(stderr, "ERROR: the dump overlaps the stub or its buffer, move them with stub= and buf=\n");
+		return -1;
+	}
+
+	memset(&p, 0, sizeof(p));
+	p.jobs = (struct lz4_job *)malloc((len / o->block + 1) * sizeof(struct lz4_job));
+	host[0] = (unsigned char *)malloc(cap);
+	host[1] = (unsigned char *)malloc(cap);
+	if (p.jobs == NULL || host[0] == NULL || host[1] == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		goto done;
+	}
+
+	r = stub_init(s, &stub, lz4_stub, sizeof(lz4_stub), o->stub);
+	if (r < 0) goto done;
+
+	stub_set(&stub, STUB_PARAM_OP, LZ4_OP_COMPRESS);
+	stub_set(&stub, STUB_ARG(LZ4_ARG_BLOCK), o->block);
+	stub_set(&stub, STUB_ARG(LZ4_ARG_HASH), o->buf);
+	stub_set(&stub, STUB_ARG(LZ4_ARG_DST), o->buf + LZ4_HASH_SIZE);
+	stub_set(&stub, STUB_ARG(LZ4_ARG_DST_END), o->buf + o->size);
+	stub_set(&stub, STUB_ARG(LZ4_ARG_END), addr + len);
+
+	pthread_mutex_init(&p.lock, NULL);
+	pthread_cond_init(&p.cond, NULL);
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	for (i = 0; i < LZ4_MAX_THREADS && i < cpus; i++) {
+		if (pthread_create(&threads[i], NULL, lz4_worker, &p)) break;
+		nthreads++;
+	}
+	if (nthreads == 0) {
+		fprintf(stderr, "ERROR: cannot start decompression threads\n");
+		r = -1;
+		goto done_pool;
+	}
+
+	// The stub leaves its staging buffer changed
+
+	if (s->mem != NULL) mem_cache_invalidate(s->mem);
+
+	printf("Downloading data from address 0x%08lX, compressed on the target\n", addr);
+
+	for (k = 0; done < len; k ^= 1, rounds++) {
+
+		t = time_now();
+		stub_set(&stub, STUB_ARG(LZ4_ARG_SRC), addr + done);
+		r = stub_run(s, &stub, &used);
+		if (r < 0) break;
+		t_target += time_now() - t;
+
+		if (used == 0 || used > cap || used & 3) {
+			fprintf(stderr, "ERROR: compressor stub returned %lu bytes\n", used);
+			r = -1;
+			break;
+		}
+
+		// The workers may still be on the last round but one
+
+		pthread_mutex_lock(&p.lock);
+		while (p.pending[k] > 0) pthread_cond_wait(&p.cond, &p.lock);
+		pthread_mutex_unlock(&p.lock);
+
+		t = time_now();
+		r = memmap_download(s, reg, (char *)host[k], used, o->buf + LZ4_HASH_SIZE);
+		if (r < 0) break;
+		t_usb += time_now() - t;
+		wire += used;
+
+		pthread_mutex_lock(&p.lock);
+		for (pos = 0; pos < used && done < len; done += blk, pos += 4 + ((n + 3) & ~3UL)) {
+			if (used - pos < 4) { p.failed = 1; break; }
+			h = host[k][pos] | (host[k][pos + 1] << 8) | (host[k][pos + 2] << 16) | ((unsigned long)host[k][pos + 3] << 24);
+			n = h & ~LZ4_RAW;
+			blk = len - done < o->block ? len - done : o->block;
+			if (n > used - pos - 4 || ((h & LZ4_RAW) && n != blk)) { p.failed = 1; break; }
+			p.jobs[p.njobs].in = host[k] + pos + 4;
+			p.jobs[p.njobs].in_len = n;
+			p.jobs[p.njobs].out = (unsigned char *)buf + done;
+			p.jobs[p.njobs].out_len = blk;
+			p.jobs[p.njobs].raw = (h & LZ4_RAW) != 0;
+			p.jobs[p.njobs].slot = k;
+			p.njobs++;
+			p.pending[k]++;
+			blocks++;
+			if (h & LZ4_RAW) raw++;
+		}
+		pthread_cond_broadcast(&p.cond);
+		pthread_mutex_unlock(&p.lock);
+
+		if (p.failed) {
+			fprintf(stderr, "ERROR: bad compressed data from the target\n");
+			r = -1;
+			break;
+		}
+	}
+
+done_pool:
+	pthread_mutex_lock(&p.lock);
+	p.quit = 1;
+	pthread_cond_broadcast(&p.cond);
+	pthread_mutex_unlock(&p.lock);
+	for (i = 0; i < nthreads; i++) pthread_join(threads[i], NULL);
+
+	if (r >= 0 && p.failed) {
+		fprintf(stderr, "ERROR: bad compressed data from the target\n");
+		r = -1;
+	}
+
+	if (r >= 0) {
+		t = time_now() - t0;
+		printf("Read %lu bytes in %.3f s (%.2f MB/s): %lu over USB (%.1f%%), %lu of %lu blocks raw, %lu rounds\n",
+			len, t, len / t / 1e6, wire, 100.0 * wire / len, raw, blocks, rounds);
+		if (t_usb > 0)
+			printf("Target compression %.3f s, transfer %.3f s (%.2f MB/s): a plain read would take about %.3f s\n",
+				t_target, t_usb, wire / t_usb / 1e6, len * t_usb / wire);
+	}
+
+	pthread_mutex_destroy(&p.lock);
+	pthread_cond_destroy(&p.cond);
+	stub_free(&stub);
+
+done:
+	free(p.jobs);
+	free(host[0]);
+	free(host[1]);
+	return r < 0 ? r : 0;
+}
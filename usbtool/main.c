@@ -9,15 +9,19 @@
 //	published by the Free Software Foundation.
 //
 
+#include <sys/stat.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <time.h>
 #include <errno.h>
 
 #include <usb.h>
 
+#include "usbtool.h"
+
 #define CC1800_VENDOR_ID	0x2009
 #define CC1800_PRODUCT_ID	0x1218
 
@@ -46,6 +50,42 @@ struct usb_device *cc1800_find (void) {
 	return NULL;
 }
 
+//
+//	Open and claim a device. Returns NULL after printing why not.
+//
+
+struct usb_dev_handle *cc1800_open (struct usb_device *dev) {
+
+	struct usb_dev_handle *handle;
+
+	handle = usb_open(dev);
+	if (handle == NULL) {
+		fprintf(stderr, "ERROR: cannot open device (%s)\n", strerror(errno));
+		return NULL;
+	}
+
+	if (usb_set_configuration(handle, 1) < 0) {
+		fprintf(stderr, "ERROR: cannot set configuration\n");
+		usb_close(handle);
+		return NULL;
+	}
+
+	if (usb_claim_interface(handle, 0) < 0) {
+		fprintf(stderr, "ERROR: cannot claim interface\n");
+		usb_close(handle);
+		return NULL;
+	}
+
+	return handle;
+}
+
+void cc1800_close (struct usb_dev_handle *handle) {
+	cc1800_queue_close(handle);
+	probe_close(handle);
+	shape_close(handle);
+	usb_close(handle);
+}
+
 //==============================================================================
 
 #define CC1800_REQ_GET_CPU_INFO		0x00
@@ -66,7 +106,9 @@ struct usb_device *cc1800_find (void) {
 //
 
 int cc1800_req_get_cpu_info (struct usb_dev_handle *handle, char *str) {
-	return usb_control_msg(
+	int r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	r = usb_control_msg(
 		handle,
 		USB_ENDPOINT_IN | USB_TYPE_VENDOR,
 		CC1800_REQ_GET_CPU_INFO,
@@ -76,6 +118,8 @@ int cc1800_req_get_cpu_info (struct usb_dev_handle *handle, char *str) {
 		8,
 		TIMEOUT
 	);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
@@ -83,7 +127,9 @@ int cc1800_req_get_cpu_info (struct usb_dev_handle *handle, char *str) {
 //
 
 int cc1800_req_set_address (struct usb_dev_handle *handle, unsigned long addr) {
-	return usb_control_msg(
+	int r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	r = usb_control_msg(
 		handle,
 		USB_ENDPOINT_OUT | USB_TYPE_VENDOR,
 		CC1800_REQ_SET_ADDRESS,
@@ -93,6 +139,9 @@ int cc1800_req_set_address (struct usb_dev_handle *handle, unsigned long addr) {
 		0,
 		TIMEOUT
 	);
+	if (r >= 0) probe_address(handle, addr); else probe_forget(handle);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
@@ -100,8 +149,11 @@ int cc1800_req_set_address (struct usb_dev_handle *handle, unsigned long addr) {
 //
 
 int cc1800_req_set_length (struct usb_dev_handle *handle, unsigned long len, int wr) {
+	int r;
 	if (wr) len |= 0x80000000; else len &= ~0x80000000;
-	return usb_control_msg(
+	r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	r = usb_control_msg(
 		handle,
 		USB_ENDPOINT_OUT | USB_TYPE_VENDOR,
 		CC1800_REQ_SET_LENGTH,
@@ -111,6 +163,8 @@ int cc1800_req_set_length (struct usb_dev_handle *handle, unsigned long len, int
 		0,
 		TIMEOUT
 	);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
@@ -123,7 +177,9 @@ int cc1800_req_set_length (struct usb_dev_handle *handle, unsigned long len, int
 //
 
 int cc1800_req_get_status (struct usb_dev_handle *handle, char *stat) {
-	return usb_control_msg(
+	int r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	r = usb_control_msg(
 		handle,
 		USB_ENDPOINT_IN | USB_TYPE_VENDOR,
 		CC1800_REQ_GET_STATUS,
@@ -133,6 +189,8 @@ int cc1800_req_get_status (struct usb_dev_handle *handle, char *stat) {
 		1,
 		TIMEOUT
 	);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
@@ -140,7 +198,9 @@ int cc1800_req_get_status (struct usb_dev_handle *handle, char *stat) {
 //
 
 int cc1800_req_execute (struct usb_dev_handle *handle) {
-	return usb_control_msg(
+	int r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	r = usb_control_msg(
 		handle,
 		USB_ENDPOINT_OUT | USB_TYPE_VENDOR,
 		CC1800_REQ_EXECUTE,
@@ -150,21 +210,33 @@ int cc1800_req_execute (struct usb_dev_handle *handle) {
 		0,
 		TIMEOUT
 	);
+	probe_running(handle, 1);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
-//	These are convenience composite functions.
+//	These are convenience composite functions. Each one holds the device for
+//	its whole request sequence (see queue.c), so that threads sharing it do not
+//	interleave their requests.
 //
 
 //
 //	CC1800 data upload: set address, set length and do a bulk transter to end point 1.
+//	The address is not set if the loader is known to be there already (see probe.c).
 //
 
 int cc1800_upload (struct usb_dev_handle *handle, const char *data, int length, unsigned long address) {
 	int r;
-	r = cc1800_req_set_address(handle, address); if (r < 0) return r;
-	r = cc1800_req_set_length(handle, length, 1); if (r < 0) return r;
-	return usb_bulk_write(handle, 1, data, length, TIMEOUT);
+	shape_transfer(handle, length);
+	r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	if (!probe_at(handle, address)) r = cc1800_req_set_address(handle, address);
+	if (r >= 0) r = cc1800_req_set_length(handle, length, 1);
+	if (r >= 0) r = usb_bulk_write(handle, 1, data, length, TIMEOUT);
+	if (r == length) probe_moved(handle, length, 1); else probe_forget(handle);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
@@ -173,9 +245,15 @@ int cc1800_upload (struct usb_dev_handle *handle, const char *data, int length,
 
 int cc1800_download (struct usb_dev_handle *handle, char *data, int length, unsigned long address) {
 	int r;
-	r = cc1800_req_set_address(handle, address); if (r < 0) return r;
-	r = cc1800_req_set_length(handle, length, 0); if (r < 0) return r;
-	return usb_bulk_read(handle, 1, data, length, TIMEOUT);
+	shape_transfer(handle, length);
+	r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+	if (!probe_at(handle, address)) r = cc1800_req_set_address(handle, address);
+	if (r >= 0) r = cc1800_req_set_length(handle, length, 0);
+	if (r >= 0) r = usb_bulk_read(handle, 1, data, length, TIMEOUT);
+	if (r == length) probe_moved(handle, length, 0); else probe_forget(handle);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //
@@ -186,14 +264,16 @@ int cc1800_execute (struct usb_dev_handle *handle, const char *data, int length,
 	int r;
 	char *check = alloca(length);			// Use the stack, so we need not care to free
 	if (check == NULL) return -ENOMEM;
-	r = cc1800_upload(handle, data, length, address);
+	r = cc1800_queue_enter(handle);
 	if (r < 0) return r;
-	if (r < length) return -EIO;
-	r = cc1800_download(handle, check, length, address);
-	if (r < 0) return r;
-	if (r < length) return -EIO;
-	if (memcmp(data, check, length)) return -EIO;
-	return cc1800_req_execute(handle);
+	r = cc1800_upload(handle, data, length, address);
+	if (r >= 0 && r < length) r = -EIO;
+	if (r >= 0) r = cc1800_download(handle, check, length, address);
+	if (r >= 0 && r < length) r = -EIO;
+	if (r >= 0 && memcmp(data, check, length)) r = -EIO;
+	if (r >= 0) r = cc1800_req_execute(handle);
+	cc1800_queue_leave(handle);
+	return r;
 }
 
 //==============================================================================
@@ -201,12 +281,12 @@ int cc1800_execute (struct usb_dev_handle *handle, const char *data, int length,
 //	Scan a 32 bit address, checking for the "0x" hexadecimal format prefix.
 //
 
-static int scan_ulong (const char *str, unsigned long *addr) {
+int scan_ulong (const char *str, unsigned long *addr) {
 
 	if (str[0] == '0' && toupper(str[1]) == 'X') {
 		if (sscanf(str + 2, "%lx", addr)) return 0;
 	} else {
-		if (!sscanf(str, "%lu", addr)) return 0;
+		if (sscanf(str, "%lu", addr)) return 0;
 	}
 
 	fprintf(stderr, "ERROR: bad value '%s'\n", str);
@@ -214,50 +294,76 @@ static int scan_ulong (const char *str, unsigned long *addr) {
 }
 
 //
-//	Load a file into memory. Memory is malloc'ed, so caller must later free it.
+//	Scan a size or rate with an optional K, M or G suffix (either case) and
+//	B, and "/s" for rates. Units are decimal, like the MB/s printed
+//	everywhere: 1M is 1000000. Returns -1 without printing if it is not one.
 //
 
-static int load_file (const char *file, char **data, unsigned long *len) {
+int scan_size (const char *str, double *v) {
 
-	FILE *f;
+	char *end;
 
-	f = fopen(file, "rb");
-	if (f == NULL) {
-		fprintf(stderr, "ERROR: cannot open file '%s'\n", file);
-		return -1;
+	*v = strtod(str, &end);
+	if (end == str || *v < 0) return -1;
+
+	switch (*end) {
+	case 'K': case 'k': *v *= 1e3; end++; break;
+	case 'M': case 'm': *v *= 1e6; end++; break;
+	case 'G': case 'g': *v *= 1e9; end++; break;
 	}
 
-	fseek(f, 0, SEEK_END);
-	*len = ftell(f);
-	fseek(f, 0, SEEK_SET);
+	if (*end == 'B') end++;
+	if (!strcmp(end, "/s")) end += 2;
+	return *end == 0 ? 0 : -1;
+}
 
-	if (*len < 0) {
-		fprintf(stderr, "ERROR: cannot get file size for '%s'\n", file);
-		fclose(f);
-		return -1;
-	}
+//
+//	Seconds on the monotonic clock, the same in every process (shape.c
+//	compares times taken by others).
+//
+
+double time_now (void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-	*data = (char *)malloc(*len);
+//
+//	Load a file into memory. Memory is malloc'ed, so caller must later free it.
+//
+
+int load_file (const char *file, char **data, unsigned long *len) {
+
+	struct uring_reader *r;
+	long n;
+
+	r = uring_open(file, len);
+	if (r == NULL) return -1;
+
+	*data = (char *)malloc(*len ? *len : 1);
 	
 	if (*data == NULL) {
 		fprintf(stderr, "ERROR: cannot allocate memory for file '%s'\n", file);
-		fclose(f);
+		uring_close(r);
 		return -1;
 	}
 
-	if (!fread(*data, *len, 1, f)) {
-		fprintf(stderr, "ERROR: cannot read file '%s'\n", file);
+	// uring_read says why when it fails, but not when the file shrank
+
+	n = uring_read(r, *data, *len);
+	if (n != (long)*len) {
+		if (n >= 0) fprintf(stderr, "ERROR: cannot read file '%s'\n", file);
 		free(*data);
-		fclose(f);
+		uring_close(r);
 		return -1;
 	}
 
 	printf("Loaded file '%s' (%lu bytes)\n", file, *len);
-	fclose(f);
+	uring_close(r);
 	return 0;
 }
 
-static int save_file (const char *file, const char *data, unsigned long len) {
+int save_file (const char *file, const char *data, unsigned long len) {
 
 	FILE *f;
 
@@ -273,22 +379,32 @@ static int save_file (const char *file, const char *data, unsigned long len) {
 		return -1;
 	}
 
+	fclose(f);
 	return 0;
 }
 
 //
-//	This is the actual command line interpreter.
+//	This is the actual command line interpreter. It is used both for the
+//	command line arguments and for each line typed in the interactive shell.
 //
 
-int cc1800_fiddle (struct usb_dev_handle *handle, int argc, const char **argv) {
+int cc1800_fiddle (struct cc1800_session *s, int argc, const char **argv) {
 
-	int i, r, cpu = 0; char s [256], *data, *verify;
+	int i, n, r, big; char *buf, *verify;
+	const char *data, *file, *stages [CC1800_MAX_STAGES];
+	struct stat st;
+	const struct cc1800_region *reg;
+	struct lz4_opts lz;
 	unsigned long addr, len;
 
-	for (i = 1; i < argc; i++) {
+	for (i = 0; i < argc; i++) {
+
+		// The shell reports on each of its own commands instead
+
+		if (strcmp(argv[i], "shell")) budget_command(argv[i]);
 
-		memset(s, 0, sizeof(s));
-		r = cc1800_req_get_cpu_info(handle, s);	
+		memset(s->cpu_info, 0, sizeof(s->cpu_info));
+		r = cc1800_req_get_cpu_info(s->handle, s->cpu_info);
 		if (r < 0) {
 			fprintf(stderr, "ERROR: cannot get CPU info\n");
 			return r;
@@ -297,10 +413,10 @@ int cc1800_fiddle (struct usb_dev_handle *handle, int argc, const char **argv) {
 		// Show CPU info only the first time, but we execute this command
 		// each time, just to make sure the it is listening
 
-		if (!cpu) { cpu = 1; printf("CPU info: %s\n", s); }
+		if (!s->cpu_shown) { s->cpu_shown = 1; printf("CPU info: %s\n", s->cpu_info); probe_attach(s); }
 
 		//
-		//	WRITE command, usage: write <addr> file
+		//	WRITE command, usage: write <addr> file [+stage ...]
 		//
 
 		if (!strcmp(argv[i], "write")) {
@@ -311,42 +427,97 @@ int cc1800_fiddle (struct usb_dev_handle *handle, int argc, const char **argv) {
 			}
 
 			r = scan_ulong(argv[++i], &addr); if (r < 0) return r;
-			r = load_file(argv[++i], &data, &len); if (r < 0) return r;
+			file = argv[++i];
+			for (n = 0; n < CC1800_MAX_STAGES && i + 1 + n < argc && argv[i + 1 + n][0] == '+'; n++) stages[n] = argv[i + 1 + n] + 1;
+
+			if (memmap_check(s, addr, 1, MEM_WRITE) == NULL) return -1;
+
+			// A directory goes as an initramfs archive, made on the fly
+
+			if (stat(file, &st) == 0 && S_ISDIR(st.st_mode)) {
+				i += n;
+				r = cpio_upload(s, addr, file, n, stages);
+				if (r < 0) return r;
+				s->addr = addr;
+				s->addr_known = 1;
+				continue;
+			}
+
+			// Files stay owned by the cache in interactive mode, unless
+			// holding them (and a copy to verify) would break the budget
+
+			big = stat(file, &st) == 0 && !budget_fits((n > 0 ? 1 : 2) * (unsigned long)st.st_size);
+
+			buf = NULL;
+			data = NULL; len = 0;
+			if (big) r = 0;
+			else if (s->files != NULL) r = file_cache_load(s->files, file, &data, &len);
+			else if (n == 0) { r = load_file(file, &buf, &len); data = buf; }
+			if (r < 0) return r;
+
+			// With stages, or too big to hold, the data is streamed through
+			// the pipeline, read straight from the file unless it is cached
+
+			if (n > 0 || big) {
+				i += n;
+				r = pipeline_upload(s, addr, file, data, len, n, stages);
+				if (r < 0) return r;
+				s->addr = addr;
+				s->addr_known = 1;
+				continue;
+			}
+
+			reg = memmap_check(s, addr, len, MEM_WRITE);
+			if (reg == NULL) {
+				free(buf);
+				return -1;
+			}
 
 			printf("Uploading data to address 0x%08lX\n", addr);
-			r = cc1800_upload(handle, data, len, addr);
+			r = memmap_upload(s, reg, data, len, addr);
 			if (r < 0) {
 				fprintf(stderr, "ERROR: CC1800 upload failed\n");
-				free(data);
+				free(buf);
 				return r;
 			}
 
+			s->addr = addr;
+			s->addr_known = 1;
+
+			if (!(reg->flags & MEM_VERIFY)) {
+				if (s->mem != NULL) mem_cache_store(s->mem, addr, data, len);
+				free(buf);
+				continue;
+			}
+
 			verify = (char *)malloc(len);
 			if (verify == NULL) {
 				fprintf(stderr, "ERROR: cannot allocate memory\n");
-				free(data);
+				free(buf);
 				return r;
 			}
 
 			printf("Downloading data for verification\n");
-			r = cc1800_download(handle, verify, len, addr);
+			r = memmap_download(s, reg, verify, len, addr);
 			if (r < 0) {
 				fprintf(stderr, "ERROR: CC1800 download failed\n");
 				free(verify);
-				free(data);
+				free(buf);
 				return r;
 			}
 
 			r = memcmp(data, verify, len);
 
+			if (s->mem != NULL) mem_cache_store(s->mem, addr, verify, len);
+
 			free(verify);
-			free(data);
+			free(buf);
 
 			if (r) printf("WARNING: data mismatch\n");
 		}
 
 		//
-		//	READ command, usage: read <addr> <len> <file>
+		//	READ command, usage: read <addr> <len> <file> [+stage ...]
 		//
 
 		else if (!strcmp(argv[i], "read")) {
@@ -358,26 +529,98 @@ int cc1800_fiddle (struct usb_dev_handle *handle, int argc, const char **argv) {
 
 			r = scan_ulong(argv[++i], &addr); if (r < 0) return r;
 			r = scan_ulong(argv[++i], &len); if (r < 0) return r;
+			for (n = 0; n < CC1800_MAX_STAGES && i + 2 + n < argc && argv[i + 2 + n][0] == '+'; n++) stages[n] = argv[i + 2 + n] + 1;
+
+			reg = memmap_check(s, addr, len, MEM_READ);
+			if (reg == NULL) return -1;
+
+			s->addr = addr;
+			s->addr_known = 1;
 
-			data = (char *)malloc(len);
-			if (data == NULL) {
+			if (n > 0 || !budget_fits(len)) {
+				file = argv[++i];
+				i += n;
+				r = pipeline_download(s, addr, len, file, n, stages);
+				if (r < 0) return r;
+				continue;
+			}
+
+			buf = (char *)malloc(len);
+			if (buf == NULL) {
 				fprintf(stderr, "ERROR: cannot allocate memory\n");
 				return -1;
 			}
 
-			printf("Downloading data from address 0x%08lX\n", addr);
-			r = cc1800_download(handle, data, len, addr);
+			if (s->mem != NULL && mem_cache_fetch(s->mem, addr, buf, len) == 0)
+				printf("Using cached data from address 0x%08lX\n", addr);
+
+			else {
+				printf("Downloading data from address 0x%08lX\n", addr);
+				r = memmap_download(s, reg, buf, len, addr);
+				if (r < 0) {
+					fprintf(stderr, "ERROR: CC1800 download failed\n");
+					free(buf);
+					return r;
+				}
+				if (s->mem != NULL) mem_cache_store(s->mem, addr, buf, len);
+			}
+
+			r = save_file(argv[++i], buf, len);
+
+			free(buf);
+
+			if (r < 0) return r;
+		}
+
+		//
+		//	DUMP command, usage: dump <addr> <len> <store> <board> [lz4=1 [key=value ...]]
+		//
+
+		else if (!strcmp(argv[i], "dump")) {
+
+			if ((argc - i) < 5) {
+				fprintf(stderr, "ERROR: dump command requires four arguments (address, length, store and board name)\n");
+				return -1;
+			}
+
+			r = scan_ulong(argv[++i], &addr); if (r < 0) return r;
+			r = scan_ulong(argv[++i], &len); if (r < 0) return r;
+
+			lz4_defaults(&lz);
+			for (n = 3; i + n < argc && (r = lz4_option(&lz, argv[i + n])) != 0; n++) if (r < 0) return r;
+
+			reg = memmap_check(s, addr, len, MEM_READ);
+			if (reg == NULL) return -1;
+
+			if (!budget_fits(len)) {
+				fprintf(stderr, "ERROR: dumping %lu bytes would break the memory budget\n", len);
+				return -1;
+			}
+
+			buf = (char *)malloc(len);
+			if (buf == NULL) {
+				fprintf(stderr, "ERROR: cannot allocate memory\n");
+				return -1;
+			}
+
+			if (lz.on) r = lz4_download(s, buf, len, addr, &lz);
+			else {
+				printf("Downloading data from address 0x%08lX\n", addr);
+				r = memmap_download(s, reg, buf, len, addr);
+			}
 			if (r < 0) {
 				fprintf(stderr, "ERROR: CC1800 download failed\n");
-				free(data);
+				free(buf);
 				return r;
 			}
 
-			r = save_file(argv[++i], data, len);
-
-			free(data);
+			s->addr = addr;
+			s->addr_known = 1;
 
+			r = store_put(argv[i + 1], argv[i + 2], s->cpu_info, addr, buf, len);
+			free(buf);
 			if (r < 0) return r;
+			i += n - 1;
 		}
 
 		//
@@ -386,14 +629,153 @@ int cc1800_fiddle (struct usb_dev_handle *handle, int argc, const char **argv) {
 
 		else if (!strcmp(argv[i], "exec")) {
 
+			if (s->addr_known && memmap_check(s, s->addr, 4, MEM_EXEC) == NULL) return -1;
+
+			// Whatever runs may change memory behind our back
+
+			if (s->mem != NULL) mem_cache_invalidate(s->mem);
+
 			printf("Executing at last address\n");
-			r = cc1800_req_execute(handle);
+			r = cc1800_req_execute(s->handle);
 			if (r < 0) {
 				fprintf(stderr, "ERROR: CC1800 execute failed\n");
 				return r;
 			}
 		}
 
+		//
+		//	MEMMAP command, usage: memmap [on|off]
+		//
+
+		else if (!strcmp(argv[i], "memmap")) {
+			i += cc1800_memmap(s, argc - i - 1, argv + i + 1);
+		}
+
+		//
+		//	PROBE command, usage: probe [show|forget] [key=value ...]
+		//
+
+		else if (!strcmp(argv[i], "probe")) {
+			r = cc1800_probe(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	NORFLASH command, usage: norflash <offset> <file> [key=value ...]
+		//
+
+		else if (!strcmp(argv[i], "norflash")) {
+			r = cc1800_norflash(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	WATERMARK command, usage: watermark <addr> <file> <name>=<start>:<size>... [key=value ...]
+		//
+
+		else if (!strcmp(argv[i], "watermark")) {
+			r = cc1800_watermark(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	MONITOR command, usage: monitor [wait | <addr> <file> [key=value...]]
+		//
+
+		else if (!strcmp(argv[i], "monitor")) {
+			r = cc1800_monitor(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	RUN command, usage: run <addr> <file> [key=value...]
+		//
+
+		else if (!strcmp(argv[i], "run")) {
+			r = cc1800_run(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	PATCH command, usage: patch <running elf> <rebuilt elf> [area=<addr>[:<size>]]
+		//
+
+		else if (!strcmp(argv[i], "patch")) {
+			r = cc1800_patch(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	COVERAGE command, usage: coverage <elf> [key=value ...]
+		//
+
+		else if (!strcmp(argv[i], "coverage")) {
+			r = cc1800_coverage(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	BENCH command, usage: bench [check|save <baseline>] [<name>...]
+		//
+
+		else if (!strcmp(argv[i], "bench")) {
+			r = cc1800_bench(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	BUDGET command, usage: budget [<size>|off]
+		//
+
+		else if (!strcmp(argv[i], "budget")) {
+			r = cc1800_budget(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	SHAPE command, usage: shape [device|fleet <rate>|off [burst=<size>]]
+		//
+
+		else if (!strcmp(argv[i], "shape")) {
+			r = cc1800_shape(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	MOUNT command, usage: mount <dir> [block=<size>] [readahead=<blocks>]
+		//
+
+		else if (!strcmp(argv[i], "mount")) {
+			r = cc1800_mount(s, argc - i - 1, argv + i + 1);
+			if (r < 0) return r;
+			i += r;
+		}
+
+		//
+		//	SHELL command, keeps the device claimed and reads commands from stdin
+		//
+
+		else if (!strcmp(argv[i], "shell")) {
+
+			if (s->interactive) {
+				fprintf(stderr, "ERROR: already in the interactive shell\n");
+				return -1;
+			}
+
+			r = cc1800_shell(s);
+			if (r < 0) return r;
+		}
+
 		else {
 			fprintf(stderr, "ERROR: unknown command '%s'\n", argv[i]);
 			return -1;
@@ -408,24 +790,61 @@ int cc1800_fiddle (struct usb_dev_handle *handle, int argc, const char **argv) {
 static const char *help =
 
 "Use any number of consecutive commands as arguments:\n"
-"    write <address> <file>\n"
-"    read <address> <length> <file>\n"
+"    write <address> <file|directory> [+<stage>...]\n"
+"    read <address> <length> <file> [+<stage>...]\n"
+"    dump <address> <length> <store> <board> [lz4=1] [block=<size>] [buf=<address>[:<size>]] [stub=<address>]\n"
 "    exec\n"
+"    memmap [on|off]\n"
+"    probe [show|forget] [at=<address>] [max=<bytes>]\n"
+"    norflash <offset> <file> [sector=<size>] [buf=<address>] [stub=<address>]\n"
+"             [spi=<data>:<status>:<busy mask>:<cs>:<cs mask>] [force=1]\n"
+"    watermark <address> <file> <name>=<start>:<size>... [pattern=<word>] [stub=<address>]\n"
+"    monitor [wait | <address> <file> [stub=<address>] [vectors=<address>] [elf=<file>]]\n"
+"    run <address> <file> [count=<n>] [stub=<address>] [vectors=<address>] [elf=<file>]\n"
+"    patch <running elf> <rebuilt elf> [area=<address>[:<size>]]\n"
+"    coverage <elf> [prefix=<dir>] [strip=<n>] [section=<name>] [block=<size>] [stub=<address>]\n"
+"    bench [check <baseline> | save <baseline>] [<name>...]\n"
+"    shape [device|fleet <rate>|off [burst=<size>]]\n"
+"    budget [<size>|off]\n"
+"    mount <dir> [block=<size>] [readahead=<blocks>]\n"
+"    shell\n"
+"\n"
+"Or, without a device, analyze a usbmon capture (text or pcap, \"-\" for stdin),\n"
+"simulate a flashing station (see plan.example) or work with a dump store:\n"
+"    analyze <capture> [dev=<bus>:<dev>]\n"
+"    plan <description> [<setting>=<value>...]\n"
+"    store <dir> add <board> <file> [<address>] | list | restore <board> <file> | regions <board>\n"
+"\n"
+"Or run a production station, flashing one board after another (see station.example):\n"
+"    station <job> [<setting>=<value>...]\n"
 "\n";
 
 int main (int argc, const char **argv) {
 
-	int r = 0;
+	int r;
 	struct usb_device *dev;
 	struct usb_dev_handle *handle;
+	struct cc1800_session s;
 
 	printf("CC1800 usbtool v1.0.0 by Ignacio Garcia Perez <iggarpe@gmail.com>\n");
 
 	if (argc < 2) {
 		fputs(help, stderr);
+		pipeline_help();
 		return 1;
 	}
 
+	// Offline commands, no device needed
+
+	if (!strcmp(argv[1], "analyze"))
+		return cc1800_analyze(argc - 2, argv + 2) < 0;
+	if (!strcmp(argv[1], "plan"))
+		return cc1800_plan(argc - 2, argv + 2) < 0;
+	if (!strcmp(argv[1], "store"))
+		return cc1800_store(argc - 2, argv + 2) < 0;
+	if (!strcmp(argv[1], "station"))
+		return cc1800_station(argc - 2, argv + 2) < 0;
+
 	dev = cc1800_find();
 	if (dev == NULL) {
 		fprintf(stderr, "ERROR: cannot find CC1800 device\n");
@@ -434,25 +853,17 @@ int main (int argc, const char **argv) {
 
 	printf("Found device %s at bus %s\n", dev->filename, dev->bus->dirname);
 
-	handle = usb_open(dev);
-	if (handle == NULL) {
-		fprintf(stderr, "ERROR: cannot open device (%s)\n", strerror(errno));
-		return 1;
-	}
-
-	r = usb_set_configuration(handle, 1);
-	if (r < 0)
-		fprintf(stderr, "ERROR: cannot set configuration\n");
+	handle = cc1800_open(dev);
+	if (handle == NULL) return 1;
 
-	else {
-		r = usb_claim_interface(handle, 0);
-		if (r < 0)
-			fprintf(stderr, "ERROR: cannot claim interface\n");
+	memset(&s, 0, sizeof(s));
+	s.handle = handle;
+	r = cc1800_fiddle(&s, argc - 1, argv + 1);
+	budget_command(NULL);
+	file_cache_free(s.files);
+	mem_cache_free(s.mem);
 
-		else r = cc1800_fiddle(handle, argc, argv);
-	}
-
-	usb_close(handle);
+	cc1800_close(handle);
 	return r;
 }
 
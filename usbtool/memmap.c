@@ -0,0 +1,180 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	SoC memory maps. A bulk transfer to or from an address the loader cannot
+//	reach hangs the device, and all we get is a timeout several seconds
+//	later, so every write, read and exec is checked against the map before
+//	touching USB. Regions also say how big a single bulk transfer may be
+//	(so that each one stays well within the USB timeout) and whether writes
+//	are read back and compared.
+//
+//	More specific regions go first, the first one holding the address wins.
+//
+
+static const struct cc1800_region cc1800_regions [] = {
+	{ "mailbox",	0x00102AD4,	0x00000008,	MEM_READ | MEM_WRITE,						0 },	// CPU info string, see stub.c
+	{ "loader",		0x00102000,	0x00002000,	MEM_READ,									0 },	// USB loader code, data and stacks
+	{ "sram",		0x00100000,	0x00002000,	MEM_READ | MEM_WRITE | MEM_EXEC | MEM_VERIFY,	0 },
+	{ "io",			0x04000000,	0x0C000000,	0,											0 },	// Peripheral registers
+	{ "sdram",		0x40000000,	0x04000000,	MEM_READ | MEM_WRITE | MEM_EXEC | MEM_VERIFY,	1 << 20 },
+	{ NULL }
+};
+
+//
+//	SoCs, matched by the start of the loader CPU info string. The first one
+//	is also used when nothing matches.
+//
+
+static const struct cc1800_soc socs [] = {
+	{ "CC1800",	"CN2009",	cc1800_regions },
+	{ NULL }
+};
+
+static const struct cc1800_region unchecked = {
+	"unchecked", 0, 0, MEM_READ | MEM_WRITE | MEM_EXEC | MEM_VERIFY, 0
+};
+
+const struct cc1800_soc *memmap_soc (struct cc1800_session *s) {
+
+	const struct cc1800_soc *soc;
+
+	if (s->soc == NULL) {
+		for (soc = socs; soc->name != NULL && strncmp(s->cpu_info, soc->cpu_info, strlen(soc->cpu_info)); soc++);
+		s->soc = soc->name != NULL ? soc : socs;
+	}
+
+	return s->soc;
+}
+
+//
+//	Check that [addr, addr + len) lies in a single region allowing the given
+//	access (MEM_READ, MEM_WRITE or MEM_EXEC). Returns the region, or NULL
+//	after printing why not.
+//
+
+const struct cc1800_region *memmap_check (struct cc1800_session *s, unsigned long addr, unsigned long len, int access) {
+
+	const struct cc1800_soc *soc = memmap_soc(s);
+	const struct cc1800_region *reg;
+	const char *what = access == MEM_WRITE ? "write" : access == MEM_READ ? "read" : "execute";
+	unsigned long last = addr + (len ? len - 1 : 0);
+
+	if (s->unchecked) return &unchecked;
+
+	for (reg = soc->regions; reg->name != NULL; reg++)
+		if (addr >= reg->base && addr - reg->base < reg->size) break;
+
+	if (reg->name == NULL) {
+		fprintf(stderr, "ERROR: cannot %s at 0x%08lX, not in the %s memory map\n", what, addr, soc->name);
+		return NULL;
+	}
+
+	if (last < addr || last - reg->base >= reg->size) {
+		fprintf(stderr, "ERROR: cannot %s 0x%08lX-0x%08lX, past the end of %s (0x%08lX-0x%08lX)\n",
+			what, addr, last, reg->name, reg->base, reg->base + reg->size - 1);
+		return NULL;
+	}
+
+	if (!(reg->flags & access)) {
+		fprintf(stderr, "ERROR: cannot %s at 0x%08lX, %s (0x%08lX-0x%08lX) does not allow it\n",
+			what, addr, reg->name, reg->base, reg->base + reg->size - 1);
+		return NULL;
+	}
+
+	return reg;
+}
+
+//
+//	Bulk transfers split as the region asks (or the transfer profile, see
+//	probe.c), holding the device throughout.
+//	The loader address is left at the start, where a following exec expects
+//	it. Return the number of bytes transferred.
+//
+
+int memmap_upload (struct cc1800_session *s, const struct cc1800_region *reg, const char *data, unsigned long len, unsigned long addr) {
+
+	unsigned long off, n, chunk = probe_window(s->handle, reg, 1);
+	int r;
+
+	if (chunk == 0 || len <= chunk) return cc1800_upload(s->handle, data, len, addr);
+
+	r = cc1800_queue_enter(s->handle);
+	if (r < 0) return r;
+
+	for (off = 0; off < len; off += n) {
+		n = len - off < chunk ? len - off : chunk;
+		r = cc1800_upload(s->handle, data + off, n, addr + off);
+		if (r < 0 || (unsigned long)r < n) break;
+	}
+
+	if (r >= 0 && off >= len && !probe_at(s->handle, addr)) r = cc1800_req_set_address(s->handle, addr);
+	cc1800_queue_leave(s->handle);
+	if (r < 0) return r;
+	return off < len ? off + r : len;
+}
+
+int memmap_download (struct cc1800_session *s, const struct cc1800_region *reg, char *data, unsigned long len, unsigned long addr) {
+
+	unsigned long off, n, chunk = probe_window(s->handle, reg, 0);
+	int r;
+
+	if (chunk == 0 || len <= chunk) return cc1800_download(s->handle, data, len, addr);
+
+	r = cc1800_queue_enter(s->handle);
+	if (r < 0) return r;
+
+	for (off = 0; off < len; off += n) {
+		n = len - off < chunk ? len - off : chunk;
+		r = cc1800_download(s->handle, data + off, n, addr + off);
+		if (r < 0 || (unsigned long)r < n) break;
+	}
+
+	if (r >= 0 && off >= len && !probe_at(s->handle, addr)) r = cc1800_req_set_address(s->handle, addr);
+	cc1800_queue_leave(s->handle);
+	if (r < 0) return r;
+	return off < len ? off + r : len;
+}
+
+//
+//	MEMMAP command, usage: memmap [on|off]
+//	Returns the number of arguments used.
+//
+
+int cc1800_memmap (struct cc1800_session *s, int argc, const char **argv) {
+
+	const struct cc1800_soc *soc = memmap_soc(s);
+	const struct cc1800_region *reg;
+
+	if (argc > 0 && (!strcmp(argv[0], "on") || !strcmp(argv[0], "off"))) {
+		s->unchecked = !strcmp(argv[0], "off");
+		printf("Memory map checks %s\n", s->unchecked ? "disabled" : "enabled");
+		return 1;
+	}
+
+	printf("%s memory map%s:\n", soc->name, s->unchecked ? " (checks disabled)" : "");
+	for (reg = soc->regions; reg->name != NULL; reg++) {
+		printf("  0x%08lX-0x%08lX  %-8s  %c%c%c%s", reg->base, reg->base + reg->size - 1, reg->name,
+			reg->flags & MEM_READ ? 'r' : '-', reg->flags & MEM_WRITE ? 'w' : '-',
+			reg->flags & MEM_EXEC ? 'x' : '-', reg->flags & MEM_VERIFY ? " verify" : "");
+		if (reg->chunk) printf(" chunk %lu KB", reg->chunk >> 10);
+		printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,452 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "usbtool.h"
+#include "stubs/monitor.h"
+
+//==============================================================================
+//
+//	Resident monitor. Once a payload runs, the loader main loop is gone and
+//	with it every bulk transfer, so memory can no longer be read or written
+//	until the next power cycle. Started with "monitor", the payload runs
+//	under a stub that hands it a poll hook:
+//
+//		void (*poll) (void) = r0 at entry;
+//		...
+//		for (;;) { do_work(); poll(); }
+//
+//	Each call moves the bulk transfers the host has asked for meanwhile, so
+//	read, write, dump and mount keep working as long as the payload calls it
+//	more often than the USB timeout. The stub progress word counts polls,
+//	which is how "monitor" tells the payload is alive and how often it polls.
+//
+//	The loader interrupt controller and timers are not documented, so the
+//	hook is cooperative rather than chained to an interrupt.
+//
+//	With vectors=<address>, the stub also points the undefined instruction
+//	and abort vectors of the table there at its own handlers while the
+//	payload runs. A crash then leaves registers, fault status and address
+//	and the top of the stack in a record at the end of the stub, and returns
+//	to the loader, so one small read tells what happened (symbolized if the
+//	ELF is given) instead of a hung device. Where the vector table is on the
+//	CC1800 is not known, so it must be given.
+//
+
+#define MON_OP_RUN			1
+
+#define MON_ARG_ENTRY		0
+#define MON_ARG_CTRL		1
+#define MON_ARG_SAVE		2
+#define MON_ARG_IMAGE		3
+#define MON_ARG_IMAGE_LEN	4
+#define MON_ARG_DAMAGE		8
+#define MON_ARG_VECTORS		9
+
+#define MON_NO_VECTORS		0xFFFFFFFFUL
+#define MON_REACH			0x02000000		// Of the B in a vector, either way
+
+// Crash record, the end of the stub
+
+#define MON_CRASH_STACK		16
+#define MON_CRASH_SIZE		(4 * (21 + MON_CRASH_STACK))
+#define MON_CRASH_TYPE		0
+#define MON_CRASH_REGS		1
+#define MON_CRASH_CPSR		17
+#define MON_CRASH_FSR		18
+#define MON_CRASH_FAR		19
+#define MON_CRASH_NSTACK	20
+#define MON_CRASH_WORDS		21
+
+static struct cc1800_stub mon_stub;
+static struct usb_dev_handle *mon_handle;
+static struct mem_cache *mon_mem;		// Session cache, put away while running
+static unsigned long mon_vectors;
+static char *mon_elf;					// To symbolize crashes with
+static unsigned mon_runs;				// Payloads started so far
+static unsigned long mon_polls;
+static double mon_time, mon_start;
+
+//
+//	Read the crash record of the stub at base and show it, symbolized if the
+//	payload ELF is known. Returns 1 if the payload crashed, 0 if not.
+//
+
+static int mon_crash (struct cc1800_session *s, unsigned long base, const char *elf, unsigned run) {
+
+	static const char *kinds [] = { "", "undefined instruction", "prefetch abort", "data abort" };
+	static const char *regs [] = { "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
+		"r8", "r9", "r10", "r11", "r12", "sp", "lr", "pc" };
+	unsigned char buf [MON_CRASH_SIZE];
+	unsigned long w [MON_CRASH_SIZE / 4], type, n, i;
+	char *names [2 + MON_CRASH_STACK];
+	int r;
+
+	r = cc1800_download(s->handle, (char *)buf, MON_CRASH_SIZE, base + sizeof(monitor_stub) - MON_CRASH_SIZE);
+	if (r < 0) return r;
+
+	for (i = 0; i < MON_CRASH_SIZE / 4; i++)
+		w[i] = buf[4 * i] | (buf[4 * i + 1] << 8) | (buf[4 * i + 2] << 16) | ((unsigned long)buf[4 * i + 3] << 24);
+
+	type = w[MON_CRASH_TYPE];
+	if (type == 0) return 0;
+	if (type > 3) {
+		fprintf(stderr, "ERROR: bad crash record\n");
+		return -EIO;
+	}
+
+	n = w[MON_CRASH_NSTACK];
+	if (n > MON_CRASH_STACK) n = MON_CRASH_STACK;
+
+	// pc, lr and the stack words, all in one go
+
+	memset(names, 0, sizeof(names));
+	if (elf != NULL) {
+		unsigned long a [2 + MON_CRASH_STACK];
+		a[0] = w[MON_CRASH_REGS + 15];
+		a[1] = w[MON_CRASH_REGS + 14];
+		memcpy(a + 2, w + MON_CRASH_WORDS, n * sizeof(unsigned long));
+		if (patch_symbolize(s, elf, a, 2 + n, names, run) < 0)
+			printf("Warning: cannot symbolize with '%s'\n", elf);
+	}
+
+	printf("Payload crashed: %s at 0x%08lX", kinds[type], w[MON_CRASH_REGS + 15]);
+	if (names[0] != NULL) printf(" (%s)", names[0]);
+	if (names[1] != NULL) printf(", lr in %s", names[1]);
+	if (type > 1) printf(", address 0x%08lX, status 0x%03lX", w[MON_CRASH_FAR], w[MON_CRASH_FSR]);
+	printf("\n");
+
+	for (i = 0; i < 16; i++)
+		printf("  %-4s0x%08lX%s", regs[i], w[MON_CRASH_REGS + i], i % 4 == 3 ? "\n" : "");
+	printf("  cpsr 0x%08lX\n", w[MON_CRASH_CPSR]);
+
+	if (n > 0) printf("Stack:\n");
+	for (i = 0; i < n; i++) {
+		printf("  sp+0x%02lX  0x%08lX", i * 4, w[MON_CRASH_WORDS + i]);
+		if (names[2 + i] != NULL) printf("  %s", names[2 + i]);
+		printf("\n");
+	}
+	if (n < MON_CRASH_STACK) printf("  (stack unreadable past %lu words)\n", n);
+
+	for (i = 0; i < 2 + MON_CRASH_STACK; i++) free(names[i]);
+	return 1;
+}
+
+//
+//	The payload has returned: report, and give the session its cache back.
+//
+
+static void mon_done (struct cc1800_session *s, unsigned long result) {
+	if (mon_vectors == MON_NO_VECTORS || mon_crash(s, mon_stub.base, mon_elf, mon_runs) <= 0)
+		printf("Payload returned 0x%08lX after %.3f s\n", result, time_now() - mon_start);
+	free(mon_elf);
+	mon_elf = NULL;
+	stub_free(&mon_stub);
+	mon_handle = NULL;
+	if (s->mem == NULL) s->mem = mon_mem;
+	else mem_cache_free(mon_mem);
+	mon_mem = NULL;
+}
+
+static int mon_status (struct cc1800_session *s, int wait) {
+
+	unsigned long value;
+	double t;
+	int r;
+
+	if (mon_handle != s->handle || !mon_stub.running) {
+		printf("No payload running under the monitor\n");
+		return 0;
+	}
+
+	r = wait ? stub_wait(s, &mon_stub, ~0UL, &value) : stub_poll(s, &mon_stub, &value);
+	if (r < 0) return r;
+
+	if (r == 0) {
+		t = time_now();
+		printf("Payload running for %.3f s, %lu polls (%.0f/s since last asked)\n",
+			t - mon_start, value, (value - mon_polls) / (t - mon_time));
+		mon_polls = value;
+		mon_time = t;
+		return 0;
+	}
+
+	// Finished: stub_wait restores the CPU info
+
+	if (!wait) {
+		r = stub_wait(s, &mon_stub, ~0UL, &value);
+		if (r < 0) return r;
+	}
+	mon_done(s, value);
+	return 0;
+}
+
+//
+//	Which payload run is going on, 0 if none. Tells users of the monitor when
+//	what they know of the running payload is stale.
+//
+
+unsigned monitor_run (struct cc1800_session *s) {
+	return mon_handle == s->handle && mon_stub.running ? mon_runs : 0;
+}
+
+//
+//	Set the monitor control word (MONITOR_HOLD, MONITOR_FLUSH). With the hold
+//	bit set, the payload stays in its poll call after this, until the word is
+//	set again without it. A flush is waited for.
+//
+
+int monitor_control (struct cc1800_session *s, unsigned long ctrl) {
+
+	unsigned char w [4];
+	int i, r;
+
+	if (mon_handle != s->handle || !mon_stub.running) {
+		fprintf(stderr, "ERROR: no payload running under the monitor\n");
+		return -1;
+	}
+
+	for (i = 0; i < 4; i++) w[i] = ctrl >> (8 * i);
+	r = cc1800_upload(s->handle, (const char *)w, 4, mon_stub.base + STUB_ARG(MON_ARG_CTRL));
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot reach the monitor, is the payload polling?\n");
+		return r;
+	}
+
+	// Flushed within the poll call that took the word, so the first
+	// read back (the next poll) should see the bit clear
+
+	for (i = 0; i < 100 && (ctrl & MONITOR_FLUSH); i++) {
+		r = cc1800_download(s->handle, (char *)w, 4, mon_stub.base + STUB_ARG(MON_ARG_CTRL));
+		if (r < 0) {
+			fprintf(stderr, "ERROR: cannot reach the monitor, is the payload polling?\n");
+			return r;
+		}
+		if (!(w[0] & MONITOR_FLUSH)) return 0;
+	}
+
+	if (ctrl & MONITOR_FLUSH) {
+		fprintf(stderr, "ERROR: monitor did not flush the caches\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+//
+//	Upload a payload and set up the monitor stub to run it, keeping a copy of
+//	the loader image right after the stub, and catching crashes through the
+//	vector table at vectors unless MON_NO_VECTORS.
+//
+
+static int mon_prepare (struct cc1800_session *s, unsigned long addr, const char *data, unsigned long len, unsigned long base,
+	unsigned long vectors, int quiet) {
+
+	const struct cc1800_region *reg;
+	unsigned long save = (base + sizeof(monitor_stub) + 15) & ~15UL;
+	int r;
+
+	reg = memmap_check(s, addr, len, MEM_WRITE);
+	if (reg == NULL || memmap_check(s, addr, 4, MEM_EXEC) == NULL ||
+		memmap_check(s, base, sizeof(monitor_stub), MEM_WRITE | MEM_EXEC) == NULL ||
+		memmap_check(s, save, CC1800_LOADER_IMAGE_SIZE, MEM_WRITE) == NULL)
+		return -1;
+
+	if (addr < save + CC1800_LOADER_IMAGE_SIZE && base < addr + len) {
+		fprintf(stderr, "ERROR: the payload overlaps the monitor\n");
+		return -1;
+	}
+
+	if (vectors != MON_NO_VECTORS && (vectors & 31 ||
+		(base > vectors ? base + sizeof(monitor_stub) - vectors : vectors - base) >= MON_REACH)) {
+		fprintf(stderr, "ERROR: the vectors must be 32 byte aligned and within 32 MB of the monitor\n");
+		return -1;
+	}
+
+	r = stub_init(s, &mon_stub, monitor_stub, sizeof(monitor_stub), base);
+	if (r < 0) return r;
+
+	stub_set(&mon_stub, STUB_PARAM_OP, MON_OP_RUN);
+	stub_set(&mon_stub, STUB_ARG(MON_ARG_ENTRY), addr);
+	stub_set(&mon_stub, STUB_ARG(MON_ARG_SAVE), save);
+	stub_set(&mon_stub, STUB_ARG(MON_ARG_IMAGE), CC1800_LOADER_IMAGE);
+	stub_set(&mon_stub, STUB_ARG(MON_ARG_IMAGE_LEN), CC1800_LOADER_IMAGE_SIZE);
+	stub_set(&mon_stub, STUB_ARG(MON_ARG_VECTORS), vectors);
+
+	if (!quiet) printf("Uploading payload to address 0x%08lX\n", addr);
+	r = memmap_upload(s, reg, data, len, addr);
+	if (r < 0) stub_free(&mon_stub);
+	return r;
+}
+
+//
+//	MONITOR command, usage:
+//	monitor [wait | <address> <file> [stub=<address>] [vectors=<address>] [elf=<file>]]
+//	Returns the number of arguments used.
+//
+
+int cc1800_monitor (struct cc1800_session *s, int argc, const char **argv) {
+
+	unsigned long addr, len, base = CC1800_STUB_BASE, vectors = MON_NO_VECTORS;
+	const char *data, *elf = NULL; char *buf = NULL;
+	int n, r;
+
+	// Anything that does not start like a number is the next command
+
+	if (argc == 0 || !isdigit((unsigned char)argv[0][0])) {
+		r = mon_status(s, argc > 0 && !strcmp(argv[0], "wait"));
+		return r < 0 ? r : argc > 0 && !strcmp(argv[0], "wait");
+	}
+
+	if (scan_ulong(argv[0], &addr) < 0) return -1;
+
+	if (argc < 2) {
+		fprintf(stderr, "ERROR: monitor command requires an address and a file name\n");
+		return -1;
+	}
+
+	for (n = 2; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		if (!strncmp(argv[n], "stub=", 5)) r = scan_ulong(argv[n] + 5, &base);
+		else if (!strncmp(argv[n], "vectors=", 8)) r = scan_ulong(argv[n] + 8, &vectors);
+		else if (!strncmp(argv[n], "elf=", 4)) { elf = argv[n] + 4; r = 0; }
+		else {
+			fprintf(stderr, "ERROR: unknown monitor option '%s'\n", argv[n]);
+			return -1;
+		}
+		if (r < 0) return r;
+	}
+
+	if (mon_handle == s->handle && mon_stub.running) {
+		fprintf(stderr, "ERROR: a payload is already running under the monitor\n");
+		return -1;
+	}
+
+	if (s->files != NULL) r = file_cache_load(s->files, argv[1], &data, &len);
+	else { r = load_file(argv[1], &buf, &len); data = buf; }
+	if (r < 0) return r;
+
+	r = mon_prepare(s, addr, data, len, base, vectors, 0);
+	free(buf);
+	if (r < 0) return r;
+
+	r = stub_start(s, &mon_stub);
+	if (r < 0) { stub_free(&mon_stub); return r; }
+
+	// The payload changes memory behind the cache's back, so reads go to
+	// the device until it returns
+
+	mon_handle = s->handle;
+	mon_runs++;
+	mon_vectors = vectors;
+	mon_elf = elf != NULL ? strdup(elf) : NULL;
+	mon_mem = s->mem;
+	s->mem = NULL;
+	mon_polls = 0;
+	mon_start = mon_time = time_now();
+
+	printf("Payload running under the monitor at 0x%08lX\n", base);
+	return n;
+}
+
+//
+//	RUN command, usage:
+//	run <address> <file> [count=<n>] [stub=<address>] [vectors=<address>] [elf=<file>]
+//	Runs a payload to completion under the monitor, which brings the loader
+//	back afterwards, so that any number of payloads can run in one boot.
+//	Stops at the first crash (caught with vectors=). Returns the number of
+//	arguments used.
+//
+
+int cc1800_run (struct cc1800_session *s, int argc, const char **argv) {
+
+	unsigned long addr, len, base = CC1800_STUB_BASE, count = 1, k, result, damage, vectors = MON_NO_VECTORS;
+	double t0, t1, t2, total = 0, worst = 0;
+	const char *data, *elf = NULL; char *buf = NULL;
+	unsigned char w [4];
+	int n, r, crashed = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "ERROR: run command requires an address and a file name\n");
+		return -1;
+	}
+
+	r = scan_ulong(argv[0], &addr); if (r < 0) return r;
+
+	for (n = 2; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		if (!strncmp(argv[n], "count=", 6)) r = scan_ulong(argv[n] + 6, &count);
+		else if (!strncmp(argv[n], "stub=", 5)) r = scan_ulong(argv[n] + 5, &base);
+		else if (!strncmp(argv[n], "vectors=", 8)) r = scan_ulong(argv[n] + 8, &vectors);
+		else if (!strncmp(argv[n], "elf=", 4)) { elf = argv[n] + 4; r = 0; }
+		else {
+			fprintf(stderr, "ERROR: unknown run option '%s'\n", argv[n]);
+			return -1;
+		}
+		if (r < 0) return r;
+	}
+
+	if (mon_handle == s->handle && mon_stub.running) {
+		fprintf(stderr, "ERROR: a payload is already running under the monitor\n");
+		return -1;
+	}
+
+	if (s->files != NULL) r = file_cache_load(s->files, argv[1], &data, &len);
+	else { r = load_file(argv[1], &buf, &len); data = buf; }
+	if (r < 0) return r;
+
+	for (k = 0; k < count; k++) {
+
+		// A fresh copy each time, the last run may have changed its data
+
+		t0 = time_now();
+		r = mon_prepare(s, addr, data, len, base, vectors, k > 0);
+		if (r < 0) break;
+
+		t1 = time_now();
+		r = stub_run(s, &mon_stub, &result);
+		if (r >= 0) r = cc1800_download(s->handle, (char *)w, 4, base + STUB_ARG(MON_ARG_DAMAGE));
+		if (r >= 0 && vectors != MON_NO_VECTORS) r = crashed = mon_crash(s, base, elf, 0);
+		stub_free(&mon_stub);
+		if (s->mem != NULL) mem_cache_invalidate(s->mem);
+		if (r < 0) {
+			fprintf(stderr, "ERROR: lost the loader after run %lu\n", k + 1);
+			break;
+		}
+		if (crashed) {
+			fprintf(stderr, "ERROR: run %lu crashed\n", k + 1);
+			r = -1;
+			break;
+		}
+		t2 = time_now();
+
+		damage = w[0] | (w[1] << 8) | (w[2] << 16) | ((unsigned long)w[3] << 24);
+		printf("Run %lu returned 0x%08lX: upload %.3f ms, run %.3f ms, cycle %.3f ms", k + 1,
+			result, (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t2 - t0) * 1e3);
+		if (damage) printf(", %lu loader words put back", damage);
+		printf("\n");
+
+		total += t2 - t0;
+		if (t2 - t0 > worst) worst = t2 - t0;
+	}
+
+	free(buf);
+	if (r < 0) return r;
+
+	if (count > 1)
+		printf("%lu runs in %.3f s, %.3f ms per cycle on average, %.3f ms worst\n",
+			count, total, total * 1e3 / count, worst * 1e3);
+
+	return n;
+}
@@ -0,0 +1,510 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#ifdef CC1800_FUSE
+#define FUSE_USE_VERSION 26
+#include <fuse.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Target memory as files: a FUSE file system with one file per readable
+//	region of the memory map, so that dd, cmp, hexdump and friends work on
+//	target RAM directly. Only built with "make FUSE=1" (needs libfuse 2).
+//
+//	Accesses go through a block cache. Sequential reads fetch several blocks
+//	ahead in a single transfer, so large reads run at close to raw bulk
+//	speed, and writes stay in the cache until flushed, when adjacent dirty
+//	blocks are merged into a single upload.
+//
+
+#define MOUNT_BLOCK			(64 << 10)
+#define MOUNT_BLOCKS		256				// 16 MB of cache
+#define MOUNT_READAHEAD		16
+#define MOUNT_READAHEAD_MAX	(MOUNT_BLOCKS / 2)
+
+struct mount_block {
+	int reg;						// Region index, -1 if unused
+	unsigned long index;			// Block number in the region
+	int valid;						// Data loaded from the target
+	unsigned long lo, hi;			// Dirty range, empty if lo == hi
+	unsigned long lru;
+	char *data;
+};
+
+struct mount_cache {
+	struct cc1800_session *s;
+	const struct cc1800_region *regions;
+	unsigned long bsize;
+	int nblocks, readahead;
+	struct mount_block *blocks;
+	unsigned long tick;
+	int seq_reg;					// Where the last read ended, for read-ahead
+	unsigned long seq_off;
+	char *buf;						// Transfer buffer, readahead blocks
+	unsigned long hits, misses, fetched, flushed;
+};
+
+static unsigned long mount_size (struct mount_cache *mc, int reg, unsigned long index) {
+	unsigned long off = index * mc->bsize, size = mc->regions[reg].size;
+	return size - off < mc->bsize ? size - off : mc->bsize;
+}
+
+static struct mount_block *mount_find (struct mount_cache *mc, int reg, unsigned long index) {
+	int i;
+	for (i = 0; i < mc->nblocks; i++)
+		if (mc->blocks[i].reg == reg && mc->blocks[i].index == index) return &mc->blocks[i];
+	return NULL;
+}
+
+//
+//	Write back every dirty block, in address order, merging runs of blocks
+//	that are dirty end to end into single uploads. Writes are verified when
+//	the region asks for it.
+//
+
+static int mount_cmp (const void *a, const void *b) {
+	const struct mount_block *x = *(const struct mount_block **)a, *y = *(const struct mount_block **)b;
+	if (x->reg != y->reg) return x->reg - y->reg;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static int mount_flush (struct mount_cache *mc) {
+
+	struct mount_block *dirty [MOUNT_BLOCKS], *b;
+	const struct cc1800_region *reg;
+	unsigned long addr, len, n, max = mc->readahead * mc->bsize;
+	int i, k, ndirty = 0, r;
+
+	for (i = 0; i < mc->nblocks; i++)
+		if (mc->blocks[i].reg >= 0 && mc->blocks[i].lo < mc->blocks[i].hi) dirty[ndirty++] = &mc->blocks[i];
+	if (ndirty == 0) return 0;
+
+	qsort(dirty, ndirty, sizeof(dirty[0]), mount_cmp);
+
+	for (i = 0; i < ndirty; i = k) {
+
+		b = dirty[i];
+		reg = &mc->regions[b->reg];
+		addr = reg->base + b->index * mc->bsize + b->lo;
+		memcpy(mc->buf, b->data + b->lo, b->hi - b->lo);
+		len = b->hi - b->lo;
+
+		for (k = i + 1; k < ndirty; k++) {
+			if (dirty[k]->reg != b->reg || dirty[k]->index != dirty[k - 1]->index + 1) break;
+			if (dirty[k - 1]->hi != mount_size(mc, b->reg, dirty[k - 1]->index) || dirty[k]->lo != 0) break;
+			if (len + dirty[k]->hi > max) break;
+			memcpy(mc->buf + len, dirty[k]->data, dirty[k]->hi);
+			len += dirty[k]->hi;
+		}
+
+		r = memmap_upload(mc->s, reg, mc->buf, len, addr);
+		if (r >= 0 && (unsigned long)r < len) r = -EIO;
+
+		if (r >= 0 && (reg->flags & MEM_VERIFY)) {
+			for (n = 0; n < len && r >= 0; n += mc->bsize) {
+				r = memmap_download(mc->s, reg, mc->buf + max, len - n < mc->bsize ? len - n : mc->bsize, addr + n);
+				if (r >= 0 && memcmp(mc->buf + n, mc->buf + max, r)) r = -EIO;
+			}
+		}
+
+		if (r < 0) {
+			fprintf(stderr, "ERROR: cannot write back 0x%08lX (%lu bytes)\n", addr, len);
+			return r;
+		}
+
+		if (mc->s->mem != NULL) mem_cache_store(mc->s->mem, addr, mc->buf, len);
+		mc->flushed += len;
+		while (i < k) { dirty[i]->lo = dirty[i]->hi = 0; i++; }
+	}
+
+	return 0;
+}
+
+//
+//	Get a free block, evicting the least recently used one. Dirty data is
+//	written back first, all of it so that it gets merged.
+//
+
+static struct mount_block *mount_alloc (struct mount_cache *mc) {
+
+	struct mount_block *b = NULL;
+	int i;
+
+	for (i = 0; i < mc->nblocks; i++) {
+		if (mc->blocks[i].reg < 0) { b = &mc->blocks[i]; break; }
+		if (b == NULL || mc->blocks[i].lru < b->lru) b = &mc->blocks[i];
+	}
+
+	if (b->reg >= 0 && b->lo < b->hi && mount_flush(mc) < 0) return NULL;
+
+	b->reg = -1;
+	b->valid = 0;
+	b->lo = b->hi = 0;
+	return b;
+}
+
+//
+//	Load block 'index' of a region, and when reading sequentially also the
+//	blocks after it that are not cached yet, in a single transfer.
+//
+
+static int mount_fetch (struct mount_cache *mc, int reg, unsigned long index, int count) {
+
+	const struct cc1800_region *rg = &mc->regions[reg];
+	struct mount_block *b, *fetch [MOUNT_READAHEAD_MAX];
+	unsigned long last = (rg->size - 1) / mc->bsize, len = 0, size;
+	int i, n, r;
+
+	// A block with dirty data but nothing loaded must be written back first
+
+	b = mount_find(mc, reg, index);
+	if (b != NULL && b->lo < b->hi && (r = mount_flush(mc)) < 0) return r;
+
+	for (n = 1; n < count && n < mc->readahead && index + n <= last && mount_find(mc, reg, index + n) == NULL; n++);
+
+	// Blocks are taken before the transfer, evicting may need the buffer
+
+	for (i = 0; i < n; i++) {
+		b = mount_find(mc, reg, index + i);
+		if (b == NULL && (b = mount_alloc(mc)) == NULL) return -EIO;
+		b->reg = reg;
+		b->index = index + i;
+		b->lru = ++mc->tick;
+		fetch[i] = b;
+		len += mount_size(mc, reg, index + i);
+	}
+
+	r = memmap_download(mc->s, rg, mc->buf, len, rg->base + index * mc->bsize);
+	if (r >= 0 && (unsigned long)r < len) r = -EIO;
+	if (r < 0) {
+		for (i = 0; i < n; i++) if (!fetch[i]->valid) fetch[i]->reg = -1;
+		return r;
+	}
+
+	mc->misses++;
+	mc->fetched += len;
+
+	for (i = 0, len = 0; i < n; i++) {
+		size = mount_size(mc, fetch[i]->reg, fetch[i]->index);
+		memcpy(fetch[i]->data, mc->buf + len, size);
+		fetch[i]->valid = 1;
+		len += size;
+	}
+
+	return 0;
+}
+
+static int mount_read (struct mount_cache *mc, int reg, char *buf, unsigned long size, unsigned long off) {
+
+	struct mount_block *b;
+	unsigned long index, o, n, done = 0;
+	int r, count;
+
+	if (off >= mc->regions[reg].size) return 0;
+	if (size > mc->regions[reg].size - off) size = mc->regions[reg].size - off;
+
+	count = reg == mc->seq_reg && off == mc->seq_off ? mc->readahead : 1;
+
+	while (done < size) {
+
+		index = (off + done) / mc->bsize;
+		o = (off + done) % mc->bsize;
+		n = mount_size(mc, reg, index) - o;
+		if (n > size - done) n = size - done;
+
+		b = mount_find(mc, reg, index);
+		if (b != NULL && b->valid) mc->hits++;
+		else {
+			r = mount_fetch(mc, reg, index, count > 1 ? count : (int)((size - done + o + mc->bsize - 1) / mc->bsize));
+			if (r < 0) return r;
+			b = mount_find(mc, reg, index);
+		}
+
+		memcpy(buf + done, b->data + o, n);
+		b->lru = ++mc->tick;
+		done += n;
+	}
+
+	mc->seq_reg = reg;
+	mc->seq_off = off + size;
+	return size;
+}
+
+static int mount_write (struct mount_cache *mc, int reg, const char *buf, unsigned long size, unsigned long off) {
+
+	struct mount_block *b;
+	unsigned long index, o, n, done = 0;
+
+	if (off >= mc->regions[reg].size) return -ENOSPC;
+	if (size > mc->regions[reg].size - off) size = mc->regions[reg].size - off;
+
+	while (done < size) {
+
+		index = (off + done) / mc->bsize;
+		o = (off + done) % mc->bsize;
+		n = mount_size(mc, reg, index) - o;
+		if (n > size - done) n = size - done;
+
+		b = mount_find(mc, reg, index);
+		if (b == NULL) {
+			b = mount_alloc(mc);
+			if (b == NULL) return -EIO;
+			b->reg = reg;
+			b->index = index;
+		}
+
+		// Blocks written without being read keep a single dirty range, so
+		// a write that leaves a hole in it needs the rest loaded first
+
+		if (!b->valid && b->lo < b->hi && (o > b->hi || o + n < b->lo)) {
+			int r = mount_fetch(mc, reg, index, 1);
+			if (r < 0) return r;
+		}
+
+		memcpy(b->data + o, buf + done, n);
+		if (b->lo == b->hi) { b->lo = o; b->hi = o + n; }
+		else { if (o < b->lo) b->lo = o; if (o + n > b->hi) b->hi = o + n; }
+		if (b->lo == 0 && b->hi == mount_size(mc, reg, index)) b->valid = 1;
+		b->lru = ++mc->tick;
+		done += n;
+	}
+
+	return size;
+}
+
+static void mount_free (struct mount_cache *mc) {
+	int i;
+	for (i = 0; i < mc->nblocks; i++) free(mc->blocks[i].data);
+	free(mc->blocks);
+	free(mc->buf);
+	free(mc);
+}
+
+static struct mount_cache *mount_new (struct cc1800_session *s, unsigned long bsize, int readahead) {
+
+	struct mount_cache *mc;
+	unsigned long n;
+	int i;
+
+	mc = (struct mount_cache *)calloc(1, sizeof(*mc));
+	if (mc == NULL) return NULL;
+
+	mc->s = s;
+	mc->regions = memmap_soc(s)->regions;
+	mc->bsize = bsize;
+
+	// Under a memory budget the cache and the read-ahead shrink to fit,
+	// the transfer buffer taking readahead + 1 blocks of it
+
+	n = budget_count(bsize, MOUNT_BLOCKS + readahead + 1, 3);
+	if (readahead > (n - 1) / 2) readahead = (n - 1) / 2;
+	mc->nblocks = n - readahead - 1 < MOUNT_BLOCKS ? n - readahead - 1 : MOUNT_BLOCKS;
+	mc->readahead = readahead;
+	mc->seq_reg = -1;
+	mc->blocks = (struct mount_block *)calloc(mc->nblocks, sizeof(*mc->blocks));
+	mc->buf = (char *)malloc((readahead + 1) * bsize);
+	if (mc->blocks == NULL || mc->buf == NULL) {
+		free(mc->blocks);
+		free(mc->buf);
+		free(mc);
+		return NULL;
+	}
+
+	for (i = 0; i < mc->nblocks; i++) {
+		mc->blocks[i].reg = -1;
+		mc->blocks[i].data = (char *)malloc(bsize);
+		if (mc->blocks[i].data == NULL) {
+			mount_free(mc);
+			return NULL;
+		}
+	}
+
+	return mc;
+}
+
+//==============================================================================
+//
+//	FUSE glue. Runs single threaded in the foreground until unmounted
+//	("fusermount -u <dir>" or Ctrl-C).
+//
+
+#ifdef CC1800_FUSE
+
+static struct mount_cache *mount_cache (void) {
+	return (struct mount_cache *)fuse_get_context()->private_data;
+}
+
+static int mount_region (const char *path) {
+
+	struct mount_cache *mc = mount_cache();
+	int i;
+
+	if (*path++ != '/') return -1;
+	for (i = 0; mc->regions[i].name != NULL; i++)
+		if ((mc->regions[i].flags & MEM_READ) && !strcmp(mc->regions[i].name, path)) return i;
+
+	return -1;
+}
+
+static int fs_getattr (const char *path, struct stat *st) {
+
+	struct mount_cache *mc = mount_cache();
+	int reg;
+
+	memset(st, 0, sizeof(*st));
+
+	if (!strcmp(path, "/")) {
+		st->st_mode = S_IFDIR | 0755;
+		st->st_nlink = 2;
+		return 0;
+	}
+
+	reg = mount_region(path);
+	if (reg < 0) return -ENOENT;
+
+	st->st_mode = S_IFREG | (mc->regions[reg].flags & MEM_WRITE ? 0644 : 0444);
+	st->st_nlink = 1;
+	st->st_size = mc->regions[reg].size;
+	return 0;
+}
+
+static int fs_readdir (const char *path, void *buf, fuse_fill_dir_t fill, off_t off, struct fuse_file_info *fi) {
+
+	struct mount_cache *mc = mount_cache();
+	int i;
+
+	if (strcmp(path, "/")) return -ENOENT;
+
+	fill(buf, ".", NULL, 0);
+	fill(buf, "..", NULL, 0);
+	for (i = 0; mc->regions[i].name != NULL; i++)
+		if (mc->regions[i].flags & MEM_READ) fill(buf, mc->regions[i].name, NULL, 0);
+
+	return 0;
+}
+
+static int fs_open (const char *path, struct fuse_file_info *fi) {
+
+	struct mount_cache *mc = mount_cache();
+	int reg = mount_region(path);
+
+	if (reg < 0) return -ENOENT;
+	if ((fi->flags & O_ACCMODE) != O_RDONLY && !(mc->regions[reg].flags & MEM_WRITE)) return -EACCES;
+
+	fi->fh = reg;
+	fi->direct_io = 1;				// Target memory is not ours to cache in the kernel
+	return 0;
+}
+
+static int fs_read (const char *path, char *buf, size_t size, off_t off, struct fuse_file_info *fi) {
+	return mount_read(mount_cache(), fi->fh, buf, size, off);
+}
+
+static int fs_write (const char *path, const char *buf, size_t size, off_t off, struct fuse_file_info *fi) {
+	return mount_write(mount_cache(), fi->fh, buf, size, off);
+}
+
+static int fs_truncate (const char *path, off_t size) {
+	return mount_region(path) < 0 ? -ENOENT : 0;		// Memory does not shrink, let "dd of=" work
+}
+
+static int fs_flush (const char *path, struct fuse_file_info *fi) {
+	return mount_flush(mount_cache());
+}
+
+static int fs_fsync (const char *path, int datasync, struct fuse_file_info *fi) {
+	return mount_flush(mount_cache());
+}
+
+static struct fuse_operations fs_ops = {
+	.getattr	= fs_getattr,
+	.readdir	= fs_readdir,
+	.open		= fs_open,
+	.read		= fs_read,
+	.write		= fs_write,
+	.truncate	= fs_truncate,
+	.flush		= fs_flush,
+	.release	= fs_flush,
+	.fsync		= fs_fsync,
+};
+
+#endif
+
+//
+//	MOUNT command, usage: mount <dir> [block=<size>] [readahead=<blocks>]
+//	Returns the number of arguments used.
+//
+
+int cc1800_mount (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct mount_cache *mc;
+	unsigned long bsize = MOUNT_BLOCK, ra = MOUNT_READAHEAD;
+	int n, r;
+
+	if (argc < 1) {
+		fprintf(stderr, "ERROR: mount command requires a directory\n");
+		return -1;
+	}
+
+	for (n = 1; n < argc; n++) {
+		if (!strncmp(argv[n], "block=", 6)) r = scan_ulong(argv[n] + 6, &bsize);
+		else if (!strncmp(argv[n], "readahead=", 10)) r = scan_ulong(argv[n] + 10, &ra);
+		else break;
+		if (r < 0) return r;
+	}
+
+	if (bsize < 512 || (bsize & (bsize - 1)) || ra < 1 || ra > MOUNT_READAHEAD_MAX) {
+		fprintf(stderr, "ERROR: block size must be a power of two from 512, read-ahead 1 to %d blocks\n", MOUNT_READAHEAD_MAX);
+		return -1;
+	}
+
+#ifdef CC1800_FUSE
+	{
+		char *fargv [] = { "usbtool", (char *)argv[0], "-f", "-s", "-o", "fsname=cc1800,big_writes", NULL };
+
+		mc = mount_new(s, bsize, ra);
+		if (mc == NULL) {
+			fprintf(stderr, "ERROR: cannot allocate memory\n");
+			return -1;
+		}
+
+		printf("Mounting target memory on '%s', unmount with: fusermount -u %s\n", argv[0], argv[0]);
+		fflush(stdout);
+
+		r = fuse_main(6, fargv, &fs_ops, mc);
+		if (r == 0) r = mount_flush(mc);
+
+		printf("%lu hits, %lu misses, %lu bytes fetched, %lu bytes written back\n",
+			mc->hits, mc->misses, mc->fetched, mc->flushed);
+		mount_free(mc);
+
+		if (r != 0) {
+			fprintf(stderr, "ERROR: cannot mount '%s'\n", argv[0]);
+			return -1;
+		}
+	}
+#else
+	(void)mc; (void)mount_new; (void)mount_free; (void)mount_read; (void)mount_write;
+	fprintf(stderr, "ERROR: built without FUSE support, rebuild with: make FUSE=1\n");
+	return -1;
+#endif
+
+	return n;
+}
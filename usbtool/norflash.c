@@ -0,0 +1,373 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <zlib.h>
+
+#include "usbtool.h"
+#include "stubs/norflash.h"
+
+//==============================================================================
+//
+//	SPI NOR flash programming. A stub running on the target hashes every
+//	erase sector of the range to be written, and only the sectors whose hash
+//	differs from the new image are erased and programmed. Sectors that are
+//	blank in the new image are only erased, and their data is not sent.
+//	Sector data is streamed to the target double buffered, the next sector
+//	going up while the current one is being erased and programmed.
+//
+//	The SPI controller registers are not documented, so they are given as
+//	parameters. The defaults are those of the simulator (sim/sim.h).
+//
+
+#define NOR_OP_ID			1
+#define NOR_OP_HASH			2
+#define NOR_OP_READ			3
+#define NOR_OP_PROGRAM		4
+
+#define NOR_ARG_SPI			0			// 5 words: data, status, busy mask, cs, cs mask
+#define NOR_ARG_ADDR		5
+#define NOR_ARG_LEN			6
+#define NOR_ARG_SECTOR		7
+#define NOR_ARG_BUF0		8
+#define NOR_ARG_BUF1		9
+#define NOR_ARG_ERASE		10
+
+#define NOR_CRC_TABLE		1024		// Stub CRC32 table at the start of the buffers, hashes after it
+
+struct nor_opts {
+	unsigned long sector;
+	unsigned long buf;				// Target buffers: 2 sectors, job list and hashes
+	unsigned long stub;
+	unsigned long spi [5];
+	int force;
+};
+
+//
+//	Same hash as the stub computes, two 32 bit values per sector: the CRC32
+//	of the sector and a multiply and xorshift hash of its words. A NULL
+//	pointer hashes erased contents.
+//
+
+void norflash_hash (const unsigned char *p, unsigned long len, unsigned char *out) {
+
+	unsigned char erased [256];
+	unsigned int a = crc32(0, NULL, 0), b = 0x9E3779B9, w;
+	unsigned long n;
+
+	if (p == NULL) {
+		memset(erased, 0xFF, sizeof(erased));
+		for (n = 0; n < len; n += sizeof(erased))
+			a = crc32(a, erased, len - n < sizeof(erased) ? len - n : sizeof(erased));
+	}
+	else a = crc32(a, p, len);
+
+	for (; len >= 4; len -= 4, p += p != NULL ? 4 : 0) {
+		w = p == NULL ? 0xFFFFFFFF : p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+		b = (b + w) * 0x85EBCA6B;
+		b ^= b >> 16;
+	}
+
+	out[0] = a; out[1] = a >> 8; out[2] = a >> 16; out[3] = a >> 24;
+	out[4] = b; out[5] = b >> 8; out[6] = b >> 16; out[7] = b >> 24;
+}
+
+static int nor_parse (const char *arg, struct nor_opts *o) {
+
+	const char *v = strchr(arg, '=') + 1;
+	int n = v - arg - 1;
+	char *end;
+	int i;
+
+	if (n == 5 && !strncmp(arg, "force", n)) o->force = strtol(v, NULL, 0) != 0;
+	else if (n == 6 && !strncmp(arg, "sector", n)) return scan_ulong(v, &o->sector);
+	else if (n == 3 && !strncmp(arg, "buf", n)) return scan_ulong(v, &o->buf);
+	else if (n == 4 && !strncmp(arg, "stub", n)) return scan_ulong(v, &o->stub);
+	else if (n == 3 && !strncmp(arg, "spi", n)) {
+		for (i = 0; i < 5; i++) {
+			o->spi[i] = strtoul(v, &end, 0);
+			if (end == v || *end != (i < 4 ? ':' : 0)) {
+				fprintf(stderr, "ERROR: spi=<data>:<status>:<busy mask>:<cs>:<cs mask> expected\n");
+				return -1;
+			}
+			v = end + 1;
+		}
+	}
+	else {
+		fprintf(stderr, "ERROR: unknown norflash option '%s'\n", arg);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int nor_op (struct cc1800_session *s, struct cc1800_stub *stub, int op, unsigned long addr, unsigned long len, unsigned long *result) {
+	stub_set(stub, STUB_PARAM_OP, op);
+	stub_set(stub, STUB_PARAM_RX, 0);
+	stub_set(stub, STUB_ARG(NOR_ARG_ADDR), addr);
+	stub_set(stub, STUB_ARG(NOR_ARG_LEN), len);
+	return stub_run(s, stub, result);
+}
+
+//
+//	Fill the parts of the first and last sectors that are not being written
+//	with the current flash contents.
+//
+
+static int nor_merge (struct cc1800_session *s, struct cc1800_stub *stub, struct nor_opts *o,
+	unsigned char *image, unsigned long start, unsigned long from, unsigned long to)
+{
+	unsigned long a = from - start, b = to - start, sec, result;
+	unsigned char *tmp;
+	int r;
+
+	tmp = (unsigned char *)malloc(o->sector);
+	if (tmp == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	for (sec = 0; sec < b + o->sector; sec += o->sector) {
+
+		if (!(a > sec && a < sec + o->sector) && !(b > sec && b < sec + o->sector)) continue;
+
+		r = nor_op(s, stub, NOR_OP_READ, start + sec, o->sector, &result);
+		if (r >= 0) r = cc1800_download(s->handle, (char *)tmp, o->sector, o->buf);
+		if (r < 0) {
+			fprintf(stderr, "ERROR: cannot read flash at 0x%08lX\n", start + sec);
+			free(tmp);
+			return r;
+		}
+
+		if (a > sec) memcpy(image + sec, tmp, a - sec);
+		if (b < sec + o->sector) memcpy(image + b, tmp + b - sec, sec + o->sector - b);
+	}
+
+	free(tmp);
+	return 0;
+}
+
+//
+//	Program the job list: sectors indexes in jobs[], flash addresses (with
+//	bit 0 set for sectors already erased, bit 1 for sectors left erased)
+//	in list[].
+//
+
+static int nor_program (struct cc1800_session *s, struct cc1800_stub *stub, struct nor_opts *o,
+	const unsigned char *image, int njobs, const int *jobs, const unsigned char *list)
+{
+	unsigned long buf [2] = { o->buf, o->buf + o->sector }, list_addr = o->buf + 2 * o->sector, value;
+	int k, d, r, used [2];
+
+	for (k = 0; k < njobs && (list[k * 4] & 2); k++);
+
+	r = cc1800_upload(s->handle, (const char *)list, njobs * 4, list_addr);
+	if (r >= 0 && k < njobs) r = cc1800_upload(s->handle, (const char *)image + jobs[k] * o->sector, o->sector, buf[0]);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot upload flash data\n");
+		return r;
+	}
+
+	stub_set(stub, STUB_PARAM_OP, NOR_OP_PROGRAM);
+	stub_set(stub, STUB_PARAM_RX, 1);
+	stub_set(stub, STUB_ARG(NOR_ARG_ADDR), list_addr);
+	stub_set(stub, STUB_ARG(NOR_ARG_LEN), njobs);
+
+	r = stub_start(s, stub); if (r < 0) return r;
+
+	// Data sector d goes into the buffer data sector d - 2 used, once the
+	// job that used it is done
+
+	used[0] = k;
+	for (d = 1, k++; k < njobs; k++) {
+		if (list[k * 4] & 2) continue;
+		r = stub_wait(s, stub, d >= 2 ? used[d & 1] + 1 : 0, &value);
+		if (r < 0) return r;
+		if (r > 0) break;
+		r = cc1800_upload(s->handle, (const char *)image + jobs[k] * o->sector, o->sector, buf[d & 1]);
+		if (r < 0) {
+			fprintf(stderr, "ERROR: cannot upload flash data\n");
+			return r;
+		}
+		used[d++ & 1] = k;
+	}
+
+	if (stub->running) {
+		r = stub_wait(s, stub, ~0UL, &value);
+		if (r < 0) return r;
+	}
+
+	if (value != 0) {
+		k = ~value;
+		if (k >= 0 && k < njobs) k = jobs[k];
+		fprintf(stderr, "ERROR: verify failed for sector %d\n", k);
+		return -1;
+	}
+
+	return 0;
+}
+
+//
+//	NORFLASH command, usage: norflash <offset> <file> [key=value ...]
+//	Returns the number of arguments used.
+//
+
+int cc1800_norflash (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct nor_opts o = {
+		4096, CC1800_SDRAM_BASE, CC1800_STUB_BASE,
+		{ 0x0C000000, 0x0C000004, 0x01, 0x0C000010, 0x01 }, 0
+	};
+	struct cc1800_stub stub;
+	unsigned long offset, len, start, end, nsec, id, size, result, i;
+	unsigned char *image = NULL, *old = NULL, *list = NULL, hash [8], ff [8];
+	const char *data; char *buf = NULL;
+	int n, r, njobs = 0, nblank = 0, *jobs = NULL;
+	double t0, t1, t2;
+
+	if (argc < 2) {
+		fprintf(stderr, "ERROR: norflash command requires two arguments (offset and file name)\n");
+		return -1;
+	}
+
+	r = scan_ulong(argv[0], &offset); if (r < 0) return r;
+	for (n = 2; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		r = nor_parse(argv[n], &o);
+		if (r < 0) return r;
+	}
+
+	if (o.sector != 4096 && o.sector != 65536) {
+		fprintf(stderr, "ERROR: sector size must be 4096 or 65536\n");
+		return -1;
+	}
+
+	if (s->files != NULL) r = file_cache_load(s->files, argv[1], &data, &len);
+	else { r = load_file(argv[1], &buf, &len); data = buf; }
+	if (r < 0) return r;
+
+	start = offset & ~(o.sector - 1);
+	end = (offset + len + o.sector - 1) & ~(o.sector - 1);
+	nsec = (end - start) / o.sector;
+
+	// Buffers hold two sectors plus the job list, or the hashes
+
+	if (memmap_check(s, o.stub, sizeof(norflash_stub), MEM_WRITE) == NULL ||
+		memmap_check(s, o.stub, sizeof(norflash_stub), MEM_EXEC) == NULL ||
+		memmap_check(s, o.buf, 2 * o.sector + nsec * 8 + 4, MEM_WRITE) == NULL)
+	{
+		free(buf);
+		return -1;
+	}
+
+	r = stub_init(s, &stub, norflash_stub, sizeof(norflash_stub), o.stub);
+	if (r < 0) { free(buf); return r; }
+
+	for (i = 0; i < 5; i++) stub_set(&stub, STUB_ARG(NOR_ARG_SPI + i), o.spi[i]);
+	stub_set(&stub, STUB_ARG(NOR_ARG_SECTOR), o.sector);
+	stub_set(&stub, STUB_ARG(NOR_ARG_BUF0), o.buf);
+	stub_set(&stub, STUB_ARG(NOR_ARG_BUF1), o.buf + o.sector);
+	stub_set(&stub, STUB_ARG(NOR_ARG_ERASE), o.sector == 4096 ? 0x20 : 0xD8);
+
+	// The stub scribbles over its buffers
+
+	if (s->mem != NULL) mem_cache_invalidate(s->mem);
+
+	t0 = time_now();
+
+	r = nor_op(s, &stub, NOR_OP_ID, 0, 0, &id);
+	if (r < 0) goto done;
+
+	size = (id & 0xFF) >= 16 && (id & 0xFF) < 32 ? 1UL << (id & 0xFF) : 0;
+	printf("NOR flash ID %06lX (%lu KB)\n", id, size >> 10);
+
+	if (id == 0 || id == 0xFFFFFF) {
+		fprintf(stderr, "ERROR: no NOR flash found\n");
+		r = -1; goto done;
+	}
+
+	if (size != 0 && (offset >= size || len > size - offset)) {
+		fprintf(stderr, "ERROR: data does not fit in the flash\n");
+		r = -1; goto done;
+	}
+
+	image = (unsigned char *)malloc(end - start);
+	old = (unsigned char *)malloc(nsec * 8);
+	list = (unsigned char *)malloc(nsec * 4);
+	jobs = (int *)malloc(nsec * sizeof(int));
+	if (image == NULL || old == NULL || list == NULL || jobs == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		r = -1; goto done;
+	}
+
+	memset(image, 0xFF, end - start);
+	memcpy(image + offset - start, data, len);
+
+	// Hash the current contents
+
+	r = nor_op(s, &stub, NOR_OP_HASH, start, end - start, &result);
+	if (r >= 0) r = cc1800_download(s->handle, (char *)old, nsec * 8, o.buf + NOR_CRC_TABLE);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot hash flash contents\n");
+		goto done;
+	}
+
+	r = nor_merge(s, &stub, &o, image, start, offset, offset + len);
+	if (r < 0) goto done;
+
+	t1 = time_now();
+
+	// Build the job list
+
+	norflash_hash(NULL, o.sector, ff);
+
+	for (i = 0; i < nsec; i++) {
+		norflash_hash(image + i * o.sector, o.sector, hash);
+		if (!o.force && !memcmp(hash, old + i * 8, 8)) continue;
+		result = start + i * o.sector;
+		if (!o.force && !memcmp(old + i * 8, ff, 8)) result |= 1;
+		if (!memcmp(hash, ff, 8)) { result |= 2; nblank++; }
+		list[njobs * 4 + 0] = result;
+		list[njobs * 4 + 1] = result >> 8;
+		list[njobs * 4 + 2] = result >> 16;
+		list[njobs * 4 + 3] = result >> 24;
+		jobs[njobs++] = i;
+	}
+
+	if (njobs > 0) {
+		r = nor_program(s, &stub, &o, image, njobs, jobs, list);
+		if (r < 0) goto done;
+	}
+
+	t2 = time_now();
+
+	printf("%d sectors programmed, %d of them only erased, %lu unchanged (hash %.3f s, program %.3f s)\n",
+		njobs, nblank, nsec - njobs, t1 - t0, t2 - t1);
+
+	// What rewriting every sector would have cost, at the rate just seen,
+	// counting blank sectors as no cheaper than the others
+
+	if (njobs > 0 && njobs < (int)nsec)
+		printf("Skipped %lu sectors, about %.3f s saved\n", nsec - njobs, (t2 - t1) / njobs * (nsec - njobs));
+
+	r = 0;
+
+done:
+	free(jobs);
+	free(list);
+	free(old);
+	free(image);
+	stub_free(&stub);
+	free(buf);
+
+	return r < 0 ? r : n;
+}
@@ -0,0 +1,841 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <elf.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Function level hot patching of a payload running under the monitor.
+//
+//	The rebuilt ELF is compared with the running one function by function.
+//	A function is unchanged if, relocated to where the running copy is, it
+//	comes out the same. Changed (and new) functions are relocated into the
+//	patch area, and the entry of the running copy becomes a branch there.
+//	All of it is written with the payload held in its poll call, and the
+//	caches are cleaned before it goes on.
+//
+//	Relocation needs the rebuilt ELF linked with -Wl,-q (--emit-relocs):
+//	branches are found from the code itself (with the ARM mapping symbols),
+//	but addresses in literal pools are only known from the relocations.
+//	Only ARM code is patched, Thumb functions are left alone.
+//
+//	Patches stack up for as long as the monitor run lasts: later patches
+//	are compared with what the earlier ones uploaded, and go further up the
+//	patch area, so that no code the payload may be in is ever overwritten.
+//
+
+#define PATCH_MAX_NAME		128
+#define PATCH_AREA_SIZE		0x10000			// Default patch area size
+#define PATCH_REACH			0x02000000		// Of a B instruction, either way
+
+struct patch_sym {
+	const char *name;
+	unsigned long addr, size;
+	int func, dup;					// Function or object, name not unique
+};
+
+struct patch_map {					// ARM mapping symbol
+	unsigned long addr;
+	char kind;						// 'a' ARM code, 't' Thumb code, 'd' data
+};
+
+struct patch_rel {
+	unsigned long addr;
+	int type;
+};
+
+struct patch_elf {
+	const char *file;
+	const unsigned char *data;
+	unsigned long len, shoff, shnum, shentsize;
+	struct patch_sym *syms;			// By address
+	struct patch_sym **names;		// By name
+	struct patch_map *maps;
+	struct patch_rel *rels;
+	int nsyms, nmaps, nrels;
+};
+
+// A function in the patch area
+
+struct patch_fn {
+	char name [PATCH_MAX_NAME];
+	unsigned long addr, size;
+	unsigned char *code;			// As uploaded
+};
+
+// A string literal copied to the patch area
+
+struct patch_str {
+	const char *text;
+	unsigned long addr;
+};
+
+// Work on one patch
+
+struct patch_ctx {
+	struct patch_elf *old, *new;
+	struct patch_fn *cur;			// Functions going to the patch area now
+	int ncur;
+	struct patch_str *strs;
+	int nstrs;
+	unsigned char *area;			// Host copy of the new part of the patch area
+	unsigned long base, used, alloc;
+	int place;						// Placing in the patch area, not comparing
+};
+
+static struct patch_fn *patch_done;		// Earlier patches in this monitor run
+static int patch_ndone;
+static struct patch_str *patch_done_strs;
+static int patch_ndone_strs;
+static unsigned patch_run;
+static unsigned long patch_next, patch_end;	// Free part of the patch area
+
+//==============================================================================
+//
+//	ELF access, 32 bit little endian ARM only
+//
+
+static unsigned long patch_u32 (const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void patch_put32 (unsigned char *p, unsigned long v) {
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static unsigned patch_u16 (const unsigned char *p) {
+	return p[0] | (p[1] << 8);
+}
+
+// Section header fields: type, flags, address, offset, size, link, info
+
+static void patch_section (struct patch_elf *e, unsigned long i, unsigned long *type, unsigned long *flags,
+	unsigned long *addr, unsigned long *off, unsigned long *size, unsigned long *link, unsigned long *info)
+{
+	const unsigned char *sh = e->data + e->shoff + i * e->shentsize;
+	*type = patch_u32(sh + 4); *flags = patch_u32(sh + 8); *addr = patch_u32(sh + 12);
+	*off = patch_u32(sh + 16); *size = patch_u32(sh + 20); *link = patch_u32(sh + 24); *info = patch_u32(sh + 28);
+}
+
+static int patch_sym_addr (const void *a, const void *b) {
+	const struct patch_sym *x = (const struct patch_sym *)a, *y = (const struct patch_sym *)b;
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static int patch_sym_name (const void *a, const void *b) {
+	return strcmp((*(struct patch_sym * const *)a)->name, (*(struct patch_sym * const *)b)->name);
+}
+
+static int patch_map_addr (const void *a, const void *b) {
+	const struct patch_map *x = (const struct patch_map *)a, *y = (const struct patch_map *)b;
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static int patch_rel_addr (const void *a, const void *b) {
+	const struct patch_rel *x = (const struct patch_rel *)a, *y = (const struct patch_rel *)b;
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static void patch_elf_free (struct patch_elf *e) {
+	free(e->syms);
+	free(e->names);
+	free(e->maps);
+	free(e->rels);
+	memset(e, 0, sizeof(*e));
+}
+
+//
+//	Collect function and object symbols, mapping symbols and the relocations
+//	of code sections.
+//
+
+static int patch_elf_open (struct patch_elf *e, const char *file, const unsigned char *data, unsigned long len) {
+
+	unsigned long i, j, type, flags, addr, off, size, link, info, stype, sflags, soff, ssize, slink, sinfo;
+	const unsigned char *p;
+	const char *name;
+	int nsyms = 0, nrels = 0;
+
+	memset(e, 0, sizeof(*e));
+	e->file = file;
+	e->data = data;
+	e->len = len;
+
+	if (len < 52 || memcmp(data, ELFMAG, SELFMAG) || data[EI_CLASS] != ELFCLASS32 ||
+		data[EI_DATA] != ELFDATA2LSB || patch_u16(data + 0x12) != EM_ARM)
+	{
+		fprintf(stderr, "ERROR: '%s' is not a 32 bit little endian ARM ELF file\n", file);
+		return -1;
+	}
+
+	e->shoff = patch_u32(data + 0x20);
+	e->shentsize = patch_u16(data + 0x2E);
+	e->shnum = patch_u16(data + 0x30);
+
+	if (e->shentsize < 40 || e->shoff > len || e->shnum > (len - e->shoff) / e->shentsize) {
+		fprintf(stderr, "ERROR: bad section headers in '%s'\n", file);
+		return -1;
+	}
+
+	for (i = 0; i < e->shnum; i++) {
+		patch_section(e, i, &type, &flags, &addr, &off, &size, &link, &info);
+		if (type != SHT_NOBITS && (off > len || size > len - off)) {
+			fprintf(stderr, "ERROR: section %lu of '%s' is truncated\n", i, file);
+			return -1;
+		}
+		if (type == SHT_SYMTAB && link < e->shnum) nsyms += size / 16;
+		else if (type == SHT_REL) nrels += size / 8;
+	}
+
+	e->syms = (struct patch_sym *)calloc(nsyms + 1, sizeof(struct patch_sym));
+	e->maps = (struct patch_map *)calloc(nsyms + 1, sizeof(struct patch_map));
+	e->rels = (struct patch_rel *)calloc(nrels + 1, sizeof(struct patch_rel));
+	e->names = (struct patch_sym **)calloc(nsyms + 1, sizeof(struct patch_sym *));
+	if (e->syms == NULL || e->maps == NULL || e->rels == NULL || e->names == NULL) {
+		fprintf(stderr, "ERROR: out of memory\n");
+		patch_elf_free(e);
+		return -1;
+	}
+
+	for (i = 0; i < e->shnum; i++) {
+
+		patch_section(e, i, &type, &flags, &addr, &off, &size, &link, &info);
+
+		// Relocations of code, at their final addresses with -q
+
+		if (type == SHT_REL) {
+			if (info >= e->shnum) continue;
+			patch_section(e, info, &stype, &sflags, &addr, &soff, &ssize, &slink, &sinfo);
+			if (!(sflags & SHF_EXECINSTR)) continue;
+			for (j = 0; j + 8 <= size; j += 8) {
+				e->rels[e->nrels].addr = patch_u32(data + off + j);
+				e->rels[e->nrels].type = ELF32_R_TYPE(patch_u32(data + off + j + 4));
+				e->nrels++;
+			}
+			continue;
+		}
+
+		if (type != SHT_SYMTAB || link >= e->shnum) continue;
+
+		patch_section(e, link, &stype, &sflags, &addr, &soff, &ssize, &slink, &sinfo);
+
+		for (j = 16; j + 16 <= size; j += 16) {
+			p = data + off + j;
+			if (patch_u32(p) >= ssize || memchr(data + soff + patch_u32(p), 0, ssize - patch_u32(p)) == NULL) continue;
+			if (patch_u16(p + 14) == SHN_UNDEF || patch_u16(p + 14) >= SHN_LORESERVE) continue;
+			name = (const char *)data + soff + patch_u32(p);
+
+			if (name[0] == '$' && strchr("atd", name[1]) && (name[2] == 0 || name[2] == '.')) {
+				e->maps[e->nmaps].addr = patch_u32(p + 4);
+				e->maps[e->nmaps].kind = name[1];
+				e->nmaps++;
+				continue;
+			}
+
+			stype = ELF32_ST_TYPE(p[12]);
+			if ((stype != STT_FUNC && stype != STT_OBJECT) || patch_u32(p + 8) == 0 || !name[0]) continue;
+			e->syms[e->nsyms].name = name;
+			e->syms[e->nsyms].addr = patch_u32(p + 4);
+			e->syms[e->nsyms].size = patch_u32(p + 8);
+			e->syms[e->nsyms].func = stype == STT_FUNC;
+			e->nsyms++;
+		}
+	}
+
+	if (e->nsyms == 0) {
+		fprintf(stderr, "ERROR: no symbols in '%s', it must not be stripped\n", file);
+		patch_elf_free(e);
+		return -1;
+	}
+
+	qsort(e->syms, e->nsyms, sizeof(struct patch_sym), patch_sym_addr);
+	qsort(e->maps, e->nmaps, sizeof(struct patch_map), patch_map_addr);
+	qsort(e->rels, e->nrels, sizeof(struct patch_rel), patch_rel_addr);
+
+	for (i = 0; i < (unsigned long)e->nsyms; i++) e->names[i] = &e->syms[i];
+	qsort(e->names, e->nsyms, sizeof(struct patch_sym *), patch_sym_name);
+
+	for (i = 1; i < (unsigned long)e->nsyms; i++)
+		if (!strcmp(e->names[i - 1]->name, e->names[i]->name)) e->names[i - 1]->dup = e->names[i]->dup = 1;
+
+	return 0;
+}
+
+// What is loaded at an address, NULL if nothing. Section flags to *flags
+
+static const unsigned char *patch_elf_bytes (struct patch_elf *e, unsigned long addr, unsigned long len, unsigned long *flags) {
+
+	unsigned long i, type, a, off, size, link, info;
+
+	for (i = 0; i < e->shnum; i++) {
+		patch_section(e, i, &type, flags, &a, &off, &size, &link, &info);
+		if (!(*flags & SHF_ALLOC) || type == SHT_NOBITS || addr < a || addr - a > size || len > size - (addr - a)) continue;
+		return e->data + off + addr - a;
+	}
+
+	return NULL;
+}
+
+// The symbol an address falls in, if any
+
+static struct patch_sym *patch_elf_at (struct patch_elf *e, unsigned long addr) {
+
+	int lo = 0, hi = e->nsyms, m, i;
+
+	while (lo < hi) {
+		m = (lo + hi) / 2;
+		if (e->syms[m].addr <= addr) lo = m + 1; else hi = m;
+	}
+
+	for (i = lo - 1; i >= 0 && i >= lo - 8; i--)
+		if (addr - e->syms[i].addr < e->syms[i].size) return &e->syms[i];
+
+	return NULL;
+}
+
+static struct patch_sym *patch_elf_named (struct patch_elf *e, const char *name) {
+
+	struct patch_sym key, *k = &key, **p;
+
+	key.name = name;
+	p = (struct patch_sym **)bsearch(&k, e->names, e->nsyms, sizeof(struct patch_sym *), patch_sym_name);
+	return p == NULL || (*p)->dup ? NULL : *p;
+}
+
+static int patch_elf_code (struct patch_elf *e, unsigned long addr) {
+
+	int lo = 0, hi = e->nmaps, m;
+
+	if (e->nmaps == 0) return 0;
+	while (lo < hi) {
+		m = (lo + hi) / 2;
+		if (e->maps[m].addr <= addr) lo = m + 1; else hi = m;
+	}
+	return lo > 0 && e->maps[lo - 1].kind == 'a';
+}
+
+static struct patch_rel *patch_elf_rel (struct patch_elf *e, unsigned long addr) {
+	struct patch_rel key = { addr, 0 };
+	return (struct patch_rel *)bsearch(&key, e->rels, e->nrels, sizeof(struct patch_rel), patch_rel_addr);
+}
+
+//==============================================================================
+//
+//	Relocation
+//
+
+static struct patch_fn *patch_find (struct patch_fn *fns, int n, const char *name) {
+	int i;
+	for (i = 0; i < n; i++) if (!strcmp(fns[i].name, name)) return &fns[i];
+	return NULL;
+}
+
+static long patch_area_grow (struct patch_ctx *c, unsigned long len) {
+
+	unsigned char *p;
+	unsigned long n = c->alloc ? c->alloc : 4096;
+
+	while (n < c->used + len) n *= 2;
+	if (n != c->alloc) {
+		p = (unsigned char *)realloc(c->area, n);
+		if (p == NULL) return -1;
+		memset(p + c->alloc, 0, n - c->alloc);
+		c->area = p;
+		c->alloc = n;
+	}
+
+	c->used += len;
+	return c->used - len;
+}
+
+//
+//	Where what the rebuilt payload has at addr is in the running one: the
+//	same offset into the same symbol, running, patched before or being
+//	patched now. Function entries are the running ones whenever there are,
+//	being redirected if patched, so that an unchanged caller compares equal
+//	however often its callees change. String literals have no symbol, and go
+//	to the patch area when they are not where they were. Other data without
+//	a symbol is taken to be where it was if its bytes are. Returns -1
+//	if not found.
+//
+
+static int patch_map (struct patch_ctx *c, unsigned long addr, unsigned long *to) {
+
+	const unsigned char *n, *o;
+	unsigned long flags, len, oflags;
+	struct patch_sym *sym, *old;
+	struct patch_fn *f;
+	long at;
+	int i;
+
+	sym = patch_elf_at(c->new, addr);
+
+	if (sym != NULL) {
+		if (sym->dup) return -1;
+		old = patch_elf_named(c->old, sym->name);
+		if (old != NULL && (old->func != sym->func || addr - sym->addr >= old->size)) old = NULL;
+		if (old != NULL && (addr == sym->addr || !sym->func)) { *to = old->addr + addr - sym->addr; return 0; }
+		if ((c->place && (f = patch_find(c->cur, c->ncur, sym->name)) != NULL) ||
+			(f = patch_find(patch_done, patch_ndone, sym->name)) != NULL)
+		{
+			*to = f->addr + addr - sym->addr;
+			return 0;
+		}
+		if (old == NULL) return -1;
+		*to = old->addr + addr - sym->addr;
+		return 0;
+	}
+
+	n = patch_elf_bytes(c->new, addr, 1, &flags);
+	if (n == NULL) return -1;
+
+	if (flags & SHF_STRINGS) {
+		len = strnlen((const char *)n, c->new->data + c->new->len - n);
+		if (patch_elf_bytes(c->new, addr, len + 1, &flags) == NULL) return -1;
+		o = patch_elf_bytes(c->old, addr, len + 1, &oflags);
+		if (o != NULL && !memcmp(o, n, len + 1)) { *to = addr; return 0; }
+
+		for (i = 0; i < patch_ndone_strs; i++)
+			if (!strcmp(patch_done_strs[i].text, (const char *)n)) { *to = patch_done_strs[i].addr; return 0; }
+		if (!c->place) return -1;
+
+		for (i = 0; i < c->nstrs; i++)
+			if (!strcmp(c->strs[i].text, (const char *)n)) { *to = c->strs[i].addr; return 0; }
+		if (!(c->nstrs & 15)) {
+			struct patch_str *p = (struct patch_str *)realloc(c->strs, (c->nstrs + 16) * sizeof(struct patch_str));
+			if (p == NULL) return -1;
+			c->strs = p;
+		}
+		at = patch_area_grow(c, len + 1);
+		if (at < 0) return -1;
+		memcpy(c->area + at, n, len + 1);
+		c->strs[c->nstrs].text = (const char *)n;
+		c->strs[c->nstrs].addr = *to = c->base + at;
+		c->nstrs++;
+		return 0;
+	}
+
+	for (len = 16; len > 0 && patch_elf_bytes(c->new, addr, len, &flags) == NULL; len--);
+	o = patch_elf_bytes(c->old, addr, len, &oflags);
+	if (o == NULL || memcmp(o, n, len)) return -1;
+	*to = addr;
+	return 0;
+}
+
+//
+//	Relocate a function of the rebuilt payload to run at addr, into out.
+//	Branches leaving the function and relocated words are fixed up, the rest
+//	is copied as is. Returns -1 if something it refers to cannot be found,
+//	reporting it when placing.
+//
+
+static int patch_relocate (struct patch_ctx *c, struct patch_sym *fn, unsigned long addr, unsigned char *out) {
+
+	unsigned long i, pc, insn, target, to;
+	struct patch_rel *rel;
+	const unsigned char *in;
+	unsigned long flags;
+	long off;
+	int type;
+
+	in = patch_elf_bytes(c->new, fn->addr, fn->size, &flags);
+	if (in == NULL) return -1;
+	memcpy(out, in, fn->size);
+
+	for (i = 0; i + 4 <= fn->size; i += 4) {
+
+		pc = fn->addr + i;
+		insn = patch_u32(in + i);
+		rel = patch_elf_rel(c->new, pc);
+		type = rel != NULL ? rel->type : R_ARM_NONE;
+
+		// Unrelocated branches out of the function (within a section)
+
+		if (rel == NULL && patch_elf_code(c->new, pc) && (insn & 0x0E000000) == 0x0A000000 && (insn >> 28) != 15) {
+			off = ((long)((insn & 0x00FFFFFF) ^ 0x00800000) - 0x00800000) * 4;
+			if (pc + 8 + off - fn->addr >= fn->size) type = R_ARM_JUMP24;
+		}
+
+		switch (type) {
+
+		case R_ARM_NONE: case R_ARM_V4BX:
+			continue;
+
+		case R_ARM_PC24: case R_ARM_CALL: case R_ARM_JUMP24:
+			if ((insn >> 28) == 15) goto unsupported;
+			off = ((long)((insn & 0x00FFFFFF) ^ 0x00800000) - 0x00800000) * 4;
+			target = pc + 8 + off;
+			if (target - fn->addr < fn->size) continue;
+			if (patch_map(c, target, &to) < 0) goto missing;
+			off = to - (addr + i + 8);
+			if (off < -PATCH_REACH || off >= PATCH_REACH) {
+				if (c->place) fprintf(stderr, "ERROR: %s cannot reach 0x%08lX from the patch area, move it closer\n", fn->name, to);
+				return -1;
+			}
+			patch_put32(out + i, (insn & 0xFF000000) | ((off >> 2) & 0x00FFFFFF));
+			continue;
+
+		case R_ARM_ABS32:
+			target = insn & ~1UL;
+			if (target - fn->addr < fn->size) to = target - fn->addr + addr;
+			else if (patch_map(c, target, &to) < 0) goto missing;
+			patch_put32(out + i, to | (insn & 1));
+			continue;
+
+		case R_ARM_REL32:
+			target = pc + insn;
+			if (target - fn->addr < fn->size) continue;
+			if (patch_map(c, target, &to) < 0) goto missing;
+			patch_put32(out + i, to - (addr + i));
+			continue;
+
+		default:
+		unsupported:
+			if (c->place) fprintf(stderr, "ERROR: %s has a relocation of type %d at 0x%08lX, not supported\n", fn->name, type, pc);
+			return -1;
+		}
+
+	missing:
+		if (c->place) fprintf(stderr, "ERROR: %s refers to 0x%08lX, which the running payload lacks\n", fn->name, target);
+		return -1;
+	}
+
+	return 0;
+}
+
+//
+//	Whether a function needs (re)placing: not in the running payload, or
+//	different from its running copy once relocated there.
+//
+
+static int patch_changed (struct patch_ctx *c, struct patch_sym *fn, unsigned char *tmp) {
+
+	struct patch_fn *prev;
+	struct patch_sym *old;
+	const unsigned char *code;
+	unsigned long flags, addr, size;
+
+	if ((prev = patch_find(patch_done, patch_ndone, fn->name)) != NULL) {
+		addr = prev->addr; size = prev->size; code = prev->code;
+	} else {
+		old = patch_elf_named(c->old, fn->name);
+		if (old == NULL || !old->func) return 1;
+		addr = old->addr; size = old->size;
+		code = patch_elf_bytes(c->old, old->addr, old->size, &flags);
+		if (code == NULL) return 1;
+	}
+
+	if (size != fn->size) return 1;
+	if (patch_relocate(c, fn, addr, tmp) < 0) return 1;
+	return memcmp(tmp, code, size) != 0;
+}
+
+//
+//	Point a running function entry at its replacement, with a B when in reach
+//	and a load of the PC when not (8 bytes).
+//
+
+static int patch_redirect (struct cc1800_session *s, const char *name, unsigned long entry, unsigned long size, unsigned long to) {
+
+	const struct cc1800_region *reg;
+	unsigned char b [8];
+	long off = to - (entry + 8);
+	unsigned long len = 4;
+
+	if (off >= -PATCH_REACH && off < PATCH_REACH) patch_put32(b, 0xEA000000 | ((off >> 2) & 0x00FFFFFF));
+	else if (size >= 8) {
+		patch_put32(b, 0xE51FF004);				// ldr pc, [pc, #-4]
+		patch_put32(b + 4, to);
+		len = 8;
+	} else {
+		fprintf(stderr, "ERROR: %s is too small to redirect that far\n", name);
+		return -1;
+	}
+
+	reg = memmap_check(s, entry, len, MEM_WRITE);
+	if (reg == NULL) return -1;
+	return memmap_upload(s, reg, (const char *)b, len, entry);
+}
+
+//
+//	PATCH command, usage: patch <running elf> <rebuilt elf> [area=<address>[:<size>]]
+//	Returns the number of arguments used.
+//
+
+int cc1800_patch (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct patch_elf old, new;
+	struct patch_ctx c;
+	struct patch_sym *fn, *o;
+	struct patch_fn *f, *prev, *done;
+	struct patch_str *strs;
+	const struct cc1800_region *reg;
+	const char *data [2], *p;
+	const unsigned char *q;
+	char *buf [2] = { NULL, NULL };
+	unsigned long len [2], area = 0, size = PATCH_AREA_SIZE, flags, max = 0;
+	unsigned char *tmp = NULL;
+	unsigned run;
+	int n, r = -1, i, added = 0, held = 0;
+	long at;
+
+	if (argc < 2) {
+		fprintf(stderr, "ERROR: patch command requires the running and the rebuilt ELF files\n");
+		return -1;
+	}
+
+	for (n = 2; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		if (!strncmp(argv[n], "area=", 5)) {
+			p = strchr(argv[n] + 5, ':');
+			if (p != NULL && scan_ulong(p + 1, &size) < 0) return -1;
+			if (scan_ulong(argv[n] + 5, &area) < 0) return -1;
+		}
+		else {
+			fprintf(stderr, "ERROR: unknown patch option '%s'\n", argv[n]);
+			return -1;
+		}
+	}
+
+	run = monitor_run(s);
+	if (run == 0) {
+		fprintf(stderr, "ERROR: no payload running under the monitor, start it with \"monitor\"\n");
+		return -1;
+	}
+
+	// Earlier patches only hold for the monitor run they were made in
+
+	if (run != patch_run) {
+		for (i = 0; i < patch_ndone; i++) free(patch_done[i].code);
+		free(patch_done);
+		patch_done = NULL;
+		patch_ndone = 0;
+		for (i = 0; i < patch_ndone_strs; i++) free((char *)patch_done_strs[i].text);
+		free(patch_done_strs);
+		patch_done_strs = NULL;
+		patch_ndone_strs = 0;
+		patch_next = patch_end = 0;
+		patch_run = run;
+	}
+
+	if (area != 0 && (area + size != patch_end || patch_next < area)) {
+		patch_next = (area + 7) & ~7UL;
+		patch_end = area + size;
+	}
+
+	if (patch_end == 0) {
+		fprintf(stderr, "ERROR: no patch area yet, give it with area=<address>[:<size>]\n");
+		return -1;
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (s->files != NULL) r = file_cache_load(s->files, argv[i], &data[i], &len[i]);
+		else { r = load_file(argv[i], &buf[i], &len[i]); data[i] = buf[i]; }
+		if (r < 0) { free(buf[0]); return r; }
+	}
+
+	memset(&c, 0, sizeof(c));
+	c.old = &old;
+	c.new = &new;
+	c.base = patch_next;
+	r = -1;
+
+	if (patch_elf_open(&old, argv[0], (const unsigned char *)data[0], len[0]) < 0) goto done_files;
+	if (patch_elf_open(&new, argv[1], (const unsigned char *)data[1], len[1]) < 0) { patch_elf_free(&old); goto done_files; }
+
+	if (new.nrels == 0) {
+		fprintf(stderr, "ERROR: no relocations in '%s', link it with -Wl,-q\n", argv[1]);
+		goto done;
+	}
+
+	for (i = 0; i < new.nsyms; i++) if (new.syms[i].size > max) max = new.syms[i].size;
+	tmp = (unsigned char *)malloc(max + 4);
+	c.cur = (struct patch_fn *)calloc(new.nsyms, sizeof(struct patch_fn));
+	if (tmp == NULL || c.cur == NULL) goto nomem;
+
+	// What changed, placed one after another
+
+	for (i = 0; i < new.nsyms; i++) {
+
+		fn = &new.syms[i];
+		if (!fn->func || (i > 0 && fn->addr == new.syms[i - 1].addr && new.syms[i - 1].func)) continue;
+
+		if (fn->dup || (fn->addr & 3)) {
+			p = (const char *)patch_elf_bytes(&old, fn->addr, fn->size, &flags);
+			q = patch_elf_bytes(&new, fn->addr, fn->size, &flags);
+			if (p == NULL || q == NULL || memcmp(p, q, fn->size))
+				printf("Warning: %s %s, left alone\n", fn->name, fn->dup ? "is defined more than once" : "is Thumb code");
+			continue;
+		}
+
+		if (strlen(fn->name) >= PATCH_MAX_NAME || !patch_changed(&c, fn, tmp)) continue;
+
+		at = patch_area_grow(&c, (fn->size + 7) & ~7UL);
+		if (at < 0) goto nomem;
+		f = &c.cur[c.ncur++];
+		strcpy(f->name, fn->name);
+		f->addr = c.base + at;
+		f->size = fn->size;
+	}
+
+	if (c.ncur == 0) {
+		printf("No functions changed\n");
+		r = 0; goto done;
+	}
+
+	// Relocate into the patch area (string literals may follow)
+
+	c.place = 1;
+
+	for (i = 0; i < c.ncur; i++) {
+		fn = patch_elf_named(&new, c.cur[i].name);
+		if (patch_relocate(&c, fn, c.cur[i].addr, c.area + (c.cur[i].addr - c.base)) < 0) goto done;
+	}
+
+	if (c.used > patch_end - c.base) {
+		fprintf(stderr, "ERROR: patch area full, %lu bytes needed and %lu left\n", c.used, patch_end - c.base);
+		goto done;
+	}
+
+	reg = memmap_check(s, c.base, c.used, MEM_WRITE | MEM_EXEC);
+	if (reg == NULL) goto done;
+
+	// All of it lands while the payload is held
+
+	r = monitor_control(s, MONITOR_HOLD);
+	if (r < 0) goto done;
+	held = 1;
+
+	r = memmap_upload(s, reg, (const char *)c.area, c.used, c.base);
+	if (r < 0) goto done;
+
+	for (i = 0; i < c.ncur; i++) {
+		f = &c.cur[i];
+		o = patch_elf_named(&old, f->name);
+		prev = patch_find(patch_done, patch_ndone, f->name);
+		if (o == NULL && prev == NULL) added++;
+		if (o != NULL && o->func && (r = patch_redirect(s, f->name, o->addr, o->size, f->addr)) < 0) goto done;
+		if (prev != NULL && (r = patch_redirect(s, f->name, prev->addr, prev->size, f->addr)) < 0) goto done;
+		printf("%s %s (%lu bytes) at 0x%08lX\n", o == NULL && prev == NULL ? "Added" : "Patched", f->name, f->size, f->addr);
+	}
+
+	held = 0;
+	r = monitor_control(s, MONITOR_FLUSH);
+	if (r < 0) goto done;
+
+	// Remember what went up, for the next patch to compare with
+
+	patch_next = (c.base + c.used + 7) & ~7UL;
+
+	strs = (struct patch_str *)realloc(patch_done_strs, (patch_ndone_strs + c.nstrs) * sizeof(struct patch_str));
+	if (strs == NULL && c.nstrs > 0) goto nomem;
+	patch_done_strs = strs;
+	for (i = 0; i < c.nstrs; i++) {
+		p = strdup(c.strs[i].text);
+		if (p == NULL) goto nomem;
+		patch_done_strs[patch_ndone_strs].text = p;
+		patch_done_strs[patch_ndone_strs++].addr = c.strs[i].addr;
+	}
+
+	done = (struct patch_fn *)realloc(patch_done, (patch_ndone + c.ncur) * sizeof(struct patch_fn));
+	if (done == NULL) goto nomem;
+	patch_done = done;
+
+	for (i = 0; i < c.ncur; i++) {
+		f = &c.cur[i];
+		f->code = (unsigned char *)malloc(f->size);
+		if (f->code == NULL) goto nomem;
+		memcpy(f->code, c.area + (f->addr - c.base), f->size);
+		prev = patch_find(patch_done, patch_ndone, f->name);
+		if (prev != NULL) { free(prev->code); *prev = *f; }
+		else patch_done[patch_ndone++] = *f;
+		f->code = NULL;
+	}
+
+	printf("%d functions patched, %d of them new, %d strings, %lu bytes uploaded, %lu bytes of patch area left\n",
+		c.ncur, added, c.nstrs, c.used, patch_end - patch_next);
+	r = 0;
+	goto done;
+
+nomem:
+	fprintf(stderr, "ERROR: out of memory\n");
+	r = -1;
+
+done:
+	if (held) monitor_control(s, 0);
+	patch_elf_free(&old);
+	patch_elf_free(&new);
+	free(c.cur);
+	free(c.strs);
+	free(c.area);
+	free(tmp);
+
+done_files:
+	free(buf[0]);
+	free(buf[1]);
+	return r < 0 ? r : n;
+}
+
+//
+//	Name addresses of the payload started from an ELF: "function+0x1c" into
+//	names[] (malloc'ed, NULL where nothing is there). Code moved by patches
+//	of the given monitor run is named after the function patched.
+//
+
+int patch_symbolize (struct cc1800_session *s, const char *file, const unsigned long *addr, int n, char **names, unsigned run) {
+
+	struct patch_elf e;
+	struct patch_sym *sym;
+	const char *data, *name;
+	char *buf = NULL, tmp [PATCH_MAX_NAME + 32];
+	unsigned long len, off;
+	int i, j, r, patched;
+
+	for (i = 0; i < n; i++) names[i] = NULL;
+
+	if (s->files != NULL) r = file_cache_load(s->files, file, &data, &len);
+	else { r = load_file(file, &buf, &len); data = buf; }
+	if (r < 0) return r;
+
+	r = patch_elf_open(&e, file, (const unsigned char *)data, len);
+	if (r < 0) { free(buf); return r; }
+
+	for (i = 0; i < n; i++) {
+
+		name = NULL;
+		patched = 0;
+		for (j = 0; run != 0 && run == patch_run && j < patch_ndone; j++)
+			if (addr[i] - patch_done[j].addr < patch_done[j].size) {
+				name = patch_done[j].name;
+				off = addr[i] - patch_done[j].addr;
+				patched = 1;
+				break;
+			}
+
+		if (name == NULL && (sym = patch_elf_at(&e, addr[i])) != NULL) {
+			name = sym->name;
+			off = addr[i] - sym->addr;
+		}
+
+		if (name == NULL) continue;
+		if (off) snprintf(tmp, sizeof(tmp), "%.*s+0x%lx%s", PATCH_MAX_NAME, name, off, patched ? " (patched)" : "");
+		else snprintf(tmp, sizeof(tmp), "%.*s%s", PATCH_MAX_NAME, name, patched ? " (patched)" : "");
+		names[i] = strdup(tmp);
+	}
+
+	patch_elf_free(&e);
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,1109 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <zlib.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Streaming transform pipeline. Data flows in fixed size chunks from a source
+//	(file or target memory) through a chain of stages to a sink (target memory
+//	or file). Each stage runs in its own worker thread, and chunks come from a
+//	fixed pool, so a full queue or an empty pool stalls the producer and the
+//	memory in flight is bounded no matter how large the transfer is.
+//
+//	The USB side always runs in the calling thread, so the device handle is
+//	never used concurrently.
+//
+
+#define PIPE_CHUNK_SIZE		(128 * 1024)
+#define PIPE_DEPTH			4			// Chunks queued between two workers
+
+struct chunk {
+	char *data;
+	unsigned long len;
+	int eos;						// Last chunk of the stream
+};
+
+struct queue {
+	struct chunk **slot;
+	int size, head, count;
+	pthread_cond_t not_empty, not_full;
+};
+
+struct pipeline;
+struct stage;
+
+struct stage_ops {
+	const char *name;
+	const char *help;
+	int (*open) (struct stage *st, const char *arg);
+	int (*process) (struct stage *st, struct chunk *c);
+	int (*finish) (struct stage *st);
+	void (*close) (struct stage *st);
+};
+
+struct stage {
+	const struct stage_ops *ops;
+	struct pipeline *p;
+	struct queue *in, *out;
+	struct chunk *cur;				// Output chunk being filled, if any
+	unsigned long pos;				// Stream offset of the next input byte
+	void *priv;
+	pthread_t thread;
+	int r;
+};
+
+struct pipeline {
+	pthread_mutex_t lock;
+	int abort;
+	unsigned long addr;				// Target address of the stream
+	struct queue pool;				// Free chunks
+	struct queue *queues;			// nstages + 1 queues between workers
+	struct stage *stages;
+	int nstages;
+	struct chunk *chunks;
+	int nchunks, depth;
+};
+
+//==============================================================================
+//
+//	Queues. A single lock protects all of them, since contention is negligible
+//	compared to the work done on each chunk.
+//
+
+static int queue_init (struct queue *q, int size) {
+	q->slot = (struct chunk **)calloc(size, sizeof(struct chunk *));
+	if (q->slot == NULL) return -1;
+	q->size = size;
+	q->head = q->count = 0;
+	pthread_cond_init(&q->not_empty, NULL);
+	pthread_cond_init(&q->not_full, NULL);
+	return 0;
+}
+
+static void queue_destroy (struct queue *q) {
+	free(q->slot);
+	pthread_cond_destroy(&q->not_empty);
+	pthread_cond_destroy(&q->not_full);
+}
+
+static int queue_push (struct pipeline *p, struct queue *q, struct chunk *c) {
+	pthread_mutex_lock(&p->lock);
+	while (q->count == q->size && !p->abort) pthread_cond_wait(&q->not_full, &p->lock);
+	if (p->abort) { pthread_mutex_unlock(&p->lock); return -1; }
+	q->slot[(q->head + q->count++) % q->size] = c;
+	pthread_cond_signal(&q->not_empty);
+	pthread_mutex_unlock(&p->lock);
+	return 0;
+}
+
+static struct chunk *queue_pop (struct pipeline *p, struct queue *q) {
+	struct chunk *c;
+	pthread_mutex_lock(&p->lock);
+	while (q->count == 0 && !p->abort) pthread_cond_wait(&q->not_empty, &p->lock);
+	if (p->abort) { pthread_mutex_unlock(&p->lock); return NULL; }
+	c = q->slot[q->head];
+	q->head = (q->head + 1) % q->size;
+	q->count--;
+	pthread_cond_signal(&q->not_full);
+	pthread_mutex_unlock(&p->lock);
+	return c;
+}
+
+static void pipeline_abort (struct pipeline *p) {
+	int i;
+	pthread_mutex_lock(&p->lock);
+	p->abort = 1;
+	pthread_cond_broadcast(&p->pool.not_empty);
+	pthread_cond_broadcast(&p->pool.not_full);
+	for (i = 0; i <= p->nstages; i++) {
+		pthread_cond_broadcast(&p->queues[i].not_empty);
+		pthread_cond_broadcast(&p->queues[i].not_full);
+	}
+	pthread_mutex_unlock(&p->lock);
+}
+
+static struct chunk *chunk_get (struct pipeline *p) {
+	struct chunk *c = queue_pop(p, &p->pool);
+	if (c != NULL) { c->len = 0; c->eos = 0; }
+	return c;
+}
+
+static void chunk_put (struct pipeline *p, struct chunk *c) {
+	queue_push(p, &p->pool, c);
+}
+
+//==============================================================================
+//
+//	Stage output helpers. Stages either forward their input chunk after
+//	modifying it in place, or write into a fresh output chunk.
+//
+
+static int stage_push (struct stage *st) {
+	struct chunk *c = st->cur;
+	st->cur = NULL;
+	if (c == NULL) return 0;
+	return queue_push(st->p, st->out, c);
+}
+
+static struct chunk *stage_out (struct stage *st) {
+	if (st->cur != NULL && st->cur->len == PIPE_CHUNK_SIZE && stage_push(st) < 0) return NULL;
+	if (st->cur == NULL) st->cur = chunk_get(st->p);
+	return st->cur;
+}
+
+static int stage_write (struct stage *st, const char *data, unsigned long len) {
+	struct chunk *c;
+	unsigned long n;
+	while (len > 0) {
+		c = stage_out(st); if (c == NULL) return -1;
+		n = PIPE_CHUNK_SIZE - c->len;
+		if (n > len) n = len;
+		memcpy(c->data + c->len, data, n);
+		c->len += n; data += n; len -= n;
+	}
+	return 0;
+}
+
+static int stage_forward (struct stage *st, struct chunk *c) {
+	if (stage_push(st) < 0) { chunk_put(st->p, c); return -1; }
+	if (c->len == 0) { chunk_put(st->p, c); return 0; }
+	return queue_push(st->p, st->out, c);
+}
+
+static void *stage_thread (void *arg) {
+
+	struct stage *st = (struct stage *)arg;
+	struct chunk *c;
+	unsigned long len;
+	int eos;
+
+	for (;;) {
+		c = queue_pop(st->p, st->in);
+		if (c == NULL) { st->r = -1; break; }
+
+		eos = c->eos; c->eos = 0; len = c->len;
+		st->r = st->ops->process(st, c);
+		st->pos += len;
+		if (st->r >= 0 && eos && st->ops->finish != NULL) st->r = st->ops->finish(st);
+		if (st->r < 0) break;
+
+		if (eos) {
+			if (stage_out(st) == NULL) { st->r = -1; break; }
+			st->cur->eos = 1;
+			st->r = stage_push(st);
+			break;
+		}
+	}
+
+	if (st->r < 0) pipeline_abort(st->p);
+	return NULL;
+}
+
+//==============================================================================
+//
+//	Stages
+//
+
+//
+//	Decompression of gzip or zlib streams.
+//
+
+struct gunzip {
+	z_stream z;
+	int done;
+};
+
+static int gunzip_open (struct stage *st, const char *arg) {
+	struct gunzip *gz = (struct gunzip *)calloc(1, sizeof(struct gunzip));
+	if (gz == NULL || inflateInit2(&gz->z, 15 + 32) != Z_OK) { free(gz); return -1; }
+	st->priv = gz;
+	return 0;
+}
+
+static int gunzip_process (struct stage *st, struct chunk *c) {
+
+	struct gunzip *gz = (struct gunzip *)st->priv;
+	z_stream *z = &gz->z;
+	struct chunk *o;
+	int r;
+
+	z->next_in = (Bytef *)c->data;
+	z->avail_in = c->len;
+
+	// Keep going while there is input or the output chunk was filled up,
+	// since then inflate may be holding more output
+
+	while (!gz->done && (z->avail_in > 0 || z->avail_out == 0)) {
+		o = stage_out(st); if (o == NULL) { chunk_put(st->p, c); return -1; }
+		z->next_out = (Bytef *)o->data + o->len;
+		z->avail_out = PIPE_CHUNK_SIZE - o->len;
+		r = inflate(z, Z_NO_FLUSH);
+		o->len = PIPE_CHUNK_SIZE - z->avail_out;
+		if (r == Z_STREAM_END) gz->done = 1;
+		else if (r == Z_BUF_ERROR) break;
+		else if (r != Z_OK) {
+			fprintf(stderr, "ERROR: gunzip: corrupt input at offset %lu\n", st->pos);
+			chunk_put(st->p, c);
+			return -1;
+		}
+	}
+
+	chunk_put(st->p, c);
+	return 0;
+}
+
+static int gunzip_finish (struct stage *st) {
+	struct gunzip *gz = (struct gunzip *)st->priv;
+	if (!gz->done) {
+		fprintf(stderr, "ERROR: gunzip: truncated input\n");
+		return -1;
+	}
+	return 0;
+}
+
+static void gunzip_close (struct stage *st) {
+	struct gunzip *gz = (struct gunzip *)st->priv;
+	if (gz != NULL) inflateEnd(&gz->z);
+	free(gz);
+}
+
+//
+//	Compression into a gzip stream, mostly useful for read.
+//
+
+static int gzip_open (struct stage *st, const char *arg) {
+	int level = arg != NULL ? atoi(arg) : 6;
+	z_stream *z = (z_stream *)calloc(1, sizeof(z_stream));
+	if (z == NULL || deflateInit2(z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		free(z);
+		return -1;
+	}
+	st->priv = z;
+	return 0;
+}
+
+static int gzip_run (struct stage *st, const char *data, unsigned long len, int flush) {
+
+	z_stream *z = (z_stream *)st->priv;
+	struct chunk *o;
+	int r;
+
+	z->next_in = (Bytef *)data;
+	z->avail_in = len;
+
+	do {
+		o = stage_out(st); if (o == NULL) return -1;
+		z->next_out = (Bytef *)o->data + o->len;
+		z->avail_out = PIPE_CHUNK_SIZE - o->len;
+		r = deflate(z, flush);
+		o->len = PIPE_CHUNK_SIZE - z->avail_out;
+	} while (z->avail_out == 0 || (flush == Z_FINISH && r != Z_STREAM_END));
+
+	return 0;
+}
+
+static int gzip_process (struct stage *st, struct chunk *c) {
+	int r = gzip_run(st, c->data, c->len, Z_NO_FLUSH);
+	chunk_put(st->p, c);
+	return r;
+}
+
+static int gzip_finish (struct stage *st) {
+	return gzip_run(st, NULL, 0, Z_FINISH);
+}
+
+static void gzip_close (struct stage *st) {
+	if (st->priv != NULL) deflateEnd((z_stream *)st->priv);
+	free(st->priv);
+}
+
+//
+//	Byte swapping of 16 or 32 bit words. Chunks coming out of a decompressor
+//	can have any length, so a partial word is carried over to the next chunk.
+//
+
+struct swap {
+	int size;
+	int ncarry;
+	char carry [4];
+};
+
+static void swap_bytes (char *p, unsigned long len, int size) {
+	unsigned long i;
+	char t;
+	for (i = 0; i + size <= len; i += size) {
+		t = p[i]; p[i] = p[i + size - 1]; p[i + size - 1] = t;
+		if (size == 4) { t = p[i + 1]; p[i + 1] = p[i + 2]; p[i + 2] = t; }
+	}
+}
+
+static int swap_open (struct stage *st, const char *arg) {
+	struct swap *sw = (struct swap *)calloc(1, sizeof(struct swap));
+	if (sw == NULL) return -1;
+	sw->size = !strcmp(st->ops->name, "swap16") ? 2 : 4;
+	st->priv = sw;
+	return 0;
+}
+
+static int swap_process (struct stage *st, struct chunk *c) {
+
+	struct swap *sw = (struct swap *)st->priv;
+	unsigned long skip = 0, tail;
+	int r;
+
+	if (sw->ncarry == 0 && c->len % sw->size == 0) {
+		swap_bytes(c->data, c->len, sw->size);
+		return stage_forward(st, c);
+	}
+
+	while (sw->ncarry > 0 && sw->ncarry < sw->size && skip < c->len)
+		sw->carry[sw->ncarry++] = c->data[skip++];
+
+	if (sw->ncarry == sw->size) {
+		swap_bytes(sw->carry, sw->size, sw->size);
+		if (stage_write(st, sw->carry, sw->size) < 0) { chunk_put(st->p, c); return -1; }
+		sw->ncarry = 0;
+	}
+
+	tail = (c->len - skip) % sw->size;
+	swap_bytes(c->data + skip, c->len - skip - tail, sw->size);
+	r = stage_write(st, c->data + skip, c->len - skip - tail);
+
+	memcpy(sw->carry + sw->ncarry, c->data + c->len - tail, tail);
+	sw->ncarry += tail;
+
+	chunk_put(st->p, c);
+	return r;
+}
+
+static int swap_finish (struct stage *st) {
+	struct swap *sw = (struct swap *)st->priv;
+	if (sw->ncarry == 0) return 0;
+	fprintf(stderr, "WARNING: %s: %d trailing bytes left unswapped\n", st->ops->name, sw->ncarry);
+	return stage_write(st, sw->carry, sw->ncarry);
+}
+
+static void swap_close (struct stage *st) {
+	free(st->priv);
+}
+
+//
+//	Patching of bytes at a given stream offset, usage: +patch:<offset>:<hex bytes>
+//
+
+struct patch {
+	unsigned long offset, len;
+	char *bytes;
+};
+
+static int patch_open (struct stage *st, const char *arg) {
+
+	struct patch *pa;
+	const char *hex;
+	char num [32];
+	unsigned long i, v;
+
+	hex = arg != NULL ? strchr(arg, ':') : NULL;
+	if (hex == NULL || hex - arg >= (int)sizeof(num) || strlen(hex + 1) == 0 || strlen(hex + 1) % 2) {
+		fprintf(stderr, "ERROR: patch requires an offset and an even number of hex digits\n");
+		return -1;
+	}
+
+	pa = (struct patch *)calloc(1, sizeof(struct patch));
+	if (pa == NULL) return -1;
+	st->priv = pa;
+
+	memcpy(num, arg, hex - arg); num[hex - arg] = 0;
+	if (scan_ulong(num, &pa->offset) < 0) return -1;
+
+	pa->len = strlen(++hex) / 2;
+	pa->bytes = (char *)malloc(pa->len);
+	if (pa->bytes == NULL) return -1;
+
+	for (i = 0; i < pa->len; i++) {
+		if (sscanf(hex + 2 * i, "%2lx", &v) != 1) {
+			fprintf(stderr, "ERROR: bad patch data '%s'\n", hex);
+			return -1;
+		}
+		pa->bytes[i] = v;
+	}
+
+	return 0;
+}
+
+static int patch_process (struct stage *st, struct chunk *c) {
+
+	struct patch *pa = (struct patch *)st->priv;
+	unsigned long from, to;
+
+	from = pa->offset > st->pos ? pa->offset : st->pos;
+	to = pa->offset + pa->len < st->pos + c->len ? pa->offset + pa->len : st->pos + c->len;
+	if (from < to) memcpy(c->data + (from - st->pos), pa->bytes + (from - pa->offset), to - from);
+
+	return stage_forward(st, c);
+}
+
+static int patch_finish (struct stage *st) {
+	struct patch *pa = (struct patch *)st->priv;
+	if (pa->offset + pa->len <= st->pos) return 0;
+	fprintf(stderr, "ERROR: patch at offset 0x%lX is beyond the end of data\n", pa->offset);
+	return -1;
+}
+
+static void patch_close (struct stage *st) {
+	struct patch *pa = (struct patch *)st->priv;
+	if (pa != NULL) free(pa->bytes);
+	free(pa);
+}
+
+//
+//	Padding up to a multiple of a given size, usage: +pad:<size>[:<fill byte>]
+//
+
+struct pad {
+	unsigned long size;
+	unsigned long fill;
+};
+
+static int pad_open (struct stage *st, const char *arg) {
+
+	struct pad *pd;
+	const char *f;
+	char num [32];
+
+	pd = (struct pad *)calloc(1, sizeof(struct pad));
+	if (pd == NULL) return -1;
+	st->priv = pd;
+
+	if (arg == NULL) {
+		fprintf(stderr, "ERROR: pad requires a size\n");
+		return -1;
+	}
+
+	f = strchr(arg, ':');
+	snprintf(num, sizeof(num), "%.*s", f != NULL ? (int)(f - arg) : (int)strlen(arg), arg);
+	if (scan_ulong(num, &pd->size) < 0) return -1;
+	if (f != NULL && scan_ulong(f + 1, &pd->fill) < 0) return -1;
+
+	if (pd->size == 0) {
+		fprintf(stderr, "ERROR: pad size cannot be zero\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int pad_process (struct stage *st, struct chunk *c) {
+	return stage_forward(st, c);
+}
+
+static int pad_finish (struct stage *st) {
+
+	struct pad *pd = (struct pad *)st->priv;
+	unsigned long n = (pd->size - st->pos % pd->size) % pd->size;
+	char fill [256];
+
+	memset(fill, pd->fill, sizeof(fill));
+	while (n > 0) {
+		if (stage_write(st, fill, n < sizeof(fill) ? n : sizeof(fill)) < 0) return -1;
+		n -= n < sizeof(fill) ? n : sizeof(fill);
+	}
+
+	return 0;
+}
+
+static void pad_close (struct stage *st) {
+	free(st->priv);
+}
+
+//
+//	CRC32 of the data going through, printed at the end of the stream.
+//
+
+static int crc32_open (struct stage *st, const char *arg) {
+	st->priv = calloc(1, sizeof(uLong));
+	if (st->priv == NULL) return -1;
+	*(uLong *)st->priv = crc32(0, NULL, 0);
+	return 0;
+}
+
+static int crc32_process (struct stage *st, struct chunk *c) {
+	*(uLong *)st->priv = crc32(*(uLong *)st->priv, (const Bytef *)c->data, c->len);
+	return stage_forward(st, c);
+}
+
+static int crc32_finish (struct stage *st) {
+	printf("CRC32 0x%08lX over %lu bytes\n", *(uLong *)st->priv, st->pos);
+	return 0;
+}
+
+static void crc32_close (struct stage *st) {
+	free(st->priv);
+}
+
+//
+//	Hex dump of the data, addressed from where it is in target memory.
+//
+
+struct hexdump {
+	struct hex_view h;
+	char carry [16];				// Start of a line split between chunks
+	unsigned long ncarry;
+};
+
+static int hex_open (struct stage *st, const char *arg) {
+	struct hexdump *hd;
+	if (arg != NULL && strcmp(arg, "all")) return -1;
+	hd = (struct hexdump *)calloc(1, sizeof(struct hexdump));
+	if (hd == NULL) return -1;
+	hex_init(&hd->h, st->p->addr, arg == NULL);
+	st->priv = hd;
+	return 0;
+}
+
+//
+//	Output lines straight into output chunks, a chunk is sent on when the
+//	next line may not fit.
+//
+
+static int hex_emit (struct stage *st, const char *data, unsigned long lines) {
+
+	struct hexdump *hd = (struct hexdump *)st->priv;
+	struct chunk *o;
+	unsigned long n;
+
+	while (lines > 0) {
+		o = stage_out(st); if (o == NULL) return -1;
+		n = (PIPE_CHUNK_SIZE - o->len) / HEX_LINE;
+		if (n == 0) { if (stage_push(st) < 0) return -1; continue; }
+		if (n > lines) n = lines;
+		o->len += hex_render(&hd->h, o->data + o->len, data, n * 16);
+		data += n * 16;
+		lines -= n;
+	}
+
+	return 0;
+}
+
+static int hex_process (struct stage *st, struct chunk *c) {
+
+	struct hexdump *hd = (struct hexdump *)st->priv;
+	unsigned long len = c->len, n = 0;
+	const char *data = c->data;
+	int r = 0;
+
+	if (hd->ncarry > 0) {
+		n = 16 - hd->ncarry < len ? 16 - hd->ncarry : len;
+		memcpy(hd->carry + hd->ncarry, data, n);
+		hd->ncarry += n;
+		if (hd->ncarry == 16) { r = hex_emit(st, hd->carry, 1); hd->ncarry = 0; }
+	}
+
+	if (r == 0) r = hex_emit(st, data + n, (len - n) / 16);
+
+	if (r == 0 && (len - n) % 16) {
+		memcpy(hd->carry, data + len - (len - n) % 16, (len - n) % 16);
+		hd->ncarry = (len - n) % 16;
+	}
+
+	chunk_put(st->p, c);
+	return r;
+}
+
+static int hex_finish_stage (struct stage *st) {
+
+	struct hexdump *hd = (struct hexdump *)st->priv;
+	struct chunk *o;
+
+	o = stage_out(st); if (o == NULL) return -1;
+	if (PIPE_CHUNK_SIZE - o->len < 2 * HEX_LINE) {
+		if (stage_push(st) < 0) return -1;
+		o = stage_out(st); if (o == NULL) return -1;
+	}
+	o->len += hex_finish(&hd->h, o->data + o->len, hd->carry, hd->ncarry);
+	return 0;
+}
+
+static void hex_close (struct stage *st) {
+	free(st->priv);
+}
+
+static const struct stage_ops stage_table [] = {
+	{ "gunzip", "decompress gzip or zlib data", gunzip_open, gunzip_process, gunzip_finish, gunzip_close },
+	{ "gzip", "[:<level>] compress into gzip format", gzip_open, gzip_process, gzip_finish, gzip_close },
+	{ "swap16", "swap bytes in 16 bit words", swap_open, swap_process, swap_finish, swap_close },
+	{ "swap32", "swap bytes in 32 bit words", swap_open, swap_process, swap_finish, swap_close },
+	{ "patch", ":<offset>:<hex bytes> overwrite bytes at a stream offset", patch_open, patch_process, patch_finish, patch_close },
+	{ "pad", ":<size>[:<fill>] pad to a multiple of size", pad_open, pad_process, pad_finish, pad_close },
+	{ "crc32", "print the CRC32 of the data", crc32_open, crc32_process, crc32_finish, crc32_close },
+	{ "hex", "[:all] hex and ASCII view, repeated lines collapsed unless all", hex_open, hex_process, hex_finish_stage, hex_close },
+	{ NULL }
+};
+
+void pipeline_help (void) {
+	const struct stage_ops *ops;
+	fprintf(stderr, "Stages (append to write or read as +<stage>[:<args>]):\n");
+	for (ops = stage_table; ops->name != NULL; ops++)
+		fprintf(stderr, "    %-8s %s\n", ops->name, ops->help);
+}
+
+//==============================================================================
+//
+//	Pipeline setup and teardown
+//
+
+static void pipeline_free (struct pipeline *p) {
+
+	int i;
+
+	for (i = 0; i < p->nstages; i++) {
+		if (p->stages[i].ops != NULL && p->stages[i].ops->close != NULL)
+			p->stages[i].ops->close(&p->stages[i]);
+	}
+
+	if (p->queues != NULL)
+		for (i = 0; i <= p->nstages; i++) queue_destroy(&p->queues[i]);
+	queue_destroy(&p->pool);
+
+	if (p->chunks != NULL)
+		for (i = 0; i < p->nchunks; i++) free(p->chunks[i].data);
+
+	pthread_mutex_destroy(&p->lock);
+	free(p->chunks);
+	free(p->queues);
+	free(p->stages);
+	free(p);
+}
+
+static struct pipeline *pipeline_new (unsigned long addr, int nstages, const char **specs) {
+
+	struct pipeline *p;
+	const struct stage_ops *ops;
+	const char *arg;
+	int i, n;
+
+	p = (struct pipeline *)calloc(1, sizeof(struct pipeline));
+	if (p == NULL) return NULL;
+	pthread_mutex_init(&p->lock, NULL);
+	p->addr = addr;
+
+	// Every queue can be full and every worker can hold an input and an
+	// output chunk at the same time, and the pool must still not run dry.
+	// Under a memory budget the queues get shallower, down to one chunk
+
+	p->nstages = nstages;
+	p->depth = budget_count((nstages + 1) * PIPE_CHUNK_SIZE, PIPE_DEPTH, 1);
+	p->nchunks = (nstages + 1) * p->depth + 2 * (nstages + 2);
+
+	p->stages = (struct stage *)calloc(nstages > 0 ? nstages : 1, sizeof(struct stage));
+	p->queues = (struct queue *)calloc(nstages + 1, sizeof(struct queue));
+	p->chunks = (struct chunk *)calloc(p->nchunks, sizeof(struct chunk));
+	if (p->stages == NULL || p->queues == NULL || p->chunks == NULL || queue_init(&p->pool, p->nchunks) < 0) goto fail;
+	for (i = 0; i <= nstages; i++) if (queue_init(&p->queues[i], p->depth) < 0) goto fail;
+
+	for (i = 0; i < p->nchunks; i++) {
+		p->chunks[i].data = (char *)malloc(PIPE_CHUNK_SIZE);
+		if (p->chunks[i].data == NULL) goto fail;
+		p->pool.slot[p->pool.count++] = &p->chunks[i];
+	}
+
+	for (i = 0; i < nstages; i++) {
+
+		arg = strchr(specs[i], ':');
+		n = arg != NULL ? arg - specs[i] : strlen(specs[i]);
+		if (arg != NULL) arg++;
+
+		for (ops = stage_table; ops->name != NULL; ops++)
+			if (strlen(ops->name) == n && !strncmp(ops->name, specs[i], n)) break;
+
+		if (ops->name == NULL) {
+			fprintf(stderr, "ERROR: unknown stage '%s'\n", specs[i]);
+			goto fail;
+		}
+
+		p->stages[i].ops = ops;
+		p->stages[i].p = p;
+		p->stages[i].in = &p->queues[i];
+		p->stages[i].out = &p->queues[i + 1];
+
+		if (ops->open(&p->stages[i], arg) < 0) {
+			fprintf(stderr, "ERROR: cannot set up stage '%s'\n", specs[i]);
+			goto fail;
+		}
+	}
+
+	return p;
+
+fail:
+	fprintf(stderr, "ERROR: cannot set up pipeline\n");
+	pipeline_free(p);
+	return NULL;
+}
+
+static int pipeline_start (struct pipeline *p) {
+	int i;
+	for (i = 0; i < p->nstages; i++) {
+		if (pthread_create(&p->stages[i].thread, NULL, stage_thread, &p->stages[i])) {
+			fprintf(stderr, "ERROR: cannot create pipeline thread\n");
+			pipeline_abort(p);
+			while (--i >= 0) pthread_join(p->stages[i].thread, NULL);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int pipeline_join (struct pipeline *p) {
+	int i, r = 0;
+	for (i = 0; i < p->nstages; i++) {
+		pthread_join(p->stages[i].thread, NULL);
+		if (p->stages[i].r < 0) r = -1;
+	}
+	return r;
+}
+
+static void pipeline_report (const char *what, unsigned long len, double t) {
+	t = time_now() - t;
+	printf("%s %lu bytes in %.3f s (%.2f MB/s)\n", what, len, t, t > 0 ? len / t / 1e6 : 0.0);
+}
+
+//==============================================================================
+//
+//	Upload: file -> stages -> target memory, each chunk verified as it goes.
+//
+
+struct file_source {
+	struct pipeline *p;
+	const char *file;
+	const char *data;				// Already loaded data, or NULL to read file
+	unsigned long len;
+	pipeline_read_t read;			// Generated data, or NULL
+	void *priv;
+	int r;
+};
+
+static void *file_source_thread (void *arg) {
+
+	struct file_source *fs = (struct file_source *)arg;
+	struct pipeline *p = fs->p;
+	struct chunk *c;
+	struct uring_reader *f = NULL;
+	unsigned long off = 0, len;
+	long n;
+	int eos, r;
+
+	fs->r = 0;
+
+	// Files are read ahead, so that the disk works while the chunk
+	// before goes through the stages and over USB
+
+	if (fs->data == NULL && fs->read == NULL) {
+		f = uring_open(fs->file, &len);
+		if (f == NULL) {
+			fs->r = -1;
+			pipeline_abort(p);
+			return NULL;
+		}
+	}
+
+	do {
+		c = chunk_get(p); if (c == NULL) { fs->r = -1; break; }
+
+		if (f != NULL) {
+			n = uring_read(f, c->data, PIPE_CHUNK_SIZE);
+			if (n < 0) {
+				chunk_put(p, c);
+				fs->r = -1;
+				break;
+			}
+			c->len = n;
+			c->eos = c->len < PIPE_CHUNK_SIZE;
+		} else if (fs->read != NULL) {
+			r = fs->read(fs->priv, c->data, PIPE_CHUNK_SIZE);
+			if (r < 0) { chunk_put(p, c); fs->r = -1; break; }
+			c->len = r;
+			c->eos = c->len < PIPE_CHUNK_SIZE;
+		} else {
+			c->len = fs->len - off < PIPE_CHUNK_SIZE ? fs->len - off : PIPE_CHUNK_SIZE;
+			memcpy(c->data, fs->data + off, c->len);
+			off += c->len;
+			c->eos = off == fs->len;
+		}
+
+		eos = c->eos;				// The chunk is not ours once pushed
+		if (queue_push(p, &p->queues[0], c) < 0) { fs->r = -1; break; }
+	} while (!eos);
+
+	uring_close(f);
+	if (fs->r < 0) pipeline_abort(p);
+	return NULL;
+}
+
+static int upload_stream (struct cc1800_session *s, unsigned long addr, struct file_source *src,
+	int nstages, const char **stages, FILE *save)
+{
+	struct pipeline *p;
+	struct file_source fs = *src;
+	const struct cc1800_region *reg;
+	struct chunk *c;
+	pthread_t source;
+	unsigned long off = 0;
+	int r = 0, mismatch = 0, eos = 0;
+	char *verify;
+	double t;
+
+	verify = (char *)malloc(PIPE_CHUNK_SIZE);
+	if (verify == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	p = pipeline_new(addr, nstages, stages);
+	if (p == NULL) { free(verify); return -1; }
+
+	fs.p = p;
+
+	if (pipeline_start(p) < 0) { pipeline_free(p); free(verify); return -1; }
+	if (pthread_create(&source, NULL, file_source_thread, &fs)) {
+		fprintf(stderr, "ERROR: cannot create pipeline thread\n");
+		pipeline_abort(p);
+		pipeline_join(p);
+		pipeline_free(p);
+		free(verify);
+		return -1;
+	}
+
+	printf("Uploading data to address 0x%08lX\n", addr);
+	t = time_now();
+
+	while (!eos) {
+
+		c = queue_pop(p, &p->queues[nstages]);
+		if (c == NULL) { r = -1; break; }
+		eos = c->eos;
+
+		if (c->len > 0) {
+
+			// The output length is only known as it comes, check each chunk
+
+			reg = memmap_check(s, addr + off, c->len, MEM_WRITE);
+			if (reg == NULL) {
+				chunk_put(p, c);
+				r = -1;
+				break;
+			}
+
+			r = cc1800_upload(s->handle, c->data, c->len, addr + off);
+			if (r >= 0 && r < (int)c->len) r = -EIO;		// A short transfer is an error too
+			if (r < 0) {
+				fprintf(stderr, "ERROR: CC1800 upload failed\n");
+				chunk_put(p, c);
+				break;
+			}
+
+			if (reg->flags & MEM_VERIFY) {
+				r = cc1800_download(s->handle, verify, c->len, addr + off);
+				if (r >= 0 && r < (int)c->len) r = -EIO;
+				if (r < 0) {
+					fprintf(stderr, "ERROR: CC1800 download failed\n");
+					chunk_put(p, c);
+					break;
+				}
+				if (memcmp(c->data, verify, c->len)) mismatch = 1;
+			}
+
+			if (save != NULL && fwrite(c->data, 1, c->len, save) != c->len) {
+				fprintf(stderr, "ERROR: cannot save uploaded data\n");
+				chunk_put(p, c);
+				r = -1;
+				break;
+			}
+
+			if (s->mem != NULL) mem_cache_store(s->mem, addr + off, reg->flags & MEM_VERIFY ? verify : c->data, c->len);
+			off += c->len;
+		}
+
+		chunk_put(p, c);
+	}
+
+	// Leave the loader address at the start, for exec
+
+	if (r >= 0 && off > 0 && !probe_at(s->handle, addr)) {
+		r = cc1800_req_set_address(s->handle, addr);
+		if (r < 0) fprintf(stderr, "ERROR: cannot set address\n");
+	}
+
+	if (r < 0) pipeline_abort(p);
+	pthread_join(source, NULL);
+	if (pipeline_join(p) < 0 || fs.r < 0) r = -1;
+	pipeline_free(p);
+	free(verify);
+
+	if (r < 0) return r;
+
+	pipeline_report("Uploaded", off, t);
+	if (mismatch) printf("WARNING: data mismatch\n");
+	return 0;
+}
+
+int pipeline_upload (struct cc1800_session *s, unsigned long addr, const char *file,
+	const char *data, unsigned long len, int nstages, const char **stages)
+{
+	struct file_source fs;
+	memset(&fs, 0, sizeof(fs));
+	fs.file = file; fs.data = data; fs.len = len;
+	return upload_stream(s, addr, &fs, nstages, stages, NULL);
+}
+
+//
+//	Upload of data generated as it goes: read() fills the buffer it is given,
+//	except at the end of the data, and returns how much it put there. What
+//	comes out of the stages is also written to 'save' if not NULL.
+//
+
+int pipeline_upload_source (struct cc1800_session *s, unsigned long addr, pipeline_read_t read, void *priv,
+	int nstages, const char **stages, FILE *save)
+{
+	struct file_source fs;
+	memset(&fs, 0, sizeof(fs));
+	fs.file = "source"; fs.read = read; fs.priv = priv;
+	return upload_stream(s, addr, &fs, nstages, stages, save);
+}
+
+//==============================================================================
+//
+//	Download: target memory -> stages -> file
+//
+
+struct file_sink {
+	struct pipeline *p;
+	struct queue *q;
+	const char *file;
+	unsigned long len;
+	int r;
+};
+
+static void *file_sink_thread (void *arg) {
+
+	struct file_sink *fk = (struct file_sink *)arg;
+	struct chunk *c;
+	FILE *f;
+	int eos = 0;
+
+	fk->r = 0;
+	fk->len = 0;
+
+	f = strcmp(fk->file, "-") ? fopen(fk->file, "wb") : stdout;
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: cannot create file '%s'\n", fk->file);
+		fk->r = -1;
+		pipeline_abort(fk->p);
+		return NULL;
+	}
+
+	while (!eos) {
+		c = queue_pop(fk->p, fk->q);
+		if (c == NULL) { fk->r = -1; break; }
+		eos = c->eos;
+		if (c->len > 0 && !fwrite(c->data, c->len, 1, f)) {
+			fprintf(stderr, "ERROR: cannot write file '%s'\n", fk->file);
+			chunk_put(fk->p, c);
+			fk->r = -1;
+			break;
+		}
+		fk->len += c->len;
+		chunk_put(fk->p, c);
+	}
+
+	if ((f == stdout ? fflush(f) : fclose(f)) != 0 && fk->r == 0) {
+		fprintf(stderr, "ERROR: cannot write file '%s'\n", fk->file);
+		fk->r = -1;
+	}
+
+	if (fk->r < 0) pipeline_abort(fk->p);
+	return NULL;
+}
+
+int pipeline_download (struct cc1800_session *s, unsigned long addr, unsigned long len,
+	const char *file, int nstages, const char **stages)
+{
+	struct pipeline *p;
+	struct file_sink fk;
+	struct chunk *c;
+	pthread_t sink;
+	unsigned long off = 0, cached = 0;
+	int r = 0, eos = 0;
+	double t;
+
+	p = pipeline_new(addr, nstages, stages);
+	if (p == NULL) return -1;
+
+	fk.p = p; fk.q = &p->queues[nstages]; fk.file = file;
+
+	// Before the sink starts, which may be writing to standard output
+
+	printf("Downloading data from address 0x%08lX\n", addr);
+	fflush(stdout);
+
+	if (pipeline_start(p) < 0) { pipeline_free(p); return -1; }
+	if (pthread_create(&sink, NULL, file_sink_thread, &fk)) {
+		fprintf(stderr, "ERROR: cannot create pipeline thread\n");
+		pipeline_abort(p);
+		pipeline_join(p);
+		pipeline_free(p);
+		return -1;
+	}
+
+	t = time_now();
+
+	do {
+		c = chunk_get(p); if (c == NULL) { r = -1; break; }
+		c->len = len - off < PIPE_CHUNK_SIZE ? len - off : PIPE_CHUNK_SIZE;
+
+		if (c->len > 0 && s->mem != NULL && mem_cache_fetch(s->mem, addr + off, c->data, c->len) == 0) cached += c->len;
+
+		else if (c->len > 0) {
+			r = cc1800_download(s->handle, c->data, c->len, addr + off);
+			if (r >= 0 && r < (int)c->len) r = -EIO;
+			if (r < 0) {
+				fprintf(stderr, "ERROR: CC1800 download failed\n");
+				chunk_put(p, c);
+				break;
+			}
+			if (s->mem != NULL) mem_cache_store(s->mem, addr + off, c->data, c->len);
+		}
+
+		off += c->len;
+		c->eos = eos = off == len;
+		r = queue_push(p, &p->queues[0], c);
+	} while (r >= 0 && !eos);
+
+	if (r < 0) pipeline_abort(p);
+	pthread_join(sink, NULL);
+	if (pipeline_join(p) < 0 || fk.r < 0) r = -1;
+	pipeline_free(p);
+
+	if (r < 0) return r;
+
+	pipeline_report("Downloaded", off, t);
+	if (cached > 0) printf("Used %lu cached bytes\n", cached);
+	if (fk.len != off) printf("Wrote %lu bytes to '%s'\n", fk.len, file);
+	return 0;
+}
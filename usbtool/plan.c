@@ -0,0 +1,736 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Capacity planner for flashing stations: a discrete event simulation of a
+//	production shift, to size the number of hosts, hubs, ports and operators
+//	before buying them. See plan.example for the description file.
+//
+//	Devices arrive at random (Poisson) and queue for a free port and an
+//	operator, who plugs them in. Each device then goes through the phases of
+//	the flashing job, fixed time ones (enumeration, booting a stub) and data
+//	transfers. Transfers are limited by the per port rate measured for that
+//	phase and share the hub uplinks and host controllers above their port,
+//	max-min fairly. Once done the device waits for an operator to unplug it.
+//
+//	Rates change whenever a transfer starts or ends, so transfers are fluid:
+//	the next completion is rescheduled on each change, and stale completion
+//	events are told apart by a generation number.
+//
+
+#define PLAN_NAME			32
+#define PLAN_MAX_LINKS		64
+#define PLAN_MAX_PORTS		1024
+#define PLAN_MAX_PHASES		16
+#define PLAN_MAX_IMAGES		16
+#define PLAN_MAX_DEPTH		8				// Hub tiers, USB allows 5 plus the root
+
+#define PLAN_ARRIVAL		1
+#define PLAN_PLUGGED		2				// Operator done plugging in
+#define PLAN_DELAY			3				// Fixed time phase done
+#define PLAN_FLOW			4				// Next transfer completion
+#define PLAN_UNPLUGGED		5
+
+struct plan_link {					// Host controller or hub uplink
+	char name [PLAN_NAME];
+	int parent;						// -1 for hosts
+	int ports;						// Device ports (hubs only)
+	double bw;						// Bytes per second
+	double load;					// Bandwidth in use
+	double used;					// Integral of load
+	double left;					// Water filling state
+	int n;
+};
+
+struct plan_port {
+	int path [PLAN_MAX_DEPTH];		// Links from the hub up to the host
+	int depth;
+	int job;						// -1 when free
+	double since, busy;
+};
+
+struct plan_phase {
+	char name [PLAN_NAME];
+	double delay;					// Fixed time, or
+	double factor, rate;			// transfer of factor * image size at up to rate
+};
+
+struct plan_image {
+	char name [PLAN_NAME];
+	double size, weight;
+};
+
+struct plan_job {
+	double arrive, start, end;
+	int image, port, phase;
+	double left, rate;				// Transfer bytes left and current rate
+	int frozen;
+};
+
+struct plan_event {
+	double t;
+	int type, job;
+	unsigned long gen;
+};
+
+struct plan {
+
+	// Description
+
+	double shift, arrival, plug, unplug;
+	int operators;
+	unsigned long seed;
+	struct plan_link links [PLAN_MAX_LINKS];
+	int nlinks;
+	struct plan_port ports [PLAN_MAX_PORTS];
+	int nports;
+	struct plan_phase phases [PLAN_MAX_PHASES];
+	int nphases;
+	struct plan_image images [PLAN_MAX_IMAGES];
+	int nimages;
+
+	// State
+
+	double now;
+	unsigned long long rng;
+	struct plan_event *heap;
+	int nheap, aheap;
+	struct plan_job *jobs;
+	int njobs, ajobs;
+	int *queue, qhead, qtail;		// Jobs waiting to be plugged in, FIFO
+	int *unplug_queue, uhead, utail;
+	int idle_ops;
+	double op_busy;
+	unsigned long gen;
+	int flow [PLAN_MAX_PORTS];		// Jobs transferring, at most one per port
+	int nflow;
+};
+
+//==============================================================================
+//
+//	Description file
+//
+
+static int plan_time (const char *s, double *v) {
+
+	char *end;
+
+	*v = strtod(s, &end);
+	if (end == s || *v < 0) return -1;
+
+	if (!strcmp(end, "ms")) *v *= 1e-3;
+	else if (!strcmp(end, "m")) *v *= 60;
+	else if (!strcmp(end, "h")) *v *= 3600;
+	else if (strcmp(end, "s") && *end != 0) return -1;
+
+	return 0;
+}
+
+//
+//	Rate, as "<n>/h", "<n>/m" or "<n>/s".
+//
+
+static int plan_rate (const char *s, double *v) {
+
+	char *end;
+
+	*v = strtod(s, &end);
+	if (end == s || *v < 0) return -1;
+
+	if (!strcmp(end, "/h")) *v /= 3600;
+	else if (!strcmp(end, "/m")) *v /= 60;
+	else if (strcmp(end, "/s")) return -1;
+
+	return 0;
+}
+
+static int plan_link_find (struct plan *p, const char *name) {
+	int i;
+	for (i = 0; i < p->nlinks && strcmp(p->links[i].name, name); i++);
+	return i < p->nlinks ? i : -1;
+}
+
+//
+//	Scalar settings, from the file or as key=value overrides.
+//
+
+static int plan_setting (struct plan *p, const char *key, const char *value) {
+
+	if (!strcmp(key, "shift")) return plan_time(value, &p->shift);
+	if (!strcmp(key, "arrival")) return plan_rate(value, &p->arrival);
+	if (!strcmp(key, "plug")) return plan_time(value, &p->plug);
+	if (!strcmp(key, "unplug")) return plan_time(value, &p->unplug);
+	if (!strcmp(key, "operators")) { p->operators = atoi(value); return p->operators > 0 ? 0 : -1; }
+	if (!strcmp(key, "seed")) { p->seed = strtoul(value, NULL, 0); return 0; }
+
+	return -2;						// Not a setting
+}
+
+static int plan_line (struct plan *p, int argc, char **argv) {
+
+	struct plan_link *l;
+	struct plan_phase *ph;
+	struct plan_image *im;
+	int r;
+
+	if (argc == 2) {
+		r = plan_setting(p, argv[0], argv[1]);
+		if (r != -2) return r;
+	}
+
+	if (!strcmp(argv[0], "host") && argc == 3) {
+		if (p->nlinks == PLAN_MAX_LINKS || plan_link_find(p, argv[1]) >= 0) return -1;
+		l = &p->links[p->nlinks++];
+		snprintf(l->name, sizeof(l->name), "%s", argv[1]);
+		l->parent = -1;
+		return scan_size(argv[2], &l->bw);
+	}
+
+	//	hub <name> <parent> <ports> <uplink bandwidth>
+
+	if (!strcmp(argv[0], "hub") && argc == 5) {
+		if (p->nlinks == PLAN_MAX_LINKS || plan_link_find(p, argv[1]) >= 0) return -1;
+		l = &p->links[p->nlinks];
+		snprintf(l->name, sizeof(l->name), "%s", argv[1]);
+		l->parent = plan_link_find(p, argv[2]);
+		l->ports = atoi(argv[3]);
+		if (l->parent < 0 || l->ports < 0) return -1;
+		p->nlinks++;
+		return scan_size(argv[4], &l->bw);
+	}
+
+	//	phase <name> <time>, or phase <name> <image size factor> <rate>
+
+	if (!strcmp(argv[0], "phase") && (argc == 3 || argc == 4)) {
+		if (p->nphases == PLAN_MAX_PHASES) return -1;
+		ph = &p->phases[p->nphases++];
+		snprintf(ph->name, sizeof(ph->name), "%s", argv[1]);
+		if (argc == 3) return plan_time(argv[2], &ph->delay);
+		ph->factor = atof(argv[2]);
+		return ph->factor > 0 ? scan_size(argv[3], &ph->rate) : -1;
+	}
+
+	//	image <name> <size> [<weight>]
+
+	if (!strcmp(argv[0], "image") && (argc == 3 || argc == 4)) {
+		if (p->nimages == PLAN_MAX_IMAGES) return -1;
+		im = &p->images[p->nimages++];
+		snprintf(im->name, sizeof(im->name), "%s", argv[1]);
+		im->weight = argc == 4 ? atof(argv[3]) : 1;
+		return im->weight > 0 ? scan_size(argv[2], &im->size) : -1;
+	}
+
+	return -1;
+}
+
+static int plan_load (struct plan *p, const char *file) {
+
+	char line [256], *argv [8], *tok, *save;
+	int argc, lineno = 0;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: cannot open file '%s'\n", file);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+
+		lineno++;
+		if ((tok = strchr(line, '#')) != NULL) *tok = 0;
+
+		for (argc = 0, tok = strtok_r(line, " \t\r\n", &save); tok != NULL && argc < 8; tok = strtok_r(NULL, " \t\r\n", &save))
+			argv[argc++] = tok;
+
+		if (argc > 0 && plan_line(p, argc, argv) < 0) {
+			fprintf(stderr, "ERROR: %s:%d: bad line\n", file, lineno);
+			fclose(f);
+			return -1;
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+//
+//	Ports, with the path of links each one goes through.
+//
+
+static int plan_build (struct plan *p) {
+
+	struct plan_port *port;
+	int i, k, l;
+
+	if (p->nphases == 0 || p->nimages == 0 || p->shift <= 0 || p->arrival <= 0) {
+		fprintf(stderr, "ERROR: the plan needs phases, images, a shift and an arrival rate\n");
+		return -1;
+	}
+
+	for (i = 0; i < p->nphases; i++) {
+		if (p->phases[i].factor > 0 && p->phases[i].rate <= 0) {
+			fprintf(stderr, "ERROR: phase %s has no rate\n", p->phases[i].name);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < p->nlinks; i++) {
+
+		if (p->links[i].bw <= 0) {
+			fprintf(stderr, "ERROR: %s has no bandwidth\n", p->links[i].name);
+			return -1;
+		}
+
+		for (k = 0; k < p->links[i].ports; k++) {
+
+			if (p->nports == PLAN_MAX_PORTS) {
+				fprintf(stderr, "ERROR: too many ports\n");
+				return -1;
+			}
+
+			port = &p->ports[p->nports++];
+			port->job = -1;
+			for (l = i; l >= 0; l = p->links[l].parent) {
+				if (port->depth == PLAN_MAX_DEPTH) {
+					fprintf(stderr, "ERROR: hubs nested too deep\n");
+					return -1;
+				}
+				port->path[port->depth++] = l;
+			}
+		}
+	}
+
+	if (p->nports == 0) {
+		fprintf(stderr, "ERROR: the plan has no hub ports\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+//==============================================================================
+//
+//	Simulation
+//
+
+static double plan_random (struct plan *p) {
+	p->rng ^= p->rng << 13; p->rng ^= p->rng >> 7; p->rng ^= p->rng << 17;
+	return ((p->rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static int plan_push (struct plan *p, double t, int type, int job) {
+
+	struct plan_event e, *h;
+	int i;
+
+	if (p->nheap == p->aheap) {
+		h = (struct plan_event *)realloc(p->heap, (p->aheap * 2 + 64) * sizeof(*h));
+		if (h == NULL) return -1;
+		p->heap = h;
+		p->aheap = p->aheap * 2 + 64;
+	}
+
+	e.t = t; e.type = type; e.job = job; e.gen = p->gen;
+
+	for (i = p->nheap++; i > 0 && p->heap[(i - 1) / 2].t > t; i = (i - 1) / 2)
+		p->heap[i] = p->heap[(i - 1) / 2];
+	p->heap[i] = e;
+
+	return 0;
+}
+
+static struct plan_event plan_pop (struct plan *p) {
+
+	struct plan_event top = p->heap[0], last = p->heap[--p->nheap];
+	int i = 0, c;
+
+	for (;;) {
+		c = 2 * i + 1;
+		if (c >= p->nheap) break;
+		if (c + 1 < p->nheap && p->heap[c + 1].t < p->heap[c].t) c++;
+		if (last.t <= p->heap[c].t) break;
+		p->heap[i] = p->heap[c];
+		i = c;
+	}
+
+	if (p->nheap > 0) p->heap[i] = last;
+	return top;
+}
+
+//
+//	Move time forward, draining transfers at their current rates.
+//
+
+static void plan_advance (struct plan *p, double t) {
+
+	double dt = t - p->now;
+	int i;
+
+	if (dt <= 0) return;
+
+	for (i = 0; i < p->nflow; i++)
+		p->jobs[p->flow[i]].left -= p->jobs[p->flow[i]].rate * dt;
+	for (i = 0; i < p->nlinks; i++)
+		p->links[i].used += p->links[i].load * dt;
+
+	p->now = t;
+}
+
+//
+//	Max-min fair rates: raise every transfer together until it hits its port
+//	rate or a link on its path fills up, then freeze it and go on with the
+//	rest. Then schedule the next completion.
+//
+
+static int plan_rates (struct plan *p) {
+
+	struct plan_job *j;
+	struct plan_port *port;
+	double inc, next;
+	int i, k, active;
+
+	for (i = 0; i < p->nlinks; i++) { p->links[i].left = p->links[i].bw; p->links[i].n = 0; p->links[i].load = 0; }
+
+	active = p->nflow;
+	for (i = 0; i < p->nflow; i++) {
+		j = &p->jobs[p->flow[i]];
+		j->rate = 0;
+		j->frozen = 0;
+		port = &p->ports[j->port];
+		for (k = 0; k < port->depth; k++) p->links[port->path[k]].n++;
+	}
+
+	while (active > 0) {
+
+		inc = HUGE_VAL;
+		for (i = 0; i < p->nflow; i++) {
+			j = &p->jobs[p->flow[i]];
+			if (!j->frozen && p->phases[j->phase].rate - j->rate < inc) inc = p->phases[j->phase].rate - j->rate;
+		}
+		for (i = 0; i < p->nlinks; i++)
+			if (p->links[i].n > 0 && p->links[i].left / p->links[i].n < inc) inc = p->links[i].left / p->links[i].n;
+
+		for (i = 0; i < p->nflow; i++) {
+			j = &p->jobs[p->flow[i]];
+			if (j->frozen) continue;
+			j->rate += inc;
+			port = &p->ports[j->port];
+			for (k = 0; k < port->depth; k++) p->links[port->path[k]].left -= inc;
+		}
+
+		for (i = 0; i < p->nflow; i++) {
+			j = &p->jobs[p->flow[i]];
+			if (j->frozen) continue;
+			port = &p->ports[j->port];
+			for (k = 0; k < port->depth && p->links[port->path[k]].left > 1e-6; k++);
+			if (k == port->depth && j->rate < p->phases[j->phase].rate * (1 - 1e-9)) continue;
+			j->frozen = 1;
+			active--;
+			for (k = 0; k < port->depth; k++) p->links[port->path[k]].n--;
+		}
+	}
+
+	next = HUGE_VAL;
+	for (i = 0; i < p->nflow; i++) {
+		j = &p->jobs[p->flow[i]];
+		port = &p->ports[j->port];
+		for (k = 0; k < port->depth; k++) p->links[port->path[k]].load += j->rate;
+		if (j->rate > 0 && j->left / j->rate < next) next = j->left / j->rate;
+	}
+
+	p->gen++;
+	return next < HUGE_VAL ? plan_push(p, p->now + next, PLAN_FLOW, -1) : 0;
+}
+
+//
+//	Start the job's next phase, or ask for it to be unplugged if it was the
+//	last one. Returns 1 if transfer rates need recomputing.
+//
+
+static int plan_phase (struct plan *p, int job) {
+
+	struct plan_job *j = &p->jobs[job];
+	struct plan_phase *ph;
+
+	if (++j->phase == p->nphases) {
+		j->end = p->now;
+		p->unplug_queue[p->utail++] = job;
+		return 0;
+	}
+
+	ph = &p->phases[j->phase];
+	if (ph->factor == 0) return plan_push(p, p->now + ph->delay, PLAN_DELAY, job) < 0 ? -1 : 0;
+
+	j->left = p->images[j->image].size * ph->factor;
+	p->flow[p->nflow++] = job;
+	return 1;
+}
+
+//
+//	Put idle operators to work, unplugging first since that frees ports.
+//
+
+static int plan_dispatch (struct plan *p) {
+
+	struct plan_job *j;
+	int i;
+
+	while (p->idle_ops > 0 && p->uhead < p->utail) {
+		p->idle_ops--;
+		p->op_busy += p->unplug;
+		if (plan_push(p, p->now + p->unplug, PLAN_UNPLUGGED, p->unplug_queue[p->uhead++]) < 0) return -1;
+	}
+
+	while (p->idle_ops > 0 && p->qhead < p->qtail) {
+
+		for (i = 0; i < p->nports && p->ports[i].job >= 0; i++);
+		if (i == p->nports) break;
+
+		j = &p->jobs[p->queue[p->qhead++]];
+		j->port = i;
+		j->start = p->now;
+		p->ports[i].job = j - p->jobs;
+		p->ports[i].since = p->now;
+		p->idle_ops--;
+		p->op_busy += p->plug;
+		if (plan_push(p, p->now + p->plug, PLAN_PLUGGED, j - p->jobs) < 0) return -1;
+	}
+
+	return 0;
+}
+
+static int plan_new_job (struct plan *p) {
+
+	struct plan_job *j;
+	double w = 0, x;
+	int i;
+
+	if (p->njobs == p->ajobs) {
+		p->ajobs = p->ajobs * 2 + 256;
+		p->jobs = (struct plan_job *)realloc(p->jobs, p->ajobs * sizeof(*p->jobs));
+		p->queue = (int *)realloc(p->queue, p->ajobs * sizeof(int));
+		p->unplug_queue = (int *)realloc(p->unplug_queue, p->ajobs * sizeof(int));
+		if (p->jobs == NULL || p->queue == NULL || p->unplug_queue == NULL) return -1;
+	}
+
+	for (i = 0; i < p->nimages; i++) w += p->images[i].weight;
+	x = plan_random(p) * w;
+	for (i = 0; i < p->nimages - 1 && x >= p->images[i].weight; i++) x -= p->images[i].weight;
+
+	j = &p->jobs[p->njobs];
+	memset(j, 0, sizeof(*j));
+	j->arrive = p->now;
+	j->image = i;
+	j->port = -1;
+	j->phase = -1;
+	j->start = j->end = -1;
+
+	p->queue[p->qtail++] = p->njobs;
+	return p->njobs++;
+}
+
+static int plan_run (struct plan *p) {
+
+	struct plan_event e;
+	struct plan_job *j;
+	int i, k, r, recompute;
+
+	p->rng = p->seed * 0x9E3779B97F4A7C15ULL + 1;
+	p->idle_ops = p->operators;
+
+	if (plan_push(p, -log(plan_random(p)) / p->arrival, PLAN_ARRIVAL, -1) < 0) return -1;
+
+	while (p->nheap > 0 && p->heap[0].t <= p->shift) {
+
+		e = plan_pop(p);
+		if (e.type == PLAN_FLOW && e.gen != p->gen) continue;
+
+		plan_advance(p, e.t);
+		recompute = 0;
+
+		switch (e.type) {
+
+		case PLAN_ARRIVAL:
+			if (plan_new_job(p) < 0) return -1;
+			if (plan_push(p, p->now - log(plan_random(p)) / p->arrival, PLAN_ARRIVAL, -1) < 0) return -1;
+			break;
+
+		case PLAN_PLUGGED:
+			p->idle_ops++;
+			/* fall through */
+		case PLAN_DELAY:
+			r = plan_phase(p, e.job);
+			if (r < 0) return -1;
+			recompute |= r;
+			break;
+
+		case PLAN_FLOW:
+			for (i = 0; i < p->nflow; ) {
+				k = p->flow[i];
+				j = &p->jobs[k];
+				if (j->left > j->rate * 1e-9 + 1e-3) { i++; continue; }
+				p->flow[i] = p->flow[--p->nflow];
+				if (plan_phase(p, k) < 0) return -1;
+			}
+			recompute = 1;
+			break;
+
+		case PLAN_UNPLUGGED:
+			p->idle_ops++;
+			j = &p->jobs[e.job];
+			p->ports[j->port].busy += p->now - p->ports[j->port].since;
+			p->ports[j->port].job = -1;
+			j->phase = p->nphases + 1;		// Gone
+			break;
+		}
+
+		if (recompute && plan_rates(p) < 0) return -1;
+		if (plan_dispatch(p) < 0) return -1;
+	}
+
+	plan_advance(p, p->shift);
+
+	for (i = 0; i < p->nports; i++)
+		if (p->ports[i].job >= 0) p->ports[i].busy += p->shift - p->ports[i].since;
+
+	return 0;
+}
+
+//==============================================================================
+//
+//	Report
+//
+
+static int plan_cmp (const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void plan_stat (const char *what, double *v, int n) {
+
+	double sum = 0;
+	int i;
+
+	if (n == 0) return;
+	qsort(v, n, sizeof(double), plan_cmp);
+	for (i = 0; i < n; i++) sum += v[i];
+	printf("%-12s mean %8.1f s   p50 %8.1f s   p95 %8.1f s   max %8.1f s\n", what,
+		sum / n, v[n / 2], v[(int)(n * 0.95)], v[n - 1]);
+}
+
+static void plan_report (struct plan *p) {
+
+	double *wait, *cycle, busy = 0, u, worst = 0;
+	const char *bottleneck = "ports";
+	int i, done = 0, queued = 0, started = 0;
+
+	wait = (double *)malloc((p->njobs + 1) * sizeof(double));
+	cycle = (double *)malloc((p->njobs + 1) * sizeof(double));
+	if (wait == NULL || cycle == NULL) { free(wait); free(cycle); return; }
+
+	for (i = 0; i < p->njobs; i++) {
+		if (p->jobs[i].start < 0) { queued++; continue; }
+		wait[started++] = p->jobs[i].start - p->jobs[i].arrive;
+		if (p->jobs[i].phase > p->nphases) cycle[done++] = p->jobs[i].end - p->jobs[i].arrive;
+	}
+
+	printf("Jobs: %d arrived, %d done (%.1f/h), %d in progress, %d waiting at the end of the shift\n",
+		p->njobs, done, done / p->shift * 3600, started - done, queued);
+	plan_stat("Queue wait", wait, started);
+	plan_stat("Cycle time", cycle, done);
+
+	printf("\nUtilization:\n");
+
+	for (i = 0; i < p->nports; i++) busy += p->ports[i].busy;
+	worst = busy / (p->nports * p->shift);
+	printf("  %-16s %6.1f%%  (%d)\n", "ports", worst * 100, p->nports);
+
+	u = p->op_busy / (p->operators * p->shift);
+	printf("  %-16s %6.1f%%  (%d)\n", "operators", u * 100, p->operators);
+	if (u > worst) { worst = u; bottleneck = "operators"; }
+
+	for (i = 0; i < p->nlinks; i++) {
+		u = p->links[i].used / (p->links[i].bw * p->shift);
+		printf("  %-16s %6.1f%%  (%.1f MB/s)\n", p->links[i].name, u * 100, p->links[i].bw / 1e6);
+		if (u > worst) { worst = u; bottleneck = p->links[i].name; }
+	}
+
+	printf("\nBusiest: %s\n", bottleneck);
+
+	free(wait);
+	free(cycle);
+}
+
+//
+//	PLAN command, usage: plan <description> [<setting>=<value>...]
+//	Runs without a device.
+//
+
+int cc1800_plan (int argc, const char **argv) {
+
+	struct plan *p;
+	char key [32];
+	const char *eq;
+	int i, r = -1;
+
+	if (argc < 1) {
+		fprintf(stderr, "ERROR: plan needs a description file\n");
+		return -1;
+	}
+
+	p = (struct plan *)calloc(1, sizeof(*p));
+	if (p == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	p->shift = 8 * 3600;
+	p->operators = 1;
+	p->seed = 1;
+
+	if (plan_load(p, argv[0]) < 0) goto done;
+
+	for (i = 1; i < argc; i++) {
+		eq = strchr(argv[i], '=');
+		if (eq == NULL || eq - argv[i] >= (int)sizeof(key)) eq = NULL;
+		else { memcpy(key, argv[i], eq - argv[i]); key[eq - argv[i]] = 0; }
+		if (eq == NULL || plan_setting(p, key, eq + 1) < 0) {
+			fprintf(stderr, "ERROR: bad setting '%s'\n", argv[i]);
+			goto done;
+		}
+	}
+
+	if (plan_build(p) < 0) goto done;
+
+	printf("Plan '%s': %d links, %d ports, %d operators, %.1f h shift, %.1f arrivals/h\n",
+		argv[0], p->nlinks, p->nports, p->operators, p->shift / 3600, p->arrival * 3600);
+
+	r = plan_run(p);
+	if (r < 0) fprintf(stderr, "ERROR: cannot allocate memory\n");
+	else plan_report(p);
+
+done:
+	free(p->heap);
+	free(p->jobs);
+	free(p->queue);
+	free(p->unplug_queue);
+	free(p);
+	return r;
+}
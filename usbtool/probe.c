@@ -0,0 +1,532 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/stat.h>
+#include <pthread.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <usb.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Loader transfer profiles. Nothing tells us the largest length the loader
+//	takes in SET_LENGTH, or where its address is left after a bulk transfer,
+//	so by default every transfer sets both and big ones are split in the
+//	conservative chunks of the memory map. The probe command measures them
+//	on a device and keeps the results per CPU info string in a profile file
+//	(CC1800_PROFILES, or "profiles" in the usbtool cache directory).
+//
+//	Once a device has a profile, SET_ADDRESS is left out when the loader is
+//	known to be at the right address already, and transfers to regions that
+//	are split use the largest window that stays well within the USB timeout.
+//	Reads and writes are measured apart, each direction with its own window.
+//	The address is only tracked between requests from the host: from an
+//	execute request until a stub is known to be back in the loader, code on
+//	the target may move it.
+//
+
+#define PROBE_MAX_DEVICES	16
+#define PROBE_MIN			4096		// Length assumed to work, search step
+#define PROBE_TEST			512			// Bytes per address test transfer
+#define PROBE_TIMEOUT		5000		// Same as the request functions
+#define PROBE_BUDGET		1.0			// Seconds per transfer, a fifth of the timeout
+
+#define PROBE_UNKNOWN		0
+#define PROBE_STICKY		1			// Address stays where it was set
+#define PROBE_ADVANCE		2			// Address moves past the data
+
+struct probe_profile {
+	char cpu_info [9];				// Empty if there is no profile
+	unsigned long max [2];			// Largest length seen working, reads and writes
+	unsigned long window [2];		// Transfer size to use
+	double rate [2];				// Bytes per second at 'max'
+	int read, write;				// Address after a bulk transfer, PROBE_*
+};
+
+struct probe_device {
+	struct usb_dev_handle *handle;	// NULL if the slot is free
+	struct probe_profile profile;
+	unsigned long addr;				// Loader address, valid if 'known'
+	int known, running;
+};
+
+static struct probe_device devices [PROBE_MAX_DEVICES];
+static pthread_mutex_t devices_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *moves [] = { "unknown", "sticky", "advance" };
+
+//
+//	Find the state of a device. Devices only get a slot when a profile is
+//	attached or probed, so those without one cost a short scan per transfer.
+//
+
+static struct probe_device *probe_lookup (struct usb_dev_handle *handle, int create) {
+
+	struct probe_device *d = NULL;
+	int i;
+
+	for (i = 0; i < PROBE_MAX_DEVICES; i++)
+		if (__atomic_load_n(&devices[i].handle, __ATOMIC_ACQUIRE) == handle) return &devices[i];
+
+	if (!create) return NULL;
+
+	pthread_mutex_lock(&devices_lock);
+
+	for (i = 0; i < PROBE_MAX_DEVICES && d == NULL; i++)
+		if (devices[i].handle == handle) d = &devices[i];
+
+	for (i = 0; i < PROBE_MAX_DEVICES && d == NULL; i++) {
+		if (devices[i].handle != NULL) continue;
+		d = &devices[i];
+		memset(d, 0, sizeof(*d));
+		__atomic_store_n(&d->handle, handle, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&devices_lock);
+	return d;
+}
+
+//==============================================================================
+//
+//	Address tracking, called by the request functions with the device held.
+//
+
+//
+//	Whether the loader address is known to be 'addr' already.
+//
+
+int probe_at (struct usb_dev_handle *handle, unsigned long addr) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	return d != NULL && d->profile.cpu_info[0] && d->known && !d->running && d->addr == addr;
+}
+
+void probe_address (struct usb_dev_handle *handle, unsigned long addr) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	if (d == NULL) return;
+	d->addr = addr;
+	d->known = !d->running;
+}
+
+//
+//	A bulk transfer of 'len' bytes went through completely.
+//
+
+void probe_moved (struct usb_dev_handle *handle, unsigned long len, int wr) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	int how;
+	if (d == NULL) return;
+	how = wr ? d->profile.write : d->profile.read;
+	if (how == PROBE_ADVANCE) d->addr += len;
+	else if (how != PROBE_STICKY) d->known = 0;
+}
+
+void probe_forget (struct usb_dev_handle *handle) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	if (d != NULL) d->known = 0;
+}
+
+//
+//	Code is running on the target (1), or is known to have returned to the
+//	loader main loop (0).
+//
+
+void probe_running (struct usb_dev_handle *handle, int running) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	if (d == NULL) return;
+	d->running = running;
+	d->known = 0;
+}
+
+//
+//	Largest transfer to (wr) or from a region, 0 for no limit.
+//
+
+unsigned long probe_window (struct usb_dev_handle *handle, const struct cc1800_region *reg, int wr) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	if (reg->chunk == 0 || d == NULL || !d->profile.cpu_info[0]) return reg->chunk;
+	return d->profile.window[wr != 0];
+}
+
+//==============================================================================
+//
+//	Profile file, one line per CPU info string.
+//
+
+static int probe_path (char *path, unsigned long size) {
+
+	const char *env = getenv("CC1800_PROFILES"), *base = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+	char dir [PATH_MAX];
+
+	if (env != NULL && *env) { snprintf(path, size, "%s", env); return 0; }
+
+	if (base != NULL && *base) snprintf(dir, sizeof(dir), "%s/usbtool", base);
+	else if (home != NULL) snprintf(dir, sizeof(dir), "%s/.cache/usbtool", home);
+	else return -1;
+
+	snprintf(path, size, "%s/profiles", dir);
+	return 0;
+}
+
+static int probe_move (const char *name) {
+	int i;
+	for (i = 0; i < 3; i++) if (!strcmp(name, moves[i])) return i;
+	return PROBE_UNKNOWN;
+}
+
+static int probe_parse (const char *line, struct probe_profile *p) {
+
+	char info [9], rd [16], wr [16];
+
+	if (sscanf(line, "%8s read=%15s window=%lu max=%lu rate=%lf write=%15s window=%lu max=%lu rate=%lf",
+		info, rd, &p->window[0], &p->max[0], &p->rate[0], wr, &p->window[1], &p->max[1], &p->rate[1]) != 9) return -1;
+	if (p->window[0] < PROBE_MIN || p->window[1] < PROBE_MIN) return -1;
+
+	strcpy(p->cpu_info, info);
+	p->read = probe_move(rd);
+	p->write = probe_move(wr);
+	return 0;
+}
+
+static void probe_format (const struct probe_profile *p, char *line, unsigned long size) {
+	snprintf(line, size, "%s read=%s window=%lu max=%lu rate=%.0f write=%s window=%lu max=%lu rate=%.0f\n",
+		p->cpu_info, moves[p->read], p->window[0], p->max[0], p->rate[0], moves[p->write], p->window[1], p->max[1], p->rate[1]);
+}
+
+static int probe_load (const char *cpu_info, struct probe_profile *p) {
+
+	char path [PATH_MAX], line [256];
+	FILE *f;
+	int r = -1;
+
+	if (probe_path(path, sizeof(path)) < 0 || (f = fopen(path, "r")) == NULL) return -1;
+
+	while (r < 0 && fgets(line, sizeof(line), f) != NULL)
+		if (probe_parse(line, p) == 0 && !strcmp(p->cpu_info, cpu_info)) r = 0;
+
+	fclose(f);
+	return r;
+}
+
+//
+//	Replace the line for a CPU info string, or remove it if 'p' is NULL. The
+//	file is written aside and renamed, so readers never see half of it.
+//	Lines for the same string that no longer parse go too.
+//
+
+static int probe_store (const char *cpu_info, const struct probe_profile *p, char *path, unsigned long size) {
+
+	char tmp [PATH_MAX + 8], line [256], *q;
+	unsigned long len = strlen(cpu_info);
+	FILE *in, *out;
+
+	if (probe_path(path, size) < 0) {
+		fprintf(stderr, "ERROR: no place for the profile file, set CC1800_PROFILES\n");
+		return -1;
+	}
+
+	snprintf(tmp, sizeof(tmp), "%s", path);
+	for (q = tmp + 1; *q; q++) {
+		if (*q != '/') continue;
+		*q = 0;
+		mkdir(tmp, 0755);
+		*q = '/';
+	}
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	out = fopen(tmp, "w");
+	if (out == NULL) {
+		fprintf(stderr, "ERROR: cannot create file '%s'\n", tmp);
+		return -1;
+	}
+
+	in = fopen(path, "r");
+	while (in != NULL && fgets(line, sizeof(line), in) != NULL)
+		if (strncmp(line, cpu_info, len) || line[len] != ' ') fputs(line, out);
+	if (in != NULL) fclose(in);
+
+	if (p != NULL) {
+		probe_format(p, line, sizeof(line));
+		fputs(line, out);
+	}
+
+	if (fclose(out) != 0 || rename(tmp, path) < 0) {
+		fprintf(stderr, "ERROR: cannot write file '%s'\n", path);
+		remove(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+//
+//	Attach the profile for the session CPU info string, if there is one.
+//
+
+void probe_attach (struct cc1800_session *s) {
+
+	struct probe_profile p;
+	struct probe_device *d;
+
+	if (probe_load(s->cpu_info, &p) < 0) return;
+
+	d = probe_lookup(s->handle, 1);
+	if (d == NULL) return;
+
+	d->profile = p;
+	d->known = 0;
+}
+
+//
+//	Forget a device about to be closed, its handle may come back for another.
+//
+
+void probe_close (struct usb_dev_handle *handle) {
+	struct probe_device *d = probe_lookup(handle, 0);
+	if (d != NULL) __atomic_store_n(&d->handle, NULL, __ATOMIC_RELEASE);
+}
+
+//==============================================================================
+//
+//	Probing
+//
+
+//
+//	Transfer without address tracking, setting the address or not. Returns
+//	the bytes moved or a negative error.
+//
+
+static int probe_xfer (struct usb_dev_handle *handle, char *data, unsigned long len, unsigned long addr, int set, int wr) {
+
+	int r = cc1800_queue_enter(handle);
+	if (r < 0) return r;
+
+	if (set) r = cc1800_req_set_address(handle, addr);
+	if (r >= 0) r = cc1800_req_set_length(handle, len, wr);
+	if (r >= 0) r = wr ? usb_bulk_write(handle, 1, data, len, PROBE_TIMEOUT) : usb_bulk_read(handle, 1, data, len, PROBE_TIMEOUT);
+
+	probe_forget(handle);
+	cc1800_queue_leave(handle);
+	return r;
+}
+
+static int probe_pair (struct usb_dev_handle *handle, char *data, unsigned long addr, int wr) {
+	int r = probe_xfer(handle, data, PROBE_TEST, addr, 1, wr);
+	if (r == PROBE_TEST) r = probe_xfer(handle, data + PROBE_TEST, PROBE_TEST, addr, 0, wr);
+	return r == PROBE_TEST ? 0 : -1;
+}
+
+//
+//	Where the address is after a transfer in each direction. Two transfers
+//	go in a row, only the first one setting the address: the second either
+//	lands on (or comes from) the same place as the first or the next one.
+//
+
+static int probe_moves (struct usb_dev_handle *handle, unsigned long addr, int wr) {
+
+	char a [2 * PROBE_TEST], b [2 * PROBE_TEST], c [2 * PROBE_TEST];
+	int i;
+
+	for (i = 0; i < 2 * PROBE_TEST; i++) {
+		a[i] = i * 7 + 1 + 3 * (i >= PROBE_TEST);
+		b[i] = ~(i * 13 + (i >= PROBE_TEST));
+	}
+
+	if (probe_xfer(handle, a, 2 * PROBE_TEST, addr, 1, 1) != 2 * PROBE_TEST) return -1;
+
+	if (wr) {
+		if (probe_pair(handle, b, addr, 1) < 0) return -1;
+		if (probe_xfer(handle, c, 2 * PROBE_TEST, addr, 1, 0) != 2 * PROBE_TEST) return -1;
+		if (!memcmp(c, b, 2 * PROBE_TEST)) return PROBE_ADVANCE;
+		if (!memcmp(c, b + PROBE_TEST, PROBE_TEST) && !memcmp(c + PROBE_TEST, a + PROBE_TEST, PROBE_TEST)) return PROBE_STICKY;
+	} else {
+		if (probe_pair(handle, c, addr, 0) < 0) return -1;
+		if (!memcmp(c, a, 2 * PROBE_TEST)) return PROBE_ADVANCE;
+		if (!memcmp(c, a, PROBE_TEST) && !memcmp(c + PROBE_TEST, a, PROBE_TEST)) return PROBE_STICKY;
+	}
+
+	return PROBE_UNKNOWN;
+}
+
+//
+//	Largest write (wr) or read that works and is fast enough: doubling from
+//	PROBE_MIN up to 'limit' while each transfer is expected to fit in
+//	PROBE_BUDGET, then a binary search below the first length that fails,
+//	if any.
+//
+
+static int probe_length (struct usb_dev_handle *handle, unsigned long addr, unsigned long limit, int wr, struct probe_profile *p, const char **why) {
+
+	const char *what = wr ? "write" : "read";
+	unsigned long lo = PROBE_MIN, hi = 0, n;
+	char *buf = NULL, *q;
+	double t;
+	int r;
+
+	buf = (char *)calloc(1, lo);
+	if (buf == NULL) goto nomem;
+
+	t = time_now();
+	if (probe_xfer(handle, buf, lo, addr, 1, wr) != (int)lo) {
+		fprintf(stderr, "ERROR: cannot %s %d bytes at 0x%08lX\n", what, PROBE_MIN, addr);
+		free(buf);
+		return -1;
+	}
+	p->rate[wr] = lo / (time_now() - t);
+
+	for (;;) {
+
+		if (hi == 0) {
+			n = lo * 2;
+			if (n > limit) n = limit;
+			if (n <= lo) { *why = "memory"; break; }
+		} else {
+			n = (lo + hi) / 2 / PROBE_MIN * PROBE_MIN;
+			if (n <= lo) { *why = "loader"; break; }
+		}
+
+		if (n / p->rate[wr] > PROBE_BUDGET) { *why = "time"; break; }
+
+		q = (char *)realloc(buf, n);
+		if (q == NULL) goto nomem;
+		buf = q;
+		memset(buf + lo, 0, n - lo);
+
+		t = time_now();
+		r = probe_xfer(handle, buf, n, addr, 1, wr);
+		t = time_now() - t;
+
+		if (r == (int)n) {
+			lo = n;
+			p->rate[wr] = n / t;
+			continue;
+		}
+
+		hi = n;
+		if (probe_xfer(handle, buf, PROBE_MIN, addr, 1, wr) != PROBE_MIN) {
+			fprintf(stderr, "ERROR: device stopped responding after a %lu byte %s, reset it\n", n, what);
+			free(buf);
+			return -1;
+		}
+	}
+
+	free(buf);
+	p->max[wr] = lo;
+	for (p->window[wr] = PROBE_MIN; p->window[wr] * 2 <= lo; p->window[wr] *= 2);
+	return 0;
+
+nomem:
+	fprintf(stderr, "ERROR: cannot allocate memory\n");
+	free(buf);
+	return -1;
+}
+
+static void probe_show (const struct probe_profile *p) {
+	printf("  address after writes: %s\n", moves[p->write]);
+	printf("  address after reads:  %s\n", moves[p->read]);
+	printf("  largest write:        %lu bytes, %.2f MB/s\n", p->max[1], p->rate[1] / 1e6);
+	printf("  largest read:         %lu bytes, %.2f MB/s\n", p->max[0], p->rate[0] / 1e6);
+	printf("  transfer window:      %lu KB writes, %lu KB reads\n", p->window[1] >> 10, p->window[0] >> 10);
+}
+
+//
+//	PROBE command, usage: probe [show|forget] [at=<address>] [max=<bytes>]
+//	Returns the number of arguments used.
+//
+
+int cc1800_probe (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct probe_profile p;
+	struct probe_device *d;
+	const struct cc1800_region *reg;
+	unsigned long addr = CC1800_SDRAM_BASE, max = 0, limit;
+	char path [PATH_MAX];
+	const char *why [2] = { "", "" };
+	int n = 0, r;
+
+	if (argc > 0 && !strcmp(argv[0], "show")) {
+		if (probe_load(s->cpu_info, &p) < 0) printf("No transfer profile for %s\n", s->cpu_info);
+		else { printf("Transfer profile for %s:\n", s->cpu_info); probe_show(&p); }
+		return 1;
+	}
+
+	if (argc > 0 && !strcmp(argv[0], "forget")) {
+		d = probe_lookup(s->handle, 0);
+		if (d != NULL) d->profile.cpu_info[0] = 0;
+		r = probe_store(s->cpu_info, NULL, path, sizeof(path));
+		if (r < 0) return r;
+		printf("Forgot transfer profile for %s\n", s->cpu_info);
+		return 1;
+	}
+
+	for (; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		if (!strncmp(argv[n], "at=", 3)) r = scan_ulong(argv[n] + 3, &addr);
+		else if (!strncmp(argv[n], "max=", 4)) r = scan_ulong(argv[n] + 4, &max);
+		else { fprintf(stderr, "ERROR: unknown probe option '%s'\n", argv[n]); r = -1; }
+		if (r < 0) return r;
+	}
+
+	reg = memmap_check(s, addr, PROBE_MIN, MEM_WRITE);
+	if (reg == NULL) return -1;
+	if (!(reg->flags & MEM_READ)) {
+		fprintf(stderr, "ERROR: probing needs readable memory at 0x%08lX\n", addr);
+		return -1;
+	}
+
+	limit = s->unchecked ? 64 << 20 : reg->base + reg->size - addr;
+	if (max != 0 && max < limit) limit = max;
+	limit = budget_count(PROBE_MIN, limit / PROBE_MIN, 1) * PROBE_MIN;
+	if (limit < PROBE_MIN) {
+		fprintf(stderr, "ERROR: no room to probe at 0x%08lX\n", addr);
+		return -1;
+	}
+
+	d = probe_lookup(s->handle, 1);
+	if (d == NULL) {
+		fprintf(stderr, "ERROR: too many devices in use\n");
+		return -1;
+	}
+
+	// Scratch memory is overwritten
+
+	if (s->mem != NULL) mem_cache_invalidate(s->mem);
+
+	printf("Probing loader transfers at 0x%08lX, up to %lu bytes\n", addr, limit);
+
+	memset(&p, 0, sizeof(p));
+	strcpy(p.cpu_info, s->cpu_info);
+
+	p.write = probe_moves(s->handle, addr, 1);
+	p.read = p.write < 0 ? -1 : probe_moves(s->handle, addr, 0);
+	if (p.read < 0) {
+		fprintf(stderr, "ERROR: address test transfers failed\n");
+		return -1;
+	}
+
+	r = probe_length(s->handle, addr, limit, 1, &p, &why[1]);
+	if (r >= 0) r = probe_length(s->handle, addr, limit, 0, &p, &why[0]);
+	if (r < 0) return r;
+
+	probe_show(&p);
+	printf("  limited by:           %s writes, %s reads\n", why[1], why[0]);
+
+	r = probe_store(p.cpu_info, &p, path, sizeof(path));
+	if (r < 0) return r;
+	printf("Saved transfer profile for %s in '%s'\n", p.cpu_info, path);
+
+	d->profile = p;
+	d->known = 0;
+	return n;
+}
@@ -0,0 +1,192 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Per-device request queue. The loader keeps state between requests (the
+//	address and length set before a bulk transfer), so a request sequence
+//	from one thread must not be interleaved with another's on the same
+//	device. Threads queue up for a device with a single atomic exchange and
+//	get it in arrival order, each one handing it over to the next when done
+//	(an MCS queue lock). Nothing is shared between devices, and host side
+//	work between requests runs in parallel.
+//
+//	A thread may enter the same device again while holding it, so composite
+//	operations can be built from the public request functions.
+//
+
+#define QUEUE_MAX_DEVICES	16
+#define QUEUE_MAX_HELD		4			// Devices held at once by one thread
+#define QUEUE_SPIN			1000		// Polls before sleeping
+
+struct queue_node {
+	struct queue_node *next;
+	int go;							// 0 waiting, 1 go ahead, 2 sleeping
+};
+
+struct queue_dev {
+	struct usb_dev_handle *handle;	// NULL if the slot is free
+	struct queue_node *tail;		// Last thread queued, NULL if idle
+};
+
+struct queue_held {
+	struct usb_dev_handle *handle;	// NULL if the slot is free
+	struct queue_dev *dev;
+	int depth;
+	struct queue_node node;
+};
+
+static struct queue_dev devices [QUEUE_MAX_DEVICES];
+static pthread_mutex_t registry = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct queue_held held [QUEUE_MAX_HELD];
+
+static void queue_sleep (int *go) {
+#ifdef __linux__
+	syscall(SYS_futex, go, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+#else
+	sched_yield();
+#endif
+}
+
+static void queue_wake (int *go) {
+#ifdef __linux__
+	syscall(SYS_futex, go, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+//
+//	Find the queue of a device. Devices are registered on first use, under a
+//	lock so that two threads cannot register the same one twice.
+//
+
+static struct queue_dev *queue_lookup (struct usb_dev_handle *handle) {
+
+	struct queue_dev *d = NULL;
+	int i;
+
+	for (i = 0; i < QUEUE_MAX_DEVICES; i++)
+		if (__atomic_load_n(&devices[i].handle, __ATOMIC_ACQUIRE) == handle) return &devices[i];
+
+	pthread_mutex_lock(&registry);
+
+	for (i = 0; i < QUEUE_MAX_DEVICES && d == NULL; i++)
+		if (devices[i].handle == handle) d = &devices[i];
+
+	for (i = 0; i < QUEUE_MAX_DEVICES && d == NULL; i++) {
+		if (devices[i].handle != NULL) continue;
+		d = &devices[i];
+		d->tail = NULL;
+		__atomic_store_n(&d->handle, handle, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&registry);
+	return d;
+}
+
+//
+//	Wait for exclusive use of a device. Returns 0, or -EBUSY if the device
+//	cannot be queued for.
+//
+
+int cc1800_queue_enter (struct usb_dev_handle *handle) {
+
+	struct queue_held *h = NULL;
+	struct queue_node *prev;
+	struct queue_dev *d;
+	int i, spin = 0, go;
+
+	for (i = 0; i < QUEUE_MAX_HELD; i++) {
+		if (held[i].handle == handle) { held[i].depth++; return 0; }
+		if (held[i].handle == NULL && h == NULL) h = &held[i];
+	}
+
+	d = queue_lookup(handle);
+	if (h == NULL || d == NULL) {
+		fprintf(stderr, "ERROR: too many devices in use\n");
+		return -EBUSY;
+	}
+
+	h->node.next = NULL;
+	h->node.go = 0;
+
+	prev = __atomic_exchange_n(&d->tail, &h->node, __ATOMIC_ACQ_REL);
+
+	if (prev != NULL) {
+		__atomic_store_n(&prev->next, &h->node, __ATOMIC_RELEASE);
+		while ((go = __atomic_load_n(&h->node.go, __ATOMIC_ACQUIRE)) != 1) {
+			if (spin < QUEUE_SPIN) { spin++; continue; }
+			if (go == 0 && !__atomic_compare_exchange_n(&h->node.go, &go, 2, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) continue;
+			queue_sleep(&h->node.go);
+		}
+	}
+
+	h->handle = handle;
+	h->dev = d;
+	h->depth = 1;
+	return 0;
+}
+
+//
+//	Let the next thread in the queue have the device.
+//
+
+void cc1800_queue_leave (struct usb_dev_handle *handle) {
+
+	struct queue_held *h = NULL;
+	struct queue_node *node, *next;
+	int i;
+
+	for (i = 0; i < QUEUE_MAX_HELD && h == NULL; i++)
+		if (held[i].handle == handle) h = &held[i];
+
+	if (h == NULL || --h->depth > 0) return;
+
+	node = &h->node;
+	h->handle = NULL;
+
+	next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	if (next == NULL) {
+		if (__atomic_compare_exchange_n(&h->dev->tail, &node, NULL, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return;
+
+		// Someone queued up but has not linked itself yet, it is about to
+
+		node = &h->node;
+		while ((next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == NULL) sched_yield();
+	}
+
+	if (__atomic_exchange_n(&next->go, 1, __ATOMIC_ACQ_REL) == 2) queue_wake(&next->go);
+}
+
+//
+//	Forget a device about to be closed. No thread may be using it.
+//
+
+void cc1800_queue_close (struct usb_dev_handle *handle) {
+	int i;
+	pthread_mutex_lock(&registry);
+	for (i = 0; i < QUEUE_MAX_DEVICES; i++)
+		if (devices[i].handle == handle) __atomic_store_n(&devices[i].handle, NULL, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&registry);
+}
@@ -0,0 +1,317 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Bandwidth shaping, so that flashing leaves room for other devices on the
+//	same USB controller. Bulk transfers take tokens from a bucket for their
+//	device and from one for the whole fleet, and wait when either runs out,
+//	so the rate is enforced at the granularity of the chunks given to
+//	cc1800_upload and cc1800_download (128 KB from the pipeline, 1 MB for
+//	SDRAM unless a transfer profile says otherwise, see probe.c).
+//
+//	The fleet bucket is shared by every usbtool process on the host through
+//	a file mapped in memory (CC1800_FLEET, /dev/shm/usbtool-fleet by default),
+//	so a limit set from any shell applies to all the stations at once.
+//
+
+#define SHAPE_MAX_DEVICES	16
+#define SHAPE_MAGIC			0x53484150
+#define SHAPE_RECHECK		1.0			// Seconds between looks for the fleet file
+
+struct shape_bucket {
+	pthread_mutex_t lock;
+	double rate, burst;				// Bytes per second and bucket size, rate 0 = no limit
+	double tokens, last;			// Tokens left at time 'last', may go negative
+	double bytes, waited, since;	// Traffic and time spent waiting since 'since'
+};
+
+struct shape_fleet {
+	unsigned magic;
+	struct shape_bucket b;
+};
+
+struct shape_device {
+	struct usb_dev_handle *handle;
+	struct shape_bucket b;
+};
+
+static struct shape_device devices [SHAPE_MAX_DEVICES];
+static pthread_mutex_t devices_lock = PTHREAD_MUTEX_INITIALIZER;
+static int shaped;						// Devices with a limit, checked without locking
+
+static struct shape_fleet *fleet;
+static double fleet_checked = -SHAPE_RECHECK;
+
+static void shape_lock (struct shape_bucket *b) {
+	if (pthread_mutex_lock(&b->lock) == EOWNERDEAD) pthread_mutex_consistent(&b->lock);
+}
+
+static void shape_init (struct shape_bucket *b, int shared) {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	if (shared) {
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);		// A killed station must not wedge the rest
+	}
+	pthread_mutex_init(&b->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+	b->rate = b->burst = b->tokens = b->bytes = b->waited = 0;
+	b->last = b->since = time_now();
+}
+
+//
+//	Map the fleet bucket, creating it if asked to. Without 'create' a missing
+//	file is looked for again at most once every SHAPE_RECHECK seconds.
+//
+
+static struct shape_fleet *shape_fleet (int create) {
+
+	const char *path = getenv("CC1800_FLEET");
+	struct shape_fleet *f;
+	double now = time_now();
+	int fd, i, init = 0;
+
+	if (fleet != NULL) return fleet;
+	if (!create && now - fleet_checked < SHAPE_RECHECK) return NULL;
+	fleet_checked = now;
+
+	if (path == NULL) path = "/dev/shm/usbtool-fleet";
+
+	fd = open(path, O_RDWR);
+	if (fd < 0 && create) {
+		fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0666);
+		if (fd >= 0) init = ftruncate(fd, sizeof(*f)) == 0;
+		else fd = open(path, O_RDWR);
+	}
+	if (fd < 0) {
+		if (create) fprintf(stderr, "ERROR: cannot open fleet bucket '%s'\n", path);
+		return NULL;
+	}
+
+	f = (struct shape_fleet *)mmap(NULL, sizeof(*f), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (f == MAP_FAILED) {
+		fprintf(stderr, "ERROR: cannot map fleet bucket '%s'\n", path);
+		return NULL;
+	}
+
+	if (init) {
+		shape_init(&f->b, 1);
+		__atomic_store_n(&f->magic, SHAPE_MAGIC, __ATOMIC_RELEASE);
+	}
+
+	// Another process may still be setting it up
+
+	for (i = 0; i < 100 && __atomic_load_n(&f->magic, __ATOMIC_ACQUIRE) != SHAPE_MAGIC; i++) usleep(1000);
+	if (f->magic != SHAPE_MAGIC) {
+		fprintf(stderr, "ERROR: fleet bucket '%s' is not valid, remove it\n", path);
+		munmap(f, sizeof(*f));
+		return NULL;
+	}
+
+	fleet = f;
+	return f;
+}
+
+static struct shape_bucket *shape_device (struct usb_dev_handle *handle, int create) {
+
+	struct shape_bucket *b = NULL;
+	int i;
+
+	pthread_mutex_lock(&devices_lock);
+	for (i = 0; i < SHAPE_MAX_DEVICES && b == NULL; i++)
+		if (devices[i].handle == handle) b = &devices[i].b;
+	for (i = 0; i < SHAPE_MAX_DEVICES && b == NULL && create; i++) {
+		if (devices[i].handle != NULL) continue;
+		devices[i].handle = handle;
+		shape_init(&devices[i].b, 0);
+		b = &devices[i].b;
+	}
+	pthread_mutex_unlock(&devices_lock);
+
+	if (b == NULL && create) fprintf(stderr, "ERROR: too many devices shaped\n");
+	return b;
+}
+
+//
+//	Forget a device about to be closed, its handle may come back for another.
+//
+
+void shape_close (struct usb_dev_handle *handle) {
+
+	int i;
+
+	pthread_mutex_lock(&devices_lock);
+	for (i = 0; i < SHAPE_MAX_DEVICES; i++) {
+		if (devices[i].handle != handle) continue;
+		if (devices[i].b.rate > 0) __atomic_sub_fetch(&shaped, 1, __ATOMIC_RELAXED);
+		pthread_mutex_destroy(&devices[i].b.lock);
+		devices[i].handle = NULL;
+		break;
+	}
+	pthread_mutex_unlock(&devices_lock);
+}
+
+//
+//	Take 'len' tokens, returning how long to wait for them. Tokens are taken
+//	even when there are not enough, so that waiting transfers get served in
+//	order and a limit lower than a chunk per second still works.
+//
+
+static double shape_take (struct shape_bucket *b, unsigned long len) {
+
+	double now, wait = 0;
+
+	shape_lock(b);
+
+	now = time_now();
+	b->bytes += len;
+
+	if (b->rate > 0) {
+		b->tokens += (now - b->last) * b->rate;
+		if (b->tokens > b->burst) b->tokens = b->burst;
+		b->tokens -= len;
+		if (b->tokens < 0) wait = -b->tokens / b->rate;
+		b->waited += wait;
+	}
+
+	b->last = now;
+	pthread_mutex_unlock(&b->lock);
+	return wait;
+}
+
+//
+//	Called before every bulk transfer of 'len' bytes to or from a device.
+//
+
+void shape_transfer (struct usb_dev_handle *handle, unsigned long len) {
+
+	struct shape_bucket *b;
+	struct shape_fleet *f;
+	struct timespec ts;
+	double wait = 0, w;
+
+	if (__atomic_load_n(&shaped, __ATOMIC_RELAXED) > 0 && (b = shape_device(handle, 0)) != NULL) wait = shape_take(b, len);
+
+	f = shape_fleet(0);
+	if (f != NULL) {
+		w = shape_take(&f->b, len);
+		if (w > wait) wait = w;
+	}
+
+	if (wait <= 0) return;
+	ts.tv_sec = (time_t)wait;
+	ts.tv_nsec = (long)((wait - ts.tv_sec) * 1e9);
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+//==============================================================================
+//
+//	SHAPE command
+//
+
+static void shape_show (const char *what, struct shape_bucket *b) {
+
+	double now, t;
+
+	shape_lock(b);
+	now = time_now();
+	t = now - b->since;
+
+	printf("%-8s", what);
+	if (b->rate > 0) printf(" limit %8.2f MB/s burst %6.2f MB,", b->rate / 1e6, b->burst / 1e6);
+	else printf(" no limit,%30s", "");
+	printf(" achieved %8.2f MB/s over %.1f s, waited %.1f s\n", t > 0 ? b->bytes / t / 1e6 : 0, t, b->waited);
+
+	b->bytes = b->waited = 0;
+	b->since = now;
+	pthread_mutex_unlock(&b->lock);
+}
+
+static void shape_set (struct shape_bucket *b, double rate, double burst) {
+	shape_lock(b);
+	b->rate = rate;
+	b->burst = burst;
+	if (b->tokens > burst) b->tokens = burst;
+	pthread_mutex_unlock(&b->lock);
+}
+
+//
+//	Usage: shape [device|fleet <rate>|off [burst=<size>]]
+//	Without arguments shows the configured and achieved rates since last
+//	shown. Returns the number of arguments used.
+//
+
+int cc1800_shape (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct shape_bucket *b;
+	double rate = 0, burst = 0;
+	int n = 0, fleetwide, had;
+
+	if (argc >= 2 && (!strcmp(argv[0], "device") || !strcmp(argv[0], "fleet"))) {
+
+		fleetwide = !strcmp(argv[0], "fleet");
+
+		if (strcmp(argv[1], "off") && (scan_size(argv[1], &rate) < 0 || rate <= 0)) {
+			fprintf(stderr, "ERROR: invalid rate '%s'\n", argv[1]);
+			return -1;
+		}
+		n = 2;
+
+		if (argc > 2 && !strncmp(argv[2], "burst=", 6)) {
+			if (scan_size(argv[2] + 6, &burst) < 0 || burst <= 0) {
+				fprintf(stderr, "ERROR: invalid burst '%s'\n", argv[2] + 6);
+				return -1;
+			}
+			n = 3;
+		}
+
+		// By default allow a tenth of a second worth, and at least a chunk
+
+		if (burst == 0) burst = rate / 10 > (1 << 20) ? rate / 10 : (1 << 20);
+
+		if (fleetwide) {
+			if (shape_fleet(1) == NULL) return -1;
+			shape_set(&fleet->b, rate, burst);
+		} else {
+			b = shape_device(s->handle, 1);
+			if (b == NULL) return -1;
+			shape_lock(b);
+			had = b->rate > 0;
+			pthread_mutex_unlock(&b->lock);
+			shape_set(b, rate, burst);
+			if (had != (rate > 0)) __atomic_add_fetch(&shaped, rate > 0 ? 1 : -1, __ATOMIC_RELAXED);
+		}
+	}
+
+	b = shape_device(s->handle, 0);
+	if (b != NULL) shape_show("device", b);
+	else printf("device   no limit\n");
+
+	if (shape_fleet(0) != NULL) shape_show("fleet", &fleet->b);
+	else printf("fleet    no limit\n");
+
+	return n;
+}
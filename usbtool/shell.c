@@ -0,0 +1,279 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Interactive shell. The device stays claimed and the caches stay warm
+//	between commands, so each line only pays for its own USB traffic.
+//
+
+#define SHELL_MAX_LINE		1024
+#define SHELL_MAX_HISTORY	500
+#define SHELL_HISTORY_FILE	".usbtool_history"
+
+static char *history [SHELL_MAX_HISTORY];
+static int history_len;
+static FILE *history_file;
+
+static void history_add (const char *line) {
+
+	if (history_len > 0 && !strcmp(history[history_len - 1], line)) return;
+
+	if (history_len == SHELL_MAX_HISTORY) {
+		free(history[0]);
+		memmove(history, history + 1, (SHELL_MAX_HISTORY - 1) * sizeof(char *));
+		history_len--;
+	}
+
+	history[history_len] = strdup(line);
+	if (history[history_len] != NULL) history_len++;
+
+	if (history_file != NULL) {
+		fprintf(history_file, "%s\n", line);
+		fflush(history_file);
+	}
+}
+
+//
+//	History is kept in the user's home directory and appended to as lines are
+//	entered, so it survives crashes and is shared by concurrent shells.
+//
+
+static void history_open (void) {
+
+	char path [SHELL_MAX_LINE], line [SHELL_MAX_LINE];
+	const char *home = getenv("HOME");
+	FILE *f;
+	int n;
+
+	if (home == NULL) return;
+	snprintf(path, sizeof(path), "%s/%s", home, SHELL_HISTORY_FILE);
+
+	f = fopen(path, "r");
+	if (f != NULL) {
+		while (fgets(line, sizeof(line), f) != NULL) {
+			n = strlen(line);
+			while (n > 0 && isspace((unsigned char)line[n - 1])) line[--n] = 0;
+			if (n > 0) history_add(line);
+		}
+		fclose(f);
+	}
+
+	history_file = fopen(path, "a");
+}
+
+static void history_close (void) {
+	int i;
+	if (history_file != NULL) fclose(history_file);
+	history_file = NULL;
+	for (i = 0; i < history_len; i++) free(history[i]);
+	history_len = 0;
+}
+
+//
+//	Expand "!!" and "!<n>" history references. Returns -1 if there is no such
+//	history entry.
+//
+
+static int history_expand (char *line, int size) {
+
+	char *end;
+	long n;
+
+	if (line[0] != '!') return 0;
+
+	if (line[1] == '!' && line[2] == 0) n = history_len;
+	else {
+		n = strtol(line + 1, &end, 10);
+		if (*end != 0) return 0;
+	}
+
+	if (n < 1 || n > history_len) {
+		fprintf(stderr, "ERROR: no such history entry '%s'\n", line);
+		return -1;
+	}
+
+	snprintf(line, size, "%s", history[n - 1]);
+	printf("%s\n", line);
+	return 0;
+}
+
+//
+//	Split a line into arguments, honoring double quotes. The line is modified
+//	in place and the arguments point into it.
+//
+
+int shell_split (char *line, const char **argv) {
+
+	int argc = 0;
+	char *p = line, *q;
+
+	for (;;) {
+		while (isspace((unsigned char)*p)) p++;
+		if (*p == 0 || *p == '#') break;
+
+		if (argc == SHELL_MAX_ARGS) {
+			fprintf(stderr, "ERROR: too many arguments\n");
+			return -1;
+		}
+
+		if (*p == '"') {
+			argv[argc++] = ++p;
+			q = strchr(p, '"');
+			if (q == NULL) {
+				fprintf(stderr, "ERROR: unterminated quote\n");
+				return -1;
+			}
+			*q = 0; p = q + 1;
+		} else {
+			argv[argc++] = p;
+			while (*p && !isspace((unsigned char)*p)) p++;
+			if (*p) *p++ = 0;
+		}
+	}
+
+	return argc;
+}
+
+static const char *shell_help =
+
+"Commands:\n"
+"    write <address> <file|directory>\n"
+"    read <address> <length> <file>\n"
+"    dump <address> <length> <store> <board> [lz4=1 [key=value...]]   add to a deduplicating dump store\n"
+"    exec\n"
+"    memmap [on|off]   show the memory map, or turn its checks on or off\n"
+"    probe [show|forget]   measure loader transfer limits, or show them\n"
+"    norflash <offset> <file> [key=value...]\n"
+"    watermark <address> <file> <name>=<start>:<size>...   run, report stack/heap use\n"
+"    monitor [wait | <address> <file> [key=value...]]   run under the monitor, or check on it\n"
+"    run <address> <file> [key=value...]   run to completion and get the loader back\n"
+"    patch <running elf> <rebuilt elf> [area=<address>[:<size>]]   hot patch changed functions\n"
+"    coverage <elf> [key=value...]   collect .gcda files after a test has run\n"
+"    bench [check|save <baseline>] [<name>...]\n"
+"    shape [device|fleet <rate>|off]   limit bulk transfer rates, or show them\n"
+"    budget [<size>|off]   limit host memory use, and report peak RSS per command\n"
+"    mount <dir> [key=value...]\n"
+"    info              show CPU info\n"
+"    files             list cached files\n"
+"    cache [clear]     show or clear the target memory cache\n"
+"    history           list command history (use !! or !<n> to repeat)\n"
+"    help\n"
+"    quit\n"
+"\n";
+
+//
+//	Shell local commands. Returns 1 if the command was handled here, or 0 if
+//	it must be passed on to the command interpreter.
+//
+
+static int shell_local (struct cc1800_session *s, int argc, const char **argv, int *quit) {
+
+	int i;
+
+	if (!strcmp(argv[0], "quit") || !strcmp(argv[0], "exit")) {
+		*quit = 1;
+	}
+
+	else if (!strcmp(argv[0], "help")) {
+		fputs(shell_help, stdout);
+	}
+
+	else if (!strcmp(argv[0], "history")) {
+		for (i = 0; i < history_len; i++) printf("%5d  %s\n", i + 1, history[i]);
+	}
+
+	else if (!strcmp(argv[0], "info")) {
+		printf("CPU info: %s\n", s->cpu_info);
+	}
+
+	else if (!strcmp(argv[0], "files")) {
+		file_cache_list(s->files);
+	}
+
+	else if (!strcmp(argv[0], "cache")) {
+		if (s->mem == NULL) printf("No target memory cache under a memory budget\n");
+		else {
+			if (argc > 1 && !strcmp(argv[1], "clear")) mem_cache_invalidate(s->mem);
+			mem_cache_stats(s->mem);
+		}
+	}
+
+	else return 0;
+
+	return 1;
+}
+
+int cc1800_shell (struct cc1800_session *s) {
+
+	char line [SHELL_MAX_LINE];
+	const char *argv [SHELL_MAX_ARGS];
+	int argc, n, r = 0, quit = 0, tty = isatty(0);
+	double t;
+
+	if (s->files == NULL) s->files = file_cache_new();
+	if (s->mem == NULL && budget_get() == 0) s->mem = mem_cache_new();
+	if (s->files == NULL || (s->mem == NULL && budget_get() == 0)) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	s->interactive = 1;
+	if (tty) history_open();
+
+	while (!quit) {
+
+		if (tty) { printf("cc1800> "); fflush(stdout); }
+		if (fgets(line, sizeof(line), stdin) == NULL) break;
+
+		n = strlen(line);
+		while (n > 0 && isspace((unsigned char)line[n - 1])) line[--n] = 0;
+		if (n == 0) continue;
+
+		if (history_expand(line, sizeof(line)) < 0) continue;
+		history_add(line);
+
+		argc = shell_split(line, argv);
+		if (argc <= 0) continue;
+
+		t = time_now();
+
+		if (!shell_local(s, argc, argv, &quit)) {
+			r = cc1800_fiddle(s, argc, argv);
+			budget_command(NULL);
+
+			// Only a dead device ends the shell, anything else is reported
+			// and the user gets to try again
+
+			if (r < 0 && cc1800_req_get_cpu_info(s->handle, s->cpu_info) < 0) {
+				fprintf(stderr, "ERROR: device is not responding\n");
+				break;
+			}
+			r = 0;
+		}
+
+		if (!quit) printf("[%.3f ms]\n", (time_now() - t) * 1e3);
+	}
+
+	if (tty && !quit) putchar('\n');
+	history_close();
+	s->interactive = 0;
+
+	return r;
+}
@@ -0,0 +1,538 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <string.h>
+
+#include "arm.h"
+
+//==============================================================================
+
+void arm_reset (struct arm_cpu *cpu) {
+	memset(cpu->r, 0, sizeof(cpu->r));
+	memset(cpu->bank, 0, sizeof(cpu->bank));
+	cpu->spsr = 0;
+	cpu->cpsr = 0x13;				// SVC mode, IRQs enabled
+	cpu->cycles = 0;
+	cpu->halt = 0;
+}
+
+// Register bank of a mode: user and system, FIQ, IRQ, SVC, abort, undefined
+
+static int arm_bank (uint32_t cpsr) {
+	switch (cpsr & 0x1F) {
+	case 0x11: return 1;
+	case 0x12: return 2;
+	case 0x13: return 3;
+	case 0x17: return 4;
+	case 0x1B: return 5;
+	default: return 0;
+	}
+}
+
+//
+//	Set CPSR, switching sp, lr and SPSR to those of the new mode.
+//
+
+void arm_set_cpsr (struct arm_cpu *cpu, uint32_t cpsr) {
+
+	int from = arm_bank(cpu->cpsr), to = arm_bank(cpsr);
+
+	if (from != to) {
+		cpu->bank[from][0] = cpu->r[13];
+		cpu->bank[from][1] = cpu->r[14];
+		cpu->bank[from][2] = cpu->spsr;
+		cpu->r[13] = cpu->bank[to][0];
+		cpu->r[14] = cpu->bank[to][1];
+		cpu->spsr = cpu->bank[to][2];
+	}
+	cpu->cpsr = cpsr;
+}
+
+static int arm_cond (uint32_t cpsr, uint32_t cond) {
+
+	int n = !!(cpsr & ARM_N), z = !!(cpsr & ARM_Z), c = !!(cpsr & ARM_C), v = !!(cpsr & ARM_V);
+
+	switch (cond) {
+	case 0x0: return z;
+	case 0x1: return !z;
+	case 0x2: return c;
+	case 0x3: return !c;
+	case 0x4: return n;
+	case 0x5: return !n;
+	case 0x6: return v;
+	case 0x7: return !v;
+	case 0x8: return c && !z;
+	case 0x9: return !c || z;
+	case 0xA: return n == v;
+	case 0xB: return n != v;
+	case 0xC: return !z && n == v;
+	case 0xD: return z || n != v;
+	default:  return 1;
+	}
+}
+
+//
+//	Register value as seen by an instruction: PC reads two instructions ahead.
+//
+
+static uint32_t arm_reg (struct arm_cpu *cpu, int n) {
+	return n == 15 ? cpu->r[15] + 8 : cpu->r[n];
+}
+
+//
+//	Barrel shifter. Returns the shifted value and updates *carry.
+//
+
+static uint32_t arm_shift (uint32_t v, int type, uint32_t amount, int imm, int *carry) {
+
+	switch (type) {
+
+	case 0:							// LSL
+		if (amount == 0) return v;
+		if (amount < 32) { *carry = (v >> (32 - amount)) & 1; return v << amount; }
+		*carry = amount == 32 ? v & 1 : 0;
+		return 0;
+
+	case 1:							// LSR
+		if (imm && amount == 0) amount = 32;
+		if (amount == 0) return v;
+		if (amount < 32) { *carry = (v >> (amount - 1)) & 1; return v >> amount; }
+		*carry = amount == 32 ? v >> 31 : 0;
+		return 0;
+
+	case 2:							// ASR
+		if (imm && amount == 0) amount = 32;
+		if (amount == 0) return v;
+		if (amount < 32) { *carry = ((int32_t)v >> (amount - 1)) & 1; return (int32_t)v >> amount; }
+		*carry = v >> 31;
+		return (int32_t)v >> 31;
+
+	default:						// ROR, RRX
+		if (imm && amount == 0) {
+			uint32_t r = (v >> 1) | ((uint32_t)*carry << 31);
+			*carry = v & 1;
+			return r;
+		}
+		if (amount == 0) return v;
+		amount &= 31;
+		if (amount == 0) { *carry = v >> 31; return v; }
+		*carry = (v >> (amount - 1)) & 1;
+		return (v >> amount) | (v << (32 - amount));
+	}
+}
+
+//
+//	Second operand of data processing instructions.
+//
+
+static uint32_t arm_operand2 (struct arm_cpu *cpu, uint32_t insn, int *carry) {
+
+	uint32_t rot, v;
+
+	*carry = !!(cpu->cpsr & ARM_C);
+
+	if (insn & 0x02000000) {
+		rot = ((insn >> 8) & 15) * 2;
+		v = insn & 0xFF;
+		if (rot == 0) return v;
+		v = (v >> rot) | (v << (32 - rot));
+		*carry = v >> 31;
+		return v;
+	}
+
+	v = arm_reg(cpu, insn & 15);
+
+	if (insn & 0x10)
+		return arm_shift(v, (insn >> 5) & 3, arm_reg(cpu, (insn >> 8) & 15) & 0xFF, 0, carry);
+
+	return arm_shift(v, (insn >> 5) & 3, (insn >> 7) & 31, 1, carry);
+}
+
+static void arm_nz (struct arm_cpu *cpu, uint32_t r) {
+	cpu->cpsr &= ~(ARM_N | ARM_Z);
+	if (r & 0x80000000) cpu->cpsr |= ARM_N;
+	if (r == 0) cpu->cpsr |= ARM_Z;
+}
+
+static uint32_t arm_add (struct arm_cpu *cpu, uint32_t a, uint32_t b, int c, int s) {
+	uint64_t u = (uint64_t)a + b + c;
+	uint32_t r = (uint32_t)u;
+	if (s) {
+		arm_nz(cpu, r);
+		cpu->cpsr &= ~(ARM_C | ARM_V);
+		if (u >> 32) cpu->cpsr |= ARM_C;
+		if (~(a ^ b) & (a ^ r) & 0x80000000) cpu->cpsr |= ARM_V;
+	}
+	return r;
+}
+
+//
+//	Write a result to a register, taking care of branches through PC.
+//
+
+static int arm_set (struct arm_cpu *cpu, int n, uint32_t v, int interwork) {
+	if (n != 15) { cpu->r[n] = v; return 0; }
+	if (interwork && (v & 1)) return -1;		// Thumb is not supported
+	cpu->r[15] = v & ~3;
+	return 1;
+}
+
+static int arm_load (struct arm_cpu *cpu, uint32_t addr, int size, uint32_t *v) {
+	if ((addr & (size - 1)) || cpu->bus.read(cpu->bus.ctx, addr, size, v) < 0) {
+		cpu->fault_addr = addr;
+		return -1;
+	}
+	return 0;
+}
+
+static int arm_store (struct arm_cpu *cpu, uint32_t addr, int size, uint32_t v) {
+	if ((addr & (size - 1)) || cpu->bus.write(cpu->bus.ctx, addr, size, v) < 0) {
+		cpu->fault_addr = addr;
+		return -1;
+	}
+	return 0;
+}
+
+//==============================================================================
+//
+//	Instruction groups. Each returns 0 to continue with the next instruction,
+//	1 if it changed PC, or an arm_stop code negated on failure.
+//
+
+static int arm_data (struct arm_cpu *cpu, uint32_t insn) {
+
+	int op = (insn >> 21) & 15, s = (insn >> 20) & 1, rd = (insn >> 12) & 15, carry;
+	uint32_t a = arm_reg(cpu, (insn >> 16) & 15), b, r = 0;
+
+	b = arm_operand2(cpu, insn, &carry);
+
+	if (s && rd == 15) return -ARM_UNDEFINED;		// Exception return, no modes here
+
+	switch (op) {
+	case 0x0: r = a & b; break;										// AND
+	case 0x1: r = a ^ b; break;										// EOR
+	case 0x2: r = arm_add(cpu, a, ~b, 1, s); break;					// SUB
+	case 0x3: r = arm_add(cpu, b, ~a, 1, s); break;					// RSB
+	case 0x4: r = arm_add(cpu, a, b, 0, s); break;					// ADD
+	case 0x5: r = arm_add(cpu, a, b, !!(cpu->cpsr & ARM_C), s); break;		// ADC
+	case 0x6: r = arm_add(cpu, a, ~b, !!(cpu->cpsr & ARM_C), s); break;		// SBC
+	case 0x7: r = arm_add(cpu, b, ~a, !!(cpu->cpsr & ARM_C), s); break;		// RSC
+	case 0x8: r = a & b; break;										// TST
+	case 0x9: r = a ^ b; break;										// TEQ
+	case 0xA: arm_add(cpu, a, ~b, 1, 1); return 0;					// CMP
+	case 0xB: arm_add(cpu, a, b, 0, 1); return 0;					// CMN
+	case 0xC: r = a | b; break;										// ORR
+	case 0xD: r = b; break;											// MOV
+	case 0xE: r = a & ~b; break;									// BIC
+	case 0xF: r = ~b; break;										// MVN
+	}
+
+	if (s && (op < 2 || (op >= 8 && op <= 9) || op >= 0xC)) {
+		arm_nz(cpu, r);
+		cpu->cpsr = (cpu->cpsr & ~ARM_C) | (carry ? ARM_C : 0);
+	}
+
+	if (op >= 8 && op <= 9) return 0;
+	return arm_set(cpu, rd, r, 0) < 0 ? -ARM_UNDEFINED : (rd == 15);
+}
+
+static int arm_multiply (struct arm_cpu *cpu, uint32_t insn) {
+
+	int rd = (insn >> 16) & 15, rn = (insn >> 12) & 15, s = (insn >> 20) & 1;
+	uint32_t a = cpu->r[insn & 15], b = cpu->r[(insn >> 8) & 15], r;
+	uint64_t u;
+
+	if (!(insn & 0x00800000)) {
+		r = a * b;
+		if (insn & 0x00200000) r += cpu->r[rn];			// MLA
+		cpu->r[rd] = r;
+		if (s) arm_nz(cpu, r);
+		return 0;
+	}
+
+	if (insn & 0x00400000) u = (uint64_t)((int64_t)(int32_t)a * (int32_t)b);
+	else u = (uint64_t)a * b;
+	if (insn & 0x00200000) u += ((uint64_t)cpu->r[rd] << 32) | cpu->r[rn];
+
+	cpu->r[rn] = (uint32_t)u;
+	cpu->r[rd] = (uint32_t)(u >> 32);
+	if (s) {
+		cpu->cpsr &= ~(ARM_N | ARM_Z);
+		if (u >> 63) cpu->cpsr |= ARM_N;
+		if (u == 0) cpu->cpsr |= ARM_Z;
+	}
+	return 0;
+}
+
+static int arm_transfer (struct arm_cpu *cpu, uint32_t insn) {
+
+	int p = (insn >> 24) & 1, u = (insn >> 23) & 1, b = (insn >> 22) & 1, w = (insn >> 21) & 1;
+	int l = (insn >> 20) & 1, rn = (insn >> 16) & 15, rd = (insn >> 12) & 15, carry;
+	uint32_t off, base = arm_reg(cpu, rn), addr, v;
+
+	carry = !!(cpu->cpsr & ARM_C);
+	if (insn & 0x02000000) off = arm_shift(cpu->r[insn & 15], (insn >> 5) & 3, (insn >> 7) & 31, 1, &carry);
+	else off = insn & 0xFFF;
+
+	addr = u ? base + off : base - off;
+	if (!p) { v = addr; addr = base; } else v = addr;
+
+	if (l) {
+		if (arm_load(cpu, addr, b ? 1 : 4, &off) < 0) return -ARM_ABORT;
+		if ((!p || w) && rn != 15) cpu->r[rn] = v;
+		if (arm_set(cpu, rd, off, 1) < 0) return -ARM_UNDEFINED;
+		return rd == 15;
+	}
+
+	if (arm_store(cpu, addr, b ? 1 : 4, arm_reg(cpu, rd)) < 0) return -ARM_ABORT;
+	if ((!p || w) && rn != 15) cpu->r[rn] = v;
+	return 0;
+}
+
+static int arm_transfer_extra (struct arm_cpu *cpu, uint32_t insn) {
+
+	int p = (insn >> 24) & 1, u = (insn >> 23) & 1, w = (insn >> 21) & 1, l = (insn >> 20) & 1;
+	int rn = (insn >> 16) & 15, rd = (insn >> 12) & 15, sh = (insn >> 5) & 3;
+	uint32_t off, base = arm_reg(cpu, rn), addr, next, v;
+
+	if (insn & 0x00400000) off = ((insn >> 4) & 0xF0) | (insn & 15);
+	else off = cpu->r[insn & 15];
+
+	addr = u ? base + off : base - off;
+	next = addr;
+	if (!p) addr = base;
+
+	if (l) {
+		if (arm_load(cpu, addr, sh == 1 || sh == 3 ? 2 : 1, &v) < 0) return -ARM_ABORT;
+		if (sh == 2) v = (int32_t)(int8_t)v;
+		else if (sh == 3) v = (int32_t)(int16_t)v;
+		if ((!p || w) && rn != 15) cpu->r[rn] = next;
+		if (rd == 15) return -ARM_UNDEFINED;
+		cpu->r[rd] = v;
+		return 0;
+	}
+
+	if (sh != 1) return -ARM_UNDEFINED;				// LDRD and STRD are not supported
+	if (arm_store(cpu, addr, 2, cpu->r[rd] & 0xFFFF) < 0) return -ARM_ABORT;
+	if ((!p || w) && rn != 15) cpu->r[rn] = next;
+	return 0;
+}
+
+static int arm_block (struct arm_cpu *cpu, uint32_t insn) {
+
+	int p = (insn >> 24) & 1, u = (insn >> 23) & 1, w = (insn >> 21) & 1, l = (insn >> 20) & 1;
+	int rn = (insn >> 16) & 15, i, n = 0, pc = 0;
+	uint32_t list = insn & 0xFFFF, addr, base = cpu->r[rn], v;
+
+	if (insn & 0x00400000) return -ARM_UNDEFINED;	// User bank or SPSR transfer
+
+	for (i = 0; i < 16; i++) if (list & (1 << i)) n++;
+
+	// Normalise to an ascending transfer starting at addr
+
+	if (u) addr = p ? base + 4 : base;
+	else addr = p ? base - 4 * n : base - 4 * n + 4;
+
+	for (i = 0; i < 16; i++) {
+		if (!(list & (1 << i))) continue;
+		if (l) {
+			if (arm_load(cpu, addr, 4, &v) < 0) return -ARM_ABORT;
+			if (i == 15) {
+				if (v & 1) return -ARM_UNDEFINED;
+				cpu->r[15] = v & ~3;
+				pc = 1;
+			} else cpu->r[i] = v;
+		} else {
+			if (arm_store(cpu, addr, 4, i == 15 ? cpu->r[15] + 8 : cpu->r[i]) < 0) return -ARM_ABORT;
+		}
+		addr += 4;
+	}
+
+	if (w && !(l && (list & (1 << rn)))) cpu->r[rn] = u ? base + 4 * n : base - 4 * n;
+	return pc;
+}
+
+//
+//	CP15 accesses: the control register, fault status and address (always
+//	an external abort at fault_addr), cache and TLB maintenance (ignored) and
+//	the ARM11 cycle counter.
+//
+
+static int arm_cp15 (struct arm_cpu *cpu, uint32_t insn) {
+
+	int l = (insn >> 20) & 1, rd = (insn >> 12) & 15;
+	int crn = (insn >> 16) & 15, crm = insn & 15, op2 = (insn >> 5) & 7;
+	uint32_t v = 0;
+
+	if (((insn >> 8) & 15) != 15) return -ARM_UNDEFINED;
+
+	if (crn == 1 && crm == 0 && op2 == 0) {
+		if (l) v = cpu->cp15_control;
+		else cpu->cp15_control = cpu->r[rd];
+	}
+	else if (crn == 15 && crm == 12 && op2 == 1) v = (uint32_t)cpu->cycles;
+	else if (crn == 0) v = 0x4107B362;				// ARM1136 main ID
+	else if (crn == 5) v = 0x8;
+	else if (crn == 6) v = cpu->fault_addr;
+	else if (crn != 7 && crn != 8 && crn != 15) return -ARM_UNDEFINED;
+
+	if (l && rd != 15) cpu->r[rd] = v;
+	return 0;
+}
+
+//
+//	ARMv6 media instructions: byte reversal and zero/sign extension.
+//
+
+static int arm_media (struct arm_cpu *cpu, uint32_t insn) {
+
+	int rd = (insn >> 12) & 15;
+	uint32_t v = cpu->r[insn & 15], rot = ((insn >> 10) & 3) * 8;
+
+	if ((insn & 0x0FFF0FF0) == 0x06BF0F30) {			// REV
+		cpu->r[rd] = (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+		return 0;
+	}
+
+	if ((insn & 0x0F8F03F0) == 0x068F0070) {			// SXTB, SXTH, UXTB, UXTH
+		if (rot) v = (v >> rot) | (v << (32 - rot));
+		switch ((insn >> 20) & 7) {
+		case 2: cpu->r[rd] = (int32_t)(int8_t)v; return 0;
+		case 3: cpu->r[rd] = (int32_t)(int16_t)v; return 0;
+		case 6: cpu->r[rd] = v & 0xFF; return 0;
+		case 7: cpu->r[rd] = v & 0xFFFF; return 0;
+		}
+	}
+
+	return -ARM_UNDEFINED;
+}
+
+//
+//	MSR to CPSR or SPSR, flags and control fields only.
+//
+
+static void arm_msr (struct arm_cpu *cpu, uint32_t insn, uint32_t v) {
+
+	uint32_t psr = insn & 0x00400000 ? cpu->spsr : cpu->cpsr;
+
+	if (insn & 0x00080000) psr = (psr & 0x00FFFFFF) | (v & 0xFF000000);
+	if (insn & 0x00010000) psr = (psr & ~0xFF) | (v & 0xFF);
+	if (insn & 0x00400000) cpu->spsr = psr;
+	else arm_set_cpsr(cpu, psr);
+}
+
+static int arm_execute (struct arm_cpu *cpu, uint32_t insn) {
+
+	uint32_t pc = cpu->r[15];
+
+	if ((insn >> 28) == 0xF) {
+		if ((insn & 0xFD70F000) == 0xF550F000) return 0;	// PLD
+		return -ARM_UNDEFINED;
+	}
+
+	if (!arm_cond(cpu->cpsr, insn >> 28)) return 0;
+
+	switch ((insn >> 25) & 7) {
+
+	case 0:
+		if ((insn & 0x0FC000F0) == 0x00000090 || (insn & 0x0F8000F0) == 0x00800090)
+			return arm_multiply(cpu, insn);
+		if ((insn & 0x0E000090) == 0x00000090 && (insn & 0x60))
+			return arm_transfer_extra(cpu, insn);
+		if ((insn & 0x0FFFFFD0) == 0x012FFF10) {			// BX, BLX
+			uint32_t t = cpu->r[insn & 15];
+			if (t & 1) return -ARM_UNDEFINED;
+			if (insn & 0x20) cpu->r[14] = pc + 4;
+			cpu->r[15] = t & ~3;
+			return 1;
+		}
+		if ((insn & 0x0FFF0FF0) == 0x016F0F10) {			// CLZ
+			uint32_t v = cpu->r[insn & 15];
+			cpu->r[(insn >> 12) & 15] = v ? __builtin_clz(v) : 32;
+			return 0;
+		}
+		if ((insn & 0x0FBF0FFF) == 0x010F0000) {			// MRS
+			cpu->r[(insn >> 12) & 15] = insn & 0x00400000 ? cpu->spsr : cpu->cpsr;
+			return 0;
+		}
+		if ((insn & 0x0FB0FFF0) == 0x0120F000) {			// MSR register
+			arm_msr(cpu, insn, cpu->r[insn & 15]);
+			return 0;
+		}
+		if ((insn & 0x01900000) == 0x01000000) return -ARM_UNDEFINED;
+		return arm_data(cpu, insn);
+
+	case 1:
+		if ((insn & 0x0FB00000) == 0x03200000) {			// MSR immediate and hints
+			uint32_t rot = ((insn >> 8) & 15) * 2, v = insn & 0xFF;
+			if (rot) v = (v >> rot) | (v << (32 - rot));
+			arm_msr(cpu, insn, v);
+			return 0;
+		}
+		if ((insn & 0x01900000) == 0x01000000) return -ARM_UNDEFINED;
+		return arm_data(cpu, insn);
+
+	case 2:
+		return arm_transfer(cpu, insn);
+
+	case 3:
+		if (insn & 0x10) return arm_media(cpu, insn);
+		return arm_transfer(cpu, insn);
+
+	case 4:
+		return arm_block(cpu, insn);
+
+	case 5:
+		if (insn & 0x01000000) cpu->r[14] = pc + 4;
+		cpu->r[15] = pc + 8 + ((int32_t)(insn << 8) >> 6);
+		return 1;
+
+	case 7:
+		if (!(insn & 0x01000000) && (insn & 0x10)) return arm_cp15(cpu, insn);
+		return -ARM_UNDEFINED;
+
+	default:
+		return -ARM_UNDEFINED;
+	}
+}
+
+//
+//	Run until something stops the CPU. On return r[15] is the address of the
+//	instruction that stopped it, and fault_addr holds the faulting address
+//	(aborts, fault_fetch set for prefetch aborts) or instruction (undefined).
+//
+
+enum arm_stop arm_run (struct arm_cpu *cpu) {
+
+	uint32_t insn;
+	int r;
+
+	for (;;) {
+
+		if (cpu->halt) return ARM_HALTED;
+		if (cpu->bus.hook != NULL && cpu->bus.hook(cpu->bus.ctx, cpu->r[15])) return ARM_HOOK;
+
+		if (arm_load(cpu, cpu->r[15], 4, &insn) < 0) {
+			cpu->fault_fetch = 1;
+			return ARM_ABORT;
+		}
+
+		r = arm_execute(cpu, insn);
+		cpu->cycles++;
+
+		if (r < 0) {
+			cpu->fault_fetch = 0;
+			if (r == -ARM_UNDEFINED) cpu->fault_addr = insn;
+			return -r;
+		}
+		if (r == 0) cpu->r[15] += 4;
+	}
+}
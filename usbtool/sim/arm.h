@@ -0,0 +1,63 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#ifndef SIM_ARM_H
+#define SIM_ARM_H
+
+#include <stdint.h>
+
+//==============================================================================
+//
+//	Minimal ARM (ARMv6, ARM state only) interpreter used by the simulator to
+//	run uploaded code. Only what plain integer code needs is implemented: no
+//	Thumb, no coprocessors other than a few CP15 registers, and modes bank sp,
+//	lr and SPSR only (not the FIQ r8-r12). Exceptions stop the CPU, the caller
+//	may then enter them (see sim_payload).
+//
+
+#define ARM_N	0x80000000
+#define ARM_Z	0x40000000
+#define ARM_C	0x20000000
+#define ARM_V	0x10000000
+
+enum arm_stop {
+	ARM_RUNNING = 0,
+	ARM_HOOK,						// PC reached a hook address
+	ARM_UNDEFINED,					// Unsupported or undefined instruction
+	ARM_ABORT,						// Memory access fault
+	ARM_HALTED,						// Stopped from outside
+};
+
+struct arm_bus {
+	void *ctx;
+	int (*read) (void *ctx, uint32_t addr, int size, uint32_t *val);
+	int (*write) (void *ctx, uint32_t addr, int size, uint32_t val);
+	int (*hook) (void *ctx, uint32_t pc);	// Non zero stops at pc
+};
+
+struct arm_cpu {
+	uint32_t r [16];
+	uint32_t cpsr;
+	uint32_t spsr;					// Of the current mode
+	uint32_t bank [6][3];			// sp, lr and SPSR of the other modes
+	uint32_t cp15_control;
+	uint64_t cycles;
+	uint32_t fault_addr;			// Faulting address or instruction
+	int fault_fetch;				// Abort on instruction fetch
+	volatile int halt;
+	struct arm_bus bus;
+};
+
+void arm_reset (struct arm_cpu *cpu);
+void arm_set_cpsr (struct arm_cpu *cpu, uint32_t cpsr);
+enum arm_stop arm_run (struct arm_cpu *cpu);
+
+#endif
@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+#	USB boot tool for ChinaChip CC1800 system-on-chip.
+#
+#	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+#
+#	This program is free software; you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License version 2 as
+#	published by the Free Software Foundation.
+#
+
+#	Functional check of incremental NOR programming against the simulated
+#	flash (sim/spinor.c), run by "make check". The flash backing file is the
+#	read back: after each norflash command it must hold the image where it
+#	was written and what it had before everywhere else. The image starts
+#	in the middle of a sector, so that the parts kept come from the flash.
+#
+#	Changes go from some bytes (top bit flips among them, which a weak
+#	sector hash misses) to a whole sector left blank (erase only), and the
+#	last run writes the same image again, which must program nothing.
+
+set -e
+
+TOOL=./usbtool-sim
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+OFFSET=4352				# 0x1100, inside the second 4 KB sector
+LEN=40000
+SIZE=1048576
+
+export CC1800_SIM_NOR="$DIR/nor.bin" CC1800_SIM_NOR_SIZE=$SIZE CC1800_SIM_NOR_SCALE=0
+
+fail () {
+	echo "check: $*" >&2
+	exit 1
+}
+
+# Xor byte $2 of file $1 with $3
+
+flip () {
+	v=$(od -An -tu1 -j "$2" -N1 "$1")
+	printf '%b' "\\0$(printf %o $((v ^ $3)))" | dd of="$1" bs=1 seek="$2" conv=notrunc 2>/dev/null
+}
+
+# Program $1, check the flash and that $2 sectors were programmed
+
+program () {
+	out=$($TOOL norflash $OFFSET "$1" 2>&1) || { echo "$out" >&2; fail "norflash $1 failed"; }
+	n=$(echo "$out" | sed -n 's/^\([0-9]*\) sectors programmed.*/\1/p')
+	[ "$n" = "$2" ] || { echo "$out" >&2; fail "$1: $n sectors programmed, $2 expected"; }
+	head -c $OFFSET "$CC1800_SIM_NOR" | cmp -s - "$DIR/before.head" || fail "$1: flash before the image changed"
+	tail -c +$((OFFSET + 1)) "$CC1800_SIM_NOR" | head -c $LEN | cmp -s - "$1" || fail "$1: flash does not match the image"
+	tail -c +$((OFFSET + LEN + 1)) "$CC1800_SIM_NOR" | cmp -s - "$DIR/before.tail" || fail "$1: flash after the image changed"
+	echo "check: $(basename "$1"): $n sectors programmed, flash matches"
+}
+
+head -c $SIZE /dev/urandom > "$CC1800_SIM_NOR"
+head -c $OFFSET "$CC1800_SIM_NOR" > "$DIR/before.head"
+tail -c +$((OFFSET + LEN + 1)) "$CC1800_SIM_NOR" > "$DIR/before.tail"
+
+head -c $LEN /dev/urandom > "$DIR/a.img"
+program "$DIR/a.img" 10
+
+# Two flips of the top bit of a word in one sector, one in another, a low
+# bit in a third (the image starts word aligned)
+
+cp "$DIR/a.img" "$DIR/b.img"
+flip "$DIR/b.img" 5003 128
+flip "$DIR/b.img" 6003 128
+flip "$DIR/b.img" 20003 128
+flip "$DIR/b.img" 30000 1
+program "$DIR/b.img" 3
+
+# The fourth sector blank in the new image
+
+cp "$DIR/b.img" "$DIR/c.img"
+head -c 4096 /dev/zero | tr '\000' '\377' | dd of="$DIR/c.img" bs=1 seek=$((3 * 4096 - OFFSET)) conv=notrunc 2>/dev/null
+program "$DIR/c.img" 1
+
+program "$DIR/c.img" 0
+
+echo "check: norflash ok"
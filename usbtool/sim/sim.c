@@ -0,0 +1,632 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include "usb.h"
+#include "arm.h"
+#include "sim.h"
+
+//==============================================================================
+//
+//	Simulated CC1800 in USB boot mode, behind the libusb 0.1 API so that the
+//	unmodified usbtool sources can be linked against it ("make usbtool-sim").
+//
+//	The SD loaded USB loader (rom.bin) is not executed, its behaviour is
+//	modeled instead: the vendor requests update the loader variables in SRAM
+//	exactly like the interrupt handler does, and a device thread plays the
+//	loader main loop, moving bulk data and calling uploaded code, which runs
+//	on a small ARM interpreter. Uploaded code may call the loader download
+//	and readback routines, which are serviced by the model as well.
+//
+//	Anything that would hang the real device (DMA outside memory, clobbering
+//	the loader, a fault in uploaded code) hangs the model too: from then on
+//	every request times out, so error paths can be exercised on the bench.
+//	Faults are taken through the exception vectors at 0, a page of RAM, when
+//	uploaded code has put a handler there.
+//
+//	CC1800_SIM_ROM			loader image, default "rom.bin" if present
+//	CC1800_SIM_VERBOSE		log requests and peripheral statistics
+//	CC1800_SIM_TRACE		log the address of every instruction executed
+//	CC1800_SIM_USBMON		write the USB traffic to a file in usbmon text format
+//
+
+#define SIM_VECTOR_BASE			0x00000000		// Exception vectors, RAM
+#define SIM_VECTOR_SIZE			0x00001000
+#define SIM_SRAM_BASE			0x00100000
+#define SIM_SRAM_SIZE			0x00004000
+#define SIM_SDRAM_BASE			0x40000000
+#define SIM_SDRAM_SIZE			(64 << 20)
+
+#define SIM_UART_BASE			0x04000000		// Debug UART
+#define SIM_UART_FR				0x18
+#define SIM_UART_DR				0x20
+#define SIM_WDT_BASE			0x04088000
+
+#define SIM_LOADER_BASE			0x00102000		// Loader code, data and stacks
+#define SIM_LOADER_END			0x00104000
+#define SIM_LOADER_INFO			0x00102AD4		// CPU info string
+#define SIM_LOADER_ADDRESS		0x00102B80
+#define SIM_LOADER_STATE		0x00102B84		// 0 idle, 1 readback, 2 download, 3 execute
+#define SIM_LOADER_HIGHSPEED	0x00102B88
+#define SIM_LOADER_LENGTH		0x00102B8C
+#define SIM_LOADER_DOWNLOAD		0x00102944		// Bulk OUT to [address], [length] bytes
+#define SIM_LOADER_READBACK		0x001029FC		// Bulk IN from [address], [length] bytes
+#define SIM_LOADER_RETURN		0x00102338		// Return address of executed code
+#define SIM_LOADER_STACK		0x00103BF0
+
+#define SIM_XFER_OUT			1
+#define SIM_XFER_IN				2
+
+struct usb_dev_handle {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int quit;
+	int dead;
+	int trace;
+
+	unsigned char vectors [SIM_VECTOR_SIZE];
+	unsigned char sram [SIM_SRAM_SIZE];
+	unsigned char *sdram;
+	struct spinor *nor;
+	struct arm_cpu cpu;
+
+	// Bulk transfer posted by the host, waiting for the device to move it
+
+	int xfer_dir;
+	char *xfer_buf;
+	int xfer_size, xfer_pos, xfer_done;
+};
+
+static struct usb_bus sim_bus;
+static struct usb_device sim_device;
+static int sim_plugs;					// Boards taken out so far
+static FILE *sim_mon;
+static unsigned long sim_mon_tag;
+
+int sim_verbose (void) {
+	return getenv("CC1800_SIM_VERBOSE") != NULL;
+}
+
+//==============================================================================
+//
+//	Device memory. SRAM words in the loader area are shared with the host
+//	thread (the interrupt handler on the real thing), so they go under the
+//	lock.
+//
+
+static uint32_t sim_var (struct usb_dev_handle *dev, uint32_t addr) {
+	uint32_t v;
+	memcpy(&v, dev->sram + addr - SIM_SRAM_BASE, 4);
+	return v;
+}
+
+static void sim_set_var (struct usb_dev_handle *dev, uint32_t addr, uint32_t v) {
+	memcpy(dev->sram + addr - SIM_SRAM_BASE, &v, 4);
+}
+
+static unsigned char *sim_mem (struct usb_dev_handle *dev, uint32_t addr, uint32_t len) {
+	if (addr - SIM_SRAM_BASE < SIM_SRAM_SIZE && len <= SIM_SRAM_BASE + SIM_SRAM_SIZE - addr)
+		return dev->sram + addr - SIM_SRAM_BASE;
+	if (addr - SIM_SDRAM_BASE < SIM_SDRAM_SIZE && len <= SIM_SDRAM_BASE + SIM_SDRAM_SIZE - addr)
+		return dev->sdram + addr - SIM_SDRAM_BASE;
+	if (addr - SIM_VECTOR_BASE < SIM_VECTOR_SIZE && len <= SIM_VECTOR_BASE + SIM_VECTOR_SIZE - addr)
+		return dev->vectors + addr - SIM_VECTOR_BASE;
+	return NULL;
+}
+
+static void sim_die (struct usb_dev_handle *dev, const char *fmt, ...) {
+
+	va_list ap;
+
+	if (dev->dead) return;
+	dev->dead = 1;
+
+	va_start(ap, fmt);
+	fprintf(stderr, "sim: device hung: ");
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+
+	pthread_cond_broadcast(&dev->cond);
+}
+
+static int sim_read (void *ctx, uint32_t addr, int size, uint32_t *val) {
+
+	struct usb_dev_handle *dev = (struct usb_dev_handle *)ctx;
+	unsigned char *p = sim_mem(dev, addr, size);
+
+	if (p != NULL) {
+		*val = 0;
+		if (addr >= SIM_LOADER_BASE && addr < SIM_LOADER_END) {
+			pthread_mutex_lock(&dev->lock);
+			memcpy(val, p, size);
+			pthread_mutex_unlock(&dev->lock);
+		} else memcpy(val, p, size);
+		return 0;
+	}
+
+	if (addr - SIM_SPI_BASE < SIM_SPI_SIZE) return spinor_read(dev->nor, addr - SIM_SPI_BASE, val);
+	if (addr - SIM_UART_BASE < 0x1000 || addr - SIM_WDT_BASE < 0x1000) { *val = 0; return 0; }
+
+	return -1;
+}
+
+static int sim_write (void *ctx, uint32_t addr, int size, uint32_t val) {
+
+	struct usb_dev_handle *dev = (struct usb_dev_handle *)ctx;
+	unsigned char *p = sim_mem(dev, addr, size);
+
+	if (p != NULL) {
+		if (addr >= SIM_LOADER_BASE && addr < SIM_LOADER_END) {
+			pthread_mutex_lock(&dev->lock);
+			memcpy(p, &val, size);
+			pthread_mutex_unlock(&dev->lock);
+		} else memcpy(p, &val, size);
+		return 0;
+	}
+
+	if (addr - SIM_SPI_BASE < SIM_SPI_SIZE) return spinor_write(dev->nor, addr - SIM_SPI_BASE, val);
+	if (addr == SIM_UART_BASE + SIM_UART_DR) { fputc(val & 0xFF, stderr); return 0; }
+	if (addr - SIM_UART_BASE < 0x1000 || addr - SIM_WDT_BASE < 0x1000) return 0;
+
+	return -1;
+}
+
+static int sim_hook (void *ctx, uint32_t pc) {
+	if (((struct usb_dev_handle *)ctx)->trace) fprintf(stderr, "sim: pc 0x%08X\n", pc);
+	return pc == SIM_LOADER_RETURN || pc == SIM_LOADER_DOWNLOAD || pc == SIM_LOADER_READBACK;
+}
+
+//==============================================================================
+//
+//	Loader routines. Called with the lock held, return once [length] bytes
+//	have been moved, however many bulk transfers the host splits them into.
+//
+
+static void sim_download (struct usb_dev_handle *dev) {
+
+	uint32_t addr = sim_var(dev, SIM_LOADER_ADDRESS);
+	uint32_t len = sim_var(dev, SIM_LOADER_LENGTH);
+	unsigned char *p = sim_mem(dev, addr, len);
+	int n;
+
+	if (p == NULL) { sim_die(dev, "download to unmapped memory 0x%08X (%u bytes)", addr, len); return; }
+
+	if (addr < SIM_LOADER_END && addr + len > SIM_LOADER_BASE &&
+		!(addr >= SIM_LOADER_INFO && addr + len <= SIM_LOADER_INFO + 8))
+	{
+		sim_die(dev, "download over the loader at 0x%08X (%u bytes)", addr, len);
+		return;
+	}
+
+	while (len > 0 && !dev->quit && !dev->dead) {
+		if (dev->xfer_dir != SIM_XFER_OUT || dev->xfer_done) {
+			pthread_cond_wait(&dev->cond, &dev->lock);
+			continue;
+		}
+		n = dev->xfer_size - dev->xfer_pos;
+		if ((uint32_t)n > len) n = len;
+		memcpy(p, dev->xfer_buf + dev->xfer_pos, n);
+		p += n; len -= n;
+		dev->xfer_pos += n;
+		if (dev->xfer_pos == dev->xfer_size) {
+			dev->xfer_done = 1;
+			pthread_cond_broadcast(&dev->cond);
+		}
+	}
+}
+
+static void sim_readback (struct usb_dev_handle *dev) {
+
+	uint32_t addr = sim_var(dev, SIM_LOADER_ADDRESS);
+	uint32_t len = sim_var(dev, SIM_LOADER_LENGTH);
+	unsigned char *p = sim_mem(dev, addr, len);
+	int n;
+
+	if (p == NULL) { sim_die(dev, "readback from unmapped memory 0x%08X (%u bytes)", addr, len); return; }
+
+	while (len > 0 && !dev->quit && !dev->dead) {
+		if (dev->xfer_dir != SIM_XFER_IN || dev->xfer_done) {
+			pthread_cond_wait(&dev->cond, &dev->lock);
+			continue;
+		}
+		n = dev->xfer_size - dev->xfer_pos;
+		if ((uint32_t)n > len) n = len;
+		memcpy(dev->xfer_buf + dev->xfer_pos, p, n);
+		p += n; len -= n;
+		dev->xfer_pos += n;
+
+		// A short packet ends the host transfer as well
+
+		if (dev->xfer_pos == dev->xfer_size || len == 0) {
+			dev->xfer_done = 1;
+			pthread_cond_broadcast(&dev->cond);
+		}
+	}
+}
+
+//
+//	Take an abort or undefined instruction through its vector, if uploaded
+//	code has set one (the loader leaves them zero). Returns 0 if not.
+//
+
+static int sim_exception (struct usb_dev_handle *dev, enum arm_stop stop) {
+
+	struct arm_cpu *cpu = &dev->cpu;
+	uint32_t vector, mode, lr, insn, cpsr = cpu->cpsr;
+
+	if (stop == ARM_UNDEFINED) { vector = 0x04; mode = 0x1B; lr = cpu->r[15] + 4; }
+	else if (cpu->fault_fetch) { vector = 0x0C; mode = 0x17; lr = cpu->r[15] + 4; }
+	else { vector = 0x10; mode = 0x17; lr = cpu->r[15] + 8; }
+
+	memcpy(&insn, dev->vectors + vector, 4);
+	if ((cpu->cp15_control & 0x2000) || insn == 0) return 0;		// High vectors are not modeled
+
+	arm_set_cpsr(cpu, (cpu->cpsr & ~0x3F) | 0x80 | mode);	// ARM state, IRQs masked
+	cpu->spsr = cpsr;
+	cpu->r[14] = lr;
+	cpu->r[15] = SIM_VECTOR_BASE + vector;
+	return 1;
+}
+
+//
+//	Run uploaded code, called without the lock. Returns when the code returns
+//	to the loader, like "bx lr" does on the real thing.
+//
+
+static void sim_payload (struct usb_dev_handle *dev, uint32_t addr) {
+
+	struct arm_cpu *cpu = &dev->cpu;
+	enum arm_stop stop;
+
+	arm_reset(cpu);
+	cpu->r[13] = SIM_LOADER_STACK;
+	cpu->r[14] = SIM_LOADER_RETURN;
+	cpu->r[15] = addr;
+	cpu->cpsr = 0x13;						// SVC mode, interrupts enabled
+
+	for (;;) {
+
+		stop = arm_run(cpu);
+		if (stop == ARM_HALTED) return;
+
+		if (stop == ARM_HOOK) {
+			if (cpu->r[15] == SIM_LOADER_RETURN) return;
+			pthread_mutex_lock(&dev->lock);
+			if (cpu->r[15] == SIM_LOADER_DOWNLOAD) sim_download(dev);
+			else sim_readback(dev);
+			stop = dev->dead || dev->quit;
+			pthread_mutex_unlock(&dev->lock);
+			if (stop) return;
+			cpu->r[15] = cpu->r[14];
+			continue;
+		}
+
+		if (sim_exception(dev, stop)) continue;
+
+		pthread_mutex_lock(&dev->lock);
+		if (stop == ARM_ABORT)
+			sim_die(dev, "abort at 0x%08X accessing 0x%08X", cpu->r[15], cpu->fault_addr);
+		else
+			sim_die(dev, "undefined instruction 0x%08X at 0x%08X", cpu->fault_addr, cpu->r[15]);
+		pthread_mutex_unlock(&dev->lock);
+		return;
+	}
+}
+
+//
+//	Loader main loop.
+//
+
+static void *sim_thread (void *arg) {
+
+	struct usb_dev_handle *dev = (struct usb_dev_handle *)arg;
+	uint32_t state, addr;
+
+	pthread_mutex_lock(&dev->lock);
+
+	while (!dev->quit) {
+
+		state = sim_var(dev, SIM_LOADER_STATE);
+		if (dev->dead || state < 1 || state > 3) {
+			pthread_cond_wait(&dev->cond, &dev->lock);
+			continue;
+		}
+
+		if (state == 1) sim_readback(dev);
+		else if (state == 2) sim_download(dev);
+		else {
+			addr = sim_var(dev, SIM_LOADER_ADDRESS);
+			pthread_mutex_unlock(&dev->lock);
+			sim_payload(dev, addr);
+			pthread_mutex_lock(&dev->lock);
+		}
+
+		sim_set_var(dev, SIM_LOADER_STATE, 0);
+		pthread_cond_broadcast(&dev->cond);
+	}
+
+	pthread_mutex_unlock(&dev->lock);
+	return NULL;
+}
+
+//==============================================================================
+//
+//	usbmon text output, as the kernel would log the same traffic for device 1
+//	on bus 1 ("usbtool analyze" reads it back). Only the first 32 bytes of
+//	data are shown, like usbmon does.
+//
+
+static void sim_mon_data (const char *bytes, int len) {
+	int i;
+	if (len > 32) len = 32;
+	if (bytes == NULL || len <= 0) return;
+	fprintf(sim_mon, " =");
+	for (i = 0; i < len; i++) fprintf(sim_mon, "%s%02x", i & 3 ? "" : " ", (unsigned char)bytes[i]);
+}
+
+static void sim_mon_event (char type, const char *addr, const char *setup, int status, int len, const char *bytes, int in) {
+
+	struct timespec ts;
+
+	if (sim_mon == NULL) return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	fprintf(sim_mon, "%08lx %lu %c %s:1:001:%d", sim_mon_tag, (unsigned long)(ts.tv_sec * 1000000UL + ts.tv_nsec / 1000) & 0xFFFFFFFFUL,
+		type, addr, addr[0] == 'B');
+
+	if (setup != NULL) fprintf(sim_mon, " s %s", setup);
+	else fprintf(sim_mon, " %d", status);
+	fprintf(sim_mon, " %d", len);
+
+	if (len > 0 && bytes != NULL && (type == 'S') != in) sim_mon_data(bytes, len);
+	else fprintf(sim_mon, " %c", in ? '<' : '>');
+
+	fprintf(sim_mon, "\n");
+}
+
+//==============================================================================
+//
+//	libusb 0.1 API
+//
+
+void usb_init (void) {
+}
+
+int usb_find_busses (void) {
+	return 1;
+}
+
+int usb_find_devices (void) {
+	return 1;
+}
+
+struct usb_bus *usb_get_busses (void) {
+	strcpy(sim_bus.dirname, "sim");
+	sim_bus.devices = &sim_device;
+	snprintf(sim_device.filename, sizeof(sim_device.filename), "%03d", sim_plugs % 127 + 1);
+	sim_device.bus = &sim_bus;
+	sim_device.descriptor.idVendor = 0x2009;
+	sim_device.descriptor.idProduct = 0x1218;
+	return &sim_bus;
+}
+
+usb_dev_handle *usb_open (struct usb_device *dev) {
+
+	struct usb_dev_handle *h;
+	const char *rom = getenv("CC1800_SIM_ROM");
+	FILE *f;
+
+	h = (struct usb_dev_handle *)calloc(1, sizeof(*h));
+	if (h == NULL) return NULL;
+
+	h->sdram = (unsigned char *)calloc(1, SIM_SDRAM_SIZE);
+	h->nor = spinor_new();
+	if (h->sdram == NULL || h->nor == NULL) {
+		free(h->sdram);
+		spinor_free(h->nor);
+		free(h);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	// The loader image sits where the SD boot code copied it, variables
+	// (right past the image) start zeroed
+
+	f = fopen(rom != NULL ? rom : "rom.bin", "rb");
+	if (f != NULL) {
+		if (!fread(h->sram + SIM_LOADER_BASE - SIM_SRAM_BASE, 1, SIM_LOADER_ADDRESS - SIM_LOADER_BASE, f)) {}
+		fclose(f);
+	}
+	memcpy(h->sram + SIM_LOADER_INFO - SIM_SRAM_BASE, "CN2009V1", 8);
+	sim_set_var(h, SIM_LOADER_HIGHSPEED, 1);
+
+	h->trace = getenv("CC1800_SIM_TRACE") != NULL;
+
+	if (getenv("CC1800_SIM_USBMON") != NULL && sim_mon == NULL)
+		sim_mon = fopen(getenv("CC1800_SIM_USBMON"), "w");
+	h->cpu.bus.ctx = h;
+	h->cpu.bus.read = sim_read;
+	h->cpu.bus.write = sim_write;
+	h->cpu.bus.hook = sim_hook;
+
+	pthread_mutex_init(&h->lock, NULL);
+	pthread_cond_init(&h->cond, NULL);
+	if (pthread_create(&h->thread, NULL, sim_thread, h)) {
+		free(h->sdram);
+		spinor_free(h->nor);
+		free(h);
+		return NULL;
+	}
+
+	return h;
+}
+
+int usb_close (usb_dev_handle *dev) {
+
+	pthread_mutex_lock(&dev->lock);
+	dev->quit = 1;
+	dev->cpu.halt = 1;
+	pthread_cond_broadcast(&dev->cond);
+	pthread_mutex_unlock(&dev->lock);
+
+	pthread_join(dev->thread, NULL);
+
+	if (sim_verbose())
+		fprintf(stderr, "sim: %llu instructions executed\n", (unsigned long long)dev->cpu.cycles);
+
+	spinor_free(dev->nor);
+	free(dev->sdram);
+	free(dev);
+
+	if (sim_mon != NULL) fclose(sim_mon);
+	sim_mon = NULL;
+
+	// Closing stands for taking the board out: the next one to be opened is
+	// a fresh board, with the next device number as on Linux
+
+	sim_plugs++;
+
+	return 0;
+}
+
+int usb_set_configuration (usb_dev_handle *dev, int configuration) {
+	return 0;
+}
+
+int usb_claim_interface (usb_dev_handle *dev, int interface) {
+	return 0;
+}
+
+int usb_release_interface (usb_dev_handle *dev, int interface) {
+	return 0;
+}
+
+//
+//	Vendor requests, as handled by the loader interrupt handler.
+//
+
+int usb_control_msg (usb_dev_handle *dev, int requesttype, int request, int value, int index, char *bytes, int size, int timeout) {
+
+	uint32_t v = ((value & 0xFFFF) << 16) | (index & 0xFFFF);
+	const char *dir = requesttype & USB_ENDPOINT_IN ? "Ci" : "Co";
+	char setup [32];
+	int r = 0;
+
+	if (sim_mon != NULL) snprintf(setup, sizeof(setup), "%02x %02x %04x %04x %04x", requesttype & 0xFF, request & 0xFF, value & 0xFFFF, index & 0xFFFF, size & 0xFFFF);
+	sim_mon_tag++;
+	sim_mon_event('S', dir, setup, 0, size, bytes, !!(requesttype & USB_ENDPOINT_IN));
+
+	pthread_mutex_lock(&dev->lock);
+
+	if (dev->dead) {
+		pthread_mutex_unlock(&dev->lock);
+		sim_mon_event('C', dir, NULL, -ETIMEDOUT, 0, NULL, 0);
+		return -ETIMEDOUT;
+	}
+
+	if (sim_verbose()) fprintf(stderr, "sim: request %d value 0x%08X\n", request, v);
+
+	switch (request) {
+
+	case 0:
+		r = size < 8 ? size : 8;
+		memcpy(bytes, dev->sram + SIM_LOADER_INFO - SIM_SRAM_BASE, r);
+		break;
+
+	case 1:
+		sim_set_var(dev, SIM_LOADER_ADDRESS, v);
+		break;
+
+	case 2:
+		sim_set_var(dev, SIM_LOADER_LENGTH, v & 0x7FFFFFFF);
+		sim_set_var(dev, SIM_LOADER_STATE, 1 + (v >> 31));
+		break;
+
+	case 3:
+		v = sim_var(dev, SIM_LOADER_STATE);
+		r = size < 4 ? size : 4;
+		memcpy(bytes, &v, r);
+		sim_set_var(dev, SIM_LOADER_STATE, 3);
+		break;
+
+	case 4:
+		sim_set_var(dev, SIM_LOADER_STATE, 3);
+		break;
+
+	default:
+		r = -EPIPE;
+		break;
+	}
+
+	pthread_cond_broadcast(&dev->cond);
+	pthread_mutex_unlock(&dev->lock);
+
+	sim_mon_event('C', dir, NULL, r < 0 ? r : 0, r < 0 ? 0 : r, bytes, !!(requesttype & USB_ENDPOINT_IN));
+
+	return r;
+}
+
+static int sim_bulk (usb_dev_handle *dev, int dir, char *bytes, int size, int timeout) {
+
+	const char *ep = dir == SIM_XFER_IN ? "Bi" : "Bo";
+	struct timespec ts;
+	int r = 0;
+
+	sim_mon_tag++;
+	sim_mon_event('S', ep, NULL, -EINPROGRESS, size, bytes, dir == SIM_XFER_IN);
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout / 1000;
+	ts.tv_nsec += (timeout % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+
+	pthread_mutex_lock(&dev->lock);
+
+	dev->xfer_dir = dir;
+	dev->xfer_buf = bytes;
+	dev->xfer_size = size;
+	dev->xfer_pos = 0;
+	dev->xfer_done = size == 0;
+	pthread_cond_broadcast(&dev->cond);
+
+	while (!dev->xfer_done && !dev->dead && r != ETIMEDOUT)
+		r = pthread_cond_timedwait(&dev->cond, &dev->lock, &ts);
+
+	r = dev->xfer_done ? dev->xfer_pos : -ETIMEDOUT;
+	dev->xfer_dir = 0;
+
+	pthread_mutex_unlock(&dev->lock);
+
+	sim_mon_event('C', ep, NULL, r < 0 ? r : 0, r < 0 ? 0 : r, bytes, dir == SIM_XFER_IN);
+
+	return r;
+}
+
+int usb_bulk_write (usb_dev_handle *dev, int ep, const char *bytes, int size, int timeout) {
+	return sim_bulk(dev, SIM_XFER_OUT, (char *)bytes, size, timeout);
+}
+
+int usb_bulk_read (usb_dev_handle *dev, int ep, char *bytes, int size, int timeout) {
+	return sim_bulk(dev, SIM_XFER_IN, bytes, size, timeout);
+}
+
+char *usb_strerror (void) {
+	return "simulated device error";
+}
@@ -0,0 +1,39 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+//==============================================================================
+//
+//	Simulated peripherals. Each one decodes a register window and returns
+//	-1 for registers it does not have, which the bus turns into an abort.
+//
+
+#define SIM_SPI_BASE		0x0C000000		// SPI controller with the NOR flash
+#define SIM_SPI_SIZE		0x00000100
+
+#define SIM_SPI_DATA		0x00			// Write sends a byte, read gets the last received
+#define SIM_SPI_STATUS		0x04			// Bit 0 set while a transfer is in progress
+#define SIM_SPI_CS			0x10			// Bit 0 drives the flash chip select, active low
+
+struct spinor;
+
+struct spinor *spinor_new (void);
+void spinor_free (struct spinor *nor);
+int spinor_read (struct spinor *nor, uint32_t reg, uint32_t *val);
+int spinor_write (struct spinor *nor, uint32_t reg, uint32_t val);
+
+int sim_verbose (void);
+
+#endif
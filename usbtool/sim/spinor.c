@@ -0,0 +1,288 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "sim.h"
+
+//==============================================================================
+//
+//	JEDEC SPI NOR flash behind a byte wide SPI controller. The chip behaves
+//	like the usual 25 series parts: erased bits are ones, programming can
+//	only clear bits, and erase/program keep the chip busy for a realistic
+//	time so that code which does not poll the status register breaks here
+//	like it would on real hardware.
+//
+//	CC1800_SIM_NOR			backing file (created if needed), kept across runs
+//	CC1800_SIM_NOR_SIZE		flash size in bytes (default 2 MB)
+//	CC1800_SIM_NOR_SCALE	multiplier for erase/program times (default 1.0)
+//
+
+#define NOR_DEFAULT_SIZE	(2 << 20)
+#define NOR_PAGE_SIZE		256
+
+#define NOR_T_SECTOR_ERASE	30e-3		// 4 KB erase
+#define NOR_T_BLOCK_ERASE	150e-3		// 64 KB erase
+#define NOR_T_CHIP_ERASE	4.0
+#define NOR_T_PAGE_PROGRAM	0.4e-3
+
+#define NOR_SR_WIP			0x01
+#define NOR_SR_WEL			0x02
+
+struct spinor {
+	unsigned char *mem;
+	unsigned long size;
+	int mapped;
+	double scale;
+	double busy_until;
+	int wel;
+
+	// Current command, reset each time chip select is asserted
+
+	int selected;
+	int count;						// Bytes clocked in since chip select
+	unsigned char cmd;
+	unsigned long addr;
+	unsigned char page [NOR_PAGE_SIZE];
+	unsigned char page_mask [NOR_PAGE_SIZE];
+	unsigned char rx;				// Last byte shifted out by the flash
+
+	unsigned long erases, programs;
+};
+
+static double nor_now (void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int nor_busy (struct spinor *nor) {
+	return nor_now() < nor->busy_until;
+}
+
+struct spinor *spinor_new (void) {
+
+	struct spinor *nor;
+	const char *file = getenv("CC1800_SIM_NOR");
+	const char *s;
+	struct stat st;
+	int fd;
+
+	nor = (struct spinor *)calloc(1, sizeof(*nor));
+	if (nor == NULL) return NULL;
+
+	nor->size = NOR_DEFAULT_SIZE;
+	s = getenv("CC1800_SIM_NOR_SIZE");
+	if (s != NULL) nor->size = strtoul(s, NULL, 0);
+	nor->scale = 1.0;
+	s = getenv("CC1800_SIM_NOR_SCALE");
+	if (s != NULL) nor->scale = strtod(s, NULL);
+
+	if (nor->size < 65536 || (nor->size & (nor->size - 1))) {
+		fprintf(stderr, "sim: bad NOR size %lu\n", nor->size);
+		free(nor);
+		return NULL;
+	}
+
+	if (file == NULL) {
+		nor->mem = (unsigned char *)malloc(nor->size);
+		if (nor->mem == NULL) { free(nor); return NULL; }
+		memset(nor->mem, 0xFF, nor->size);
+		return nor;
+	}
+
+	// A new (or shorter) backing file is extended with erased contents
+
+	fd = open(file, O_RDWR | O_CREAT, 0644);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "sim: cannot open NOR file '%s'\n", file);
+		if (fd >= 0) close(fd);
+		free(nor);
+		return NULL;
+	}
+
+	if ((unsigned long)st.st_size < nor->size) {
+		static const unsigned char ff [4096] = { [0 ... 4095] = 0xFF };
+		unsigned long off;
+		for (off = st.st_size; off < nor->size; off += sizeof(ff) - off % sizeof(ff))
+			if (pwrite(fd, ff, sizeof(ff) - off % sizeof(ff), off) < 0) break;
+	}
+
+	nor->mem = (unsigned char *)mmap(NULL, nor->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (nor->mem == MAP_FAILED) {
+		fprintf(stderr, "sim: cannot map NOR file '%s'\n", file);
+		free(nor);
+		return NULL;
+	}
+
+	nor->mapped = 1;
+	return nor;
+}
+
+void spinor_free (struct spinor *nor) {
+
+	if (nor == NULL) return;
+
+	if (sim_verbose())
+		fprintf(stderr, "sim: NOR %lu sector erases, %lu page programs\n", nor->erases, nor->programs);
+
+	if (nor->mapped) munmap(nor->mem, nor->size);
+	else free(nor->mem);
+	free(nor);
+}
+
+//
+//	Erase and program take effect when chip select is released, as on the
+//	real parts, and only if the write enable latch was set beforehand.
+//
+
+static void nor_commit (struct spinor *nor) {
+
+	unsigned long a, i, n = 0;
+	double t = 0;
+
+	if (!nor->wel) return;
+
+	switch (nor->cmd) {
+	case 0x20: if (nor->count == 4) { n = 4096; t = NOR_T_SECTOR_ERASE; } break;
+	case 0xD8: if (nor->count == 4) { n = 65536; t = NOR_T_BLOCK_ERASE; } break;
+	case 0x60:
+	case 0xC7: if (nor->count == 1) { n = nor->size; t = NOR_T_CHIP_ERASE; } break;
+
+	case 0x02:
+		if (nor->count <= 4) return;
+		a = nor->addr & ~(NOR_PAGE_SIZE - 1);
+		for (i = 0; i < NOR_PAGE_SIZE; i++)
+			if (nor->page_mask[i]) nor->mem[a + i] &= nor->page[i];
+		nor->programs++;
+		nor->busy_until = nor_now() + NOR_T_PAGE_PROGRAM * nor->scale;
+		nor->wel = 0;
+		return;
+
+	default:
+		return;
+	}
+
+	if (n == 0) return;
+
+	a = nor->cmd == 0x60 || nor->cmd == 0xC7 ? 0 : nor->addr & ~(n - 1);
+	memset(nor->mem + a, 0xFF, n);
+	nor->erases += n / 4096;
+	nor->busy_until = nor_now() + t * nor->scale;
+	nor->wel = 0;
+}
+
+//
+//	Shift one byte in and return the byte shifted out.
+//
+
+static unsigned char nor_shift (struct spinor *nor, unsigned char b) {
+
+	int n = nor->count++;
+	unsigned long mask = nor->size - 1;
+	unsigned char r = 0xFF;
+
+	if (n == 0) {
+		nor->cmd = b;
+
+		// Anything but a status read is ignored while busy
+
+		if (nor_busy(nor) && b != 0x05) { nor->cmd = 0; return r; }
+
+		switch (b) {
+		case 0x06: nor->wel = 1; break;
+		case 0x04: nor->wel = 0; break;
+		case 0x02: memset(nor->page_mask, 0, sizeof(nor->page_mask)); break;
+		}
+		nor->addr = 0;
+		return r;
+	}
+
+	switch (nor->cmd) {
+
+	case 0x9F:
+		if (n == 1) r = 0xEF;							// Winbond
+		else if (n == 2) r = 0x40;
+		else if (n == 3) r = __builtin_ctzl(nor->size);	// Capacity as log2 of the size
+		break;
+
+	case 0x05:
+		r = (nor_busy(nor) ? NOR_SR_WIP : 0) | (nor->wel ? NOR_SR_WEL : 0);
+		break;
+
+	case 0x03:
+	case 0x0B:
+	case 0x20:
+	case 0xD8:
+	case 0x02:
+		if (n <= 3) { nor->addr = ((nor->addr << 8) | b) & mask; break; }
+		if (nor->cmd == 0x0B && n == 4) break;			// Dummy byte
+		if (nor->cmd == 0x03 || nor->cmd == 0x0B) {
+			r = nor->mem[nor->addr & mask];
+			nor->addr++;
+		} else if (nor->cmd == 0x02) {
+			unsigned long i = (nor->addr + n - 4) & (NOR_PAGE_SIZE - 1);
+			nor->page[i] = b;
+			nor->page_mask[i] = 1;
+		}
+		break;
+	}
+
+	return r;
+}
+
+int spinor_read (struct spinor *nor, uint32_t reg, uint32_t *val) {
+
+	switch (reg) {
+	case SIM_SPI_DATA:		*val = nor->rx; break;
+	case SIM_SPI_STATUS:	*val = 0; break;		// Transfers complete instantly
+	case SIM_SPI_CS:		*val = !nor->selected; break;
+	default: return -1;
+	}
+
+	return 0;
+}
+
+int spinor_write (struct spinor *nor, uint32_t reg, uint32_t val) {
+
+	switch (reg) {
+
+	case SIM_SPI_DATA:
+		nor->rx = nor->selected ? nor_shift(nor, val & 0xFF) : 0xFF;
+		break;
+
+	case SIM_SPI_STATUS:
+		break;
+
+	case SIM_SPI_CS:
+		if (!(val & 1) && !nor->selected) {
+			nor->selected = 1;
+			nor->count = 0;
+		} else if ((val & 1) && nor->selected) {
+			nor->selected = 0;
+			if (nor->count > 0) nor_commit(nor);
+		}
+		break;
+
+	default:
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#ifndef SIM_USB_H
+#define SIM_USB_H
+
+//==============================================================================
+//
+//	The subset of the libusb 0.1 API used by usbtool. The simulator build
+//	picks this header instead of the system one and links against sim.c,
+//	which implements it on top of a simulated CC1800 in USB boot mode.
+//
+
+#include <limits.h>
+
+#define USB_ENDPOINT_IN			0x80
+#define USB_ENDPOINT_OUT		0x00
+#define USB_TYPE_VENDOR			(0x02 << 5)
+
+struct usb_device_descriptor {
+	unsigned short idVendor;
+	unsigned short idProduct;
+};
+
+struct usb_bus;
+
+struct usb_device {
+	struct usb_device *next, *prev;
+	char filename [PATH_MAX + 1];
+	struct usb_bus *bus;
+	struct usb_device_descriptor descriptor;
+};
+
+struct usb_bus {
+	struct usb_bus *next, *prev;
+	char dirname [PATH_MAX + 1];
+	struct usb_device *devices;
+};
+
+typedef struct usb_dev_handle usb_dev_handle;
+
+void usb_init (void);
+int usb_find_busses (void);
+int usb_find_devices (void);
+struct usb_bus *usb_get_busses (void);
+
+usb_dev_handle *usb_open (struct usb_device *dev);
+int usb_close (usb_dev_handle *dev);
+int usb_set_configuration (usb_dev_handle *dev, int configuration);
+int usb_claim_interface (usb_dev_handle *dev, int interface);
+int usb_release_interface (usb_dev_handle *dev, int interface);
+
+int usb_control_msg (usb_dev_handle *dev, int requesttype, int request, int value, int index, char *bytes, int size, int timeout);
+int usb_bulk_write (usb_dev_handle *dev, int ep, const char *bytes, int size, int timeout);
+int usb_bulk_read (usb_dev_handle *dev, int ep, char *bytes, int size, int timeout);
+
+char *usb_strerror (void);
+
+#endif
@@ -0,0 +1,410 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/stat.h>
+#include <pthread.h>
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Production station loop. Waits for a board, runs the job on it, signals
+//	pass or fail, waits for the board to be taken out and for the next one,
+//	until told to stop. See station.example for the job file.
+//
+//	The per-board files a job needs (environment blocks, patches, serial
+//	numbers, images made for that board) come from host commands, which run
+//	for the next board in a thread of their own while the current one is
+//	being flashed, in the other of two work directories. Files shared by
+//	every board stay loaded in memory for the whole run.
+//
+//	Time is accounted to flashing, waiting for the operator to swap boards,
+//	waiting for preparation to finish and signalling, and reported together
+//	with the boards per hour on Ctrl-C or after the given number of boards.
+//
+
+#define STATION_MAX_LINES	64
+#define STATION_MAX_LINE	1024
+#define STATION_SETTLE		20			// Tries for a fresh board to answer
+
+#define STATION_FLASH		0
+#define STATION_SWAP		1
+#define STATION_PREPARE		2
+#define STATION_SIGNAL		3
+
+struct station {
+	char *prepare [STATION_MAX_LINES];
+	char *run [STATION_MAX_LINES];
+	int nprepare, nrun;
+	char *pass, *fail;				// Host commands, NULL for none
+	char dir [PATH_MAX];			// Work directories are dir/0 and dir/1
+	unsigned long serial;			// Of the first board
+	unsigned long boards;			// Stop after that many, 0 for never
+	unsigned long poll;				// ms between looks for a board
+	double time [4];				// Seconds spent, STATION_*
+	unsigned long passed, failed;
+};
+
+struct station_prep {
+	struct station *st;
+	unsigned long board;
+	int r;
+	pthread_t thread;
+};
+
+static const char *station_times [] = { "flashing", "swapping boards", "waiting for preparation", "signalling" };
+static volatile sig_atomic_t station_stop;
+
+static void station_signal (int sig) {
+	station_stop = 1;
+}
+
+static void station_put (char *out, unsigned long size, unsigned long *n, const char *v) {
+	for (; *v; v++, (*n)++) if (*n + 1 < size) out[*n] = *v;
+}
+
+//
+//	Replace {board}, {serial} and {dir} in a line.
+//
+
+static int station_expand (struct station *st, const char *in, unsigned long board, char *out, unsigned long size) {
+
+	unsigned long n = 0;
+	char v [PATH_MAX + 32];
+
+	while (*in) {
+		if (!strncmp(in, "{board}", 7)) { snprintf(v, sizeof(v), "%lu", board + 1); in += 7; }
+		else if (!strncmp(in, "{serial}", 8)) { snprintf(v, sizeof(v), "%lu", st->serial + board); in += 8; }
+		else if (!strncmp(in, "{dir}", 5)) { snprintf(v, sizeof(v), "%s/%lu", st->dir, board & 1); in += 5; }
+		else { v[0] = *in++; v[1] = 0; }
+		station_put(out, size, &n, v);
+	}
+
+	if (n >= size) {
+		fprintf(stderr, "ERROR: line too long after expansion\n");
+		return -1;
+	}
+
+	out[n] = 0;
+	return 0;
+}
+
+//
+//	Host command, with placeholders. Returns 0 if it succeeded.
+//
+
+static int station_system (struct station *st, const char *cmd, unsigned long board) {
+	char line [STATION_MAX_LINE];
+	if (station_expand(st, cmd, board, line, sizeof(line)) < 0) return -1;
+	return system(line) == 0 ? 0 : -1;
+}
+
+//
+//	Preparation thread for one board.
+//
+
+static void *station_prepare (void *arg) {
+
+	struct station_prep *p = (struct station_prep *)arg;
+	int i;
+
+	p->r = 0;
+	for (i = 0; i < p->st->nprepare && p->r == 0; i++) {
+		p->r = station_system(p->st, p->st->prepare[i], p->board);
+		if (p->r < 0) fprintf(stderr, "ERROR: board %lu: preparation failed: %s\n", p->board + 1, p->st->prepare[i]);
+	}
+
+	return NULL;
+}
+
+static int station_start (struct station_prep *p, struct station *st, unsigned long board) {
+	p->st = st;
+	p->board = board;
+	if (pthread_create(&p->thread, NULL, station_prepare, p) == 0) return 0;
+	fprintf(stderr, "ERROR: cannot start preparation thread\n");
+	return -1;
+}
+
+//
+//	Wait for the board just done to go away (or be replaced), then for the
+//	next one. Returns NULL if told to stop meanwhile.
+//
+
+static struct usb_device *station_wait (struct station *st, const char *last) {
+
+	struct usb_device *dev;
+	char name [PATH_MAX * 2 + 2];
+
+	for (;;) {
+		dev = cc1800_find();
+		if (dev != NULL) snprintf(name, sizeof(name), "%s:%s", dev->bus->dirname, dev->filename);
+		if (dev != NULL && (last == NULL || strcmp(name, last))) return dev;
+		if (dev == NULL) last = NULL;
+		if (station_stop) return NULL;
+		usleep(st->poll * 1000);
+	}
+}
+
+//
+//	Run the job on a board. Returns 0 if it passed.
+//
+
+static int station_board (struct station *st, struct file_cache *files, struct usb_device *dev, unsigned long board) {
+
+	struct cc1800_session s;
+	struct usb_dev_handle *handle;
+	const char *argv [SHELL_MAX_ARGS];
+	char line [STATION_MAX_LINE], info [8];
+	int i, argc, r = -1;
+
+	handle = cc1800_open(dev);
+	if (handle == NULL) return -1;
+
+	// A board just plugged in may take a moment to answer
+
+	for (i = 0; i < STATION_SETTLE && cc1800_req_get_cpu_info(handle, info) < 0; i++) usleep(st->poll * 1000);
+
+	memset(&s, 0, sizeof(s));
+	s.handle = handle;
+	s.files = files;
+
+	for (i = 0; i < st->nrun; i++) {
+		if (station_expand(st, st->run[i], board, line, sizeof(line)) < 0) break;
+		argc = shell_split(line, argv);
+		if (argc < 0) break;
+		if (argc > 0 && cc1800_fiddle(&s, argc, argv) < 0) break;
+	}
+
+	if (i == st->nrun) r = 0;
+
+	mem_cache_free(s.mem);
+	cc1800_close(handle);
+	return r;
+}
+
+//==============================================================================
+//
+//	Job file
+//
+
+static int station_line (struct station *st, char *line) {
+
+	char *key = line, *value, *end;
+	char **list;
+	int *n;
+
+	while (*key == ' ' || *key == '\t') key++;
+	if (*key == '#' || *key == 0) return 0;
+
+	for (value = key; *value && *value != ' ' && *value != '\t' && *value != '='; value++);
+	if (*value) *value++ = 0;
+	while (*value == ' ' || *value == '\t') value++;
+	if (*value == 0) return -1;
+
+	if (!strcmp(key, "prepare") || !strcmp(key, "run")) {
+		list = key[0] == 'p' ? st->prepare : st->run;
+		n = key[0] == 'p' ? &st->nprepare : &st->nrun;
+		if (*n == STATION_MAX_LINES) return -1;
+		list[*n] = strdup(value);
+		return list[(*n)++] == NULL ? -1 : 0;
+	}
+
+	if (!strcmp(key, "pass") || !strcmp(key, "fail")) {
+		list = key[0] == 'p' ? &st->pass : &st->fail;
+		free(*list);
+		*list = strdup(value);
+		return *list == NULL ? -1 : 0;
+	}
+
+	if (!strcmp(key, "dir")) {
+		snprintf(st->dir, sizeof(st->dir), "%s", value);
+		return 0;
+	}
+
+	if (!strcmp(key, "serial")) st->serial = strtoul(value, &end, 0);
+	else if (!strcmp(key, "boards")) st->boards = strtoul(value, &end, 0);
+	else if (!strcmp(key, "poll")) st->poll = strtoul(value, &end, 0);
+	else return -1;
+
+	while (*end == ' ' || *end == '\t') end++;
+	return end != value && (*end == 0 || *end == '#') ? 0 : -1;
+}
+
+static int station_load (struct station *st, const char *file) {
+
+	char line [STATION_MAX_LINE];
+	int n, lineno = 0;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: cannot open file '%s'\n", file);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+
+		lineno++;
+		n = strlen(line);
+		while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = 0;
+
+		if (station_line(st, line) < 0) {
+			fprintf(stderr, "ERROR: %s:%d: bad line\n", file, lineno);
+			fclose(f);
+			return -1;
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void station_free (struct station *st) {
+	int i;
+	for (i = 0; i < st->nprepare; i++) free(st->prepare[i]);
+	for (i = 0; i < st->nrun; i++) free(st->run[i]);
+	free(st->pass);
+	free(st->fail);
+}
+
+static void station_report (struct station *st, double total) {
+
+	unsigned long boards = st->passed + st->failed;
+	int i;
+
+	printf("\n%lu boards, %lu passed, %lu failed in %.1f min", boards, st->passed, st->failed, total / 60);
+	if (total > 0) printf(", %.1f boards/h", boards * 3600 / total);
+	printf("\n");
+
+	for (i = 0; i < 4; i++)
+		printf("  %-24s %8.1f s  %5.1f%%\n", station_times[i], st->time[i], total > 0 ? 100 * st->time[i] / total : 0);
+}
+
+//
+//	STATION command, usage: station <job> [<setting>=<value>...]
+//
+
+int cc1800_station (int argc, const char **argv) {
+
+	struct station st;
+	struct station_prep prep;
+	struct file_cache *files = NULL;
+	struct usb_device *dev;
+	struct sigaction sa;
+	char last [PATH_MAX * 2 + 2], line [STATION_MAX_LINE], path [PATH_MAX + 8];
+	const char *tmp = getenv("TMPDIR");
+	unsigned long board;
+	double start, t;
+	int i, r = -1, pending = 0;
+
+	if (argc < 1) {
+		fprintf(stderr, "ERROR: station command requires a job file\n");
+		return -1;
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.serial = 1;
+	st.poll = 200;
+	snprintf(st.dir, sizeof(st.dir), "%s/usbtool-station-%d", tmp != NULL ? tmp : "/tmp", (int)getpid());
+
+	if (station_load(&st, argv[0]) < 0) goto done;
+
+	for (i = 1; i < argc; i++) {
+		snprintf(line, sizeof(line), "%s", argv[i]);
+		if (strchr(line, '=') == NULL || station_line(&st, line) < 0) {
+			fprintf(stderr, "ERROR: bad setting '%s'\n", argv[i]);
+			goto done;
+		}
+	}
+
+	if (st.nrun == 0) {
+		fprintf(stderr, "ERROR: the job has no run lines\n");
+		goto done;
+	}
+
+	for (i = 0; i < 2; i++) {
+		snprintf(path, sizeof(path), "%s/%d", st.dir, i);
+		mkdir(st.dir, 0755);
+		if (mkdir(path, 0755) < 0 && access(path, W_OK) < 0) {
+			fprintf(stderr, "ERROR: cannot create directory '%s'\n", path);
+			goto done;
+		}
+	}
+
+	files = file_cache_new();
+	if (files == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		goto done;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = station_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	printf("Station ready, %d run lines, work files in '%s'. Ctrl-C to stop.\n", st.nrun, st.dir);
+
+	if (station_start(&prep, &st, 0) < 0) goto done;
+	pending = 1;
+
+	start = time_now();
+	last[0] = 0;
+	r = 0;
+
+	for (board = 0; !station_stop && (st.boards == 0 || board < st.boards); board++) {
+
+		printf("\nWaiting for board %lu\n", board + 1);
+		t = time_now();
+		dev = station_wait(&st, last[0] ? last : NULL);
+		st.time[STATION_SWAP] += time_now() - t;
+		if (dev == NULL) break;
+		snprintf(last, sizeof(last), "%s:%s", dev->bus->dirname, dev->filename);
+
+		// Its files must be ready, then the next board's are made while
+		// this one is flashed
+
+		t = time_now();
+		pthread_join(prep.thread, NULL);
+		pending = 0;
+		st.time[STATION_PREPARE] += time_now() - t;
+		if (prep.r < 0) { r = -1; break; }
+
+		if ((st.boards == 0 || board + 1 < st.boards) && station_start(&prep, &st, board + 1) == 0) pending = 1;
+
+		t = time_now();
+		i = station_board(&st, files, dev, board);
+		st.time[STATION_FLASH] += time_now() - t;
+
+		if (i == 0) st.passed++; else st.failed++;
+		printf("\a\n==== Board %lu, serial %lu: %s ====\n", board + 1, st.serial + board, i == 0 ? "PASS" : "FAIL");
+
+		t = time_now();
+		if (i == 0 ? st.pass : st.fail) station_system(&st, i == 0 ? st.pass : st.fail, board);
+		st.time[STATION_SIGNAL] += time_now() - t;
+		fflush(stdout);
+
+		if (!pending && (st.boards == 0 || board + 1 < st.boards)) { r = -1; break; }
+	}
+
+	if (pending) pthread_join(prep.thread, NULL);
+	station_report(&st, time_now() - start);
+
+done:
+	file_cache_free(files);
+	station_free(&st);
+	return r;
+}
@@ -0,0 +1,796 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Deduplicating dump store. Memory and flash dumps from many boards are
+//	mostly the same, so each dump is cut into chunks at content defined
+//	boundaries and every distinct chunk is stored once:
+//
+//		<store>/pack		chunk data, appended to
+//		<store>/index		fingerprint, pack offset and length of each chunk
+//		<store>/dumps/<board>	recipe: the dump's chunks in order, as text
+//
+//	Boundaries are where a gear hash of the last 64 bytes has its top bits
+//	clear (FastCDC with normalized chunking: harder to match before the
+//	average size, easier after), so an insertion or a changed byte only
+//	moves the boundaries next to it. Fingerprints are 128 bit and not
+//	cryptographic, dumps are not adversarial.
+//
+//	Writers take an exclusive lock on the store, so several stations can
+//	share one.
+//
+
+#define STORE_MIN		(2 << 10)
+#define STORE_AVG		(8 << 10)
+#define STORE_MAX		(64 << 10)
+#define STORE_MASK_S	0xFFFE000000000000ULL	// 15 bits, before STORE_AVG
+#define STORE_MASK_L	0xFFE0000000000000ULL	// 11 bits, after
+#define STORE_WINDOW	64						// Bytes a 64 bit gear hash depends on
+
+struct store_chunk {
+	unsigned char hash [16];
+	unsigned long long off;
+	unsigned len;
+	int used;
+	unsigned refs, mark;			// Dumps using it and last one counted, for list
+	int slot;						// Distinct chunk number, for regions
+};
+
+struct store {
+	int lock;
+	FILE *pack, *index;
+	unsigned long long pack_len;
+	struct store_chunk *tab;
+	unsigned long size, count;
+	char dir [PATH_MAX];
+};
+
+struct store_ref {
+	struct store_chunk *c;
+	unsigned long long off;
+	unsigned len;
+};
+
+struct store_recipe {
+	char board [NAME_MAX + 1];
+	char cpu [16];
+	unsigned long addr, len;
+	struct store_ref *refs;
+	unsigned long n;
+};
+
+static unsigned long long gear [256];
+
+//==============================================================================
+//
+//	Chunking
+//
+
+static void store_gear (void) {
+	unsigned long long x = 0x6363313830300000ULL, z;
+	int i;
+	if (gear[0]) return;
+	for (i = 0; i < 256; i++) {					// splitmix64, fixed forever
+		z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		gear[i] = z ^ (z >> 31);
+	}
+}
+
+struct store_cand {
+	unsigned long pos;				// Cut after this many bytes
+	int strong;						// Matches STORE_MASK_S too
+};
+
+struct store_cands {
+	struct store_cand *c;
+	unsigned long n, size;
+};
+
+static int store_cand (struct store_cands *cs, unsigned long pos, unsigned long long h) {
+	struct store_cand *c;
+	if (cs->n == cs->size) {
+		cs->size = cs->size ? cs->size * 2 : 1024;
+		c = (struct store_cand *)realloc(cs->c, cs->size * sizeof(*c));
+		if (c == NULL) return -1;
+		cs->c = c;
+	}
+	cs->c[cs->n].pos = pos;
+	cs->c[cs->n++].strong = !(h & STORE_MASK_S);
+	return 0;
+}
+
+//
+//	Find every position where a boundary may go. The hash only depends on the
+//	last 64 bytes, so the data is split in four segments hashed side by side,
+//	each one starting 64 bytes early, with the same results as going through
+//	it in order. Four independent dependency chains run about twice as fast
+//	as one; vector gathers of the gear table turned out slower than that.
+//
+
+static int store_scan (const unsigned char *p, unsigned long len, struct store_cands *out) {
+
+	struct store_cands lane [4];
+	const unsigned char *p0, *p1, *p2, *p3;
+	unsigned long seg = len / 4, j, base [4];
+	unsigned long long h [4], h0, h1, h2, h3;
+	int l, r = 0;
+
+	memset(lane, 0, sizeof(lane));
+	memset(out, 0, sizeof(*out));
+
+	for (l = 0; l < 4; l++) {
+		base[l] = l * seg;
+		h[l] = 0;
+		for (j = base[l] > STORE_WINDOW ? base[l] - STORE_WINDOW : 0; j < base[l]; j++) h[l] = (h[l] << 1) + gear[p[j]];
+	}
+
+	h0 = h[0]; h1 = h[1]; h2 = h[2]; h3 = h[3];
+	p0 = p; p1 = p + seg; p2 = p + 2 * seg; p3 = p + 3 * seg;
+
+	for (j = 0; j < seg && r == 0; j++) {
+		h0 = (h0 << 1) + gear[p0[j]];
+		h1 = (h1 << 1) + gear[p1[j]];
+		h2 = (h2 << 1) + gear[p2[j]];
+		h3 = (h3 << 1) + gear[p3[j]];
+		if (__builtin_expect(!(h0 & STORE_MASK_L) | !(h1 & STORE_MASK_L) | !(h2 & STORE_MASK_L) | !(h3 & STORE_MASK_L), 0)) {
+			if (!(h0 & STORE_MASK_L) && store_cand(&lane[0], base[0] + j + 1, h0) < 0) r = -1;
+			if (!(h1 & STORE_MASK_L) && store_cand(&lane[1], base[1] + j + 1, h1) < 0) r = -1;
+			if (!(h2 & STORE_MASK_L) && store_cand(&lane[2], base[2] + j + 1, h2) < 0) r = -1;
+			if (!(h3 & STORE_MASK_L) && store_cand(&lane[3], base[3] + j + 1, h3) < 0) r = -1;
+		}
+	}
+
+	// What does not divide evenly goes on with the last lane
+
+	for (j = 4 * seg; j < len && r == 0; j++) {
+		h3 = (h3 << 1) + gear[p[j]];
+		if (!(h3 & STORE_MASK_L) && store_cand(&lane[3], j + 1, h3) < 0) r = -1;
+	}
+
+	// Lanes are in order, so are their candidates
+
+	for (l = 0; l < 4; l++) out->size += lane[l].n;
+	out->c = (struct store_cand *)malloc((out->size + 1) * sizeof(struct store_cand));
+	if (out->c == NULL) r = -1;
+
+	for (l = 0; l < 4; l++) {
+		if (r == 0) memcpy(out->c + out->n, lane[l].c, lane[l].n * sizeof(struct store_cand));
+		out->n += lane[l].n;
+		free(lane[l].c);
+	}
+
+	return r;
+}
+
+//
+//	Pick boundaries among the candidates: not before STORE_MIN, a strong one
+//	before STORE_AVG, any one after, and STORE_MAX at the most. Calls 'emit'
+//	for each chunk.
+//
+
+static int store_chunks (const unsigned char *p, unsigned long len, struct store_cands *cs,
+	int (*emit) (void *priv, const unsigned char *p, unsigned long off, unsigned long len), void *priv)
+{
+	unsigned long start = 0, cut, i = 0, k;
+	int r;
+
+	while (start < len) {
+
+		cut = start + STORE_MAX < len ? start + STORE_MAX : len;
+
+		if (len - start > STORE_MIN) {
+			while (i < cs->n && cs->c[i].pos < start + STORE_MIN) i++;
+			for (k = i; k < cs->n && cs->c[k].pos < cut; k++) {
+				if (cs->c[k].pos < start + STORE_AVG && !cs->c[k].strong) continue;
+				cut = cs->c[k].pos;
+				break;
+			}
+		}
+
+		r = emit(priv, p + start, start, cut - start);
+		if (r < 0) return r;
+		start = cut;
+	}
+
+	return 0;
+}
+
+//
+//	128 bit fingerprint, two independent 64 bit lanes.
+//
+
+static unsigned long long store_mix (unsigned long long h) {
+	h ^= h >> 33; h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ULL;
+	return h ^ (h >> 33);
+}
+
+static void store_hash (const unsigned char *p, unsigned long len, unsigned char *out) {
+
+	unsigned long long a = 0x9E3779B97F4A7C15ULL ^ len, b = 0xC2B2AE3D27D4EB4FULL + len, w;
+	unsigned long i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		memcpy(&w, p + i, 8);
+		a = ((a ^ (w * 0x87C37B91114253D5ULL)) << 31 | (a ^ (w * 0x87C37B91114253D5ULL)) >> 33) * 0x4CF5AD432745937FULL;
+		b = ((b + w) << 27 | (b + w) >> 37) * 0x52DCE729ULL + a;
+	}
+
+	for (w = 0; i < len; i++) w = (w << 8) | p[i];
+	a = store_mix(a ^ w);
+	b = store_mix(b + w + a);
+	a += b;
+
+	memcpy(out, &a, 8);
+	memcpy(out + 8, &b, 8);
+}
+
+//==============================================================================
+//
+//	Store files
+//
+
+static struct store_chunk *store_find (struct store *st, const unsigned char *hash) {
+	unsigned long long k;
+	unsigned long i;
+	memcpy(&k, hash, 8);
+	for (i = k & (st->size - 1); st->tab[i].used; i = (i + 1) & (st->size - 1))
+		if (!memcmp(st->tab[i].hash, hash, 16)) return &st->tab[i];
+	return &st->tab[i];
+}
+
+static int store_grow (struct store *st) {
+
+	struct store_chunk *old = st->tab, *c;
+	unsigned long i, n = st->size;
+
+	st->size = n ? n * 2 : 1 << 16;
+	st->tab = (struct store_chunk *)calloc(st->size, sizeof(*c));
+	if (st->tab == NULL) { st->tab = old; st->size = n; return -1; }
+
+	for (i = 0; i < n; i++) {
+		if (!old[i].used) continue;
+		c = store_find(st, old[i].hash);
+		*c = old[i];
+	}
+
+	free(old);
+	return 0;
+}
+
+static void store_close (struct store *st) {
+	if (st->pack != NULL) fclose(st->pack);
+	if (st->index != NULL) fclose(st->index);
+	if (st->lock >= 0) close(st->lock);		// Drops the lock
+	free(st->tab);
+}
+
+static int store_open (struct store *st, const char *dir, int write) {
+
+	char path [PATH_MAX + 16];
+	unsigned char rec [28];
+	struct store_chunk *c;
+	struct stat sb;
+
+	memset(st, 0, sizeof(*st));
+	st->lock = -1;
+	snprintf(st->dir, sizeof(st->dir), "%s", dir);
+
+	if (write) {
+		mkdir(dir, 0777);
+		snprintf(path, sizeof(path), "%s/dumps", dir);
+		mkdir(path, 0777);
+	}
+
+	snprintf(path, sizeof(path), "%s/lock", dir);
+	st->lock = open(path, write ? O_RDWR | O_CREAT : O_RDONLY, 0666);
+	if (st->lock < 0 || flock(st->lock, write ? LOCK_EX : LOCK_SH) < 0) {
+		fprintf(stderr, "ERROR: cannot open store '%s'\n", dir);
+		store_close(st);
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/pack", dir);
+	st->pack = fopen(path, write ? "a+b" : "rb");
+	snprintf(path, sizeof(path), "%s/index", dir);
+	st->index = fopen(path, write ? "a+b" : "rb");
+	if (st->pack == NULL || st->index == NULL || store_grow(st) < 0) {
+		fprintf(stderr, "ERROR: cannot open store '%s'\n", dir);
+		store_close(st);
+		return -1;
+	}
+
+	// Data past the last indexed chunk is from an interrupted writer, and is
+	// simply left there
+
+	fstat(fileno(st->pack), &sb);
+	st->pack_len = sb.st_size;
+
+	rewind(st->index);
+	while (fread(rec, 1, sizeof(rec), st->index) == sizeof(rec)) {
+		if (st->count * 2 >= st->size && store_grow(st) < 0) { store_close(st); return -1; }
+		c = store_find(st, rec);
+		if (c->used) continue;
+		memcpy(c->hash, rec, 16);
+		memcpy(&c->off, rec + 16, 8);
+		memcpy(&c->len, rec + 24, 4);
+		c->used = 1;
+		st->count++;
+	}
+
+	return 0;
+}
+
+static int store_name_ok (const char *board) {
+	const char *p;
+	if (*board == 0 || *board == '.' || strlen(board) > NAME_MAX - 4) return 0;
+	for (p = board; *p; p++)
+		if (!(*p >= 'a' && *p <= 'z') && !(*p >= 'A' && *p <= 'Z') && !(*p >= '0' && *p <= '9') && !strchr("._-", *p)) return 0;
+	return 1;
+}
+
+static void store_hex (const unsigned char *hash, char *out) {
+	int i;
+	for (i = 0; i < 16; i++) sprintf(out + i * 2, "%02x", hash[i]);
+}
+
+static int store_unhex (const char *s, unsigned char *hash) {
+	int i, v;
+	for (i = 0; i < 16; i++) {
+		if (sscanf(s + i * 2, "%2x", &v) != 1) return -1;
+		hash[i] = v;
+	}
+	return 0;
+}
+
+//
+//	Load a dump recipe. Chunks missing from the index are an error.
+//
+
+static int store_recipe (struct store *st, const char *board, struct store_recipe *rc) {
+
+	char path [PATH_MAX + NAME_MAX + 16], line [128], hex [40];
+	unsigned char hash [16];
+	unsigned long long off;
+	struct store_ref *t;
+	unsigned long size = 0;
+	unsigned len;
+	FILE *f;
+	int r = 0;
+
+	memset(rc, 0, sizeof(*rc));
+	snprintf(rc->board, sizeof(rc->board), "%s", board);
+	snprintf(path, sizeof(path), "%s/dumps/%s", st->dir, board);
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: no dump '%s' in store '%s'\n", board, st->dir);
+		return -1;
+	}
+
+	while (r == 0 && fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "cpu %15s", rc->cpu) == 1) continue;
+		if (sscanf(line, "address 0x%lx", &rc->addr) == 1) continue;
+		if (sscanf(line, "length %lu", &rc->len) == 1) continue;
+		if (sscanf(line, "chunk %39s %llu %u", hex, &off, &len) != 3) continue;
+
+		if (rc->n == size) {
+			size = size ? size * 2 : 1024;
+			t = (struct store_ref *)realloc(rc->refs, size * sizeof(*t));
+			if (t == NULL) { r = -1; break; }
+			rc->refs = t;
+		}
+
+		if (store_unhex(hex, hash) < 0) r = -1;
+		else {
+			rc->refs[rc->n].c = store_find(st, hash);
+			rc->refs[rc->n].off = off;
+			rc->refs[rc->n].len = len;
+			if (!rc->refs[rc->n++].c->used) r = -1;
+		}
+	}
+
+	fclose(f);
+	if (r < 0) fprintf(stderr, "ERROR: dump '%s' is damaged or refers to missing chunks\n", board);
+	return r;
+}
+
+//==============================================================================
+//
+//	Adding a dump
+//
+
+struct store_add {
+	struct store *st;
+	FILE *recipe;
+	unsigned long chunks, fresh;
+	unsigned long long fresh_bytes;
+};
+
+static int store_emit (void *priv, const unsigned char *p, unsigned long off, unsigned long len) {
+
+	struct store_add *a = (struct store_add *)priv;
+	struct store *st = a->st;
+	struct store_chunk *c;
+	unsigned char rec [28];
+	char hex [33];
+
+	if (st->count * 2 >= st->size && store_grow(st) < 0) return -1;
+
+	store_hash(p, len, rec);
+	c = store_find(st, rec);
+
+	if (!c->used) {
+		if (fwrite(p, 1, len, st->pack) != len) return -1;
+		memcpy(c->hash, rec, 16);
+		c->off = st->pack_len;
+		c->len = len;
+		c->used = 1;
+		st->count++;
+		st->pack_len += len;
+
+		memcpy(rec + 16, &c->off, 8);
+		memcpy(rec + 24, &c->len, 4);
+		if (fwrite(rec, 1, sizeof(rec), st->index) != sizeof(rec)) return -1;
+
+		a->fresh++;
+		a->fresh_bytes += len;
+	}
+
+	store_hex(c->hash, hex);
+	fprintf(a->recipe, "chunk %s %llu %u\n", hex, c->off, c->len);
+	a->chunks++;
+	return 0;
+}
+
+int store_put (const char *dir, const char *board, const char *cpu, unsigned long addr, const char *data, unsigned long len) {
+
+	char path [PATH_MAX + NAME_MAX + 16], tmp [PATH_MAX + NAME_MAX + 20];
+	struct store_cands cs;
+	struct store_add a;
+	struct store st;
+	time_t now = time(NULL);
+	int r;
+
+	if (!store_name_ok(board)) {
+		fprintf(stderr, "ERROR: invalid board name '%s' (letters, digits, '.', '_' and '-')\n", board);
+		return -1;
+	}
+
+	if (store_open(&st, dir, 1) < 0) return -1;
+
+	store_gear();
+	r = store_scan((const unsigned char *)data, len, &cs);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		store_close(&st);
+		return r;
+	}
+
+	snprintf(path, sizeof(path), "%s/dumps/%s", dir, board);
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	memset(&a, 0, sizeof(a));
+	a.st = &st;
+	a.recipe = fopen(tmp, "w");
+	if (a.recipe == NULL) {
+		fprintf(stderr, "ERROR: cannot create file '%s'\n", tmp);
+		free(cs.c);
+		store_close(&st);
+		return -1;
+	}
+
+	fprintf(a.recipe, "board %s\ncpu %s\naddress 0x%08lX\nlength %lu\ntime %s", board, cpu, addr, len, ctime(&now));
+
+	r = store_chunks((const unsigned char *)data, len, &cs, store_emit, &a);
+	free(cs.c);
+
+	// Chunk data goes to disk before the index and recipe that refer to it
+
+	if (r == 0 && (fflush(st.pack) != 0 || fsync(fileno(st.pack)) < 0 || fflush(st.index) != 0)) r = -1;
+	if (fclose(a.recipe) != 0) r = -1;
+	if (r == 0 && rename(tmp, path) < 0) r = -1;
+
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot write to store '%s'\n", dir);
+		unlink(tmp);
+		store_close(&st);
+		return r;
+	}
+
+	printf("Stored '%s': %lu bytes in %lu chunks, %lu new (%llu bytes, %.1f%% deduplicated)\n",
+		board, len, a.chunks, a.fresh, a.fresh_bytes, len ? 100.0 - 100.0 * a.fresh_bytes / len : 100.0);
+
+	store_close(&st);
+	return 0;
+}
+
+//==============================================================================
+//
+//	Queries
+//
+
+static int store_restore (struct store *st, const char *board, const char *file) {
+
+	struct store_recipe rc;
+	unsigned char hash [16];
+	unsigned long i;
+	char *buf;
+	FILE *f;
+	int r;
+
+	r = store_recipe(st, board, &rc);
+	if (r < 0) { free(rc.refs); return r; }
+
+	buf = (char *)malloc(STORE_MAX);
+	f = fopen(file, "wb");
+	if (buf == NULL || f == NULL) {
+		fprintf(stderr, "ERROR: cannot create file '%s'\n", file);
+		if (f != NULL) fclose(f);
+		free(buf);
+		free(rc.refs);
+		return -1;
+	}
+
+	for (i = 0; i < rc.n && r == 0; i++) {
+		if (rc.refs[i].len > STORE_MAX || pread(fileno(st->pack), buf, rc.refs[i].len, rc.refs[i].off) != (ssize_t)rc.refs[i].len) r = -1;
+		else {
+			store_hash((unsigned char *)buf, rc.refs[i].len, hash);
+			if (memcmp(hash, rc.refs[i].c->hash, 16)) r = -1;
+			else if (fwrite(buf, 1, rc.refs[i].len, f) != rc.refs[i].len) r = -2;
+		}
+	}
+
+	if (fclose(f) != 0 && r == 0) r = -2;
+	if (r == -1) fprintf(stderr, "ERROR: store '%s' is damaged at chunk %lu of '%s'\n", st->dir, i - 1, board);
+	if (r == -2) fprintf(stderr, "ERROR: cannot write file '%s'\n", file);
+	if (r == 0) printf("Restored '%s' (0x%08lX, %lu bytes) to '%s'\n", board, rc.addr, rc.len, file);
+
+	free(buf);
+	free(rc.refs);
+	return r < 0 ? -1 : 0;
+}
+
+static int store_namecmp (const void *a, const void *b) {
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+//
+//	All dump names in the store, sorted.
+//
+
+static int store_boards (struct store *st, char ***names) {
+
+	char path [PATH_MAX + 16], **t;
+	struct dirent *de;
+	int n = 0, size = 0;
+	DIR *d;
+
+	*names = NULL;
+	snprintf(path, sizeof(path), "%s/dumps", st->dir);
+	d = opendir(path);
+	if (d == NULL) return 0;
+
+	while ((de = readdir(d)) != NULL) {
+		if (!store_name_ok(de->d_name) || strstr(de->d_name, ".tmp")) continue;
+		if (n == size) {
+			size = size ? size * 2 : 64;
+			t = (char **)realloc(*names, size * sizeof(char *));
+			if (t == NULL) break;
+			*names = t;
+		}
+		(*names)[n] = strdup(de->d_name);
+		if ((*names)[n] != NULL) n++;
+	}
+
+	closedir(d);
+	qsort(*names, n, sizeof(char *), store_namecmp);
+	return n;
+}
+
+static void store_free_names (char **names, int n) {
+	while (n > 0) free(names[--n]);
+	free(names);
+}
+
+static int store_list (struct store *st) {
+
+	struct store_recipe *rc;
+	unsigned long long total = 0, unique;
+	unsigned long i;
+	struct store_chunk *c;
+	char **names;
+	int n, b, r = 0;
+
+	n = store_boards(st, &names);
+	rc = (struct store_recipe *)calloc(n + 1, sizeof(*rc));
+	if (rc == NULL) { store_free_names(names, n); return -1; }
+
+	for (i = 0; i < st->size; i++) st->tab[i].refs = st->tab[i].mark = 0;
+
+	for (b = 0; b < n && r == 0; b++) {
+		r = store_recipe(st, names[b], &rc[b]);
+		for (i = 0; r == 0 && i < rc[b].n; i++) {
+			c = rc[b].refs[i].c;
+			if (c->mark != (unsigned)b + 1) { c->mark = b + 1; c->refs++; }
+		}
+		total += rc[b].len;
+	}
+
+	if (r == 0) {
+		printf("%-24s %-10s %-10s %12s %8s %12s\n", "board", "cpu", "address", "length", "chunks", "unique");
+		for (b = 0; b < n; b++) {
+			for (i = 0, unique = 0; i < rc[b].n; i++) {
+				c = rc[b].refs[i].c;
+				if (c->refs == 1 && c->mark != 0) unique += c->len;
+				c->mark = 0;				// Each distinct chunk counted once
+			}
+			printf("%-24s %-10s 0x%08lX %12lu %8lu %12llu\n", names[b], rc[b].cpu, rc[b].addr, rc[b].len, rc[b].n, unique);
+		}
+		printf("%d dumps, %llu bytes, stored in %lu chunks and %llu bytes (%.1fx)\n",
+			n, total, st->count, st->pack_len, st->pack_len ? (double)total / st->pack_len : 0.0);
+	}
+
+	for (b = 0; b < n; b++) free(rc[b].refs);
+	free(rc);
+	store_free_names(names, n);
+	return r;
+}
+
+//
+//	Which other boards have each part of a dump: runs of chunks found in
+//	the same set of dumps are printed as address ranges, followed by how much
+//	of the dump each other board shares.
+//
+
+static void store_who (unsigned char *set, char **names, int n, int self) {
+
+	int b, k = 0, count = 0;
+
+	for (b = 0; b < n; b++) if (b != self && (set[b / 8] & (1 << (b % 8)))) count++;
+
+	if (count == 0) { printf("unique\n"); return; }
+	if (count == n - 1) { printf("all %d other boards\n", count); return; }
+
+	printf("%d:", count);
+	for (b = 0; b < n && k < 4; b++)
+		if (b != self && (set[b / 8] & (1 << (b % 8)))) { printf(" %s", names[b]); k++; }
+	if (count > k) printf(" +%d more", count - k);
+	printf("\n");
+}
+
+static int store_regions (struct store *st, const char *board) {
+
+	struct store_recipe q, rc;
+	unsigned long long *shared, addr, start;
+	unsigned char *sets, *cur;
+	unsigned long i, nslots = 0;
+	int n, b, self = -1, setlen, r = 0;
+	char **names;
+
+	r = store_recipe(st, board, &q);
+	if (r < 0) { free(q.refs); return r; }
+
+	n = store_boards(st, &names);
+	for (b = 0; b < n; b++) if (!strcmp(names[b], board)) self = b;
+	setlen = (n + 7) / 8;
+
+	// Distinct chunks of the dump get a bit set each, one bit per board
+
+	for (i = 0; i < st->size; i++) st->tab[i].slot = -1;
+	for (i = 0; i < q.n; i++) if (q.refs[i].c->slot < 0) q.refs[i].c->slot = nslots++;
+
+	sets = (unsigned char *)calloc(nslots + 1, setlen);
+	shared = (unsigned long long *)calloc(n + 1, sizeof(*shared));
+	if (sets == NULL || shared == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		r = -1;
+	}
+
+	for (b = 0; b < n && r == 0; b++) {
+		if (b == self) continue;
+		r = store_recipe(st, names[b], &rc);
+		for (i = 0; r == 0 && i < rc.n; i++)
+			if (rc.refs[i].c->slot >= 0) sets[rc.refs[i].c->slot * setlen + b / 8] |= 1 << (b % 8);
+		free(rc.refs);
+	}
+
+	if (r == 0) {
+		printf("%s, %lu bytes from 0x%08lX, shared with %d other boards:\n", board, q.len, q.addr, n - 1);
+
+		addr = start = q.addr;
+		for (i = 0; i < q.n; i++) {
+			cur = sets + q.refs[i].c->slot * setlen;
+			for (b = 0; b < n; b++) if (cur[b / 8] & (1 << (b % 8))) shared[b] += q.refs[i].len;
+			addr += q.refs[i].len;
+			if (i + 1 < q.n && !memcmp(cur, sets + q.refs[i + 1].c->slot * setlen, setlen)) continue;
+			printf("  0x%08llX-0x%08llX %10llu  ", start, addr - 1, addr - start);
+			store_who(cur, names, n, self);
+			start = addr;
+		}
+
+		printf("\n");
+		for (b = 0; b < n; b++)
+			if (b != self) printf("  %-24s %12llu bytes shared (%.1f%%)\n", names[b], shared[b], q.len ? 100.0 * shared[b] / q.len : 0.0);
+	}
+
+	for (i = 0; i < st->size; i++) st->tab[i].slot = 0;
+	free(sets);
+	free(shared);
+	free(q.refs);
+	store_free_names(names, n);
+	return r;
+}
+
+//==============================================================================
+//
+//	STORE command, usage:
+//		store <dir> add <board> <file> [<address>]
+//		store <dir> list
+//		store <dir> restore <board> <file>
+//		store <dir> regions <board>
+//
+
+int cc1800_store (int argc, const char **argv) {
+
+	struct store st;
+	unsigned long addr = 0, len;
+	char *data;
+	int r;
+
+	if (argc >= 4 && !strcmp(argv[1], "add")) {
+		if (argc > 4 && scan_ulong(argv[4], &addr) < 0) return -1;
+		r = load_file(argv[3], &data, &len);
+		if (r < 0) return r;
+		r = store_put(argv[0], argv[2], "-", addr, data, len);
+		free(data);
+		return r;
+	}
+
+	if (argc >= 2 && !strcmp(argv[1], "list")) {
+		if (store_open(&st, argv[0], 0) < 0) return -1;
+		r = store_list(&st);
+	}
+
+	else if (argc >= 4 && !strcmp(argv[1], "restore")) {
+		if (store_open(&st, argv[0], 0) < 0) return -1;
+		r = store_restore(&st, argv[2], argv[3]);
+	}
+
+	else if (argc >= 3 && !strcmp(argv[1], "regions")) {
+		if (store_open(&st, argv[0], 0) < 0) return -1;
+		r = store_regions(&st, argv[2]);
+	}
+
+	else {
+		fprintf(stderr, "ERROR: usage: store <dir> add <board> <file> [<address>] | list | restore <board> <file> | regions <board>\n");
+		return -1;
+	}
+
+	store_close(&st);
+	return r;
+}
@@ -0,0 +1,193 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Target stub runner (see stubs/stub.inc for the target side). Stubs rely
+//	on the internals of the SD loaded USB loader, so they are only run when
+//	the loader identifies itself as the one we know.
+//
+
+#define STUB_MAGIC			0x54534343
+#define STUB_POLL_US		200
+#define STUB_SETTLE_US		1000
+
+static const char stub_busy [8] = { 'B', 'U', 'S', 'Y', 0xFF, 0xFF, 0xFF, 0xFF };
+
+static unsigned long stub_word (const char *p) {
+	const unsigned char *u = (const unsigned char *)p;
+	return u[0] | (u[1] << 8) | (u[2] << 16) | ((unsigned long)u[3] << 24);
+}
+
+void stub_set (struct cc1800_stub *stub, int offset, unsigned long value) {
+	unsigned char *p = stub->image + offset;
+	p[0] = value; p[1] = value >> 8; p[2] = value >> 16; p[3] = value >> 24;
+}
+
+unsigned long stub_get (struct cc1800_stub *stub, int offset) {
+	return stub_word((const char *)stub->image + offset);
+}
+
+//
+//	Prepare a stub image for running at the given address. The image is
+//	copied, so that parameters can be filled in.
+//
+
+int stub_init (struct cc1800_session *s, struct cc1800_stub *stub, const unsigned char *code, unsigned long size, unsigned long base) {
+
+	if (memcmp(s->cpu_info, CC1800_LOADER_CPU_INFO, 8)) {
+		fprintf(stderr, "ERROR: target stubs need the %s USB loader (found '%s')\n", CC1800_LOADER_CPU_INFO, s->cpu_info);
+		return -1;
+	}
+
+	if (size < STUB_PARAM_END || stub_word((const char *)code + 4) != STUB_MAGIC) {
+		fprintf(stderr, "ERROR: bad stub image\n");
+		return -1;
+	}
+
+	stub->image = (unsigned char *)malloc(size);
+	if (stub->image == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+
+	memcpy(stub->image, code, size);
+	stub->size = size;
+	stub->base = base;
+	stub->running = 0;
+
+	stub_set(stub, STUB_PARAM_STATUS, CC1800_LOADER_INFO_ADDR);
+	stub_set(stub, STUB_PARAM_STATE, CC1800_LOADER_STATE_ADDR);
+	stub_set(stub, STUB_PARAM_DOWNLOAD, CC1800_LOADER_DOWNLOAD);
+	stub_set(stub, STUB_PARAM_READBACK, CC1800_LOADER_READBACK);
+
+	return 0;
+}
+
+void stub_free (struct cc1800_stub *stub) {
+	free(stub->image);
+	stub->image = NULL;
+}
+
+//
+//	Upload and start the stub. The image goes up verified, since a corrupt
+//	stub would most likely hang the device. Returns once the stub is known
+//	to be running: until the loader main loop has picked up the execute
+//	request, any other request would override it.
+//
+
+int stub_start (struct cc1800_session *s, struct cc1800_stub *stub) {
+
+	unsigned long value;
+	int r;
+
+	r = cc1800_upload(s->handle, stub_busy, 8, CC1800_LOADER_INFO_ADDR);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot set stub mailbox\n");
+		return r;
+	}
+
+	r = cc1800_execute(s->handle, (const char *)stub->image, stub->size, stub->base);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot start stub\n");
+		return r;
+	}
+
+	stub->running = 1;
+
+	for (;;) {
+		r = stub_poll(s, stub, &value);
+		if (r < 0) {
+			fprintf(stderr, "ERROR: target stub is not responding\n");
+			return r;
+		}
+		if (r > 0 || value != 0xFFFFFFFF) break;
+		usleep(STUB_POLL_US);
+	}
+
+	return 0;
+}
+
+//
+//	Check on a running stub. Returns 1 once done, with the result in *value,
+//	or 0 while busy, with the progress in *value.
+//
+
+int stub_poll (struct cc1800_session *s, struct cc1800_stub *stub, unsigned long *value) {
+
+	char info [8];
+	int r;
+
+	r = cc1800_req_get_cpu_info(s->handle, info);
+	if (r < 0) return r;
+
+	*value = stub_word(info + 4);
+	if (!memcmp(info, "DONE", 4)) return 1;
+	if (!memcmp(info, "BUSY", 4)) return 0;
+
+	fprintf(stderr, "ERROR: lost track of the target stub\n");
+	return -EIO;
+}
+
+//
+//	Wait for a running stub to reach some progress value (or finish). When
+//	done, the CPU info string is restored and the result is in *value.
+//
+
+int stub_wait (struct cc1800_session *s, struct cc1800_stub *stub, unsigned long progress, unsigned long *value) {
+
+	int r;
+
+	for (;;) {
+		r = stub_poll(s, stub, value);
+		if (r < 0) {
+			fprintf(stderr, "ERROR: target stub is not responding\n");
+			return r;
+		}
+		if (r > 0) break;
+		if (*value >= progress) return 0;
+		usleep(STUB_POLL_US);
+	}
+
+	// Give the stub time to get back to the loader main loop, which resets
+	// its state word on return and would eat a request arriving before that
+
+	stub->running = 0;
+	usleep(STUB_SETTLE_US);
+	probe_running(s->handle, 0);
+
+	r = cc1800_upload(s->handle, CC1800_LOADER_CPU_INFO, 8, CC1800_LOADER_INFO_ADDR);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot restore CPU info\n");
+		return r;
+	}
+
+	return 1;
+}
+
+//
+//	Run a stub to completion, the stub result goes to *result.
+//
+
+int stub_run (struct cc1800_session *s, struct cc1800_stub *stub, unsigned long *result) {
+	int r;
+	r = stub_start(s, stub); if (r < 0) return r;
+	r = stub_wait(s, stub, ~0UL, result); if (r < 0) return r;
+	return 0;
+}
@@ -0,0 +1,86 @@
+// Generated from lz4.S by "make stubs", do not edit
+static const unsigned char lz4_stub [] = {
+  0x16, 0x00, 0x00, 0xea, 0x43, 0x43, 0x53, 0x54, 0x05, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xf0, 0x4f, 0x2d, 0xe9, 0x6c, 0xb0, 0x4f, 0xe2, 0x00, 0x00, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x07, 0x00, 0x00, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x1c, 0x00, 0x00, 0xea, 0x54, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x48, 0x23, 0x9f, 0xe5, 0x00, 0x20, 0x81, 0xe5,
+  0xf0, 0x8f, 0xbd, 0xe8, 0x5c, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x1e, 0xff, 0x2f, 0xe1, 0x10, 0x40, 0x2d, 0xe9,
+  0x14, 0x10, 0x9b, 0xe5, 0x00, 0x00, 0x91, 0xe5, 0x00, 0x20, 0xa0, 0xe3,
+  0x01, 0x00, 0x50, 0xe3, 0x08, 0x00, 0x00, 0x0a, 0x02, 0x00, 0x50, 0xe3,
+  0x10, 0x80, 0xbd, 0x18, 0x00, 0x20, 0x81, 0xe5, 0x18, 0x30, 0x9b, 0xe5,
+  0x33, 0xff, 0x2f, 0xe1, 0x58, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x80, 0xe2,
+  0x58, 0x00, 0x8b, 0xe5, 0x10, 0x80, 0xbd, 0xe8, 0x00, 0x20, 0x81, 0xe5,
+  0x1c, 0x30, 0x9b, 0xe5, 0x33, 0xff, 0x2f, 0xe1, 0x10, 0x80, 0xbd, 0xe8,
+  0xf0, 0x47, 0x2d, 0xe9, 0x20, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x50, 0xe3,
+  0x00, 0x00, 0xe0, 0x13, 0xf0, 0x87, 0xbd, 0x18, 0x24, 0x40, 0x9b, 0xe5,
+  0x28, 0x50, 0x9b, 0xe5, 0x2c, 0x60, 0x9b, 0xe5, 0x34, 0x70, 0x9b, 0xe5,
+  0x38, 0x80, 0x9b, 0xe5, 0x00, 0x90, 0xa0, 0xe3, 0x05, 0x00, 0x54, 0xe1,
+  0x2c, 0x00, 0x00, 0x2a, 0x06, 0xa0, 0x84, 0xe0, 0x05, 0x00, 0x5a, 0xe1,
+  0x05, 0xa0, 0xa0, 0x81, 0x04, 0x10, 0x4a, 0xe0, 0xa1, 0x13, 0x81, 0xe0,
+  0x20, 0x10, 0x81, 0xe2, 0x07, 0x20, 0x48, 0xe0, 0x02, 0x00, 0x51, 0xe1,
+  0x23, 0x00, 0x00, 0x8a, 0x04, 0x00, 0xa0, 0xe1, 0x0a, 0x10, 0xa0, 0xe1,
+  0x04, 0x20, 0x87, 0xe2, 0x30, 0x30, 0x9b, 0xe5, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x20, 0x00, 0x00, 0xea, 0x07, 0x00, 0x40, 0xe0, 0x04, 0x00, 0x40, 0xe2,
+  0x04, 0x10, 0x4a, 0xe0, 0x01, 0x00, 0x50, 0xe1, 0x0d, 0x00, 0x00, 0x3a,
+  0x02, 0x01, 0x81, 0xe3, 0x04, 0x20, 0x87, 0xe2, 0x01, 0x30, 0x84, 0xe1,
+  0x03, 0x00, 0x13, 0xe3, 0x04, 0x00, 0x00, 0x1a, 0x04, 0x30, 0x94, 0xe4,
+  0x04, 0x30, 0x82, 0xe4, 0x0a, 0x00, 0x54, 0xe1, 0xfb, 0xff, 0xff, 0x3a,
+  0x03, 0x00, 0x00, 0xea, 0x01, 0x30, 0xd4, 0xe4, 0x01, 0x30, 0xc2, 0xe4,
+  0x0a, 0x00, 0x54, 0xe1, 0xfb, 0xff, 0xff, 0x3a, 0x04, 0x00, 0x87, 0xe4,
+  0x02, 0x01, 0xc0, 0xe3, 0x03, 0x00, 0x80, 0xe2, 0x03, 0x00, 0xc0, 0xe3,
+  0x00, 0x70, 0x87, 0xe0, 0x0a, 0x40, 0xa0, 0xe1, 0x01, 0x90, 0x89, 0xe2,
+  0x09, 0x00, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xaf, 0xff, 0xff, 0xea,
+  0xd0, 0xff, 0xff, 0xea, 0x34, 0x00, 0x9b, 0xe5, 0x00, 0x00, 0x47, 0xe0,
+  0xf0, 0x87, 0xbd, 0xe8, 0xf0, 0x4f, 0x2d, 0xe9, 0x00, 0x40, 0xa0, 0xe1,
+  0x01, 0x50, 0xa0, 0xe1, 0x02, 0x60, 0xa0, 0xe1, 0x03, 0xa0, 0xa0, 0xe1,
+  0x00, 0x70, 0xa0, 0xe1, 0x00, 0x80, 0xa0, 0xe1, 0x0c, 0xb0, 0x41, 0xe2,
+  0xd0, 0x31, 0x9f, 0xe5, 0x00, 0xe0, 0xa0, 0xe3, 0x0b, 0x00, 0x58, 0xe1,
+  0x53, 0x00, 0x00, 0x2a, 0x00, 0x90, 0xd8, 0xe5, 0x01, 0x00, 0xd8, 0xe5,
+  0x00, 0x94, 0x89, 0xe1, 0x02, 0x00, 0xd8, 0xe5, 0x00, 0x98, 0x89, 0xe1,
+  0x03, 0x00, 0xd8, 0xe5, 0x00, 0x9c, 0x89, 0xe1, 0x99, 0x03, 0x00, 0xe0,
+  0x20, 0x0a, 0xa0, 0xe1, 0x00, 0x11, 0x9a, 0xe7, 0x00, 0x81, 0x8a, 0xe7,
+  0x04, 0x00, 0x51, 0xe1, 0x0d, 0x00, 0x00, 0x3a, 0x08, 0x00, 0x51, 0xe1,
+  0x0b, 0x00, 0x00, 0x2a, 0x01, 0x20, 0x48, 0xe0, 0x01, 0x08, 0x52, 0xe3,
+  0x08, 0x00, 0x00, 0x2a, 0x00, 0x20, 0xd1, 0xe5, 0x01, 0xc0, 0xd1, 0xe5,
+  0x0c, 0x24, 0x82, 0xe1, 0x02, 0xc0, 0xd1, 0xe5, 0x0c, 0x28, 0x82, 0xe1,
+  0x03, 0xc0, 0xd1, 0xe5, 0x0c, 0x2c, 0x82, 0xe1, 0x09, 0x00, 0x52, 0xe1,
+  0x15, 0x00, 0x00, 0x0a, 0x01, 0xe0, 0x8e, 0xe2, 0x2e, 0x03, 0xb0, 0xe1,
+  0x06, 0x00, 0x00, 0x1a, 0x01, 0x80, 0x88, 0xe2, 0x0b, 0x00, 0x58, 0xe1,
+  0x32, 0x00, 0x00, 0x2a, 0x03, 0x00, 0xd8, 0xe5, 0x29, 0x94, 0xa0, 0xe1,
+  0x00, 0x9c, 0x89, 0xe1, 0xe1, 0xff, 0xff, 0xea, 0x00, 0x80, 0x88, 0xe0,
+  0x01, 0x80, 0x88, 0xe2, 0x0b, 0x00, 0x58, 0xe1, 0x2a, 0x00, 0x00, 0x2a,
+  0x00, 0x90, 0xd8, 0xe5, 0x01, 0x00, 0xd8, 0xe5, 0x00, 0x94, 0x89, 0xe1,
+  0x02, 0x00, 0xd8, 0xe5, 0x00, 0x98, 0x89, 0xe1, 0x03, 0x00, 0xd8, 0xe5,
+  0x00, 0x9c, 0x89, 0xe1, 0xd5, 0xff, 0xff, 0xea, 0x01, 0x10, 0x48, 0xe0,
+  0x05, 0xe0, 0x45, 0xe2, 0x04, 0x20, 0x88, 0xe2, 0x0e, 0x00, 0x52, 0xe1,
+  0x04, 0x00, 0x00, 0x2a, 0x00, 0x00, 0xd2, 0xe5, 0x01, 0xc0, 0x52, 0xe7,
+  0x0c, 0x00, 0x50, 0xe1, 0x01, 0x20, 0x82, 0x02, 0xf8, 0xff, 0xff, 0x0a,
+  0x08, 0x90, 0x42, 0xe0, 0x04, 0x90, 0x49, 0xe2, 0x09, 0xc0, 0xa0, 0xe1,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x19, 0x00, 0x00, 0xea, 0x01, 0x10, 0xc6, 0xe4,
+  0x21, 0x04, 0xa0, 0xe1, 0x01, 0x00, 0xc6, 0xe4, 0x0f, 0x00, 0x59, 0xe2,
+  0x0f, 0xe0, 0xa0, 0x21, 0x23, 0x00, 0x00, 0x2a, 0x02, 0x80, 0xa0, 0xe1,
+  0x02, 0x70, 0xa0, 0xe1, 0xa0, 0x30, 0x9f, 0xe5, 0x00, 0xe0, 0xa0, 0xe3,
+  0x0b, 0x00, 0x58, 0xe1, 0x07, 0x00, 0x00, 0x2a, 0x00, 0x90, 0xd8, 0xe5,
+  0x01, 0x00, 0xd8, 0xe5, 0x00, 0x94, 0x89, 0xe1, 0x02, 0x00, 0xd8, 0xe5,
+  0x00, 0x98, 0x89, 0xe1, 0x03, 0x00, 0xd8, 0xe5, 0x00, 0x9c, 0x89, 0xe1,
+  0xb2, 0xff, 0xff, 0xea, 0x05, 0x80, 0xa0, 0xe1, 0x00, 0xc0, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x01, 0x00, 0x00, 0xea, 0x06, 0x00, 0xa0, 0xe1,
+  0xf0, 0x8f, 0xbd, 0xe8, 0x04, 0xe0, 0x2d, 0xe5, 0x07, 0x00, 0x48, 0xe0,
+  0x0f, 0x00, 0x5c, 0xe3, 0x0f, 0xc0, 0xa0, 0x23, 0x0f, 0x00, 0x50, 0xe3,
+  0xf0, 0xc0, 0x8c, 0x23, 0x00, 0xc2, 0x8c, 0x31, 0x01, 0xc0, 0xc6, 0xe4,
+  0x0f, 0x00, 0x50, 0xe2, 0x0f, 0xe0, 0xa0, 0x21, 0x04, 0x00, 0x00, 0x2a,
+  0x08, 0x00, 0x57, 0xe1, 0x01, 0x30, 0xd7, 0x34, 0x01, 0x30, 0xc6, 0x34,
+  0xfb, 0xff, 0xff, 0x3a, 0x04, 0xf0, 0x9d, 0xe4, 0xff, 0x00, 0x50, 0xe3,
+  0xff, 0x30, 0xa0, 0x23, 0x01, 0x30, 0xc6, 0x24, 0xff, 0x00, 0x40, 0x22,
+  0xfa, 0xff, 0xff, 0x2a, 0x01, 0x00, 0xc6, 0xe4, 0x1e, 0xff, 0x2f, 0xe1,
+  0x44, 0x4f, 0x4e, 0x45, 0xb1, 0x79, 0x37, 0x9e
+};
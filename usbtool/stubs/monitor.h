@@ -0,0 +1,98 @@
+// Generated from monitor.S by "make stubs", do not edit
+static const unsigned char monitor_stub [] = {
+  0x16, 0x00, 0x00, 0xea, 0x43, 0x43, 0x53, 0x54, 0x04, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xf0, 0x4f, 0x2d, 0xe9, 0x6c, 0xb0, 0x4f, 0xe2, 0x00, 0x00, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x07, 0x00, 0x00, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x1c, 0x00, 0x00, 0xea, 0x54, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x2c, 0x23, 0x9f, 0xe5, 0x00, 0x20, 0x81, 0xe5,
+  0xf0, 0x8f, 0xbd, 0xe8, 0x5c, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x1e, 0xff, 0x2f, 0xe1, 0x10, 0x40, 0x2d, 0xe9,
+  0x14, 0x10, 0x9b, 0xe5, 0x00, 0x00, 0x91, 0xe5, 0x00, 0x20, 0xa0, 0xe3,
+  0x01, 0x00, 0x50, 0xe3, 0x08, 0x00, 0x00, 0x0a, 0x02, 0x00, 0x50, 0xe3,
+  0x10, 0x80, 0xbd, 0x18, 0x00, 0x20, 0x81, 0xe5, 0x18, 0x30, 0x9b, 0xe5,
+  0x33, 0xff, 0x2f, 0xe1, 0x58, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x80, 0xe2,
+  0x58, 0x00, 0x8b, 0xe5, 0x10, 0x80, 0xbd, 0xe8, 0x00, 0x20, 0x81, 0xe5,
+  0x1c, 0x30, 0x9b, 0xe5, 0x33, 0xff, 0x2f, 0xe1, 0x10, 0x80, 0xbd, 0xe8,
+  0xf0, 0x47, 0x2d, 0xe9, 0x20, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x50, 0xe3,
+  0x00, 0x00, 0xe0, 0x13, 0xf0, 0x87, 0xbd, 0x18, 0x38, 0xd0, 0x8b, 0xe5,
+  0x00, 0x00, 0x0f, 0xe1, 0x3c, 0x00, 0x8b, 0xe5, 0x10, 0x0f, 0x11, 0xee,
+  0x40, 0x00, 0x8b, 0xe5, 0x2c, 0x00, 0x9b, 0xe5, 0x30, 0x10, 0x9b, 0xe5,
+  0x34, 0x20, 0x9b, 0xe5, 0x04, 0x20, 0x52, 0xe2, 0x02, 0x30, 0x91, 0x57,
+  0x02, 0x30, 0x80, 0x57, 0xfb, 0xff, 0xff, 0x5a, 0x48, 0x00, 0x9b, 0xe5,
+  0x01, 0x00, 0x70, 0xe3, 0x0d, 0x00, 0x00, 0x0a, 0x45, 0x1f, 0x8f, 0xe2,
+  0x04, 0x20, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1, 0x37, 0x00, 0x00, 0xea,
+  0x45, 0x1f, 0x8f, 0xe2, 0x0c, 0x20, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x33, 0x00, 0x00, 0xea, 0x45, 0x1f, 0x8f, 0xe2, 0x10, 0x20, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x2f, 0x00, 0x00, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x70, 0x00, 0x00, 0xea, 0x76, 0x0f, 0x8f, 0xe2, 0x24, 0x30, 0x9b, 0xe5,
+  0x33, 0xff, 0x2f, 0xe1, 0x63, 0xbf, 0x4f, 0xe2, 0x00, 0x90, 0xa0, 0xe1,
+  0x3c, 0x10, 0x9b, 0xe5, 0x01, 0xf0, 0x2f, 0xe1, 0x38, 0xd0, 0x9b, 0xe5,
+  0x40, 0x10, 0x9b, 0xe5, 0x10, 0x1f, 0x01, 0xee, 0x48, 0x00, 0x9b, 0xe5,
+  0x00, 0xa0, 0xa0, 0xe3, 0x01, 0x00, 0x70, 0xe3, 0x07, 0x00, 0x00, 0x0a,
+  0x82, 0x3f, 0x8f, 0xe2, 0x04, 0x10, 0x93, 0xe5, 0x04, 0x10, 0x80, 0xe5,
+  0x0c, 0x10, 0x93, 0xe5, 0x0c, 0x10, 0x80, 0xe5, 0x10, 0x10, 0x93, 0xe5,
+  0x10, 0x10, 0x80, 0xe5, 0x01, 0xa0, 0xa0, 0xe3, 0x2c, 0x10, 0x9b, 0xe5,
+  0x30, 0x20, 0x9b, 0xe5, 0x34, 0x30, 0x9b, 0xe5, 0x10, 0x40, 0x9b, 0xe5,
+  0x00, 0x50, 0xa0, 0xe3, 0x04, 0x30, 0x53, 0xe2, 0x09, 0x00, 0x00, 0x4a,
+  0x03, 0x60, 0x82, 0xe0, 0x04, 0x70, 0x46, 0xe0, 0x04, 0x00, 0x57, 0xe3,
+  0xf9, 0xff, 0xff, 0x9a, 0x03, 0x70, 0x91, 0xe7, 0x00, 0x80, 0x96, 0xe5,
+  0x08, 0x00, 0x57, 0xe1, 0x00, 0x70, 0x86, 0x15, 0x01, 0x50, 0x85, 0x12,
+  0xf3, 0xff, 0xff, 0xea, 0x44, 0x50, 0x8b, 0xe5, 0x05, 0xa0, 0x9a, 0xe1,
+  0x01, 0x00, 0x00, 0x0a, 0x0f, 0xe0, 0xa0, 0xe1, 0x44, 0x00, 0x00, 0xea,
+  0x09, 0x00, 0xa0, 0xe1, 0xf0, 0x87, 0xbd, 0xe8, 0x62, 0x3f, 0x8f, 0xe2,
+  0x02, 0xc0, 0x90, 0xe7, 0x02, 0xc0, 0x83, 0xe7, 0x00, 0xc0, 0x41, 0xe0,
+  0x02, 0xc0, 0x4c, 0xe0, 0x08, 0xc0, 0x4c, 0xe2, 0x4c, 0xc1, 0xa0, 0xe1,
+  0xff, 0xc4, 0xcc, 0xe3, 0xea, 0xc4, 0x8c, 0xe3, 0x02, 0xc0, 0x80, 0xe7,
+  0x1e, 0xff, 0x2f, 0xe1, 0x70, 0x01, 0x8f, 0xe5, 0x01, 0x00, 0xa0, 0xe3,
+  0x04, 0xe0, 0x4e, 0xe2, 0x06, 0x00, 0x00, 0xea, 0x60, 0x01, 0x8f, 0xe5,
+  0x02, 0x00, 0xa0, 0xe3, 0x04, 0xe0, 0x4e, 0xe2, 0x02, 0x00, 0x00, 0xea,
+  0x50, 0x01, 0x8f, 0xe5, 0x03, 0x00, 0xa0, 0xe3, 0x08, 0xe0, 0x4e, 0xe2,
+  0x48, 0x11, 0x8f, 0xe5, 0x48, 0x11, 0x9f, 0xe5, 0x00, 0x00, 0x51, 0xe3,
+  0x26, 0x00, 0x00, 0x1a, 0x3c, 0x01, 0x8f, 0xe5, 0x51, 0x1f, 0x8f, 0xe2,
+  0xfc, 0x1f, 0x81, 0xe8, 0x28, 0x21, 0x9f, 0xe5, 0x28, 0x31, 0x9f, 0xe5,
+  0x2c, 0x21, 0x8f, 0xe5, 0x2c, 0x31, 0x8f, 0xe5, 0x60, 0xe1, 0x8f, 0xe5,
+  0x00, 0x10, 0x4f, 0xe1, 0x5c, 0x11, 0x8f, 0xe5, 0x00, 0x20, 0x0f, 0xe1,
+  0x1f, 0x30, 0x01, 0xe2, 0x10, 0x00, 0x53, 0xe3, 0x1f, 0x30, 0xa0, 0x03,
+  0xc0, 0x30, 0x83, 0xe3, 0x03, 0xf0, 0x21, 0xe1, 0x0d, 0x40, 0xa0, 0xe1,
+  0x0e, 0x50, 0xa0, 0xe1, 0x02, 0xf0, 0x21, 0xe1, 0x28, 0x41, 0x8f, 0xe5,
+  0x28, 0x51, 0x8f, 0xe5, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x20, 0xa0, 0xe3,
+  0x02, 0x00, 0x50, 0xe3, 0x30, 0x1f, 0x15, 0x0e, 0x50, 0x2f, 0x16, 0x0e,
+  0x03, 0x00, 0x50, 0xe3, 0x10, 0x1f, 0x15, 0x0e, 0x10, 0x2f, 0x16, 0x0e,
+  0x10, 0x11, 0x8f, 0xe5, 0x10, 0x21, 0x8f, 0xe5, 0x45, 0x3f, 0x8f, 0xe2,
+  0x00, 0x10, 0xa0, 0xe3, 0x01, 0x21, 0x94, 0xe7, 0x01, 0x21, 0x83, 0xe7,
+  0x01, 0x10, 0x81, 0xe2, 0xfc, 0x10, 0x8f, 0xe5, 0x10, 0x00, 0x51, 0xe3,
+  0xf9, 0xff, 0xff, 0x3a, 0x00, 0x00, 0xe0, 0xe3, 0x91, 0xff, 0xff, 0xea,
+  0x00, 0x00, 0xa0, 0xe3, 0x1a, 0x0f, 0x07, 0xee, 0x9a, 0x0f, 0x07, 0xee,
+  0x15, 0x0f, 0x07, 0xee, 0xd5, 0x0f, 0x07, 0xee, 0x95, 0x0f, 0x07, 0xee,
+  0x1e, 0xff, 0x2f, 0xe1, 0x30, 0x48, 0x2d, 0xe9, 0xd9, 0xbf, 0x4f, 0xe2,
+  0x5c, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x80, 0xe2, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x48, 0xff, 0xff, 0xea, 0x14, 0x10, 0x9b, 0xe5, 0x00, 0x50, 0x91, 0xe5,
+  0x01, 0x50, 0x45, 0xe2, 0x01, 0x00, 0x55, 0xe3, 0x01, 0x00, 0x00, 0x8a,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x45, 0xff, 0xff, 0xea, 0x28, 0x40, 0x9b, 0xe5,
+  0x02, 0x00, 0x14, 0xe3, 0x03, 0x00, 0x00, 0x0a, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xe6, 0xff, 0xff, 0xea, 0x02, 0x40, 0xc4, 0xe3, 0x28, 0x40, 0x8b, 0xe5,
+  0x01, 0x00, 0x14, 0xe3, 0xef, 0xff, 0xff, 0x1a, 0x01, 0x00, 0x55, 0xe3,
+  0xed, 0xff, 0xff, 0x9a, 0x30, 0x88, 0xbd, 0xe8, 0x44, 0x4f, 0x4e, 0x45,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
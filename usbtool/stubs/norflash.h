@@ -0,0 +1,132 @@
+// Generated from norflash.S by "make stubs", do not edit
+static const unsigned char norflash_stub [] = {
+  0x16, 0x00, 0x00, 0xea, 0x43, 0x43, 0x53, 0x54, 0x01, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xf0, 0x4f, 0x2d, 0xe9, 0x6c, 0xb0, 0x4f, 0xe2, 0x00, 0x00, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x07, 0x00, 0x00, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x1c, 0x00, 0x00, 0xea, 0x54, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x68, 0x25, 0x9f, 0xe5, 0x00, 0x20, 0x81, 0xe5,
+  0xf0, 0x8f, 0xbd, 0xe8, 0x5c, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x1e, 0xff, 0x2f, 0xe1, 0x10, 0x40, 0x2d, 0xe9,
+  0x14, 0x10, 0x9b, 0xe5, 0x00, 0x00, 0x91, 0xe5, 0x00, 0x20, 0xa0, 0xe3,
+  0x01, 0x00, 0x50, 0xe3, 0x08, 0x00, 0x00, 0x0a, 0x02, 0x00, 0x50, 0xe3,
+  0x10, 0x80, 0xbd, 0x18, 0x00, 0x20, 0x81, 0xe5, 0x18, 0x30, 0x9b, 0xe5,
+  0x33, 0xff, 0x2f, 0xe1, 0x58, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x80, 0xe2,
+  0x58, 0x00, 0x8b, 0xe5, 0x10, 0x80, 0xbd, 0xe8, 0x00, 0x20, 0x81, 0xe5,
+  0x1c, 0x30, 0x9b, 0xe5, 0x33, 0xff, 0x2f, 0xe1, 0x10, 0x80, 0xbd, 0xe8,
+  0x04, 0xe0, 0x2d, 0xe5, 0x20, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x50, 0xe3,
+  0x56, 0x00, 0x00, 0x0a, 0x02, 0x00, 0x50, 0xe3, 0x75, 0x00, 0x00, 0x0a,
+  0x03, 0x00, 0x50, 0xe3, 0x67, 0x00, 0x00, 0x0a, 0x04, 0x00, 0x50, 0xe3,
+  0xd0, 0x00, 0x00, 0x0a, 0x00, 0x00, 0xe0, 0xe3, 0x04, 0xf0, 0x9d, 0xe4,
+  0x30, 0x10, 0x9b, 0xe5, 0x34, 0x30, 0x9b, 0xe5, 0x00, 0x20, 0x91, 0xe5,
+  0x03, 0x20, 0xc2, 0xe1, 0x00, 0x20, 0x81, 0xe5, 0x1e, 0xff, 0x2f, 0xe1,
+  0x30, 0x10, 0x9b, 0xe5, 0x34, 0x30, 0x9b, 0xe5, 0x00, 0x20, 0x91, 0xe5,
+  0x03, 0x20, 0x82, 0xe1, 0x00, 0x20, 0x81, 0xe5, 0x1e, 0xff, 0x2f, 0xe1,
+  0x24, 0x10, 0x9b, 0xe5, 0x28, 0x20, 0x9b, 0xe5, 0x2c, 0x30, 0x9b, 0xe5,
+  0x00, 0x00, 0x81, 0xe5, 0x00, 0xc0, 0x92, 0xe5, 0x03, 0x00, 0x1c, 0xe1,
+  0xfc, 0xff, 0xff, 0x1a, 0x00, 0x00, 0x91, 0xe5, 0xff, 0x00, 0x00, 0xe2,
+  0x1e, 0xff, 0x2f, 0xe1, 0x30, 0x40, 0x2d, 0xe9, 0x00, 0x40, 0xa0, 0xe1,
+  0x01, 0x50, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xe4, 0xff, 0xff, 0xea,
+  0x04, 0x00, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xed, 0xff, 0xff, 0xea,
+  0x25, 0x08, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xea, 0xff, 0xff, 0xea,
+  0x25, 0x04, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xe7, 0xff, 0xff, 0xea,
+  0x05, 0x00, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xe4, 0xff, 0xff, 0xea,
+  0x30, 0x80, 0xbd, 0xe8, 0x04, 0xe0, 0x2d, 0xe5, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xd4, 0xff, 0xff, 0xea, 0x06, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xdd, 0xff, 0xff, 0xea, 0x0f, 0xe0, 0xa0, 0xe1, 0xd5, 0xff, 0xff, 0xea,
+  0x04, 0xf0, 0x9d, 0xe4, 0x10, 0x40, 0x2d, 0xe9, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xcb, 0xff, 0xff, 0xea, 0x05, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xd4, 0xff, 0xff, 0xea, 0xff, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xd1, 0xff, 0xff, 0xea, 0x00, 0x40, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xc8, 0xff, 0xff, 0xea, 0x01, 0x00, 0x14, 0xe3, 0x10, 0x80, 0xbd, 0x08,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x9f, 0xff, 0xff, 0xea, 0xef, 0xff, 0xff, 0xea,
+  0x24, 0x10, 0x9b, 0xe5, 0x28, 0x20, 0x9b, 0xe5, 0x2c, 0x30, 0x9b, 0xe5,
+  0xff, 0x00, 0xa0, 0xe3, 0x01, 0x50, 0x55, 0xe2, 0x1e, 0xff, 0x2f, 0x41,
+  0x00, 0x00, 0x81, 0xe5, 0x00, 0xc0, 0x92, 0xe5, 0x03, 0x00, 0x1c, 0xe1,
+  0xfc, 0xff, 0xff, 0x1a, 0x00, 0xc0, 0x91, 0xe5, 0x01, 0xc0, 0xc4, 0xe4,
+  0xf6, 0xff, 0xff, 0xea, 0x0f, 0xe0, 0xa0, 0xe1, 0xae, 0xff, 0xff, 0xea,
+  0x9f, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1, 0xb7, 0xff, 0xff, 0xea,
+  0xff, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1, 0xb4, 0xff, 0xff, 0xea,
+  0x00, 0x48, 0xa0, 0xe1, 0xff, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xb0, 0xff, 0xff, 0xea, 0x00, 0x44, 0x84, 0xe1, 0xff, 0x00, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0xac, 0xff, 0xff, 0xea, 0x00, 0x40, 0x84, 0xe1,
+  0x0f, 0xe0, 0xa0, 0xe1, 0xa3, 0xff, 0xff, 0xea, 0x04, 0x00, 0xa0, 0xe1,
+  0x04, 0xf0, 0x9d, 0xe4, 0x03, 0x00, 0xa0, 0xe3, 0x38, 0x10, 0x9b, 0xe5,
+  0x0f, 0xe0, 0xa0, 0xe1, 0xad, 0xff, 0xff, 0xea, 0x44, 0x40, 0x9b, 0xe5,
+  0x3c, 0x50, 0x9b, 0xe5, 0x0f, 0xe0, 0xa0, 0xe1, 0xd5, 0xff, 0xff, 0xea,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x97, 0xff, 0xff, 0xea, 0x00, 0x00, 0xa0, 0xe3,
+  0x04, 0xf0, 0x9d, 0xe4, 0x44, 0x10, 0x9b, 0xe5, 0x10, 0x23, 0x9f, 0xe5,
+  0x00, 0x00, 0xa0, 0xe3, 0x00, 0x30, 0xa0, 0xe1, 0x08, 0xc0, 0xa0, 0xe3,
+  0xa3, 0x30, 0xb0, 0xe1, 0x02, 0x30, 0x23, 0x20, 0x01, 0xc0, 0x5c, 0xe2,
+  0xfb, 0xff, 0xff, 0x1a, 0x00, 0x31, 0x81, 0xe7, 0x01, 0x00, 0x80, 0xe2,
+  0x01, 0x0c, 0x50, 0xe3, 0xf5, 0xff, 0xff, 0x1a, 0x03, 0x00, 0xa0, 0xe3,
+  0x38, 0x10, 0x9b, 0xe5, 0x0f, 0xe0, 0xa0, 0xe1, 0x94, 0xff, 0xff, 0xea,
+  0x44, 0x40, 0x9b, 0xe5, 0x01, 0x4b, 0x84, 0xe2, 0x3c, 0x50, 0x9b, 0xe5,
+  0x24, 0x60, 0x9b, 0xe5, 0x28, 0x70, 0x9b, 0xe5, 0x2c, 0x80, 0x9b, 0xe5,
+  0x00, 0x90, 0xa0, 0xe3, 0x00, 0x00, 0x55, 0xe3, 0x40, 0x00, 0x00, 0x0a,
+  0x40, 0xa0, 0x9b, 0xe5, 0x0a, 0x50, 0x45, 0xe0, 0x44, 0xe0, 0x9b, 0xe5,
+  0x00, 0x00, 0xe0, 0xe3, 0xa0, 0x12, 0x9f, 0xe5, 0x00, 0x20, 0xa0, 0xe3,
+  0xff, 0x30, 0xa0, 0xe3, 0x00, 0x30, 0x86, 0xe5, 0x00, 0xc0, 0x97, 0xe5,
+  0x08, 0x00, 0x1c, 0xe1, 0xfc, 0xff, 0xff, 0x1a, 0x00, 0xc0, 0x96, 0xe5,
+  0xff, 0xc0, 0x0c, 0xe2, 0x0c, 0x20, 0x82, 0xe1, 0x00, 0xc0, 0x2c, 0xe0,
+  0xff, 0xc0, 0x0c, 0xe2, 0x0c, 0xc1, 0x9e, 0xe7, 0x20, 0x04, 0x2c, 0xe0,
+  0x00, 0x30, 0x86, 0xe5, 0x00, 0xc0, 0x97, 0xe5, 0x08, 0x00, 0x1c, 0xe1,
+  0xfc, 0xff, 0xff, 0x1a, 0x00, 0xc0, 0x96, 0xe5, 0xff, 0xc0, 0x0c, 0xe2,
+  0x0c, 0x24, 0x82, 0xe1, 0x00, 0xc0, 0x2c, 0xe0, 0xff, 0xc0, 0x0c, 0xe2,
+  0x0c, 0xc1, 0x9e, 0xe7, 0x20, 0x04, 0x2c, 0xe0, 0x00, 0x30, 0x86, 0xe5,
+  0x00, 0xc0, 0x97, 0xe5, 0x08, 0x00, 0x1c, 0xe1, 0xfc, 0xff, 0xff, 0x1a,
+  0x00, 0xc0, 0x96, 0xe5, 0xff, 0xc0, 0x0c, 0xe2, 0x0c, 0x28, 0x82, 0xe1,
+  0x00, 0xc0, 0x2c, 0xe0, 0xff, 0xc0, 0x0c, 0xe2, 0x0c, 0xc1, 0x9e, 0xe7,
+  0x20, 0x04, 0x2c, 0xe0, 0x00, 0x30, 0x86, 0xe5, 0x00, 0xc0, 0x97, 0xe5,
+  0x08, 0x00, 0x1c, 0xe1, 0xfc, 0xff, 0xff, 0x1a, 0x00, 0xc0, 0x96, 0xe5,
+  0xff, 0xc0, 0x0c, 0xe2, 0x0c, 0x2c, 0x82, 0xe1, 0x00, 0xc0, 0x2c, 0xe0,
+  0xff, 0xc0, 0x0c, 0xe2, 0x0c, 0xc1, 0x9e, 0xe7, 0x20, 0x04, 0x2c, 0xe0,
+  0x02, 0x10, 0x81, 0xe0, 0xe4, 0x31, 0x9f, 0xe5, 0x91, 0x03, 0x01, 0xe0,
+  0x21, 0x18, 0x21, 0xe0, 0x04, 0xa0, 0x5a, 0xe2, 0xcb, 0xff, 0xff, 0x1a,
+  0x00, 0x00, 0xe0, 0xe1, 0x04, 0x00, 0x84, 0xe4, 0x04, 0x10, 0x84, 0xe4,
+  0x01, 0x90, 0x89, 0xe2, 0x09, 0x00, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x12, 0xff, 0xff, 0xea, 0xbc, 0xff, 0xff, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x38, 0xff, 0xff, 0xea, 0x00, 0x00, 0xa0, 0xe3, 0x04, 0xf0, 0x9d, 0xe4,
+  0x00, 0x90, 0xa0, 0xe3, 0x00, 0x00, 0xa0, 0xe3, 0x04, 0x00, 0x2d, 0xe5,
+  0x3c, 0x00, 0x9b, 0xe5, 0x00, 0x00, 0x59, 0xe1, 0x5d, 0x00, 0x00, 0x2a,
+  0x38, 0x00, 0x9b, 0xe5, 0x09, 0x81, 0x90, 0xe7, 0x00, 0x70, 0xa0, 0xe3,
+  0x02, 0x00, 0x18, 0xe3, 0x0b, 0x00, 0x00, 0x1a, 0x58, 0x00, 0x9b, 0xe5,
+  0x00, 0x10, 0x9d, 0xe5, 0x01, 0x00, 0x50, 0xe1, 0x02, 0x00, 0x00, 0x8a,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x00, 0xff, 0xff, 0xea, 0xf8, 0xff, 0xff, 0xea,
+  0x01, 0x00, 0x11, 0xe3, 0x44, 0x70, 0x9b, 0x05, 0x48, 0x70, 0x9b, 0x15,
+  0x01, 0x10, 0x81, 0xe2, 0x00, 0x10, 0x8d, 0xe5, 0x40, 0xa0, 0x9b, 0xe5,
+  0x01, 0x00, 0x18, 0xe3, 0x03, 0x80, 0xc8, 0xe3, 0x09, 0x00, 0x00, 0x1a,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x3b, 0xff, 0xff, 0xea, 0x4c, 0x00, 0x9b, 0xe5,
+  0x08, 0x10, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0x25, 0xff, 0xff, 0xea,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x13, 0xff, 0xff, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x3c, 0xff, 0xff, 0xea, 0x00, 0x00, 0x57, 0xe3, 0x1c, 0x00, 0x00, 0x0a,
+  0x00, 0x60, 0xa0, 0xe3, 0x06, 0x40, 0x87, 0xe0, 0x01, 0x5c, 0xa0, 0xe3,
+  0x04, 0x00, 0x94, 0xe4, 0x01, 0x00, 0x70, 0xe3, 0x02, 0x00, 0x00, 0x1a,
+  0x04, 0x50, 0x55, 0xe2, 0xfa, 0xff, 0xff, 0x1a, 0x10, 0x00, 0x00, 0xea,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x26, 0xff, 0xff, 0xea, 0x02, 0x00, 0xa0, 0xe3,
+  0x06, 0x10, 0x88, 0xe0, 0x0f, 0xe0, 0xa0, 0xe1, 0x10, 0xff, 0xff, 0xea,
+  0x06, 0x40, 0x87, 0xe0, 0x01, 0x5c, 0xa0, 0xe3, 0x01, 0x00, 0xd4, 0xe4,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x01, 0xff, 0xff, 0xea, 0x01, 0x50, 0x55, 0xe2,
+  0xfa, 0xff, 0xff, 0x1a, 0x0f, 0xe0, 0xa0, 0xe1, 0xf7, 0xfe, 0xff, 0xea,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x20, 0xff, 0xff, 0xea, 0x01, 0x6c, 0x86, 0xe2,
+  0x0a, 0x00, 0x56, 0xe1, 0xe3, 0xff, 0xff, 0x3a, 0x03, 0x00, 0xa0, 0xe3,
+  0x08, 0x10, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1, 0xfe, 0xfe, 0xff, 0xea,
+  0x00, 0x60, 0xa0, 0xe3, 0x38, 0x40, 0x9b, 0xe5, 0x3c, 0x00, 0x9b, 0xe5,
+  0x00, 0x41, 0x84, 0xe0, 0x04, 0x50, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x23, 0xff, 0xff, 0xea, 0x04, 0x00, 0x14, 0xe5, 0x00, 0x10, 0xe0, 0xe3,
+  0x00, 0x00, 0x57, 0xe3, 0x06, 0x10, 0x97, 0x17, 0x01, 0x00, 0x50, 0xe1,
+  0x09, 0x00, 0x00, 0x1a, 0x04, 0x60, 0x86, 0xe2, 0x0a, 0x00, 0x56, 0xe1,
+  0xf0, 0xff, 0xff, 0x3a, 0x0f, 0xe0, 0xa0, 0xe1, 0xdc, 0xfe, 0xff, 0xea,
+  0x01, 0x90, 0x89, 0xe2, 0x09, 0x00, 0xa0, 0xe1, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xaf, 0xfe, 0xff, 0xea, 0xa3, 0xff, 0xff, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0xd5, 0xfe, 0xff, 0xea, 0x09, 0x00, 0xe0, 0xe1, 0x04, 0xd0, 0x8d, 0xe2,
+  0x04, 0xf0, 0x9d, 0xe4, 0x00, 0x00, 0xa0, 0xe3, 0x04, 0xd0, 0x8d, 0xe2,
+  0x04, 0xf0, 0x9d, 0xe4, 0x44, 0x4f, 0x4e, 0x45, 0x20, 0x83, 0xb8, 0xed,
+  0xb9, 0x79, 0x37, 0x9e, 0x6b, 0xca, 0xeb, 0x85
+};
@@ -0,0 +1,58 @@
+// Generated from watermark.S by "make stubs", do not edit
+static const unsigned char watermark_stub [] = {
+  0x16, 0x00, 0x00, 0xea, 0x43, 0x43, 0x53, 0x54, 0x02, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xf0, 0x4f, 0x2d, 0xe9, 0x6c, 0xb0, 0x4f, 0xe2, 0x00, 0x00, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0x07, 0x00, 0x00, 0xea, 0x0f, 0xe0, 0xa0, 0xe1,
+  0x1c, 0x00, 0x00, 0xea, 0x54, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x7c, 0x21, 0x9f, 0xe5, 0x00, 0x20, 0x81, 0xe5,
+  0xf0, 0x8f, 0xbd, 0xe8, 0x5c, 0x00, 0x8b, 0xe5, 0x10, 0x10, 0x9b, 0xe5,
+  0x04, 0x00, 0x81, 0xe5, 0x1e, 0xff, 0x2f, 0xe1, 0x10, 0x40, 0x2d, 0xe9,
+  0x14, 0x10, 0x9b, 0xe5, 0x00, 0x00, 0x91, 0xe5, 0x00, 0x20, 0xa0, 0xe3,
+  0x01, 0x00, 0x50, 0xe3, 0x08, 0x00, 0x00, 0x0a, 0x02, 0x00, 0x50, 0xe3,
+  0x10, 0x80, 0xbd, 0x18, 0x00, 0x20, 0x81, 0xe5, 0x18, 0x30, 0x9b, 0xe5,
+  0x33, 0xff, 0x2f, 0xe1, 0x58, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x80, 0xe2,
+  0x58, 0x00, 0x8b, 0xe5, 0x10, 0x80, 0xbd, 0xe8, 0x00, 0x20, 0x81, 0xe5,
+  0x1c, 0x30, 0x9b, 0xe5, 0x33, 0xff, 0x2f, 0xe1, 0x10, 0x80, 0xbd, 0xe8,
+  0xf0, 0x47, 0x2d, 0xe9, 0x20, 0x00, 0x9b, 0xe5, 0x01, 0x00, 0x50, 0xe3,
+  0x00, 0x00, 0xe0, 0x13, 0xf0, 0x87, 0xbd, 0x18, 0x41, 0x4f, 0x8f, 0xe2,
+  0x2c, 0x50, 0x9b, 0xe5, 0x28, 0x00, 0x9b, 0xe5, 0x00, 0x10, 0xa0, 0xe1,
+  0x00, 0x20, 0xa0, 0xe1, 0x00, 0x30, 0xa0, 0xe1, 0x00, 0x80, 0xa0, 0xe1,
+  0x00, 0x90, 0xa0, 0xe1, 0x00, 0xa0, 0xa0, 0xe1, 0x00, 0xc0, 0xa0, 0xe1,
+  0x01, 0x50, 0x55, 0xe2, 0x0b, 0x00, 0x00, 0x4a, 0x00, 0x60, 0x94, 0xe5,
+  0x04, 0x70, 0x94, 0xe5, 0x10, 0x40, 0x84, 0xe2, 0x06, 0xe0, 0x47, 0xe0,
+  0x20, 0x00, 0x5e, 0xe3, 0x01, 0x00, 0x00, 0x3a, 0x0f, 0x17, 0xa6, 0xe8,
+  0xfa, 0xff, 0xff, 0xea, 0x07, 0x00, 0x56, 0xe1, 0x04, 0x00, 0x86, 0x34,
+  0xfc, 0xff, 0xff, 0x3a, 0xf1, 0xff, 0xff, 0xea, 0x01, 0x00, 0xa0, 0xe3,
+  0x0f, 0xe0, 0xa0, 0xe1, 0xc8, 0xff, 0xff, 0xea, 0x24, 0x30, 0x9b, 0xe5,
+  0x33, 0xff, 0x2f, 0xe1, 0x06, 0xbd, 0x4f, 0xe2, 0x00, 0xa0, 0xa0, 0xe1,
+  0x02, 0x00, 0xa0, 0xe3, 0x0f, 0xe0, 0xa0, 0xe1, 0xc1, 0xff, 0xff, 0xea,
+  0x7c, 0x40, 0x8f, 0xe2, 0x2c, 0x50, 0x9b, 0xe5, 0x28, 0x00, 0x9b, 0xe5,
+  0x01, 0x50, 0x55, 0xe2, 0x18, 0x00, 0x00, 0x4a, 0x00, 0x60, 0x94, 0xe5,
+  0x04, 0x70, 0x94, 0xe5, 0x08, 0x80, 0x94, 0xe5, 0x01, 0x00, 0x18, 0xe3,
+  0x08, 0x00, 0x00, 0x0a, 0x06, 0x10, 0xa0, 0xe1, 0x07, 0x00, 0x51, 0xe1,
+  0x03, 0x00, 0x00, 0x0a, 0x00, 0x20, 0x91, 0xe5, 0x00, 0x00, 0x52, 0xe1,
+  0x04, 0x10, 0x81, 0x02, 0xf9, 0xff, 0xff, 0x0a, 0x01, 0x20, 0x47, 0xe0,
+  0x07, 0x00, 0x00, 0xea, 0x07, 0x10, 0xa0, 0xe1, 0x06, 0x00, 0x51, 0xe1,
+  0x03, 0x00, 0x00, 0x0a, 0x04, 0x20, 0x11, 0xe5, 0x00, 0x00, 0x52, 0xe1,
+  0x04, 0x10, 0x41, 0x02, 0xf9, 0xff, 0xff, 0x0a, 0x06, 0x20, 0x41, 0xe0,
+  0x0c, 0x20, 0x84, 0xe5, 0x10, 0x40, 0x84, 0xe2, 0xe4, 0xff, 0xff, 0xea,
+  0x0a, 0x00, 0xa0, 0xe1, 0xf0, 0x87, 0xbd, 0xe8, 0x44, 0x4f, 0x4e, 0x45,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
@@ -0,0 +1,433 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#define _GNU_SOURCE
+
+#include <linux/io_uring.h>
+#include <linux/fs.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Image file reader. A plain fread of an image that is not in the page
+//	cache waits for the disk one request at a time, and no USB traffic
+//	starts until it is done. Here reads are queued through io_uring, up to
+//	URING_DEPTH blocks ahead of the caller, and a file that is mostly not
+//	cached is opened with O_DIRECT so the data goes straight to our aligned
+//	buffers. Without io_uring (old kernels, seccomp) the same blocks are
+//	read one at a time with pread, and anything the ring or O_DIRECT cannot
+//	do is retried that way too, so callers never see the difference.
+//
+
+#define URING_BLOCK		(128 * 1024)	// Read size, a pipeline chunk
+#define URING_DEPTH		8				// Reads in flight
+#define URING_ALIGN		4096			// O_DIRECT buffer and offset alignment
+#define URING_SPAN		(1UL << 63)		// Completion tag of a read into the caller's buffer
+
+struct uring_slot {
+	char *buf;
+	long len;						// Bytes read, -1 while in flight
+};
+
+struct uring_reader {
+	const char *file;
+	int fd, direct, plain;			// plain: buffered fd for retries, or -1
+	unsigned long len, pos;			// File length, next byte to hand out
+	unsigned long next;				// Next block to queue
+	struct uring_slot slots [URING_DEPTH];
+
+	int ring;						// io_uring fd, or -1 to use pread
+	void *sq, *cq;
+	unsigned long sq_size, cq_size;
+	struct io_uring_sqe *sqes;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned sqe_count;
+};
+
+//
+//	Whether less than half of the file is in the page cache, in which case
+//	going around it is worth it.
+//
+
+static int uring_cold (int fd, unsigned long len) {
+
+	unsigned long pages, i, hot = 0, page = sysconf(_SC_PAGESIZE);
+	unsigned char *vec;
+	void *map;
+
+	if (len == 0) return 0;
+	pages = (len + page - 1) / page;
+
+	map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) return 0;
+	vec = (unsigned char *)malloc(pages);
+	if (vec != NULL && mincore(map, len, vec) == 0)
+		for (i = 0; i < pages; i++) hot += vec[i] & 1;
+	else hot = pages;
+	free(vec);
+	munmap(map, len);
+
+	return hot < pages / 2;
+}
+
+static int uring_setup (struct uring_reader *r) {
+
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	r->ring = syscall(__NR_io_uring_setup, URING_DEPTH, &p);
+	if (r->ring < 0) return -1;
+
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_size > r->sq_size) r->sq_size = r->cq_size;
+		r->cq_size = 0;
+	}
+
+	r->sq = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring, IORING_OFF_SQ_RING);
+	if (r->sq == MAP_FAILED) { r->sq = NULL; return -1; }
+	if (r->cq_size == 0) r->cq = r->sq;
+	else {
+		r->cq = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring, IORING_OFF_CQ_RING);
+		if (r->cq == MAP_FAILED) { r->cq = NULL; return -1; }
+	}
+
+	r->sqe_count = p.sq_entries;
+	r->sqes = (struct io_uring_sqe *)mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) { r->sqes = NULL; return -1; }
+
+	r->sq_head = (unsigned *)((char *)r->sq + p.sq_off.head);
+	r->sq_tail = (unsigned *)((char *)r->sq + p.sq_off.tail);
+	r->sq_mask = (unsigned *)((char *)r->sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)((char *)r->sq + p.sq_off.array);
+	r->cq_head = (unsigned *)((char *)r->cq + p.cq_off.head);
+	r->cq_tail = (unsigned *)((char *)r->cq + p.cq_off.tail);
+	r->cq_mask = (unsigned *)((char *)r->cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)((char *)r->cq + p.cq_off.cqes);
+	return 0;
+}
+
+static void uring_teardown (struct uring_reader *r) {
+	if (r->sqes != NULL) munmap(r->sqes, r->sqe_count * sizeof(struct io_uring_sqe));
+	if (r->cq != NULL && r->cq != r->sq) munmap(r->cq, r->cq_size);
+	if (r->sq != NULL) munmap(r->sq, r->sq_size);
+	if (r->ring >= 0) close(r->ring);
+	r->sqes = NULL; r->sq = r->cq = NULL;
+	r->ring = -1;
+}
+
+//
+//	Bytes the read of a block must return.
+//
+
+static long uring_want (struct uring_reader *r, unsigned long block) {
+	unsigned long off = block * URING_BLOCK;
+	return r->len - off < URING_BLOCK ? r->len - off : URING_BLOCK;
+}
+
+//
+//	Finish a read of 'blocks' blocks that came back short or failed, through
+//	the page cache.
+//
+
+static int uring_retry (struct uring_reader *r, char *buf, unsigned long block, long done, unsigned long blocks) {
+
+	long want = uring_want(r, block) + (blocks - 1) * URING_BLOCK, n;
+
+	if (done < 0) done = 0;
+
+	if (r->plain < 0) r->plain = open(r->file, O_RDONLY);
+	if (r->plain < 0) return -1;
+
+	while (done < want) {
+		n = pread(r->plain, buf + done, want - done, block * URING_BLOCK + done);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return -1;
+		done += n;
+	}
+
+	return 0;
+}
+
+static void uring_queue (struct uring_reader *r, unsigned *tail, char *buf, unsigned long block, unsigned long tag) {
+	struct io_uring_sqe *sqe = &r->sqes[*tail & *r->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = r->fd;
+	sqe->off = block * URING_BLOCK;
+	sqe->addr = (unsigned long)buf;
+	sqe->len = URING_BLOCK;
+	sqe->user_data = block | tag;
+	r->sq_array[*tail & *r->sq_mask] = *tail & *r->sq_mask;
+	(*tail)++;
+}
+
+static int uring_enter (struct uring_reader *r, unsigned submit, unsigned wait) {
+	int k;
+	if (submit > 0) __atomic_store_n(r->sq_tail, *r->sq_tail + submit, __ATOMIC_RELEASE);
+	do k = syscall(__NR_io_uring_enter, r->ring, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	while (k < 0 && errno == EINTR);
+	return k < 0 ? -1 : 0;
+}
+
+//
+//	Next completion, waiting for one if needed. Returns -1 on error.
+//
+
+static int uring_reap (struct uring_reader *r, unsigned long *tag, long *res) {
+
+	struct io_uring_cqe *cqe;
+	unsigned head = *r->cq_head;
+
+	while (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+		if (uring_enter(r, 0, 1) < 0) return -1;
+
+	cqe = &r->cqes[head & *r->cq_mask];
+	*tag = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+//
+//	Queue reads for blocks not yet asked for while there are free slots.
+//
+
+static int uring_submit (struct uring_reader *r) {
+
+	unsigned long last = (r->len + URING_BLOCK - 1) / URING_BLOCK;
+	unsigned tail, n = 0;
+	struct uring_slot *sl;
+
+	if (r->ring < 0) return 0;
+
+	tail = *r->sq_tail;
+	while (r->next < last && r->next < r->pos / URING_BLOCK + URING_DEPTH) {
+		sl = &r->slots[r->next % URING_DEPTH];
+		sl->len = -1;
+		uring_queue(r, &tail, sl->buf, r->next++, 0);
+		n++;
+	}
+
+	return n > 0 ? uring_enter(r, n, 0) : 0;
+}
+
+//
+//	Wait until the block holding r->pos is in its slot.
+//
+
+static int uring_wait (struct uring_reader *r) {
+
+	unsigned long block = r->pos / URING_BLOCK, b;
+	struct uring_slot *sl = &r->slots[block % URING_DEPTH];
+	long res;
+
+	// Without a ring, read it now
+
+	if (r->ring < 0) {
+		if (r->next > block) return 0;
+		r->next = block + 1;
+		do res = pread(r->fd, sl->buf, URING_BLOCK, block * URING_BLOCK);
+		while (res < 0 && errno == EINTR);
+		sl->len = uring_want(r, block);
+		return res != sl->len ? uring_retry(r, sl->buf, block, res, 1) : 0;
+	}
+
+	if (uring_submit(r) < 0) return -1;
+
+	while (sl->len < 0) {
+		if (uring_reap(r, &b, &res) < 0) return -1;
+		r->slots[b % URING_DEPTH].len = uring_want(r, b);
+		if (res != uring_want(r, b) && uring_retry(r, r->slots[b % URING_DEPTH].buf, b, res, 1) < 0) return -1;
+	}
+
+	return 0;
+}
+
+//
+//	Whole blocks go straight to the caller's buffer when nothing has been
+//	read ahead, which saves a copy when the file is read in one go. Only
+//	blocks entirely within the file: a direct read of the last one could
+//	write past the end of the buffer. A cached file is copied in a single
+//	read instead, since ring reads that fault on fresh buffer pages are
+//	handed to kernel workers and end up slower. Returns the number of
+//	bytes read.
+//
+
+static long uring_span (struct uring_reader *r, char *buf, unsigned long len) {
+
+	unsigned long first = r->pos / URING_BLOCK, count, queued = 0, done = 0, b;
+	unsigned tail, n;
+	long res;
+
+	count = (r->len - r->pos) / URING_BLOCK;
+	if (len / URING_BLOCK < count) count = len / URING_BLOCK;
+	if (r->pos % URING_BLOCK || r->next != first || count == 0) return 0;
+	if (r->direct && (unsigned long)buf % URING_ALIGN) return 0;
+
+	if (r->ring < 0 || !r->direct) {
+		if (uring_retry(r, buf, first, 0, count) < 0) return -1;
+		done = count;
+	}
+
+	while (done < count) {
+		tail = *r->sq_tail; n = 0;
+		for (; queued < count && queued - done < URING_DEPTH; queued++, n++)
+			uring_queue(r, &tail, buf + queued * URING_BLOCK, first + queued, URING_SPAN);
+		if (n > 0 && uring_enter(r, n, 0) < 0) return -1;
+
+		if (uring_reap(r, &b, &res) < 0) return -1;
+		b &= ~URING_SPAN;
+		done++;
+		if (res != URING_BLOCK && uring_retry(r, buf + (b - first) * URING_BLOCK, b, res, 1) < 0) {
+			while (done++ < queued && uring_reap(r, &b, &res) == 0);	// Not into a freed buffer
+			return -1;
+		}
+	}
+
+	r->pos += count * URING_BLOCK;
+	r->next = first + count;
+	return count * URING_BLOCK;
+}
+
+struct uring_reader *uring_open (const char *file, unsigned long *len) {
+
+	struct uring_reader *r;
+	unsigned long long size;
+	struct stat st;
+	int i;
+
+	r = (struct uring_reader *)calloc(1, sizeof(*r));
+	if (r == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory for file '%s'\n", file);
+		return NULL;
+	}
+	r->file = file;
+	r->plain = r->ring = -1;
+
+	// Block devices (a partition or a card to copy from) have no size in
+	// st_size, the kernel tells it apart
+
+	r->fd = open(file, O_RDONLY);
+	if (r->fd < 0 || fstat(r->fd, &st) < 0) goto bad;
+	if (S_ISREG(st.st_mode)) size = st.st_size;
+	else if (!S_ISBLK(st.st_mode) || ioctl(r->fd, BLKGETSIZE64, &size) < 0) goto bad;
+	r->len = *len = size;
+
+	// Keep the buffered descriptor for retries, and read through a direct
+	// one when the file is cold and the filesystem allows it
+
+	if (uring_cold(r->fd, r->len) && (i = open(file, O_RDONLY | O_DIRECT)) >= 0) {
+		r->plain = r->fd;
+		r->fd = i;
+		r->direct = 1;
+	}
+
+	for (i = 0; i < URING_DEPTH; i++)
+		if (posix_memalign((void **)&r->slots[i].buf, URING_ALIGN, URING_BLOCK)) {
+			r->slots[i].buf = NULL;
+			fprintf(stderr, "ERROR: cannot allocate memory for file '%s'\n", file);
+			uring_close(r);
+			return NULL;
+		}
+
+	if (getenv("CC1800_NO_URING") != NULL || uring_setup(r) < 0) uring_teardown(r);
+
+	return r;
+
+bad:
+	fprintf(stderr, "ERROR: cannot open file '%s'\n", file);
+	if (r->fd >= 0) close(r->fd);
+	free(r);
+	return NULL;
+}
+
+//
+//	Read the next 'len' bytes of the file. Returns how many, which is less
+//	than asked only at the end of the file, or -1 on error.
+//
+
+long uring_read (struct uring_reader *r, char *buf, unsigned long len) {
+
+	unsigned long done, off, n;
+	struct uring_slot *sl;
+	long span;
+
+	span = uring_span(r, buf, len);
+	if (span < 0) {
+		fprintf(stderr, "ERROR: cannot read file '%s'\n", r->file);
+		return -1;
+	}
+	done = span;
+
+	while (done < len && r->pos < r->len) {
+
+		if (uring_wait(r) < 0) {
+			fprintf(stderr, "ERROR: cannot read file '%s'\n", r->file);
+			return -1;
+		}
+
+		sl = &r->slots[(r->pos / URING_BLOCK) % URING_DEPTH];
+		off = r->pos % URING_BLOCK;
+		n = sl->len - off < len - done ? sl->len - off : len - done;
+		memcpy(buf + done, sl->buf + off, n);
+		done += n;
+		r->pos += n;
+	}
+
+	// Keep the disk busy while the caller works on this
+
+	if (uring_submit(r) < 0) {
+		fprintf(stderr, "ERROR: cannot read file '%s'\n", r->file);
+		return -1;
+	}
+
+	return done;
+}
+
+void uring_close (struct uring_reader *r) {
+
+	unsigned long b, done;
+	long res;
+	int i;
+
+	if (r == NULL) return;
+
+	// Reads in flight still target our buffers
+
+	if (r->ring >= 0)
+		for (b = r->pos / URING_BLOCK; b < r->next; b++)
+			while (r->slots[b % URING_DEPTH].len < 0) {
+				if (uring_reap(r, &done, &res) < 0) goto gone;
+				r->slots[done % URING_DEPTH].len = 0;
+			}
+gone:
+	uring_teardown(r);
+	for (i = 0; i < URING_DEPTH; i++) free(r->slots[i].buf);
+	if (r->plain >= 0) close(r->plain);
+	close(r->fd);
+	free(r);
+}
@@ -0,0 +1,616 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "usbtool.h"
+
+//==============================================================================
+//
+//	Offline analyzer for usbmon captures of CC1800 boot mode traffic, to see
+//	how other tools (the vendor unbricking tool in particular) drive the
+//	loader. Takes the usbmon text format (/sys/kernel/debug/usb/usbmon/<n>u)
+//	or classic pcap with Linux USB headers (tcpdump, Wireshark), and decodes
+//	the vendor requests and the bulk traffic on end point 1.
+//
+//	Everything happens in a single pass over the capture with bounded state,
+//	so captures of any size can be piped in.
+//
+//	Transfers are grouped in phases, one per SET_LENGTH request, and a line
+//	is printed for each as it completes. A gap is the time from the end of
+//	one URB to the start of the next one with nothing in flight, which is
+//	time lost on the host side.
+//
+
+#define MON_PENDING			64				// Outstanding URBs tracked
+#define MON_SIZES			16				// Distinct bulk URB sizes kept
+#define MON_TOP_GAPS		5
+#define MON_REQUESTS		5
+#define MON_DATA			32				// Captured payload bytes kept
+
+//
+//	A capture event, either format.
+//
+
+struct mon_ev {
+	unsigned long long id;
+	double t;
+	char type;						// 'S'ubmit, 'C'omplete, 'E'rror
+	char xfer;						// 'C'ontrol, 'B'ulk, 'I'nterrupt, 'Z' isochronous
+	int in;
+	int bus, dev, ep;
+	int setup;						// Setup packet valid
+	unsigned char pkt [8];
+	int status;
+	unsigned long len;				// Requested (S) or actual (C) length
+	int data_len;
+	unsigned char data [MON_DATA];
+};
+
+struct mon_urb {
+	unsigned long long id;
+	double t;
+	int req;						// Vendor request, or -1
+	int bulk;
+};
+
+struct mon_phase {
+	char kind;						// 'W'rite, 'R'ead, 'B'ulk without SET_LENGTH, 0 none
+	unsigned long addr, len;
+	double t0, t1;
+	unsigned long long bytes;
+	unsigned long urbs, min, max, ctl;
+	double gap_max, gap_sum;
+};
+
+struct mon_gap {
+	double t, gap;
+	char what [32];
+};
+
+struct mon {
+
+	int bus, dev;					// Device analyzed, dev 0 until locked
+	int fixed;						// Given by the user, do not relock
+
+	double t_first, t_last;
+	unsigned long long events, skipped, errors;
+
+	struct mon_urb pending [MON_PENDING];
+	int npending;
+	double idle_since;				// Negative while URBs are in flight
+
+	unsigned long addr;				// Sticky loader address
+	char cpu_info [9];
+	struct mon_phase phase;
+	unsigned long phases, execs;
+
+	struct {
+		unsigned long count;
+		double lat_sum, lat_max;
+	} req [MON_REQUESTS + 1];		// Last one for standard requests
+
+	struct {
+		unsigned long long bytes;
+		unsigned long urbs;
+		double lat_sum;
+		unsigned long size [MON_SIZES], size_count [MON_SIZES], other_sizes;
+	} bulk [2];						// OUT, IN
+
+	unsigned long gap_hist [7];
+	double gap_sum;
+	struct mon_gap top [MON_TOP_GAPS];
+};
+
+static const char *mon_req_names [MON_REQUESTS + 1] = {
+	"GET_CPU_INFO", "SET_ADDRESS", "SET_LENGTH", "GET_STATUS", "EXECUTE", "(standard)"
+};
+
+static const double mon_gap_limits [6] = { 10e-6, 100e-6, 1e-3, 10e-3, 100e-3, 1 };
+static const char *mon_gap_names [7] = { "< 10 us", "< 100 us", "< 1 ms", "< 10 ms", "< 100 ms", "< 1 s", ">= 1 s" };
+
+//==============================================================================
+//
+//	usbmon text format. Lines look like:
+//
+//		ffff88003b1c6e40 3575914555 S Ci:1:005:0 s c0 00 0000 0000 0008 8 <
+//		ffff88003b1c6e40 3575914560 C Ci:1:005:0 0 8 = 434e3230 30395631
+//		ffff88003b1c6a80 3575914601 S Bo:1:005:1 -115 131072 = 00000000 ...
+//
+//	The timestamp is in microseconds and wraps at 32 bits. The older format
+//	without the bus number in the address is also accepted.
+//
+
+struct mon_text {
+	FILE *f;
+	unsigned long last;
+	double base;
+	char line [1024];
+};
+
+static int mon_hex (const char *s, unsigned long *v) {
+	char *end;
+	*v = strtoul(s, &end, 16);
+	return *s != 0 && *end == 0 ? 0 : -1;
+}
+
+static int mon_nibble (int c) {
+	return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+static int mon_text_next (struct mon_text *mt, struct mon_ev *e) {
+
+	char *tok [64], *p, *save;
+	unsigned long v, ts;
+	int n, i, c;
+
+	for (;;) {
+
+		if (fgets(mt->line, sizeof(mt->line), mt->f) == NULL) return 0;
+
+		// Data is at most 32 bytes, so longer lines are not usbmon: skip them
+
+		if (strchr(mt->line, '\n') == NULL && !feof(mt->f)) {
+			while ((c = getc(mt->f)) != EOF && c != '\n');
+			continue;
+		}
+
+		for (n = 0, p = strtok_r(mt->line, " \t\r\n", &save); p != NULL && n < 64; p = strtok_r(NULL, " \t\r\n", &save))
+			tok[n++] = p;
+
+		if (n < 5 || strlen(tok[2]) != 1 || strlen(tok[3]) < 6 || tok[3][2] != ':') continue;
+
+		memset(e, 0, sizeof(*e));
+		e->id = strtoull(tok[0], NULL, 16);
+
+		ts = strtoul(tok[1], NULL, 10);
+		if (ts < mt->last && mt->last - ts > 0x80000000UL) mt->base += 4294.967296;
+		mt->last = ts;
+		e->t = mt->base + ts * 1e-6;
+
+		e->type = tok[2][0];
+		e->xfer = tok[3][0];
+		e->in = tok[3][1] == 'i';
+
+		// "Bo:1:005:1", or "Bo:005:1" in the old format
+
+		e->bus = strtol(tok[3] + 3, &p, 10);
+		if (*p++ != ':') continue;
+		e->dev = strtol(p, &p, 10);
+		if (*p == ':') e->ep = strtol(p + 1, &p, 10);
+		else { e->ep = e->dev; e->dev = e->bus; e->bus = 0; }
+
+		i = 4;
+		if (!strcmp(tok[i], "s")) {
+			if (n < 10) continue;
+			for (c = 0; c < 5; c++) if (mon_hex(tok[5 + c], &v) < 0) break;
+			if (c < 5) continue;
+			mon_hex(tok[5], &v); e->pkt[0] = v;
+			mon_hex(tok[6], &v); e->pkt[1] = v;
+			mon_hex(tok[7], &v); e->pkt[2] = v; e->pkt[3] = v >> 8;
+			mon_hex(tok[8], &v); e->pkt[4] = v; e->pkt[5] = v >> 8;
+			mon_hex(tok[9], &v); e->pkt[6] = v; e->pkt[7] = v >> 8;
+			e->setup = 1;
+			i = 10;
+		} else {
+			e->status = atoi(tok[i++]);	// Interrupt and iso add ":..." fields, atoi stops there
+		}
+
+		if (i < n) e->len = strtoul(tok[i++], NULL, 10);
+
+		if (i < n && !strcmp(tok[i], "=")) {
+			for (i++; i < n; i++) {
+				for (p = tok[i]; isxdigit(p[0]) && isxdigit(p[1]) && e->data_len < MON_DATA; p += 2)
+					e->data[e->data_len++] = (mon_nibble(p[0]) << 4) | mon_nibble(p[1]);
+			}
+		}
+
+		return 1;
+	}
+}
+
+//==============================================================================
+//
+//	pcap with LINKTYPE_USB_LINUX (189) or LINKTYPE_USB_LINUX_MMAPPED (220).
+//	The USB header is in the byte order of the capturing host, which is also
+//	the byte order of the file as far as Wireshark is concerned.
+//
+
+#define PCAP_MAGIC			0xA1B2C3D4
+#define PCAP_MAGIC_NS		0xA1B23C4D
+
+struct mon_pcap {
+	FILE *f;
+	int swap;
+	int ns;
+	int hdr;						// USB header size
+	unsigned char *buf;
+	unsigned long size;
+};
+
+static unsigned long mon_u32 (struct mon_pcap *mp, const unsigned char *p) {
+	if (mp->swap) return ((unsigned long)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static int mon_pcap_open (struct mon_pcap *mp) {
+
+	unsigned char h [24];
+	unsigned long magic, link;
+
+	if (fread(h, sizeof(h), 1, mp->f) != 1) {
+		fprintf(stderr, "ERROR: truncated pcap header\n");
+		return -1;
+	}
+
+	mp->swap = 0;
+	magic = mon_u32(mp, h);
+	if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS) mp->swap = 1;
+	magic = mon_u32(mp, h);
+	mp->ns = magic == PCAP_MAGIC_NS;
+
+	link = mon_u32(mp, h + 20) & 0xFFFF;
+	if (link == 189) mp->hdr = 48;
+	else if (link == 220) mp->hdr = 64;
+	else {
+		fprintf(stderr, "ERROR: not a Linux USB capture (pcap link type %lu)\n", link);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int mon_pcap_next (struct mon_pcap *mp, struct mon_ev *e) {
+
+	unsigned char h [16], *u;
+	unsigned long incl;
+	int i;
+
+	for (;;) {
+
+		if (fread(h, sizeof(h), 1, mp->f) != 1) return 0;
+
+		incl = mon_u32(mp, h + 8);
+		if (incl > mp->size) {
+			if (incl > (64 << 20)) {
+				fprintf(stderr, "ERROR: corrupt pcap record\n");
+				return -1;
+			}
+			free(mp->buf);
+			mp->size = incl;
+			mp->buf = (unsigned char *)malloc(incl);
+			if (mp->buf == NULL) {
+				fprintf(stderr, "ERROR: cannot allocate memory\n");
+				return -1;
+			}
+		}
+
+		if (fread(mp->buf, 1, incl, mp->f) != incl) return 0;
+		if (incl < (unsigned long)mp->hdr) continue;
+
+		u = mp->buf;
+		memset(e, 0, sizeof(*e));
+		e->id = mon_u32(mp, u + (mp->swap ? 4 : 0)) | ((unsigned long long)mon_u32(mp, u + (mp->swap ? 0 : 4)) << 32);
+		e->type = u[8];
+		e->xfer = "ZICB"[u[9] & 3];
+		e->in = !!(u[10] & 0x80);
+		e->ep = u[10] & 0x7F;
+		e->dev = u[11];
+		e->bus = mp->swap ? (u[12] << 8) | u[13] : u[12] | (u[13] << 8);
+		e->setup = u[14] == 0;
+		e->status = (int)mon_u32(mp, u + 28);
+		e->len = mon_u32(mp, u + 32);
+		memcpy(e->pkt, u + 40, 8);
+		if (mp->swap) {
+			for (i = 2; i < 8; i += 2) { unsigned char t = e->pkt[i]; e->pkt[i] = e->pkt[i + 1]; e->pkt[i + 1] = t; }
+		}
+
+		e->t = mon_u32(mp, h) + mon_u32(mp, h + 4) * (mp->ns ? 1e-9 : 1e-6);
+
+		if (u[15] == 0 && e->xfer != 'Z') {
+			e->data_len = incl - mp->hdr;
+			if (e->data_len > MON_DATA) e->data_len = MON_DATA;
+			memcpy(e->data, u + mp->hdr, e->data_len);
+		}
+
+		return 1;
+	}
+}
+
+//==============================================================================
+//
+//	Analysis
+//
+
+static void mon_phase_close (struct mon *m) {
+
+	struct mon_phase *p = &m->phase;
+	double d = p->t1 - p->t0;
+	char sizes [32], rate [16];
+
+	if (p->kind == 0) return;
+
+	if (p->urbs == 0) sizes[0] = 0;
+	else if (p->min == p->max) snprintf(sizes, sizeof(sizes), "%lu", p->min);
+	else snprintf(sizes, sizeof(sizes), "%lu..%lu", p->min, p->max);
+
+	if (d > 0 && p->bytes) snprintf(rate, sizeof(rate), "%.2f", p->bytes / d / 1e6);
+	else rate[0] = 0;
+
+	printf("%12.6f  %-5s 0x%08lX %10lu %10llu %6lu %15s %9s %8.3f %8.3f", p->t0 - m->t_first,
+		p->kind == 'W' ? "write" : p->kind == 'R' ? "read" : "bulk", p->addr, p->len, p->bytes, p->urbs,
+		sizes, rate, p->gap_sum * 1e3, p->gap_max * 1e3);
+	if (p->ctl) printf("  +%lu requests", p->ctl);
+	printf("\n");
+
+	m->phases++;
+	memset(p, 0, sizeof(*p));
+}
+
+static void mon_phase_open (struct mon *m, char kind, unsigned long len, double t) {
+	mon_phase_close(m);
+	m->phase.kind = kind;
+	m->phase.addr = m->addr;
+	m->phase.len = len;
+	m->phase.t0 = m->phase.t1 = t;
+}
+
+static void mon_gap (struct mon *m, const struct mon_ev *e, int req) {
+
+	double g = e->t - m->idle_since;
+	int i;
+
+	if (m->idle_since < 0 || g < 0) return;
+
+	for (i = 0; i < 6 && g >= mon_gap_limits[i]; i++);
+	m->gap_hist[i]++;
+	m->gap_sum += g;
+	m->phase.gap_sum += g;
+	if (g > m->phase.gap_max) m->phase.gap_max = g;
+
+	// Keep the largest ones, sorted
+
+	for (i = MON_TOP_GAPS; i > 0 && g > m->top[i - 1].gap; i--)
+		if (i < MON_TOP_GAPS) m->top[i] = m->top[i - 1];
+	if (i == MON_TOP_GAPS) return;
+
+	m->top[i].t = e->t;
+	m->top[i].gap = g;
+	if (req >= 0 && req < MON_REQUESTS) snprintf(m->top[i].what, sizeof(m->top[i].what), "before %s", mon_req_names[req]);
+	else if (req >= 0) snprintf(m->top[i].what, sizeof(m->top[i].what), "before standard request");
+	else snprintf(m->top[i].what, sizeof(m->top[i].what), "before bulk %s %lu", e->in ? "IN" : "OUT", e->len);
+}
+
+static void mon_size (struct mon *m, int dir, unsigned long len) {
+
+	int i;
+
+	for (i = 0; i < MON_SIZES && m->bulk[dir].size_count[i] && m->bulk[dir].size[i] != len; i++);
+	if (i == MON_SIZES) { m->bulk[dir].other_sizes++; return; }
+	m->bulk[dir].size[i] = len;
+	m->bulk[dir].size_count[i]++;
+}
+
+static void mon_event (struct mon *m, const struct mon_ev *e) {
+
+	struct mon_urb *u;
+	int req = -1, i;
+	unsigned long v;
+
+	if (m->events++ == 0) m->t_first = e->t;
+	m->t_last = e->t;
+
+	// Vendor requests 0 to 4 identify the device; a new GET_CPU_INFO moves
+	// the analysis to whichever device sent it (re-enumeration)
+
+	if (e->type == 'S' && e->xfer == 'C' && e->setup && (e->pkt[0] & 0x60) == 0x40 && e->pkt[1] < MON_REQUESTS) {
+		if (!m->fixed && (m->dev == 0 || (e->pkt[1] == 0 && (e->bus != m->bus || e->dev != m->dev)))) {
+			if (m->dev != 0) printf("Switching to device %d:%03d\n", e->bus, e->dev);
+			m->bus = e->bus;
+			m->dev = e->dev;
+		}
+	}
+
+	if (e->dev != m->dev || e->bus != m->bus || (e->xfer != 'C' && !(e->xfer == 'B' && e->ep == 1))) {
+		m->skipped++;
+		return;
+	}
+
+	if (e->type == 'S') {
+
+		if (e->xfer == 'C' && e->setup) req = (e->pkt[0] & 0x60) == 0x40 && e->pkt[1] < MON_REQUESTS ? e->pkt[1] : MON_REQUESTS;
+
+		mon_gap(m, e, req);
+		m->idle_since = -1;
+
+		if (m->npending == MON_PENDING) {
+			memmove(m->pending, m->pending + 1, sizeof(m->pending[0]) * --m->npending);
+		}
+		u = &m->pending[m->npending++];
+		u->id = e->id;
+		u->t = e->t;
+		u->req = req;
+		u->bulk = e->xfer == 'B';
+
+		v = ((unsigned long)e->pkt[3] << 24) | (e->pkt[2] << 16) | (e->pkt[5] << 8) | e->pkt[4];	// wValue:wIndex
+
+		switch (req) {
+		case 1:
+			m->addr = v;
+			break;
+		case 2:
+			mon_phase_open(m, v & 0x80000000 ? 'W' : 'R', v & 0x7FFFFFFF, e->t);
+			break;
+		case 4:
+			mon_phase_close(m);
+			printf("%12.6f  exec  0x%08lX\n", e->t - m->t_first, m->addr);
+			m->execs++;
+			break;
+		default:
+			if (req >= 0 && m->phase.kind) m->phase.ctl++;
+			break;
+		}
+
+		if (u->bulk && m->phase.kind == 0) mon_phase_open(m, 'B', 0, e->t);
+		return;
+	}
+
+	// Completion: match it to its submission
+
+	for (i = m->npending - 1; i >= 0 && m->pending[i].id != e->id; i--);
+	if (i < 0) return;
+	u = &m->pending[i];
+
+	if (e->status != 0) m->errors++;
+
+	if (u->req >= 0) {
+		m->req[u->req].count++;
+		m->req[u->req].lat_sum += e->t - u->t;
+		if (e->t - u->t > m->req[u->req].lat_max) m->req[u->req].lat_max = e->t - u->t;
+		if (u->req == 0 && e->data_len >= 8 && m->cpu_info[0] == 0) {
+			for (v = 0; v < 8; v++) m->cpu_info[v] = isprint(e->data[v]) ? e->data[v] : '.';
+		}
+	}
+
+	if (u->bulk) {
+		m->bulk[e->in].urbs++;
+		m->bulk[e->in].bytes += e->len;
+		m->bulk[e->in].lat_sum += e->t - u->t;
+		mon_size(m, e->in, e->len);
+
+		if (m->phase.urbs == 0 || e->len < m->phase.min) m->phase.min = e->len;
+		if (e->len > m->phase.max) m->phase.max = e->len;
+		m->phase.urbs++;
+		m->phase.bytes += e->len;
+	}
+
+	if (m->phase.kind) m->phase.t1 = e->t;
+
+	memmove(u, u + 1, sizeof(*u) * (m->npending - i - 1));
+	if (--m->npending == 0) m->idle_since = e->t;
+}
+
+static void mon_summary (struct mon *m) {
+
+	static const char *dirs [2] = { "OUT", "IN" };
+	double span = m->t_last - m->t_first;
+	int i, d;
+
+	mon_phase_close(m);
+
+	printf("\nCapture: %llu events over %.3f s, %llu skipped (other devices and end points)\n", m->events, span, m->skipped);
+	if (m->dev == 0) {
+		printf("No CC1800 vendor requests found\n");
+		return;
+	}
+
+	printf("Device %d:%03d", m->bus, m->dev);
+	if (m->cpu_info[0]) printf(", CPU info '%s'", m->cpu_info);
+	printf(", %lu phases, %lu executes, %llu URB errors\n", m->phases, m->execs, m->errors);
+
+	printf("\n%-14s %10s %12s %12s\n", "request", "count", "avg latency", "max latency");
+	for (i = 0; i <= MON_REQUESTS; i++) {
+		if (m->req[i].count == 0) continue;
+		printf("%-14s %10lu %9.1f us %9.1f us\n", mon_req_names[i], m->req[i].count,
+			m->req[i].lat_sum / m->req[i].count * 1e6, m->req[i].lat_max * 1e6);
+	}
+
+	for (d = 0; d < 2; d++) {
+		if (m->bulk[d].urbs == 0) continue;
+		printf("\nBulk %s: %llu bytes in %lu URBs, avg latency %.1f us, sizes:", dirs[d], m->bulk[d].bytes,
+			m->bulk[d].urbs, m->bulk[d].lat_sum / m->bulk[d].urbs * 1e6);
+		for (i = 0; i < MON_SIZES && m->bulk[d].size_count[i]; i++)
+			printf(" %lux%lu", m->bulk[d].size_count[i], m->bulk[d].size[i]);
+		if (m->bulk[d].other_sizes) printf(" (%lu of other sizes)", m->bulk[d].other_sizes);
+		printf("\n");
+	}
+
+	printf("\nHost gaps: %.3f s total (%.1f%% of the capture)\n", m->gap_sum, span > 0 ? m->gap_sum / span * 100 : 0);
+	for (i = 0; i < 7; i++)
+		if (m->gap_hist[i]) printf("  %-9s %10lu\n", mon_gap_names[i], m->gap_hist[i]);
+	for (i = 0; i < MON_TOP_GAPS && m->top[i].gap > 0; i++)
+		printf("  %10.3f ms at %.6f, %s\n", m->top[i].gap * 1e3, m->top[i].t - m->t_first, m->top[i].what);
+}
+
+//
+//	ANALYZE command, usage: analyze <capture> [dev=<bus>:<dev>]
+//	Runs without a device. The capture may be "-" for stdin.
+//
+
+int cc1800_analyze (int argc, const char **argv) {
+
+	struct mon *m;
+	struct mon_ev e;
+	struct mon_text mt;
+	struct mon_pcap mp;
+	FILE *f;
+	int i, c, r = 0;
+
+	if (argc < 1) {
+		fprintf(stderr, "ERROR: analyze needs a capture file\n");
+		return -1;
+	}
+
+	m = (struct mon *)calloc(1, sizeof(*m));
+	if (m == NULL) {
+		fprintf(stderr, "ERROR: cannot allocate memory\n");
+		return -1;
+	}
+	m->idle_since = -1;
+
+	for (i = 1; i < argc; i++) {
+		if (!strncmp(argv[i], "dev=", 4) && sscanf(argv[i] + 4, "%d:%d", &m->bus, &m->dev) == 2) m->fixed = 1;
+		else {
+			fprintf(stderr, "ERROR: bad option '%s'\n", argv[i]);
+			free(m);
+			return -1;
+		}
+	}
+
+	f = strcmp(argv[0], "-") ? fopen(argv[0], "rb") : stdin;
+	if (f == NULL) {
+		fprintf(stderr, "ERROR: cannot open file '%s'\n", argv[0]);
+		free(m);
+		return -1;
+	}
+
+	// Text lines start with a hex URB tag, pcap with its magic
+
+	c = getc(f);
+	ungetc(c, f);
+
+	printf("%12s  %-5s %-10s %10s %10s %6s %15s %9s %8s %8s\n", "time (s)", "phase", "address", "length",
+		"moved", "URBs", "URB sizes", "MB/s", "gaps ms", "max ms");
+
+	if (c == 0xD4 || c == 0xA1 || c == 0x4D) {
+		memset(&mp, 0, sizeof(mp));
+		mp.f = f;
+		r = mon_pcap_open(&mp);
+		while (r >= 0 && (r = mon_pcap_next(&mp, &e)) > 0) mon_event(m, &e);
+		free(mp.buf);
+	} else if (c == 0x0A) {
+		fprintf(stderr, "ERROR: pcapng is not supported, convert with: editcap -F pcap <in> <out>\n");
+		r = -1;
+	} else {
+		memset(&mt, 0, sizeof(mt));
+		mt.f = f;
+		while ((r = mon_text_next(&mt, &e)) > 0) mon_event(m, &e);
+	}
+
+	if (r >= 0) mon_summary(m);
+
+	if (f != stdin) fclose(f);
+	free(m);
+	return r < 0 ? -1 : 0;
+}
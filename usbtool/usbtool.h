@@ -0,0 +1,378 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#ifndef USBTOOL_H
+#define USBTOOL_H
+
+#include <usb.h>
+
+//==============================================================================
+//
+//	Session state. A session lives for as long as the device stays claimed,
+//	which is a single command line in batch mode and the whole shell lifetime
+//	in interactive mode.
+//
+
+struct file_cache;
+struct mem_cache;
+struct cc1800_soc;
+
+struct cc1800_session {
+	struct usb_dev_handle *handle;
+	char cpu_info [9];				// CPU info string, valid once cpu_shown is set
+	int cpu_shown;
+	int interactive;				// Set while running the interactive shell
+	struct file_cache *files;		// Loaded files, NULL when caching is disabled
+	struct mem_cache *mem;			// Target memory contents, NULL when disabled
+	const struct cc1800_soc *soc;	// Memory map, looked up on first use
+	int unchecked;					// Memory map checks disabled
+	unsigned long addr;				// Loader address for exec, valid if addr_known
+	int addr_known;
+};
+
+//==============================================================================
+//
+//	CC1800 USB boot mode requests (main.c)
+//
+
+struct usb_device *cc1800_find (void);
+struct usb_dev_handle *cc1800_open (struct usb_device *dev);
+void cc1800_close (struct usb_dev_handle *handle);
+
+int cc1800_req_get_cpu_info (struct usb_dev_handle *handle, char *str);
+int cc1800_req_set_address (struct usb_dev_handle *handle, unsigned long addr);
+int cc1800_req_set_length (struct usb_dev_handle *handle, unsigned long len, int wr);
+int cc1800_req_get_status (struct usb_dev_handle *handle, char *stat);
+int cc1800_req_execute (struct usb_dev_handle *handle);
+
+int cc1800_upload (struct usb_dev_handle *handle, const char *data, int length, unsigned long address);
+int cc1800_download (struct usb_dev_handle *handle, char *data, int length, unsigned long address);
+int cc1800_execute (struct usb_dev_handle *handle, const char *data, int length, unsigned long address);
+
+int cc1800_fiddle (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Argument parsing, time and file helpers (main.c)
+//
+
+int scan_ulong (const char *str, unsigned long *addr);
+int scan_size (const char *str, double *v);
+double time_now (void);
+int load_file (const char *file, char **data, unsigned long *len);
+int save_file (const char *file, const char *data, unsigned long len);
+
+//==============================================================================
+//
+//	Per-device request queue (queue.c). Every request function above holds
+//	the device while it runs; wrap a longer sequence in enter/leave to make
+//	it atomic too.
+//
+
+int cc1800_queue_enter (struct usb_dev_handle *handle);
+void cc1800_queue_leave (struct usb_dev_handle *handle);
+void cc1800_queue_close (struct usb_dev_handle *handle);
+
+//==============================================================================
+//
+//	Bandwidth shaping (shape.c)
+//
+
+void shape_transfer (struct usb_dev_handle *handle, unsigned long len);
+void shape_close (struct usb_dev_handle *handle);
+int cc1800_shape (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Host memory budget (budget.c)
+//
+
+unsigned long budget_get (void);
+int budget_fits (unsigned long len);
+unsigned long budget_count (unsigned long unit, unsigned long want, unsigned long least);
+void budget_command (const char *name);
+int cc1800_budget (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Read ahead file reader (uring.c)
+//
+
+struct uring_reader;
+
+struct uring_reader *uring_open (const char *file, unsigned long *len);
+long uring_read (struct uring_reader *r, char *buf, unsigned long len);
+void uring_close (struct uring_reader *r);
+
+//==============================================================================
+//
+//	Host side caches (cache.c)
+//
+
+struct file_cache *file_cache_new (void);
+void file_cache_free (struct file_cache *fc);
+int file_cache_load (struct file_cache *fc, const char *file, const char **data, unsigned long *len);
+void file_cache_list (struct file_cache *fc);
+
+struct mem_cache *mem_cache_new (void);
+void mem_cache_free (struct mem_cache *mc);
+void mem_cache_store (struct mem_cache *mc, unsigned long addr, const char *data, unsigned long len);
+int mem_cache_fetch (struct mem_cache *mc, unsigned long addr, char *data, unsigned long len);
+void mem_cache_invalidate (struct mem_cache *mc);
+void mem_cache_stats (struct mem_cache *mc);
+
+//==============================================================================
+//
+//	SoC memory maps (memmap.c)
+//
+
+#define MEM_READ			0x01
+#define MEM_WRITE			0x02
+#define MEM_EXEC			0x04
+#define MEM_VERIFY			0x08			// Read writes back and compare
+
+struct cc1800_region {
+	const char *name;
+	unsigned long base, size;
+	int flags;
+	unsigned long chunk;			// Largest bulk transfer, 0 for no limit
+};
+
+struct cc1800_soc {
+	const char *name;
+	const char *cpu_info;			// Loader CPU info prefix
+	const struct cc1800_region *regions;
+};
+
+const struct cc1800_soc *memmap_soc (struct cc1800_session *s);
+const struct cc1800_region *memmap_check (struct cc1800_session *s, unsigned long addr, unsigned long len, int access);
+int memmap_upload (struct cc1800_session *s, const struct cc1800_region *reg, const char *data, unsigned long len, unsigned long addr);
+int memmap_download (struct cc1800_session *s, const struct cc1800_region *reg, char *data, unsigned long len, unsigned long addr);
+int cc1800_memmap (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Loader transfer profiles (probe.c). The request functions report what
+//	they do with the device held, so that redundant SET_ADDRESS requests
+//	can be left out.
+//
+
+int probe_at (struct usb_dev_handle *handle, unsigned long addr);
+void probe_address (struct usb_dev_handle *handle, unsigned long addr);
+void probe_moved (struct usb_dev_handle *handle, unsigned long len, int wr);
+void probe_forget (struct usb_dev_handle *handle);
+void probe_running (struct usb_dev_handle *handle, int running);
+unsigned long probe_window (struct usb_dev_handle *handle, const struct cc1800_region *reg, int wr);
+void probe_attach (struct cc1800_session *s);
+void probe_close (struct usb_dev_handle *handle);
+int cc1800_probe (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Streaming transform pipeline (pipeline.c)
+//
+
+#define CC1800_MAX_STAGES	16
+
+typedef int (*pipeline_read_t) (void *priv, char *buf, unsigned long len);
+
+void pipeline_help (void);
+int pipeline_upload (struct cc1800_session *s, unsigned long addr, const char *file,
+	const char *data, unsigned long len, int nstages, const char **stages);
+int pipeline_upload_source (struct cc1800_session *s, unsigned long addr, pipeline_read_t read, void *priv,
+	int nstages, const char **stages, FILE *save);
+int pipeline_download (struct cc1800_session *s, unsigned long addr, unsigned long len,
+	const char *file, int nstages, const char **stages);
+
+//==============================================================================
+//
+//	Hex dump rendering (hex.c)
+//
+
+#define HEX_LINE	79			// Bytes in a full line of output
+
+struct hex_view {
+	unsigned long addr;			// Address of the next line
+	int squeeze, skipping, started, simd;
+	unsigned char prev [16];	// Last line shown
+};
+
+void hex_init (struct hex_view *h, unsigned long addr, int squeeze);
+unsigned long hex_render (struct hex_view *h, char *out, const char *data, unsigned long len);
+unsigned long hex_finish (struct hex_view *h, char *out, const char *data, unsigned long len);
+
+//==============================================================================
+//
+//	Initramfs archives (cpio.c)
+//
+
+int cpio_upload (struct cc1800_session *s, unsigned long addr, const char *dir, int nstages, const char **stages);
+
+//==============================================================================
+//
+//	Target stubs (stub.c). These rely on the SD loaded USB loader internals:
+//	where its variables and bulk transfer routines are, and that uploaded
+//	code returning to it brings it back to its main loop.
+//
+
+#define CC1800_LOADER_CPU_INFO		"CN2009V1"
+#define CC1800_LOADER_INFO_ADDR		0x00102AD4		// CPU info string, doubles as stub mailbox
+#define CC1800_LOADER_STATE_ADDR	0x00102B84		// Main loop state word
+#define CC1800_LOADER_DOWNLOAD		0x00102944		// Bulk OUT routine
+#define CC1800_LOADER_READBACK		0x001029FC		// Bulk IN routine
+#define CC1800_LOADER_IMAGE			0x00102000		// Loader code and data
+#define CC1800_LOADER_IMAGE_SIZE	0x00000B80
+
+#define CC1800_STUB_BASE			0x00101000		// Default stub address, in free SRAM
+#define CC1800_SDRAM_BASE			0x40000000		// Default stub buffers
+
+#define STUB_PARAM_STATUS			0x10
+#define STUB_PARAM_STATE			0x14
+#define STUB_PARAM_DOWNLOAD			0x18
+#define STUB_PARAM_READBACK			0x1C
+#define STUB_PARAM_OP				0x20
+#define STUB_PARAM_ARGS				0x24
+#define STUB_PARAM_RESULT			0x54
+#define STUB_PARAM_RX				0x58
+#define STUB_PARAM_PROGRESS			0x5C
+#define STUB_PARAM_END				0x60
+
+#define STUB_ARG(n)					(STUB_PARAM_ARGS + 4 * (n))
+
+struct cc1800_stub {
+	unsigned char *image;
+	unsigned long size;
+	unsigned long base;
+	int running;
+};
+
+int stub_init (struct cc1800_session *s, struct cc1800_stub *stub, const unsigned char *code, unsigned long size, unsigned long base);
+void stub_free (struct cc1800_stub *stub);
+void stub_set (struct cc1800_stub *stub, int offset, unsigned long value);
+unsigned long stub_get (struct cc1800_stub *stub, int offset);
+int stub_start (struct cc1800_session *s, struct cc1800_stub *stub);
+int stub_poll (struct cc1800_session *s, struct cc1800_stub *stub, unsigned long *value);
+int stub_wait (struct cc1800_session *s, struct cc1800_stub *stub, unsigned long progress, unsigned long *value);
+int stub_run (struct cc1800_session *s, struct cc1800_stub *stub, unsigned long *result);
+
+//==============================================================================
+//
+//	SPI NOR flash programming (norflash.c)
+//
+
+int cc1800_norflash (struct cc1800_session *s, int argc, const char **argv);
+void norflash_hash (const unsigned char *p, unsigned long len, unsigned char *out);
+
+//==============================================================================
+//
+//	Stack and heap high-water marks (watermark.c)
+//
+
+int cc1800_watermark (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Resident monitor (monitor.c)
+//
+
+#define MONITOR_HOLD		0x01			// Keep the payload in its poll call
+#define MONITOR_FLUSH		0x02			// Clean and invalidate the caches
+
+unsigned monitor_run (struct cc1800_session *s);
+int monitor_control (struct cc1800_session *s, unsigned long ctrl);
+int cc1800_monitor (struct cc1800_session *s, int argc, const char **argv);
+int cc1800_run (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Compressed readback (lz4.c)
+//
+
+struct lz4_opts {
+	int on;
+	unsigned long block;			// Compressed separately, fall back to raw
+	unsigned long buf, size;		// Target staging buffer
+	unsigned long stub;
+};
+
+void lz4_defaults (struct lz4_opts *o);
+int lz4_option (struct lz4_opts *o, const char *arg);
+int lz4_download (struct cc1800_session *s, char *buf, unsigned long len, unsigned long addr, const struct lz4_opts *o);
+
+//==============================================================================
+//
+//	Hot patching (patch.c)
+//
+
+int patch_symbolize (struct cc1800_session *s, const char *file, const unsigned long *addr, int n, char **names, unsigned run);
+int cc1800_patch (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Coverage counter collection (coverage.c)
+//
+
+int cc1800_coverage (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Benchmarks (bench.c)
+//
+
+int cc1800_bench (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	Target memory mounted as files (mount.c)
+//
+
+int cc1800_mount (struct cc1800_session *s, int argc, const char **argv);
+
+//==============================================================================
+//
+//	usbmon capture analyzer (usbmon.c)
+//
+
+int cc1800_analyze (int argc, const char **argv);
+
+//==============================================================================
+//
+//	Deduplicating dump store (store.c)
+//
+
+int store_put (const char *dir, const char *board, const char *cpu, unsigned long addr, const char *data, unsigned long len);
+int cc1800_store (int argc, const char **argv);
+
+//==============================================================================
+//
+//	Flashing station capacity planner (plan.c)
+//
+
+int cc1800_plan (int argc, const char **argv);
+
+//==============================================================================
+//
+//	Production station loop (station.c)
+//
+
+int cc1800_station (int argc, const char **argv);
+
+//==============================================================================
+//
+//	Interactive shell (shell.c)
+//
+
+#define SHELL_MAX_ARGS		64
+
+int shell_split (char *line, const char **argv);
+int cc1800_shell (struct cc1800_session *s);
+
+#endif
@@ -0,0 +1,208 @@
+//==============================================================================
+//
+//	USB boot tool for ChinaChip CC1800 system-on-chip.
+//
+//	Copyright (C) 2011 Ignacio Garcia Perez <iggarpe@gmail.com>
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as
+//	published by the Free Software Foundation.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "usbtool.h"
+#include "stubs/watermark.h"
+
+//==============================================================================
+//
+//	Stack and heap high-water marks of a payload. A stub running on the
+//	target fills the regions with a pattern, calls the payload, and once it
+//	returns finds how much of each region was written to, so that nothing
+//	but the payload and the stub goes over USB, and the results come back
+//	in a single small transfer.
+//
+//	The payload must return to its caller like any code run with exec. A
+//	region whose name starts with "stack" grows down, any other grows up.
+//
+
+#define WM_OP_RUN			1
+
+#define WM_ARG_ENTRY		0
+#define WM_ARG_PATTERN		1
+#define WM_ARG_COUNT		2
+
+#define WM_MAX_REGIONS		8
+#define WM_REGION_SIZE		16			// Start, end, flags, used
+#define WM_TABLE			(sizeof(watermark_stub) - WM_MAX_REGIONS * WM_REGION_SIZE)
+
+struct wm_region {
+	char name [32];
+	unsigned long start, size;
+	int down;
+};
+
+static unsigned long wm_word (const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static int wm_overlap (unsigned long a, unsigned long alen, unsigned long b, unsigned long blen) {
+	return a < b + blen && b < a + alen;
+}
+
+//
+//	Parse <name>=<start>:<size>
+//
+
+static int wm_region (const char *arg, struct wm_region *reg) {
+
+	const char *v = strchr(arg, '=') + 1;
+	char *end;
+
+	if (v - arg - 1 >= (int)sizeof(reg->name)) {
+		fprintf(stderr, "ERROR: region name too long in '%s'\n", arg);
+		return -1;
+	}
+
+	memcpy(reg->name, arg, v - arg - 1);
+	reg->name[v - arg - 1] = 0;
+	reg->down = !strncmp(reg->name, "stack", 5);
+
+	reg->start = strtoul(v, &end, 0);
+	if (end == v || *end != ':') goto bad;
+	v = end + 1;
+	reg->size = strtoul(v, &end, 0);
+	if (end == v || *end != 0) goto bad;
+
+	if ((reg->start | reg->size) & 3 || reg->size == 0) {
+		fprintf(stderr, "ERROR: region '%s' must be word aligned and not empty\n", reg->name);
+		return -1;
+	}
+
+	return 0;
+
+bad:
+	fprintf(stderr, "ERROR: <name>=<start>:<size> expected instead of '%s'\n", arg);
+	return -1;
+}
+
+//
+//	WATERMARK command, usage: watermark <addr> <file> <name>=<start>:<size>...
+//	[pattern=<word>] [stub=<address>]. Returns the number of arguments used.
+//
+
+int cc1800_watermark (struct cc1800_session *s, int argc, const char **argv) {
+
+	struct wm_region regs [WM_MAX_REGIONS];
+	struct cc1800_stub stub;
+	const struct cc1800_region *reg;
+	unsigned long addr, len, base = CC1800_STUB_BASE, pattern = 0xDEADBEEF, result, used;
+	unsigned char table [WM_MAX_REGIONS * WM_REGION_SIZE];
+	const char *data; char *buf = NULL;
+	int n, r, i, nregs = 0;
+	double t;
+
+	if (argc < 3) {
+		fprintf(stderr, "ERROR: watermark command requires an address, a file name and at least one region\n");
+		return -1;
+	}
+
+	r = scan_ulong(argv[0], &addr); if (r < 0) return r;
+
+	for (n = 2; n < argc && strchr(argv[n], '=') != NULL; n++) {
+		if (!strncmp(argv[n], "pattern=", 8)) r = scan_ulong(argv[n] + 8, &pattern);
+		else if (!strncmp(argv[n], "stub=", 5)) r = scan_ulong(argv[n] + 5, &base);
+		else if (nregs == WM_MAX_REGIONS) {
+			fprintf(stderr, "ERROR: at most %d regions\n", WM_MAX_REGIONS);
+			r = -1;
+		}
+		else r = wm_region(argv[n], &regs[nregs++]);
+		if (r < 0) return r;
+	}
+
+	if (nregs == 0) {
+		fprintf(stderr, "ERROR: no regions given\n");
+		return -1;
+	}
+
+	if (s->files != NULL) r = file_cache_load(s->files, argv[1], &data, &len);
+	else { r = load_file(argv[1], &buf, &len); data = buf; }
+	if (r < 0) return r;
+
+	// Neither the payload nor the stub may be filled over
+
+	reg = memmap_check(s, addr, len, MEM_WRITE);
+	if (reg == NULL || memmap_check(s, addr, 4, MEM_EXEC) == NULL ||
+		memmap_check(s, base, sizeof(watermark_stub), MEM_WRITE | MEM_EXEC) == NULL)
+	{
+		free(buf);
+		return -1;
+	}
+
+	for (i = 0; i < nregs; i++) {
+		if (memmap_check(s, regs[i].start, regs[i].size, MEM_WRITE) == NULL) { free(buf); return -1; }
+		if (wm_overlap(regs[i].start, regs[i].size, addr, len) || wm_overlap(regs[i].start, regs[i].size, base, sizeof(watermark_stub))) {
+			fprintf(stderr, "ERROR: region '%s' overlaps the payload or the stub\n", regs[i].name);
+			free(buf);
+			return -1;
+		}
+	}
+
+	r = stub_init(s, &stub, watermark_stub, sizeof(watermark_stub), base);
+	if (r < 0) { free(buf); return r; }
+
+	stub_set(&stub, STUB_PARAM_OP, WM_OP_RUN);
+	stub_set(&stub, STUB_ARG(WM_ARG_ENTRY), addr);
+	stub_set(&stub, STUB_ARG(WM_ARG_PATTERN), pattern);
+	stub_set(&stub, STUB_ARG(WM_ARG_COUNT), nregs);
+
+	for (i = 0; i < nregs; i++) {
+		stub_set(&stub, WM_TABLE + i * WM_REGION_SIZE + 0, regs[i].start);
+		stub_set(&stub, WM_TABLE + i * WM_REGION_SIZE + 4, regs[i].start + regs[i].size);
+		stub_set(&stub, WM_TABLE + i * WM_REGION_SIZE + 8, regs[i].down);
+	}
+
+	// Payload and stub both write memory behind the cache's back
+
+	if (s->mem != NULL) mem_cache_invalidate(s->mem);
+
+	printf("Uploading payload to address 0x%08lX\n", addr);
+	r = memmap_upload(s, reg, data, len, addr);
+	if (r < 0) goto done;
+
+	r = stub_start(s, &stub);
+	if (r < 0) goto done;
+
+	r = stub_wait(s, &stub, 1, &result);
+	if (r < 0) goto done;
+	printf("Running payload\n");
+	t = time_now();
+
+	if (r == 0) r = stub_wait(s, &stub, ~0UL, &result);
+	if (r < 0) goto done;
+
+	r = cc1800_download(s->handle, (char *)table, nregs * WM_REGION_SIZE, base + WM_TABLE);
+	if (r < 0) {
+		fprintf(stderr, "ERROR: cannot read back high-water marks\n");
+		goto done;
+	}
+
+	printf("Payload returned 0x%08lX after %.3f s\n", result, time_now() - t);
+	printf("%-16s %10s %10s %10s %6s %10s\n", "region", "start", "size", "used", "", "free");
+
+	for (i = 0; i < nregs; i++) {
+		used = wm_word(table + i * WM_REGION_SIZE + 12);
+		printf("%-16s 0x%08lX %10lu %10lu %5.1f%% %10lu%s\n", regs[i].name, regs[i].start, regs[i].size,
+			used, 100.0 * used / regs[i].size, regs[i].size - used,
+			used == regs[i].size ? "  overflowed?" : "");
+	}
+
+	r = 0;
+
+done:
+	stub_free(&stub);
+	free(buf);
+	return r < 0 ? r : n;
+}